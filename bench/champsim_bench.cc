@@ -0,0 +1,491 @@
+// simulator throughput benchmark on synthetic traces (make bench)
+// generates one deterministic trace per access pattern, runs a ChampSim binary built with the
+// multi L1D/L2C prefetchers once per prefetcher and pattern, and reports simulated instructions
+// per wall-clock second (KIPS), host CPU time and peak RSS of each run
+//
+// usage: champsim_bench --binary=<champsim> [--out=<dir>] [--config_dir=<dir>]
+//                       [--warmup=<instructions>] [--instructions=<instructions>] [--density=<percent>]
+//                       [--patterns=<p1,p2,...>] [--l2c=<name[:config],...>] [--l1d=<name[:config],...>]
+// an empty --l2c= or --l1d= skips that level; results also go to <out>/bench.csv
+// a binary built with make profile=1 also reports where its host time went: the components with the
+// largest share are listed under each run, and all of them go to <out>/profile.csv
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <zlib.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "instruction.h"
+
+using namespace std;
+
+#define BENCH_BLOCK 64
+#define BENCH_PAGE 4096
+// components listed under each run of a profiling build
+#define BENCH_PROFILE_TOP 6
+
+// registers the generators use, clear of the stack pointer (6), flags (25) and instruction pointer (26)
+#define REG_INDEX 1
+#define REG_BASE 2
+#define REG_VALUE 3
+#define REG_SUM 4
+#define REG_NODE 5
+#define REG_COUNT 7
+
+// instructions of the simulated program, gzip-compressed as ChampSim reads them
+class TRACE_WRITER {
+  public:
+    TRACE_WRITER(const string &v1, uint64_t v2) : written(0), limit(v2) {
+        file = gzopen(v1.c_str(), "wb1");
+        if (file == NULL) {
+            cerr << "*** CANNOT WRITE TRACE FILE: " << v1 << " ***" << endl;
+            exit(1);
+        }
+    };
+    ~TRACE_WRITER() { gzclose(file); };
+
+    bool done() { return written >= limit; }
+
+    void load(uint64_t ip, uint64_t addr, uint8_t dst, uint8_t src) {
+        input_instr instr;
+        instr.ip = ip;
+        instr.source_memory[0] = addr;
+        instr.source_registers[0] = src;
+        instr.destination_registers[0] = dst;
+        write(instr);
+    }
+    void store(uint64_t ip, uint64_t addr, uint8_t src, uint8_t base) {
+        input_instr instr;
+        instr.ip = ip;
+        instr.destination_memory[0] = addr;
+        instr.source_registers[0] = src;
+        instr.source_registers[1] = base;
+        write(instr);
+    }
+    void alu(uint64_t ip, uint8_t dst, uint8_t src1, uint8_t src2) {
+        input_instr instr;
+        instr.ip = ip;
+        instr.destination_registers[0] = dst;
+        instr.source_registers[0] = src1;
+        instr.source_registers[1] = src2;
+        write(instr);
+    }
+    void branch(uint64_t ip, bool taken) {
+        input_instr instr;
+        instr.ip = ip;
+        instr.is_branch = 1;
+        instr.branch_taken = taken;
+        instr.source_registers[0] = REG_COUNT;
+        write(instr);
+    }
+
+  private:
+    gzFile file;
+    uint64_t written, limit;
+
+    void write(input_instr &instr) {
+        gzwrite(file, &instr, sizeof(instr));
+        written++;
+    }
+};
+
+// every data structure of a pattern lives in its own 64GB slice of the address space
+static uint64_t region_base(uint32_t v1) { return 0x100000000000ULL + ((uint64_t)v1 << 36); }
+
+// a[i] = b[i] + c[i] over 64MB arrays
+static void gen_stream(TRACE_WRITER &out, uint32_t density, mt19937_64 &rng)
+{
+    const uint64_t elements = (64ULL << 20) / 8, ip = 0x400000;
+    for (uint64_t i = 0; !out.done(); i = (i + 1) % elements) {
+        out.load(ip, region_base(1) + 8 * i, REG_VALUE, REG_INDEX);
+        out.load(ip + 4, region_base(2) + 8 * i, REG_SUM, REG_INDEX);
+        out.alu(ip + 8, REG_VALUE, REG_VALUE, REG_SUM);
+        out.store(ip + 12, region_base(0) + 8 * i, REG_VALUE, REG_INDEX);
+        out.alu(ip + 16, REG_INDEX, REG_INDEX, 0);
+        out.branch(ip + 20, true);
+    }
+}
+
+// eight loads per iteration, each with its own constant stride of 1 to 8 blocks plus an offset
+static void gen_stride(TRACE_WRITER &out, uint32_t density, mt19937_64 &rng)
+{
+    const uint64_t ip = 0x410000, span = 256ULL << 20;
+    uint64_t stride[8];
+    for (uint32_t j = 0; j < 8; j++)
+        stride[j] = (j + 1) * BENCH_BLOCK + 8 * (rng() % 8);
+    for (uint64_t i = 0; !out.done(); i++) {
+        for (uint32_t j = 0; j < 8; j++) {
+            out.load(ip + 8 * j, region_base(j) + (i * stride[j]) % span, REG_VALUE, REG_INDEX);
+            out.alu(ip + 8 * j + 4, REG_SUM, REG_SUM, REG_VALUE);
+        }
+        out.alu(ip + 64, REG_INDEX, REG_INDEX, 0);
+        out.branch(ip + 68, true);
+    }
+}
+
+// walks a linked list of 512K one-block nodes laid out as a random cycle, every load waits for the previous one
+static void gen_pointer_chase(TRACE_WRITER &out, uint32_t density, mt19937_64 &rng)
+{
+    const uint32_t nodes = 512 * 1024;
+    const uint64_t ip = 0x420000;
+    vector<uint32_t> next(nodes);
+    for (uint32_t i = 0; i < nodes; i++)
+        next[i] = i;
+    // Sattolo's shuffle makes a single cycle through all nodes
+    for (uint32_t i = nodes - 1; i > 0; i--)
+        swap(next[i], next[rng() % i]);
+
+    for (uint32_t node = 0; !out.done(); node = next[node]) {
+        uint64_t addr = region_base(0) + (uint64_t)node * BENCH_BLOCK;
+        out.load(ip, addr, REG_NODE, REG_NODE);
+        out.load(ip + 4, addr + 8, REG_VALUE, REG_NODE);
+        out.alu(ip + 8, REG_SUM, REG_SUM, REG_VALUE);
+        out.branch(ip + 12, true);
+    }
+}
+
+// 16 code paths, each touching a fixed footprint of density percent of the blocks of a 4KB region,
+// on regions drawn at random from 1GB; one load PC per block of the footprint
+static void gen_spatial(TRACE_WRITER &out, uint32_t density, mt19937_64 &rng)
+{
+    const uint32_t paths = 16, blocks = BENCH_PAGE / BENCH_BLOCK;
+    const uint64_t regions = (1ULL << 30) / BENCH_PAGE, ip = 0x430000;
+    vector<vector<uint32_t> > footprint(paths);
+    for (uint32_t p = 0; p < paths; p++) {
+        for (uint32_t b = 0; b < blocks; b++) {
+            if (rng() % 100 < density)
+                footprint[p].push_back(b);
+        }
+        if (footprint[p].empty())
+            footprint[p].push_back(rng() % blocks);
+        shuffle(footprint[p].begin(), footprint[p].end(), rng);
+    }
+
+    while (!out.done()) {
+        uint32_t p = rng() % paths;
+        uint64_t region = region_base(0) + (rng() % regions) * BENCH_PAGE;
+        uint64_t path_ip = ip + p * 0x1000;
+        for (uint32_t k = 0; k < footprint[p].size(); k++) {
+            out.load(path_ip + 8 * k, region + footprint[p][k] * BENCH_BLOCK, REG_VALUE, REG_BASE);
+            out.alu(path_ip + 8 * k + 4, REG_SUM, REG_SUM, REG_VALUE);
+        }
+        out.alu(path_ip + 0x800, REG_BASE, REG_BASE, 0);
+        out.branch(path_ip + 0x804, true);
+    }
+}
+
+// CSR traversal of a 1M-vertex graph of degree 1 to 16: offsets and edges stream,
+// the neighbour properties are read at random and the new property of each vertex is stored
+static void gen_graph(TRACE_WRITER &out, uint32_t density, mt19937_64 &rng)
+{
+    const uint32_t vertices = 1 << 20;
+    const uint64_t ip = 0x440000;
+    uint64_t edge = 0;
+    for (uint32_t v = 0; !out.done(); v = (v + 1) % vertices) {
+        uint32_t degree = 1 + rng() % 16;
+        out.load(ip, region_base(0) + 8 * (uint64_t)v, REG_BASE, REG_INDEX);
+        for (uint32_t e = 0; e < degree; e++, edge++) {
+            uint32_t neighbour = rng() % vertices;
+            out.load(ip + 4, region_base(1) + 4 * (edge % (16ULL * vertices)), REG_NODE, REG_BASE);
+            out.load(ip + 8, region_base(2) + 8 * (uint64_t)neighbour, REG_VALUE, REG_NODE);
+            out.alu(ip + 12, REG_SUM, REG_SUM, REG_VALUE);
+            out.branch(ip + 16, e + 1 < degree);
+        }
+        out.store(ip + 20, region_base(3) + 8 * (uint64_t)v, REG_SUM, REG_INDEX);
+        out.alu(ip + 24, REG_INDEX, REG_INDEX, 0);
+        out.branch(ip + 28, true);
+    }
+}
+
+typedef void (*generator)(TRACE_WRITER &out, uint32_t density, mt19937_64 &rng);
+
+struct PATTERN {
+    const char *name;
+    generator generate;
+};
+
+static const PATTERN patterns[] = {
+    {"stream", gen_stream},
+    {"stride", gen_stride},
+    {"pointer_chase", gen_pointer_chase},
+    {"spatial", gen_spatial},
+    {"graph", gen_graph},
+};
+
+// prefetchers of multi.l2c_pref and multi.l1d_pref, and the config file each is benchmarked with
+struct PREFETCHER {
+    string name, config;
+};
+
+static const char *default_l2c[] = {
+    "none:nopref.ini", "sms:sms-8k.ini", "bop:bop.ini", "dspatch:dspatch.ini", "scooby:scooby.ini",
+    "next_line:next_line.ini", "sandbox:sandbox.ini", "spp_dev2:spp_dev2.ini", "spp_ppf_dev:spp_ppf_dev.ini",
+    "mlop:mlop.ini", "bingo:bingo-8k.ini", "RSA:RSA.ini", "pmp:pmp.ini", "rb:rb.ini", "ISB:ISB.ini",
+    "Domino:Domino.ini", "sisb", "sdomino", "stride:stride.ini", "streamer:streamer.ini", "power7:power7.ini",
+    "ipcp", "ampm:ampm.ini",
+};
+
+static const char *default_l1d[] = {
+    "next_line:next_line.ini", "stride:stride.ini", "ipcp", "rb",
+};
+
+static vector<string> split(const string &v1)
+{
+    vector<string> result;
+    size_t start = 0;
+    while (start < v1.size()) {
+        size_t end = v1.find(',', start);
+        if (end == string::npos)
+            end = v1.size();
+        if (end > start)
+            result.push_back(v1.substr(start, end - start));
+        start = end + 1;
+    }
+    return result;
+}
+
+static PREFETCHER parse_prefetcher(const string &v1)
+{
+    PREFETCHER p;
+    size_t colon = v1.find(':');
+    p.name = v1.substr(0, colon);
+    if (colon != string::npos)
+        p.config = v1.substr(colon + 1);
+    return p;
+}
+
+struct RESULT {
+    bool ok;
+    double wall, user, sys, ipc;
+    long peak_rss_kb;
+    // [Profile] of a profiling build: component and its share of the main loop, largest first
+    vector<pair<string, double> > profile;
+
+    RESULT() : ok(false), wall(0), user(0), sys(0), ipc(0), peak_rss_kb(0){};
+};
+
+static bool larger_share(const pair<string, double> &v1, const pair<string, double> &v2) { return v1.second > v2.second; }
+
+static double seconds(const struct timeval &v1) { return v1.tv_sec + v1.tv_usec / 1e6; }
+
+// runs the simulator with its output in log, and measures it with wait4()
+static RESULT run(const vector<string> &args, const string &log)
+{
+    RESULT result;
+
+    vector<char *> argv;
+    for (uint32_t i = 0; i < args.size(); i++)
+        argv.push_back(const_cast<char *>(args[i].c_str()));
+    argv.push_back(NULL);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            _exit(127);
+        dup2(fd, 1);
+        dup2(fd, 2);
+        execv(argv[0], &argv[0]);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0)
+        return result;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    result.wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    result.user = seconds(usage.ru_utime);
+    result.sys = seconds(usage.ru_stime);
+    result.peak_rss_kb = usage.ru_maxrss;
+
+    ifstream in(log.c_str());
+    string line;
+    bool in_profile = false;
+    const string share = "_self_share ";
+    while (getline(in, line)) {
+        size_t pos = line.find("cumulative IPC: ");
+        if (line.compare(0, 13, "Finished CPU ") == 0 && pos != string::npos)
+            result.ipc = atof(line.c_str() + pos + 16);
+        if (line == "[Profile]")
+            in_profile = true;
+        pos = line.find(share);
+        if (in_profile && pos != string::npos)
+            result.profile.push_back(make_pair(line.substr(0, pos), atof(line.c_str() + pos + share.size())));
+    }
+    sort(result.profile.begin(), result.profile.end(), larger_share);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    string binary, out = "bench_out", config_dir = "config";
+    uint64_t warmup = 100000, instructions = 500000;
+    uint32_t density = 50;
+    vector<string> pattern_names, l2c_list(default_l2c, default_l2c + sizeof(default_l2c) / sizeof(default_l2c[0])),
+        l1d_list(default_l1d, default_l1d + sizeof(default_l1d) / sizeof(default_l1d[0]));
+    for (uint32_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+        pattern_names.push_back(patterns[i].name);
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq), value = (eq == string::npos) ? "" : arg.substr(eq + 1);
+        if (key == "--binary")
+            binary = value;
+        else if (key == "--out")
+            out = value;
+        else if (key == "--config_dir")
+            config_dir = value;
+        else if (key == "--warmup")
+            warmup = strtoull(value.c_str(), NULL, 0);
+        else if (key == "--instructions")
+            instructions = strtoull(value.c_str(), NULL, 0);
+        else if (key == "--density")
+            density = atoi(value.c_str());
+        else if (key == "--patterns")
+            pattern_names = split(value);
+        else if (key == "--l2c")
+            l2c_list = split(value);
+        else if (key == "--l1d")
+            l1d_list = split(value);
+        else {
+            cerr << "*** UNKNOWN OPTION: " << arg << " ***" << endl;
+            return 1;
+        }
+    }
+    if (binary.empty()) {
+        cerr << "*** champsim_bench needs --binary=<champsim built with multi L1D/L2C prefetchers> ***" << endl;
+        return 1;
+    }
+
+    mkdir(out.c_str(), 0755);
+
+    // the traces are regenerated every time, from a fixed seed per pattern
+    vector<string> traces;
+    for (uint32_t i = 0; i < pattern_names.size(); i++) {
+        const PATTERN *pattern = NULL;
+        for (uint32_t j = 0; j < sizeof(patterns) / sizeof(patterns[0]); j++) {
+            if (pattern_names[i] == patterns[j].name)
+                pattern = &patterns[j];
+        }
+        if (pattern == NULL) {
+            cerr << "*** UNKNOWN PATTERN: " << pattern_names[i] << " ***" << endl;
+            return 1;
+        }
+        // ChampSim seeds itself from the name before ".champsimtrace.gz"
+        string trace = out + "/" + pattern->name + ".champsimtrace.gz";
+        mt19937_64 rng(0x5eed + i);
+        TRACE_WRITER writer(trace, warmup + instructions + 2 * ROB_SIZE);
+        pattern->generate(writer, density, rng);
+        traces.push_back(trace);
+    }
+
+    // L1D runs keep the L2C without prefetcher
+    // a run is its name, the arguments that select the prefetcher and its [Profile] component
+    vector<pair<string, vector<string> > > runs;
+    vector<string> run_component;
+    for (uint32_t i = 0; i < l2c_list.size(); i++) {
+        PREFETCHER p = parse_prefetcher(l2c_list[i]);
+        vector<string> args;
+        args.push_back("--l2c_prefetcher_types=" + p.name);
+        if (p.config.size())
+            args.push_back("--config=" + config_dir + "/" + p.config);
+        runs.push_back(make_pair("l2c_" + p.name, args));
+        run_component.push_back("Core_0_L2C_" + p.name);
+    }
+    for (uint32_t i = 0; i < l1d_list.size(); i++) {
+        PREFETCHER p = parse_prefetcher(l1d_list[i]);
+        vector<string> args;
+        args.push_back("--config=" + config_dir + "/nopref.ini");
+        args.push_back("--l1d_prefetcher_types=" + p.name);
+        if (p.config.size())
+            args.push_back("--config=" + config_dir + "/" + p.config);
+        runs.push_back(make_pair("l1d_" + p.name, args));
+        run_component.push_back("Core_0_L1D_" + p.name);
+    }
+
+    FILE *csv = fopen((out + "/bench.csv").c_str(), "w");
+    if (csv == NULL) {
+        cerr << "*** CANNOT WRITE " << out << "/bench.csv ***" << endl;
+        return 1;
+    }
+    fprintf(csv, "prefetcher,pattern,instructions,wall_s,kips,user_s,sys_s,peak_rss_kb,ipc\n");
+    FILE *profile_csv = NULL;
+    printf("%-18s %-14s %10s %9s %9s %9s %8s %10s %8s\n", "prefetcher", "pattern", "instr", "wall_s", "KIPS", "user_s", "sys_s", "RSS_MB", "IPC");
+    fflush(stdout);
+
+    int failed = 0;
+    for (uint32_t r = 0; r < runs.size(); r++) {
+        for (uint32_t t = 0; t < traces.size(); t++) {
+            vector<string> args;
+            args.push_back(binary);
+            args.push_back("--warmup_instructions=" + to_string(warmup));
+            args.push_back("--simulation_instructions=" + to_string(instructions));
+            args.insert(args.end(), runs[r].second.begin(), runs[r].second.end());
+            args.push_back("-traces");
+            args.push_back(traces[t]);
+
+            string log = out + "/" + runs[r].first + "-" + pattern_names[t] + ".out";
+            RESULT result = run(args, log);
+            if (!result.ok) {
+                printf("%-18s %-14s FAILED, see %s\n", runs[r].first.c_str(), pattern_names[t].c_str(), log.c_str());
+                fflush(stdout);
+                failed++;
+                continue;
+            }
+
+            double kips = (warmup + instructions) / result.wall / 1000;
+            printf("%-18s %-14s %10lu %9.2f %9.1f %9.2f %8.2f %10.1f %8.4f\n", runs[r].first.c_str(), pattern_names[t].c_str(), warmup + instructions,
+                   result.wall, kips, result.user, result.sys, result.peak_rss_kb / 1024.0, result.ipc);
+            fflush(stdout);
+            fprintf(csv, "%s,%s,%lu,%.3f,%.1f,%.3f,%.3f,%ld,%.5f\n", runs[r].first.c_str(), pattern_names[t].c_str(), warmup + instructions,
+                    result.wall, kips, result.user, result.sys, result.peak_rss_kb, result.ipc);
+
+            if (result.profile.empty())
+                continue;
+            printf("    ");
+            for (uint32_t i = 0; i < result.profile.size() && i < BENCH_PROFILE_TOP; i++)
+                printf("%s%s %.1f%%", i ? ", " : "", result.profile[i].first.c_str(), result.profile[i].second);
+            for (uint32_t i = BENCH_PROFILE_TOP; i < result.profile.size(); i++) {
+                if (result.profile[i].first == run_component[r])
+                    printf(", ... %s %.1f%%", result.profile[i].first.c_str(), result.profile[i].second);
+            }
+            printf("\n");
+            fflush(stdout);
+            if (profile_csv == NULL) {
+                profile_csv = fopen((out + "/profile.csv").c_str(), "w");
+                if (profile_csv == NULL) {
+                    cerr << "*** CANNOT WRITE " << out << "/profile.csv ***" << endl;
+                    return 1;
+                }
+                fprintf(profile_csv, "prefetcher,pattern,component,self_share\n");
+            }
+            for (uint32_t i = 0; i < result.profile.size(); i++)
+                fprintf(profile_csv, "%s,%s,%s,%.4f\n", runs[r].first.c_str(), pattern_names[t].c_str(), result.profile[i].first.c_str(), result.profile[i].second);
+        }
+    }
+    fclose(csv);
+    if (profile_csv)
+        fclose(profile_csv);
+
+    return failed ? 1 : 0;
+}
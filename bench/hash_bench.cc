@@ -0,0 +1,147 @@
+// feature hash microbenchmark (make hash_bench)
+// times the tile index computation of a PC_Delta feature (folded XOR, tiling offset, hash, modulo)
+// in the two forms FeatureKnowledge has used:
+//   dispatch: an out-of-line folded_xor() with its loop and HashZoo::getHash(selector, key),
+//             which picks the hash function again on every call
+//   resolved: the inline folded_xor() of util.h and a hash function resolved once with
+//             HashZoo::getHashFunction(), as the tile index generators do now
+// each form is timed over the same pseudo-random accesses and the median of the runs is reported
+//
+// usage: hash_bench [--hash=<selector>] [--tiles=<n>] [--accesses=<n>] [--runs=<n>]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "util.h"
+
+using namespace std;
+
+#define DELTA_BITS 7
+
+// first tiling offset of feature_knowledge_helper.h
+#define BENCH_TILING_OFFSET 0xaca081b9
+
+struct ACCESS {
+    uint64_t pc;
+    int32_t delta;
+};
+
+// folded_xor() as it was before moving to util.h, kept out of line
+__attribute__((noinline)) static uint32_t folded_xor_call(uint64_t value, uint32_t num_folds)
+{
+    assert(num_folds > 1);
+    assert((num_folds & (num_folds-1)) == 0); /* has to be power of 2 */
+    uint32_t mask = 0;
+    uint32_t bits_in_fold = 64/num_folds;
+    if (num_folds == 2)
+        mask = 0xffffffff;
+    else
+        mask = (1ul << bits_in_fold) - 1;
+    uint32_t folded_value = 0;
+    for (uint32_t fold = 0; fold < num_folds; ++fold)
+        folded_value = folded_value ^ ((value >> (fold * bits_in_fold)) & mask);
+    return folded_value;
+}
+
+static inline uint64_t pc_delta(const ACCESS &access)
+{
+    uint32_t unsigned_delta = (access.delta < 0) ? (((-1) * access.delta) + (1 << (DELTA_BITS - 1))) : access.delta;
+    return (access.pc << 7) + unsigned_delta;
+}
+
+__attribute__((noinline)) static uint64_t run_dispatch(const vector<ACCESS> &accesses, uint32_t selector, uint32_t tiles)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < accesses.size(); i++) {
+        uint32_t raw_index = folded_xor_call(pc_delta(accesses[i]), 2) ^ BENCH_TILING_OFFSET;
+        sum += HashZoo::getHash(selector, raw_index) % tiles;
+    }
+    return sum;
+}
+
+__attribute__((noinline)) static uint64_t run_resolved(const vector<ACCESS> &accesses, HashZoo::hash_fn hash, uint32_t tiles)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < accesses.size(); i++) {
+        uint32_t raw_index = folded_xor(pc_delta(accesses[i]), 2) ^ BENCH_TILING_OFFSET;
+        sum += hash(raw_index) % tiles;
+    }
+    return sum;
+}
+
+static double now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool parse_uint(const char *arg, const char *name, uint32_t &value)
+{
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=')
+        return false;
+    value = strtoul(arg + len + 1, NULL, 0);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    // jenkins over 128 tiles, as in the default Pythia configuration
+    uint32_t selector = 2, tiles = 128, num_accesses = 10000000, runs = 5;
+    for (int i = 1; i < argc; i++) {
+        if (!parse_uint(argv[i], "--hash", selector) && !parse_uint(argv[i], "--tiles", tiles)
+            && !parse_uint(argv[i], "--accesses", num_accesses) && !parse_uint(argv[i], "--runs", runs)) {
+            cerr << "*** UNKNOWN ARGUMENT: " << argv[i] << " ***" << endl;
+            return 1;
+        }
+    }
+    if (tiles == 0 || num_accesses == 0 || runs == 0) {
+        cerr << "*** TILES, ACCESSES AND RUNS MUST BE NON-ZERO ***" << endl;
+        return 1;
+    }
+
+    // a few hundred load PCs and small deltas, like the accesses a prefetcher sees
+    vector<ACCESS> accesses(num_accesses);
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (uint32_t i = 0; i < num_accesses; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        accesses[i].pc = 0x400000 + 4 * (state % 512);
+        accesses[i].delta = (int32_t)((state >> 32) % 127) - 63;
+    }
+
+    HashZoo::hash_fn hash = HashZoo::getHashFunction(selector);
+    vector<double> dispatch_ns, resolved_ns;
+    uint64_t dispatch_sum = 0, resolved_sum = 0;
+    for (uint32_t r = 0; r < runs; r++) {
+        double start = now_ns();
+        dispatch_sum = run_dispatch(accesses, selector, tiles);
+        dispatch_ns.push_back((now_ns() - start) / num_accesses);
+
+        start = now_ns();
+        resolved_sum = run_resolved(accesses, hash, tiles);
+        resolved_ns.push_back((now_ns() - start) / num_accesses);
+    }
+
+    if (dispatch_sum != resolved_sum) {
+        cerr << "*** THE TWO FORMS DISAGREE: " << dispatch_sum << " " << resolved_sum << " ***" << endl;
+        return 1;
+    }
+
+    sort(dispatch_ns.begin(), dispatch_ns.end());
+    sort(resolved_ns.begin(), resolved_ns.end());
+    double dispatch = dispatch_ns[runs / 2], resolved = resolved_ns[runs / 2];
+    printf("hash %u, %u tiles, %u accesses, median of %u runs\n", selector, tiles, num_accesses, runs);
+    printf("dispatch %6.2f ns/index\n", dispatch);
+    printf("resolved %6.2f ns/index\n", resolved);
+    printf("speedup  %6.2fx\n", dispatch / resolved);
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "ooo_cpu.h"
+#include "checkpoint.h"
 
 #define BIMODAL_TABLE_SIZE 16384
 #define BIMODAL_PRIME 16381
@@ -30,3 +31,8 @@ void O3_CPU::last_branch_result(uint64_t ip, uint8_t taken)
     else if ((taken == 0) && (bimodal_table[cpu][hash] > 0))
         bimodal_table[cpu][hash]--;
 }
+
+void O3_CPU::checkpoint_branch_predictor(CHECKPOINT &cp)
+{
+    cp.array(bimodal_table[cpu], BIMODAL_TABLE_SIZE);
+}
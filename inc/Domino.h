@@ -4,6 +4,8 @@
 #include <vector>
 #include "prefetcher.h"
 #include "cache.h"
+#include "bakshalipour_framework.h"
+#include "history_buffer.h"
 #include "algorithm"
 #include <map>
 #include <set>
@@ -39,8 +41,11 @@ class Super_Entry
 public:
     Super_Entry(uint64_t first_address = 0, uint64_t second_address = 0, uint64_t point = 0, int size = 0, int debug_level = 0)
         : data(size, Entry()), lru(size, 0), debug_level(debug_level),
-          mru_address(second_address), mru_point(point)
+          first_address(first_address), mru_address(second_address), mru_point(point)
     {
+        // the empty entries a set-associative index table is built with
+        if (size == 0)
+            return;
         data[0] = Entry(true, second_address, point);
         set_mru(0);
         mru_address = second_address;
@@ -79,6 +84,15 @@ public:
                 cout << "address=0x" << hex << data[i].second_address << ", pointer=" << dec << data[i].pointer << endl;
         }
     }
+    void checkpoint(CHECKPOINT &cp)
+    {
+        cp.vector_entries(data);
+        cp.vector_entries(lru);
+        cp.scalar(t);
+        cp.scalar(first_address);
+        cp.scalar(mru_address);
+        cp.scalar(mru_point);
+    }
 };
 
 class Stream_data
@@ -96,7 +110,7 @@ class Active_stream
     vector<int> lru;
     uint64_t t = 1;
     int debug_level;
-    vector<uint64_t> *history_buffer;
+    History_buffer *history_buffer;
     int select_victim()
     {
         return min_element(lru.begin(), lru.end()) - lru.begin();
@@ -107,7 +121,7 @@ class Active_stream
     }
 
 public:
-    Active_stream(int size, vector<uint64_t> *HBP, int debug_level = 0)
+    Active_stream(int size, History_buffer *HBP, int debug_level = 0)
         : stream(size), lru(size, 0),
           history_buffer(HBP), debug_level(debug_level){};
     void create_stream(Stream_data data)
@@ -123,7 +137,7 @@ public:
             if (stream[i].prefetched_addr.count(address) > 0)
             {
                 stream[i].prefetched_addr.erase(address);
-                if (stream[i].pointer < history_buffer->size() - 1)
+                if (history_buffer->valid(stream[i].pointer + 1))
                 {
                     stream[i].pointer++;
                     uint64_t new_prefetch_addr = (*history_buffer)[stream[i].pointer];
@@ -140,6 +154,17 @@ public:
         }
         return false;
     }
+    void checkpoint(CHECKPOINT &cp)
+    {
+        cp.check(stream.size(), "Domino active streams");
+        for (size_t i = 0; i < stream.size(); i++)
+        {
+            cp.scalar(stream[i].pointer);
+            cp.set_entries(stream[i].prefetched_addr);
+        }
+        cp.vector_entries(lru);
+        cp.scalar(t);
+    }
 };
 
 class Domino : public Prefetcher
@@ -150,17 +175,26 @@ public:
     void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
     void register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
     void dump_stats();
+    void register_stats(string section);
     void print_config();
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
 
 private:
     void init_knobs();
     void init_stats();
+    void checkpoint(CHECKPOINT &cp);
     bool match_second_address(uint64_t second_address, vector<uint64_t> &pref_addr);
     bool seach_first_address(uint64_t first_address, vector<uint64_t> &pref_addr);
+    Super_Entry *find_index(uint64_t first_address);
+    void insert_index(uint64_t first_address, const Super_Entry &super_entry);
+    bool is_prefetched(uint64_t block_address);
+    void set_prefetched(uint64_t block_address);
+    void clear_prefetched(uint64_t block_address);
 
-    vector<uint64_t> history_buffer;
+    History_buffer history_buffer;
     uint64_t last_address;
-    Super_Entry *match_candidate;
+    uint64_t match_candidate;
     bool match_candidate_valid;
     map<uint64_t, Super_Entry> index_table;
     Active_stream active_stream;
@@ -168,6 +202,12 @@ private:
     set<uint64_t> prefetched_address;
     CACHE *parent = NULL;
 
+    // Domino_bounded: a fixed-size ring history, a set-associative index table and prefetch filter
+    // in place of the unbounded history vector, index map and prefetched address set
+    bool bounded;
+    LRUSetAssociativeCache<Super_Entry> bounded_index_table;
+    LRUSetAssociativeCache<bool> prefetch_filter;
+
     int super_entry_size;
     int degree;
     int debug_level;
@@ -5,6 +5,7 @@
 #include <vector>
 #include "prefetcher.h"
 #include "bitmap.h"
+#include "entry_pool.h"
 using namespace std;
 
 #define MAX_OFFSETS 64
@@ -27,7 +28,7 @@ public:
 class AMPM : public Prefetcher 
 {
 private:
-    deque<AMPM_PB_Entry*> page_buffer;
+    ENTRY_POOL<AMPM_PB_Entry> page_buffer; /* keyed by page_id, LRU first */
     deque<uint64_t> pref_buffer; 
 
     struct 
@@ -75,7 +76,10 @@ public:
     ~AMPM();
     void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
     void dump_stats();
+    void register_stats(string section);
     void print_config();
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
 };
 
 #endif /* AMPM_H */
@@ -8,8 +8,21 @@
 #include <unordered_map>
 #include <sstream>
 #include <algorithm>
+#include <type_traits>
+#include <stdint.h>
+#include <assert.h>
+#include "checkpoint.h"
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 using namespace std;
 
+/* 1 selects the flat-array tables below for every prefetcher built on this framework,
+* 0 the original per-set vectors and hash-map CAMs (both evict the same entries) */
+#ifndef BAKSHALIPOUR_FLAT_TABLES
+#define BAKSHALIPOUR_FLAT_TABLES 1
+#endif
+
 /**
 * A class for printing beautiful data tables.
 * It's useful for logging the information contained in tabular structures.
@@ -115,7 +128,24 @@ private:
    vector<vector<string>> cells;
 };
 
-template <class T> class SetAssociativeCache {
+template <class T, bool FLAT = BAKSHALIPOUR_FLAT_TABLES> class SetAssociativeCache;
+template <class T, bool FLAT = BAKSHALIPOUR_FLAT_TABLES> class LRUSetAssociativeCache;
+
+/**
+* Geometry of a table that can be switched off: as given while `enabled`, empty otherwise.
+* The ways are never 0, so a table is built without dividing by them even when its ways knob
+* is unset; an owner that enables the table rejects zero ways itself.
+*/
+class TableGeometry {
+public:
+   TableGeometry(bool enabled, int size, int num_ways)
+   : size(enabled ? size : 0), num_ways((enabled && num_ways) ? num_ways : 1) {}
+
+   int size;
+   int num_ways;
+};
+
+template <class T> class SetAssociativeCache<T, false> {
 public:
    class Entry {
    public:
@@ -221,6 +251,41 @@ public:
 
    void set_debug_level(int debug_level) { this->debug_level = debug_level; }
 
+   /**
+   * Saves or restores the entries for --checkpoint_save/--checkpoint_load, `T` has to be plain data.
+   * The CAMs only mirror the valid entries, so they are rebuilt instead of saved.
+   */
+   void checkpoint(CHECKPOINT &cp) {
+      static_assert(std::is_trivially_copyable<T>::value, "entries that are not plain data need checkpoint(cp, walk_data)");
+      cp.check(this->size, "prefetcher table size");
+      cp.check(this->num_ways, "prefetcher table ways");
+      for (int i = 0; i < num_sets; i += 1) {
+         cp.array(&this->entries[i][0], num_ways);
+         if (!cp.saving())
+         this->rebuild_cam(i);
+      }
+   }
+
+   /**
+   * Same as above for a `T` that is not plain data, `walk_data(cp, data)` saves or restores one entry's data.
+   */
+   template <class W> void checkpoint(CHECKPOINT &cp, W walk_data) {
+      cp.check(this->size, "prefetcher table size");
+      cp.check(this->num_ways, "prefetcher table ways");
+      for (int i = 0; i < num_sets; i += 1) {
+         for (int j = 0; j < num_ways; j += 1) {
+            Entry &entry = this->entries[i][j];
+            cp.scalar(entry.key);
+            cp.scalar(entry.index);
+            cp.scalar(entry.tag);
+            cp.scalar(entry.valid);
+            walk_data(cp, entry.data);
+         }
+         if (!cp.saving())
+         this->rebuild_cam(i);
+      }
+   }
+
 protected:
    /* should be overriden in children */
    virtual void write_data(Entry &entry, Table &table, int row) {}
@@ -242,6 +307,18 @@ protected:
       return valid_entries;
    }
 
+   /**
+   * @return The `num_ways` entries of set `index`, for children that match on partial tags
+   */
+   Entry *set_entries(uint64_t index) { return &this->entries[index][0]; }
+
+   void rebuild_cam(int index) {
+      cams[index].clear();
+      for (int j = 0; j < num_ways; j += 1)
+      if (entries[index][j].valid)
+      cams[index][entries[index][j].tag] = j;
+   }
+
    int size;
    int num_ways;
    int num_sets;
@@ -251,17 +328,240 @@ protected:
    int debug_level = 0;
 };
 
-template <class T> class LRUSetAssociativeCache : public SetAssociativeCache<T> {
-   typedef SetAssociativeCache<T> Super;
+/**
+* Same table as above, laid out for lookups: all entries live in one `num_sets * num_ways` array,
+* and their tags are mirrored in a separate array so that `find()` compares a whole set at once
+* instead of hashing into a per-set CAM.
+*/
+template <class T> class SetAssociativeCache<T, true> {
+public:
+   class Entry {
+   public:
+      uint64_t key;
+      uint64_t index;
+      uint64_t tag;
+      bool valid;
+      T data;
+   };
+
+   SetAssociativeCache(int size, int num_ways, int debug_level = 0)
+   : size(size), num_ways(num_ways), num_sets(size / num_ways), way_stride((num_ways + 3) & ~3),
+   entries(num_sets * num_ways), tags(num_sets * way_stride, (uint64_t)INVALID_TAG), debug_level(debug_level) {
+      // assert(size % num_ways == 0);
+      for (int i = 0; i < num_sets * num_ways; i += 1)
+      entries[i].valid = false;
+      /* calculate `index_len` (number of bits required to store the index) */
+      for (int max_index = num_sets - 1; max_index > 0; max_index >>= 1)
+      this->index_len += 1;
+   }
+
+   /**
+   * Invalidates the entry corresponding to the given key.
+   * @return A pointer to the invalidated entry
+   */
+   Entry *erase(uint64_t key) {
+      uint64_t index = key % this->num_sets;
+      int way = this->find_way(index, key / this->num_sets);
+      if (way < 0)
+      return nullptr;
+      Entry &entry = this->entries[index * this->num_ways + way];
+      entry.valid = false;
+      this->tags[index * this->way_stride + way] = INVALID_TAG;
+      return &entry;
+   }
+
+   /**
+   * @return The old state of the entry that was updated
+   */
+   Entry insert(uint64_t key, const T &data) {
+      uint64_t index = key % this->num_sets;
+      uint64_t tag = key / this->num_sets;
+      Entry *set = this->set_entries(index);
+      int way = this->find_way(index, tag);
+      if (way >= 0) {
+         Entry old_entry = set[way];
+         set[way].data = data;
+         return old_entry;
+      }
+      int victim_way = -1;
+      for (int i = 0; i < this->num_ways; i += 1)
+      if (!set[i].valid) {
+         victim_way = i;
+         break;
+      }
+      if (victim_way == -1) {
+         victim_way = this->select_victim(index);
+      }
+      Entry &victim = set[victim_way];
+      Entry old_entry = victim;
+      victim = {key, index, tag, true, data};
+      this->tags[index * this->way_stride + victim_way] = tag;
+      return old_entry;
+   }
+
+   Entry *find(uint64_t key) {
+      uint64_t index = key % this->num_sets;
+      int way = this->find_way(index, key / this->num_sets);
+      if (way < 0)
+      return nullptr;
+      return &this->entries[index * this->num_ways + way];
+   }
+
+   /**
+   * Creates a table with the given headers and populates the rows by calling `write_data` on all
+   * valid entries contained in the cache. This function makes it easy to visualize the contents
+   * of a cache.
+   * @return The constructed table as a string
+   */
+   string log(vector<string> headers) {
+      vector<Entry> valid_entries = this->get_valid_entries();
+      Table table(headers.size(), valid_entries.size() + 1);
+      table.set_row(0, headers);
+      for (unsigned i = 0; i < valid_entries.size(); i += 1)
+      this->write_data(valid_entries[i], table, i + 1);
+      return table.to_string();
+   }
+
+   int get_index_len() { return this->index_len; }
+
+   void set_debug_level(int debug_level) { this->debug_level = debug_level; }
+
+   /**
+   * Saves or restores the entries for --checkpoint_save/--checkpoint_load, `T` has to be plain data.
+   */
+   void checkpoint(CHECKPOINT &cp) {
+      static_assert(std::is_trivially_copyable<T>::value, "entries that are not plain data need checkpoint(cp, walk_data)");
+      cp.check(this->size, "prefetcher table size");
+      cp.check(this->num_ways, "prefetcher table ways");
+      cp.array(&this->entries[0], this->entries.size());
+      cp.array(&this->tags[0], this->tags.size());
+   }
+
+   /**
+   * Same as above for a `T` that is not plain data, `walk_data(cp, data)` saves or restores one entry's data.
+   */
+   template <class W> void checkpoint(CHECKPOINT &cp, W walk_data) {
+      cp.check(this->size, "prefetcher table size");
+      cp.check(this->num_ways, "prefetcher table ways");
+      for (int i = 0; i < num_sets * num_ways; i += 1) {
+         Entry &entry = this->entries[i];
+         cp.scalar(entry.key);
+         cp.scalar(entry.index);
+         cp.scalar(entry.tag);
+         cp.scalar(entry.valid);
+         walk_data(cp, entry.data);
+      }
+      cp.array(&this->tags[0], this->tags.size());
+   }
+
+protected:
+   /* tag of invalid ways, a valid entry holding it is still found through its `valid` bit */
+   static const uint64_t INVALID_TAG = UINT64_MAX;
+
+   /* should be overriden in children */
+   virtual void write_data(Entry &entry, Table &table, int row) {}
+
+   /**
+   * @return The way of the selected victim
+   */
+   virtual int select_victim(uint64_t index) {
+      /* random eviction policy if not overriden */
+      return rand() % this->num_ways;
+   }
+
+   vector<Entry> get_valid_entries() {
+      vector<Entry> valid_entries;
+      for (int i = 0; i < num_sets * num_ways; i += 1)
+      if (entries[i].valid)
+      valid_entries.push_back(entries[i]);
+      return valid_entries;
+   }
+
+   /**
+   * @return The `num_ways` entries of set `index`, for children that match on partial tags
+   */
+   Entry *set_entries(uint64_t index) { return &this->entries[index * this->num_ways]; }
+
+   /**
+   * @return The way of set `index` holding `tag`, -1 if there is none
+   */
+   int find_way(uint64_t index, uint64_t tag) {
+      const uint64_t *set_tags = &this->tags[index * this->way_stride];
+      const Entry *set = this->set_entries(index);
+      for (int base = 0; base < this->num_ways; base += 64) {
+         uint64_t match = match_tags(set_tags + base, min(64, this->way_stride - base), tag);
+         int ways = this->num_ways - base;
+         if (ways < 64)
+         match &= (1ULL << ways) - 1;
+         for (; match; match &= match - 1) {
+            int way = base + __builtin_ctzll(match);
+            if (set[way].valid)
+            return way;
+         }
+      }
+      return -1;
+   }
+
+   /**
+   * @return Bit i set if `set_tags[i] == tag`, for `ways` (a multiple of 4, at most 64) tags
+   */
+   uint64_t match_tags(const uint64_t *set_tags, int ways, uint64_t tag) {
+      uint64_t match = 0;
+#if defined(__AVX2__)
+      __m256i key = _mm256_set1_epi64x(tag);
+      for (int i = 0; i < ways; i += 4) {
+         __m256i eq = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(set_tags + i)), key);
+         match |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(eq)) << i;
+      }
+#elif defined(__SSE2__)
+      __m128i key = _mm_set1_epi64x(tag);
+      for (int i = 0; i < ways; i += 2) {
+         /* SSE2 has no 64-bit compare, so both 32-bit halves have to match */
+         __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(set_tags + i)), key);
+         eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+         match |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(eq)) << i;
+      }
+#else
+      for (int i = 0; i < ways; i += 1)
+      match |= (uint64_t)(set_tags[i] == tag) << i;
+#endif
+      return match;
+   }
+
+   int size;
+   int num_ways;
+   int num_sets;
+   int way_stride; /* num_ways rounded up to whole vectors, the padding holds INVALID_TAG */
+   int index_len = 0; /* in bits */
+   vector<Entry> entries;
+   vector<uint64_t> tags;
+   int debug_level = 0;
+};
+
+template <class T> class LRUSetAssociativeCache<T, false> : public SetAssociativeCache<T, false> {
+   typedef SetAssociativeCache<T, false> Super;
 
 public:
    LRUSetAssociativeCache(int size, int num_ways, int debug_level = 0)
    : Super(size, num_ways, debug_level), lru(this->num_sets, vector<uint64_t>(num_ways)) {}
 
+   LRUSetAssociativeCache(const TableGeometry &geometry, int debug_level = 0)
+   : LRUSetAssociativeCache(geometry.size, geometry.num_ways, debug_level) {}
+
    void set_mru(uint64_t key) { *this->get_lru(key) = this->t++; }
 
    void set_lru(uint64_t key) { *this->get_lru(key) = 0; }
 
+   void checkpoint(CHECKPOINT &cp) {
+      Super::checkpoint(cp);
+      this->checkpoint_lru(cp);
+   }
+
+   template <class W> void checkpoint(CHECKPOINT &cp, W walk_data) {
+      Super::checkpoint(cp, walk_data);
+      this->checkpoint_lru(cp);
+   }
+
 protected:
    /* @override */
    int select_victim(uint64_t index) {
@@ -277,10 +577,89 @@ protected:
       return &this->lru[index][way];
    }
 
+   void checkpoint_lru(CHECKPOINT &cp) {
+      for (int i = 0; i < this->num_sets; i += 1)
+      cp.array(&this->lru[i][0], this->num_ways);
+      cp.scalar(this->t);
+   }
+
    vector<vector<uint64_t>> lru;
    uint64_t t = 1;
 };
 
+/**
+* LRU on the flat table. Instead of a global timestamp per entry, every way keeps its rank within
+* its set: 0 for ways never touched (or demoted by `set_lru`), and 1 (oldest) to n (newest) for
+* the n others. Only the order within a set matters to `select_victim`, so it picks the same
+* victim as the timestamps would, lowest way first among the zeros.
+*/
+template <class T> class LRUSetAssociativeCache<T, true> : public SetAssociativeCache<T, true> {
+   typedef SetAssociativeCache<T, true> Super;
+
+public:
+   LRUSetAssociativeCache(int size, int num_ways, int debug_level = 0)
+   : Super(size, num_ways, debug_level), lru(this->num_sets * num_ways, 0) {
+      assert(num_ways < 256);
+   }
+
+   LRUSetAssociativeCache(const TableGeometry &geometry, int debug_level = 0)
+   : LRUSetAssociativeCache(geometry.size, geometry.num_ways, debug_level) {}
+
+   void set_mru(uint64_t key) {
+      uint8_t *lru_set = this->get_lru_set(key);
+      int way = this->get_way(key), ways = this->num_ways;
+      uint8_t old_rank = lru_set[way], ranked = 0;
+      /* ranks are bytes, so the loops keep everything in locals for the compiler to vectorize them */
+      for (int i = 0; i < ways; i += 1)
+      ranked += (lru_set[i] != 0);
+      if (old_rank == 0) {
+         lru_set[way] = ranked + 1;
+         return;
+      }
+      for (int i = 0; i < ways; i += 1)
+      lru_set[i] -= (lru_set[i] > old_rank);
+      lru_set[way] = ranked;
+   }
+
+   void set_lru(uint64_t key) {
+      uint8_t *lru_set = this->get_lru_set(key);
+      int way = this->get_way(key), ways = this->num_ways;
+      uint8_t old_rank = lru_set[way];
+      if (old_rank == 0)
+      return;
+      for (int i = 0; i < ways; i += 1)
+      lru_set[i] -= (lru_set[i] > old_rank);
+      lru_set[way] = 0;
+   }
+
+   void checkpoint(CHECKPOINT &cp) {
+      Super::checkpoint(cp);
+      cp.array(&this->lru[0], this->lru.size());
+   }
+
+   template <class W> void checkpoint(CHECKPOINT &cp, W walk_data) {
+      Super::checkpoint(cp, walk_data);
+      cp.array(&this->lru[0], this->lru.size());
+   }
+
+protected:
+   /* @override */
+   int select_victim(uint64_t index) {
+      uint8_t *lru_set = &this->lru[index * this->num_ways];
+      return min_element(lru_set, lru_set + this->num_ways) - lru_set;
+   }
+
+   uint8_t *get_lru_set(uint64_t key) { return &this->lru[(key % this->num_sets) * this->num_ways]; }
+
+   int get_way(uint64_t key) {
+      int way = this->find_way(key % this->num_sets, key / this->num_sets);
+      assert(way >= 0);
+      return way;
+   }
+
+   vector<uint8_t> lru;
+};
+
 uint64_t hash_index(uint64_t key, int index_len);
 template <class T> inline T square(T x) { return x * x; }
 
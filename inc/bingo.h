@@ -10,6 +10,7 @@
 #include "prefetcher.h"
 #include "cache.h"
 #include "bakshalipour_framework.h"
+#include "block_pattern.h"
 
 // #define PATTERN_RECORD
 #define TRACK_FIRST_USE
@@ -101,10 +102,10 @@ private:
 };
 
 template <class T>
-string pattern_to_string(const vector<T> &pattern)
+string pattern_to_string(const T &pattern)
 {
    ostringstream oss;
-   for (unsigned i = 0; i < pattern.size(); i += 1)
+   for (int i = 0; i < pattern.size(); i += 1)
       oss << int(pattern[i]);
    return oss.str();
 }
@@ -114,7 +115,7 @@ class AccumulationTableData
 public:
    uint64_t pc;
    int offset;
-   vector<bool> pattern;
+   BlockPattern pattern;
 
 #ifdef TRACK_FIRST_USE
    uint64_t insert_cycle;
@@ -158,7 +159,7 @@ public:
             cerr << "[AccumulationTable::set_pattern] Not found!" << dec << endl;
          return false;
       }
-      entry->data.pattern[offset] = true;
+      entry->data.pattern.set(offset);
       Super::set_mru(key);
       if (this->debug_level >= 2)
          cerr << "[AccumulationTable::set_pattern] OK!" << dec << endl;
@@ -184,9 +185,9 @@ public:
               << ", offset=" << dec << offset << dec << endl;
       uint64_t key = this->build_key(region_number);
       // assert(!Super::find(key));
-      vector<bool> pattern(this->pattern_len, false);
-      pattern[offset] = true;
-      pattern[offset2] = true;
+      BlockPattern pattern(this->pattern_len);
+      pattern.set(offset);
+      pattern.set(offset2);
 #ifdef TRACK_FIRST_USE
       Entry old_entry = Super::insert(key, {pc, offset, pattern, current_core_cycle[0]});
 #else
@@ -246,21 +247,10 @@ enum Event
    MISS = 2
 };
 
-template <class T>
-vector<T> my_rotate(const vector<T> &x, int n)
-{
-   vector<T> y;
-   int len = x.size();
-   n = n % len;
-   for (int i = 0; i < len; i += 1)
-      y.push_back(x[(i - n + len) % len]);
-   return y;
-}
-
 class PatternHistoryTableData
 {
 public:
-   vector<bool> pattern;
+   BlockPattern pattern;
 
 #ifdef TRACK_FIRST_USE
    uint64_t insert_cycle;
@@ -296,14 +286,14 @@ public:
    }
 
    /* NOTE: In BINGO, address is actually block number. */
-   void insert(uint64_t pc, uint64_t address, vector<bool> pattern)
+   void insert(uint64_t pc, uint64_t address, BlockPattern pattern)
    {
       if (this->debug_level >= 2)
          cerr << "PatternHistoryTable::insert(pc=0x" << hex << pc << ", address=0x" << address
               << ", pattern=" << pattern_to_string(pattern) << ")" << dec << endl;
       // assert((int)pattern.size() == this->pattern_len);
       int offset = address % this->pattern_len;
-      pattern = my_rotate(pattern, -offset);
+      pattern = pattern.rotate(-offset);
       uint64_t key = this->build_key(pc, address);
 #ifdef TRACK_FIRST_USE
       Super::insert(key, {pattern, current_core_cycle[0]});
@@ -315,19 +305,19 @@ public:
 
    /**
     * First searches for a PC+Address match. If no match is found, returns all PC+Offset matches.
-    * @return All un-rotated patterns if matches were found, returns an empty vector otherwise
+    * @param matches Refilled with all un-rotated patterns if matches were found, left empty otherwise
     */
-   vector<vector<bool>> find(uint64_t pc, uint64_t address)
+   void find(uint64_t pc, uint64_t address, vector<BlockPattern> &matches)
    {
       if (this->debug_level >= 2)
          cerr << "PatternHistoryTable::find(pc=0x" << hex << pc << ", address=0x" << address << ")" << dec << endl;
       uint64_t key = this->build_key(pc, address);
       uint64_t index = key % this->num_sets;
       uint64_t tag = key / this->num_sets;
-      auto &set = this->entries[index];
+      auto *set = this->set_entries(index);
       uint64_t min_tag_mask = (1 << (this->pc_width + this->min_addr_width - this->index_len)) - 1;
       uint64_t max_tag_mask = (1 << (this->pc_width + this->max_addr_width - this->index_len)) - 1;
-      vector<vector<bool>> matches;
+      matches.clear();
       this->last_event = MISS;
       for (int i = 0; i < this->num_ways; i += 1)
       {
@@ -335,7 +325,7 @@ public:
             continue;
          bool min_match = ((set[i].tag & min_tag_mask) == (tag & min_tag_mask));
          bool max_match = ((set[i].tag & max_tag_mask) == (tag & max_tag_mask));
-         vector<bool> &cur_pattern = set[i].data.pattern;
+         const BlockPattern &cur_pattern = set[i].data.pattern;
          if (max_match)
          {
 #ifdef TRACK_FIRST_USE
@@ -372,8 +362,7 @@ public:
       }
       int offset = address % this->pattern_len;
       for (int i = 0; i < (int)matches.size(); i += 1)
-         matches[i] = my_rotate(matches[i], +offset);
-      return matches;
+         matches[i] = matches[i].rotate(+offset);
    }
 
    Event get_last_event() { return this->last_event; }
@@ -435,7 +424,7 @@ class PrefetchStreamerData
 {
 public:
    /* contains the prefetch fill level for each block of spatial region */
-   vector<int> pattern;
+   FillPattern pattern;
 };
 
 class PrefetchStreamer : public LRUSetAssociativeCache<PrefetchStreamerData>
@@ -451,7 +440,7 @@ public:
               << ", debug_level=" << debug_level << ", num_ways=" << num_ways << ")" << dec << endl;
    }
 
-   void insert(uint64_t region_number, vector<int> pattern)
+   void insert(uint64_t region_number, const FillPattern &pattern)
    {
       if (this->debug_level >= 2)
          cerr << "PrefetchStreamer::insert(region_number=0x" << hex << region_number
@@ -485,11 +474,11 @@ public:
       }
       Super::set_mru(key);
       int pf_issued = 0;
-      vector<int> &pattern = entry->data.pattern;
-      pattern[region_offset] = 0; /* accessed block will be automatically fetched if necessary (miss) */
+      FillPattern &pattern = entry->data.pattern;
+      pattern.set(region_offset, 0); /* accessed block will be automatically fetched if necessary (miss) */
       int pf_offset;
       /* prefetch blocks that are close to the recent access first (locality!) */
-      for (int d = 1; d < this->pattern_len; d += 1)
+      for (int d = 1; d < this->pattern_len && pattern.any(); d += 1)
       {
          /* prefer positive strides */
          for (int sgn = +1; sgn >= -1; sgn -= 2)
@@ -502,7 +491,7 @@ public:
                {
                   cache->prefetch_line(0, base_addr, pf_address, pattern[pf_offset], 0);
                   pf_issued += 1;
-                  pattern[pf_offset] = 0;
+                  pattern.set(pf_offset, 0);
                   pref_addr.emplace_back(pf_address); // lyq: for pc-record
                }
                else
@@ -552,7 +541,10 @@ public:
    void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, std::vector<uint64_t> &pref_addr);
    void register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
    void dump_stats();
+   void register_stats(string section);
    void print_config();
+   void save(CHECKPOINT &cp);
+   void load(CHECKPOINT &cp);
 
    /**
     * Updates BINGO's state based on the most recent LOAD access.
@@ -572,7 +564,6 @@ public:
    void add_useful(uint64_t block_number, Event ev);
    void add_useless(uint64_t block_number, Event ev);
    void reset_stats();
-   void print_stats();
 
 private:
    /**
@@ -580,7 +571,7 @@ private:
     * @return The appropriate prefetch level for all blocks based on PHT output or an empty vector
     *         if no blocks should be prefetched
     */
-   vector<int> find_in_pht(uint64_t pc, uint64_t address);
+   FillPattern find_in_pht(uint64_t pc, uint64_t address);
 
    void insert_in_pht(const AccumulationTable::Entry &entry);
 
@@ -590,10 +581,11 @@ private:
     * @return  The appropriate prefetch level for all blocks based on BINGO's voting thresholds or
     *          an empty vector if no blocks should be prefetched
     */
-   vector<int> vote(const vector<vector<bool>> &x);
+   FillPattern vote(const vector<BlockPattern> &x);
 
    void init_knobs();
    void init_stats();
+   void checkpoint(CHECKPOINT &cp);
 
    /*======================*/
    CACHE *parent = NULL;
@@ -602,6 +594,8 @@ private:
    AccumulationTable accumulation_table;
    PatternHistoryTable pht;
    PrefetchStreamer pf_streamer;
+   /* scratch buffer reused by find_in_pht() */
+   vector<BlockPattern> pht_matches;
    int debug_level = 0;
    uint32_t pc_address_fill_level;
 
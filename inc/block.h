@@ -5,6 +5,8 @@
 #include "instruction.h"
 #include "set.h"
 
+class CHECKPOINT;
+
 // CACHE BLOCK
 class BLOCK {
   public:
@@ -194,11 +196,21 @@ class PACKET_QUEUE {
 
     PACKET *entry, processed_packet[2*MAX_READ_PER_CYCLE];
 
+    // occupancy bitmap over the entries and the slot holding each queued address,
+    // so lookups and the next-ready scans do not walk empty entries
+    // an address queued twice is counted in num_shadowed, and while any is,
+    // lookups fall back to scanning so the first match in queue order is still returned
+    vector<uint64_t> busy;
+    FLAT_MAP where;
+    uint32_t num_shadowed;
+    uint8_t match_full_addr;
+
     // constructor
     PACKET_QUEUE(string v1, uint32_t v2) : NAME(v1), SIZE(v2) {
         is_RQ = 0;
         is_WQ = 0;
         write_mode = 0;
+        match_full_addr = (NAME == "L1D_WQ");
 
         cpu = 0; 
         head = 0;
@@ -221,12 +233,13 @@ class PACKET_QUEUE {
         ROW_BUFFER_MISS = 0;
         FULL = 0;
 
-        entry = new PACKET[SIZE]; 
+        allocate();
     };
 
     PACKET_QUEUE() {
         is_RQ = 0;
         is_WQ = 0;
+        match_full_addr = 0;
 
         cpu = 0; 
         head = 0;
@@ -258,9 +271,34 @@ class PACKET_QUEUE {
     };
 
     // functions
+    void allocate();
     int check_queue(PACKET* packet);
     void add_queue(PACKET* packet),
          remove_queue(PACKET* packet);
+    void checkpoint(CHECKPOINT &cp);
+
+    // for queues filled in place (MSHR, DRAM queues) rather than through add_queue()
+    int check_address(uint64_t address);
+    void add_index(uint32_t index);
+    int free_index();
+
+    // first occupied entry at or after index, SIZE if there is none
+    uint32_t next_busy(uint32_t index) {
+        if (index >= SIZE)
+            return SIZE;
+        uint32_t word = index / 64;
+        uint64_t bits = busy[word] & (~0ULL << (index % 64));
+        while (bits == 0) {
+            if (++word == busy.size())
+                return SIZE;
+            bits = busy[word];
+        }
+        return word*64 + __builtin_ctzll(bits);
+    };
+
+  private:
+    uint64_t queue_key(PACKET *packet) { return match_full_addr ? packet->full_addr : packet->address; }
+    void remove_index(uint32_t index);
 };
 
 // reorder buffer
@@ -315,6 +353,8 @@ class CORE_BUFFER {
     ~CORE_BUFFER() {
         delete[] entry;
     };
+
+    void checkpoint(CHECKPOINT &cp);
 };
 
 // load/store queue 
@@ -382,5 +422,7 @@ class LOAD_STORE_QUEUE {
     ~LOAD_STORE_QUEUE() {
         delete[] entry;
     };
+
+    void checkpoint(CHECKPOINT &cp);
 };
 #endif
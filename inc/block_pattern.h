@@ -0,0 +1,181 @@
+#ifndef BLOCK_PATTERN_H
+#define BLOCK_PATTERN_H
+
+#include <stdint.h>
+#include <assert.h>
+#include <vector>
+#include "champsim.h"
+
+/* longest spatial region the patterns below can describe, 4KB of 64B blocks */
+#define PATTERN_MAX_BLOCKS 64
+
+/**
+ * Footprint of a spatial region, one bit per block, kept in a single word.
+ * Unlike Bitmap it carries its own length: RB/RSA concatenate and split patterns of
+ * neighbouring region sizes, and a zero-length pattern stands for "no pattern".
+ */
+class BlockPattern
+{
+public:
+    BlockPattern() : bits(0), len(0) {}
+    explicit BlockPattern(int len, uint64_t bits = 0) : bits(bits & low_mask(len)), len(len)
+    {
+        assert(len <= PATTERN_MAX_BLOCKS);
+    }
+
+    int size() const { return len; }
+    bool empty() const { return len == 0; }
+    uint64_t word() const { return bits; }
+
+    bool operator[](int i) const { return (bits >> i) & 1; }
+    void set(int i) { bits |= 1ULL << i; }
+    void reset(int i) { bits &= ~(1ULL << i); }
+
+    bool any() const { return bits != 0; }
+    int count() const { return __builtin_popcountll(bits); }
+    /* true if no block in [l, r) is set */
+    bool none(int l, int r) const { return !(bits & range_mask(l, r)); }
+    /* number of blocks in [l, r) that differ from `x` */
+    int count_diff(const BlockPattern &x, int l, int r) const { return __builtin_popcountll((bits ^ x.bits) & range_mask(l, r)); }
+
+    /* grows (zero-filled) or truncates the pattern */
+    void resize(int n)
+    {
+        assert(n <= PATTERN_MAX_BLOCKS);
+        bits &= low_mask(n);
+        len = n;
+    }
+
+    /* blocks [l, r) as a pattern of length r - l */
+    BlockPattern sub(int l, int r) const { return BlockPattern(r - l, bits >> l); }
+
+    BlockPattern operator|(const BlockPattern &x) const { return BlockPattern(len, bits | x.bits); }
+
+    /* concatenation, `x` becomes the upper blocks */
+    BlockPattern operator+(const BlockPattern &x) const
+    {
+        return BlockPattern(len + x.len, bits | (len < 64 ? x.bits << len : 0));
+    }
+
+    /* block i moves to block (i + n) mod size() */
+    BlockPattern rotate(int n) const
+    {
+        if (len == 0)
+            return *this;
+        n %= len;
+        if (n < 0)
+            n += len;
+        if (n == 0)
+            return *this;
+        return BlockPattern(len, (bits << n) | (bits >> (len - n)));
+    }
+
+    static uint64_t low_mask(int n) { return n >= 64 ? ~0ULL : (1ULL << n) - 1; }
+    static uint64_t range_mask(int l, int r) { return low_mask(r) & ~low_mask(l); }
+
+private:
+    uint64_t bits;
+    int len;
+};
+
+/**
+ * Prefetch fill level (0, FILL_L1, FILL_L2 or FILL_LLC) of every block of a spatial region,
+ * 2 bits per block, stored bit-sliced: bit i of `lo` and `hi` together encode block i.
+ */
+class FillPattern
+{
+public:
+    FillPattern() : lo(0), hi(0), len(0) {}
+    explicit FillPattern(int len) : lo(0), hi(0), len(len) { assert(len <= PATTERN_MAX_BLOCKS); }
+
+    int size() const { return len; }
+    bool empty() const { return len == 0; }
+
+    int operator[](int i) const { return code_level(((lo >> i) & 1) | (((hi >> i) & 1) << 1)); }
+
+    void set(int i, int fill_level)
+    {
+        uint64_t code = level_code(fill_level);
+        lo = (lo & ~(1ULL << i)) | ((code & 1) << i);
+        hi = (hi & ~(1ULL << i)) | ((code >> 1) << i);
+    }
+
+    /* sets every block of `x` to `fill_level` */
+    void set_blocks(const BlockPattern &x, int fill_level)
+    {
+        uint64_t code = level_code(fill_level);
+        uint64_t m = x.word() & BlockPattern::low_mask(len);
+        lo = (code & 1) ? (lo | m) : (lo & ~m);
+        hi = (code >> 1) ? (hi | m) : (hi & ~m);
+    }
+
+    /* blocks with a non-zero fill level */
+    BlockPattern blocks() const { return BlockPattern(len, lo | hi); }
+    bool any() const { return (lo | hi) != 0; }
+
+    /* blocks of `x` that are to be prefetched overwrite this pattern */
+    void merge(const FillPattern &x)
+    {
+        uint64_t m = x.lo | x.hi;
+        lo = (lo & ~m) | x.lo;
+        hi = (hi & ~m) | x.hi;
+    }
+
+    /* copies `x` over blocks [start, start + x.size()) */
+    void copy_at(int start, const FillPattern &x)
+    {
+        assert(start + x.len <= len);
+        uint64_t m = BlockPattern::low_mask(x.len) << start;
+        lo = (lo & ~m) | (x.lo << start);
+        hi = (hi & ~m) | (x.hi << start);
+    }
+
+    /* block i moves to block (i + n) mod size() */
+    FillPattern rotate(int n) const
+    {
+        FillPattern y(len);
+        y.lo = BlockPattern(len, lo).rotate(n).word();
+        y.hi = BlockPattern(len, hi).rotate(n).word();
+        return y;
+    }
+
+private:
+    static int code_level(uint64_t code)
+    {
+        static const int level[4] = {0, FILL_L1, FILL_L2, FILL_LLC};
+        return level[code];
+    }
+
+    static uint64_t level_code(int fill_level)
+    {
+        switch (fill_level)
+        {
+        case 0:
+            return 0;
+        case FILL_L1:
+            return 1;
+        case FILL_L2:
+            return 2;
+        case FILL_LLC:
+            return 3;
+        }
+        assert(0);
+        return 0;
+    }
+
+    uint64_t lo, hi;
+    int len;
+};
+
+/**
+ * Adds one to cnt[i] for every pattern of `x` that has block i set.
+ * Only the set bits of each pattern are visited.
+ */
+inline void count_votes(const std::vector<BlockPattern> &x, int *cnt)
+{
+    for (unsigned j = 0; j < x.size(); j += 1)
+        for (uint64_t bits = x[j].word(); bits; bits &= bits - 1)
+            cnt[__builtin_ctzll(bits)] += 1;
+}
+
+#endif /* BLOCK_PATTERN_H */
@@ -59,6 +59,7 @@ private:
 	void buffer_prefetch(vector<uint64_t> pref_addr);
 	void issue_prefetch(vector<uint64_t> &pref_addr);
 	void insert_rr(uint64_t address);
+	void checkpoint(CHECKPOINT &cp);
 
 public:
 	BOPrefetcher(string type);
@@ -66,7 +67,10 @@ public:
 	void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
 	void register_fill(uint64_t address);
 	void dump_stats();
+	void register_stats(string section);
 	void print_config();
+	void save(CHECKPOINT &cp);
+	void load(CHECKPOINT &cp);
 };
 
 #endif /* BOP_H */
@@ -3,6 +3,7 @@
 
 #include "memory_class.h"
 #include "prefetcher.h"
+#include "profile.h"
 
 // PAGE
 extern uint32_t PAGE_TABLE_LATENCY, SWAP_LATENCY;
@@ -128,9 +129,17 @@ class CACHE : public MEMORY {
     vector<Prefetcher*> prefetchers;
     vector<Prefetcher*> l1d_prefetchers;
 
+#ifdef ENABLE_PROFILE
+    // see register_profile() in main.cc
+    PROFILE_SITE profile_operate, profile_handle_fill, profile_handle_writeback, profile_handle_read, profile_handle_prefetch;
+#endif
+
     /* For semi-perfect cache */
     deque<uint64_t> page_buffer;
 
+    /* STLB misses whose page walk is left to the main thread under --parallel_cores */
+    vector<PACKET> page_walks;
+
     /* For cache accuracy measurement */
     uint64_t cycle, next_measure_cycle;
     uint64_t pf_useful_epoch, pf_filled_epoch;
@@ -221,6 +230,10 @@ class CACHE : public MEMORY {
          handle_read(),
          handle_prefetch();
 
+    uint64_t next_event_cycle(uint64_t current);
+    void fast_forward(uint64_t cycles);
+    void finish_page_walks();
+
     void add_mshr(PACKET *packet),
          update_fill_cycle(),
          llc_initialize_replacement(uint64_t rand_seed),
@@ -280,6 +293,9 @@ class CACHE : public MEMORY {
         l1d_prefetcher_broadcast_acc(uint32_t bw_level),
         l2c_prefetcher_broadcast_acc(uint32_t bw_level),
         llc_prefetcher_broadcast_acc(uint32_t bw_level);
+
+    void checkpoint(CHECKPOINT &cp),
+         llc_checkpoint_replacement(CHECKPOINT &cp);
 };
 
 #endif
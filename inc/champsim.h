@@ -19,6 +19,8 @@
 #include <string>
 #include <iomanip>
 
+#include "flat_map.h"
+
 // USEFUL MACROS
 //#define DEBUG_PRINT
 #define SANITY_CHECK
@@ -89,7 +91,7 @@ extern uint64_t current_core_cycle[NUM_CPUS],
                 drc_blocks;
 
 extern queue <uint64_t> page_queue;
-extern map <uint64_t, uint64_t> page_table, inverse_table, recent_page, unique_cl[NUM_CPUS];
+extern FLAT_MAP page_table, inverse_table, unique_cl[NUM_CPUS];
 extern uint64_t previous_ppage, num_adjacent_page, num_cl[NUM_CPUS], allocated_pages, num_page[NUM_CPUS], minor_fault[NUM_CPUS], major_fault[NUM_CPUS];
 
 void print_stats();
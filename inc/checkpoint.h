@@ -0,0 +1,208 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+#define CHECKPOINT_MAGIC "CSCKPT"
+#define CHECKPOINT_VERSION 4
+
+// snapshot of the simulator state right after finish_warmup()
+// every structure walks its state through one checkpoint() routine that either
+// appends to the image (save) or reads it back in the same order (restore)
+// the image is kept in memory and gzip-compressed to disk in one go, so sections
+// can be length-prefixed and skipped when the restoring run is configured differently
+class CHECKPOINT {
+  public:
+    // empty image to be filled and written with write_file()
+    CHECKPOINT();
+    // image read back from a file written by an earlier run
+    CHECKPOINT(const char *v1);
+
+    bool saving() { return SAVING; }
+    void write_file(const char *file_name);
+
+    // raw bytes, only for plain data without pointers (BLOCK, PACKET, ooo_model_instr, ...)
+    void bytes(void *data, size_t len);
+    template <typename T> void scalar(T &v) { bytes(&v, sizeof(T)); }
+    template <typename T> void array(T *v, size_t n) { bytes(v, sizeof(T) * n); }
+
+    void str(std::string &s);
+
+    // on save records value, on restore asserts that the restoring run has the same value
+    void check(uint64_t value, const char *what);
+    // named marker, catches a save/restore sequence that went out of sync
+    void section(const char *name);
+
+    template <typename K, typename V> void map_entries(std::map<K, V> &m) {
+        uint64_t n = m.size();
+        scalar(n);
+        if (SAVING) {
+            for (typename std::map<K, V>::iterator it = m.begin(); it != m.end(); it++) {
+                K k = it->first;
+                scalar(k);
+                scalar(it->second);
+            }
+        } else {
+            m.clear();
+            for (uint64_t i = 0; i < n; i++) {
+                K k;
+                V v;
+                scalar(k);
+                scalar(v);
+                m.insert(m.end(), std::make_pair(k, v));
+            }
+        }
+    }
+
+    // an unordered container iterates in an order set by its bucket count and insertion history,
+    // which end-of-run dumps print in. Restoring the bucket count with buckets() and inserting the
+    // entries in back_to_front() order rebuilds the same iteration order
+    template <typename C> void buckets(C &c) {
+        uint64_t n = c.bucket_count();
+        scalar(n);
+        if (!SAVING) {
+            c.clear();
+            c.rehash(n);
+        }
+    }
+    template <typename C> std::vector<typename C::iterator> back_to_front(C &c) {
+        std::vector<typename C::iterator> order;
+        for (typename C::iterator it = c.begin(); it != c.end(); it++)
+            order.push_back(it);
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+
+    template <typename K, typename V> void map_entries(std::unordered_map<K, V> &m) {
+        uint64_t n = m.size();
+        scalar(n);
+        buckets(m);
+        if (SAVING) {
+            std::vector<typename std::unordered_map<K, V>::iterator> order = back_to_front(m);
+            for (uint64_t i = 0; i < n; i++) {
+                K k = order[i]->first;
+                scalar(k);
+                scalar(order[i]->second);
+            }
+        } else {
+            for (uint64_t i = 0; i < n; i++) {
+                K k;
+                V v;
+                scalar(k);
+                scalar(v);
+                m.insert(std::make_pair(k, v));
+            }
+        }
+    }
+
+    template <typename T> void set_entries(std::unordered_set<T> &s) {
+        uint64_t n = s.size();
+        scalar(n);
+        buckets(s);
+        if (SAVING) {
+            std::vector<typename std::unordered_set<T>::iterator> order = back_to_front(s);
+            for (uint64_t i = 0; i < n; i++) {
+                T v = *order[i];
+                scalar(v);
+            }
+        } else {
+            for (uint64_t i = 0; i < n; i++) {
+                T v;
+                scalar(v);
+                s.insert(v);
+            }
+        }
+    }
+
+    template <typename T> void set_entries(std::set<T> &s) {
+        uint64_t n = s.size();
+        scalar(n);
+        if (SAVING) {
+            for (typename std::set<T>::iterator it = s.begin(); it != s.end(); it++) {
+                T v = *it;
+                scalar(v);
+            }
+        } else {
+            s.clear();
+            for (uint64_t i = 0; i < n; i++) {
+                T v;
+                scalar(v);
+                s.insert(s.end(), v);
+            }
+        }
+    }
+
+    template <typename T> void vector_entries(std::vector<T> &v) {
+        uint64_t n = v.size();
+        scalar(n);
+        if (!SAVING)
+            v.resize(n);
+        if (n)
+            array(&v[0], n);
+    }
+
+    template <typename T> void deque_entries(std::deque<T> &d) {
+        uint64_t n = d.size();
+        scalar(n);
+        if (!SAVING)
+            d.resize(n);
+        for (uint64_t i = 0; i < n; i++)
+            scalar(d[i]);
+    }
+
+    template <typename T> void queue_entries(std::queue<T> &q) {
+        std::deque<T> d;
+        if (SAVING) {
+            std::queue<T> copy = q;
+            while (!copy.empty()) {
+                d.push_back(copy.front());
+                copy.pop();
+            }
+        }
+        deque_entries(d);
+        if (!SAVING)
+            q = std::queue<T>(d);
+    }
+
+    // standard library random engines only expose their state through streams
+    template <typename E> void engine(E &e) {
+        std::string s;
+        if (SAVING) {
+            std::ostringstream out;
+            out << e;
+            s = out.str();
+        }
+        str(s);
+        if (!SAVING) {
+            std::istringstream in(s);
+            in >> e;
+        }
+    }
+
+    // state behind rand()/srand()
+    void libc_rand();
+
+    // length-prefixed blob, used for state the restoring run may not be able to consume
+    // begin_blob() returns the offset to hand to end_blob() on save, and the blob length on restore
+    uint64_t begin_blob();
+    void end_blob(uint64_t start);
+    void skip(uint64_t len);
+    uint64_t position() { return pos; }
+
+  private:
+    const bool SAVING;
+    std::vector<uint8_t> image;
+    uint64_t pos;
+};
+
+#endif
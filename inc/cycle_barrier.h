@@ -0,0 +1,40 @@
+#ifndef CYCLE_BARRIER_H
+#define CYCLE_BARRIER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+// spins this many times before yielding, threads are expected to arrive within a few microseconds
+#define CYCLE_BARRIER_SPINS 1024
+
+// reusable barrier for the threads of --parallel_cores, crossed twice per simulated cycle
+// the last thread to arrive opens the next phase, and the release/acquire pair on phase
+// makes everything written before the barrier visible to every thread after it
+class CYCLE_BARRIER {
+  public:
+    CYCLE_BARRIER(uint32_t v1) : NUM_THREADS(v1) {
+        waiting = 0;
+        phase = 0;
+    };
+
+    void wait() {
+        uint32_t current = phase.load(std::memory_order_acquire);
+        if (waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == NUM_THREADS) {
+            waiting.store(0, std::memory_order_relaxed);
+            phase.store(current + 1, std::memory_order_release);
+            return;
+        }
+
+        for (uint32_t spins = 0; phase.load(std::memory_order_acquire) == current; spins++) {
+            if (spins >= CYCLE_BARRIER_SPINS)
+                std::this_thread::yield();
+        }
+    }
+
+  private:
+    const uint32_t NUM_THREADS;
+    std::atomic<uint32_t> waiting, phase;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define DRAM_H
 
 #include "memory_class.h"
+#include "profile.h"
 
 // DRAM configuration
 #define DRAM_CHANNEL_WIDTH 8 // 8B
@@ -23,6 +24,56 @@ extern uint32_t DRAM_MTPS, DRAM_DBUS_RETURN_TIME, DRAM_DBUS_MAX_CAS;
 
 void print_dram_config();
 
+// DRAM coordinates of a queued request, decoded once when it enters RQ or WQ
+class DRAM_COORD {
+  public:
+    uint32_t rank, bank, row;
+};
+
+// index over the RQ or WQ of one channel, kept in step with the queue so the scheduler
+// looks at banks and scheduled requests instead of rescanning every entry and its address
+// pending[b] holds the unscheduled requests of bank b (rank*DRAM_BANKS + bank) oldest first,
+// by event_cycle and then queue index, the order in which the full-queue scans picked them;
+// scheduled holds the requests being served, at most one per bank
+// requests with a zero address are never scheduled and stay out of the lists, as in the scans
+class DRAM_QUEUE_INDEX {
+  public:
+    PACKET_QUEUE *queue;
+    vector<DRAM_COORD> coord;
+    vector<uint32_t> pending[DRAM_RANKS*DRAM_BANKS], scheduled;
+
+    // oldest pending request of each bank in row hit_row, -1 if none,
+    // computed on demand and kept until the bank's list or open row changes
+    int hit_index[DRAM_RANKS*DRAM_BANKS];
+    uint32_t hit_row[DRAM_RANKS*DRAM_BANKS];
+    uint8_t hit_valid[DRAM_RANKS*DRAM_BANKS];
+
+    void init(PACKET_QUEUE *v1);
+    void clear();
+
+    // i is served before j
+    bool older(uint32_t i, uint32_t j) {
+        return (queue->entry[i].event_cycle < queue->entry[j].event_cycle)
+               || ((queue->entry[i].event_cycle == queue->entry[j].event_cycle) && (i < j));
+    };
+
+    uint32_t bank_of(uint32_t index) { return coord[index].rank*DRAM_BANKS + coord[index].bank; };
+
+    // oldest pending request of bank b, -1 if none
+    int oldest(uint32_t b) { return pending[b].empty() ? -1 : pending[b][0]; };
+    // oldest pending request of bank b that hits open_row, -1 if none
+    int oldest_hit(uint32_t b, uint32_t open_row);
+
+    void add(uint32_t index, DRAM_COORD v1),
+         schedule(uint32_t index),
+         unschedule(uint32_t index),
+         remove(uint32_t index);
+
+  private:
+    void add_pending(uint32_t index),
+         remove_pending(uint32_t index);
+};
+
 // DRAM
 class MEMORY_CONTROLLER : public MEMORY {
   public:
@@ -39,6 +90,7 @@ class MEMORY_CONTROLLER : public MEMORY {
 
     // queues
     PACKET_QUEUE WQ[DRAM_CHANNELS], RQ[DRAM_CHANNELS];
+    DRAM_QUEUE_INDEX WQ_index[DRAM_CHANNELS], RQ_index[DRAM_CHANNELS];
     
     // to measure bandwidth
     uint64_t rq_enqueue_count, last_enqueue_count, epoch_enqueue_count, next_bw_measure_cycle;
@@ -46,6 +98,11 @@ class MEMORY_CONTROLLER : public MEMORY {
     uint64_t total_bw_epochs;
     uint64_t bw_level_hist[DRAM_BW_LEVELS];
 
+#ifdef ENABLE_PROFILE
+    // see register_profile() in main.cc
+    PROFILE_SITE profile_operate, profile_schedule, profile_process;
+#endif
+
     // constructor
     MEMORY_CONTROLLER(string v1) : NAME (v1) {
 	for(uint32_t channel = 0; channel < DRAM_CHANNELS; ++channel){    
@@ -71,11 +128,14 @@ class MEMORY_CONTROLLER : public MEMORY {
 
             WQ[i].NAME = "DRAM_WQ" + to_string(i);
             WQ[i].SIZE = DRAM_WQ_SIZE;
-            WQ[i].entry = new PACKET [DRAM_WQ_SIZE];
+            WQ[i].allocate();
 
             RQ[i].NAME = "DRAM_RQ" + to_string(i);
             RQ[i].SIZE = DRAM_RQ_SIZE;
-            RQ[i].entry = new PACKET [DRAM_RQ_SIZE];
+            RQ[i].allocate();
+
+            WQ_index[i].init(&WQ[i]);
+            RQ_index[i].init(&RQ[i]);
         }
 
         fill_level = FILL_DRAM;
@@ -109,6 +169,12 @@ class MEMORY_CONTROLLER : public MEMORY {
          update_process_cycle(PACKET_QUEUE *queue),
          reset_remain_requests(PACKET_QUEUE *queue, uint32_t channel);
 
+    DRAM_QUEUE_INDEX *queue_index(PACKET_QUEUE *queue) {
+        return queue->is_WQ ? &WQ_index[queue - WQ] : &RQ_index[queue - RQ];
+    };
+    void rebuild_queue_index(DRAM_QUEUE_INDEX *index);
+
+    DRAM_COORD dram_get_coord(uint64_t address);
     uint32_t dram_get_channel(uint64_t address),
              dram_get_rank   (uint64_t address),
              dram_get_bank   (uint64_t address),
@@ -116,9 +182,12 @@ class MEMORY_CONTROLLER : public MEMORY {
              dram_get_column (uint64_t address),
              drc_check_hit (uint64_t address, uint32_t cpu, uint32_t channel, uint32_t rank, uint32_t bank, uint32_t row);
 
-    uint64_t get_bank_earliest_cycle();
+    uint64_t get_bank_earliest_cycle(),
+             next_event_cycle(uint64_t current);
 
     int check_dram_queue(PACKET_QUEUE *queue, PACKET *packet);
+
+    void checkpoint(CHECKPOINT &cp);
 };
 
 #endif
@@ -6,6 +6,7 @@
 #include <limits.h>
 #include "bitmap.h"
 #include "prefetcher.h"
+#include "entry_pool.h"
 
 #define DSPATCH_MAX_BW_LEVEL 4
 
@@ -71,8 +72,8 @@ public:
 class DSPatch : public Prefetcher
 {
 private:
-	deque<DSPatch_PBEntry*> page_buffer;
-	DSPatch_SPTEntry **spt;
+	ENTRY_POOL<DSPatch_PBEntry> page_buffer; /* keyed by page, FIFO */
+	DSPatch_SPTEntry *spt;
 	deque<uint64_t> pref_buffer;
 
 	/* 0 => b/w is less than 25% of peak
@@ -156,8 +157,11 @@ public:
 	~DSPatch();
 	void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
 	void dump_stats();
+	void register_stats(string section);
 	void print_config();
 	void update_bw(uint8_t bw);
+	void save(CHECKPOINT &cp);
+	void load(CHECKPOINT &cp);
 };
 
 
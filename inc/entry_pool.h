@@ -0,0 +1,268 @@
+#ifndef ENTRY_POOL_H
+#define ENTRY_POOL_H
+
+#include <stdint.h>
+#include <assert.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "flat_map.h"
+
+#define ENTRY_POOL_NIL UINT32_MAX
+
+// fixed-capacity arena for the tracking tables of the prefetchers
+// all entries live in one array allocated by init(), and are constructed in place on insert
+// and destroyed in place on erase, so a full table recycles its slots without touching the heap
+// live entries are kept on an intrusive doubly linked list: front() is the oldest (FIFO) or
+// least recently used entry, back() the newest, and move_to_back() refreshes an entry
+// a pool created with keyed = true also maps a uint64_t key per entry to its slot
+// entries sharing a key are chained in the order their keys were set, which is list order
+// for a FIFO that only adds at the back
+template <typename T> class ENTRY_POOL {
+  public:
+    class iterator {
+      public:
+        iterator(ENTRY_POOL *v1, uint32_t v2) : pool(v1), index(v2) {};
+        T &operator*() const { return *pool->entry(index); }
+        T *operator->() const { return pool->entry(index); }
+        iterator &operator++() {
+            index = pool->link[index].next;
+            return *this;
+        }
+        bool operator==(const iterator &v1) const { return index == v1.index; }
+        bool operator!=(const iterator &v1) const { return index != v1.index; }
+
+      private:
+        ENTRY_POOL *pool;
+        uint32_t index;
+    };
+
+    // the key index stays at its smallest size unless init() asks for it
+    ENTRY_POOL() : keys(0) {
+        head = tail = free_head = ENTRY_POOL_NIL;
+        num_entries = 0;
+        keyed = false;
+    };
+
+    // lets pools be kept in a std::vector, entries stay where they are
+    ENTRY_POOL(ENTRY_POOL &&v1) noexcept : slot(std::move(v1.slot)), link(std::move(v1.link)), keys(std::move(v1.keys)) {
+        head = v1.head;
+        tail = v1.tail;
+        free_head = v1.free_head;
+        num_entries = v1.num_entries;
+        keyed = v1.keyed;
+        v1.head = v1.tail = v1.free_head = ENTRY_POOL_NIL;
+        v1.num_entries = 0;
+    };
+    ENTRY_POOL(const ENTRY_POOL &) = delete;
+    ENTRY_POOL &operator=(const ENTRY_POOL &) = delete;
+
+    ~ENTRY_POOL() { clear(); };
+
+    // allocates room for v1 entries, the only allocation the pool ever does
+    void init(uint32_t v1, bool v2 = false) {
+        assert(num_entries == 0);
+        slot.resize(v1);
+        link.resize(v1);
+        keyed = v2;
+        if (keyed)
+            keys = FLAT_MAP(v1);
+        head = tail = ENTRY_POOL_NIL;
+        free_head = ENTRY_POOL_NIL;
+        for (uint32_t i = v1; i-- > 0;) {
+            link[i].next = free_head;
+            free_head = i;
+        }
+    }
+
+    uint32_t size() const { return num_entries; }
+    uint32_t capacity() const { return slot.size(); }
+    bool empty() const { return num_entries == 0; }
+    bool full() const { return free_head == ENTRY_POOL_NIL; }
+
+    T *front() { return entry(head); }
+    T *back() { return entry(tail); }
+    // neighbours in list order, NULL past either end
+    T *next(T *v1) { return entry(link[index_of(v1)].next); }
+    T *prev(T *v1) { return entry(link[index_of(v1)].prev); }
+
+    iterator begin() { return iterator(this, head); }
+    iterator end() { return iterator(this, ENTRY_POOL_NIL); }
+
+    // first entry in list order for which v1 holds, NULL if none
+    template <typename P> T *find_if(P v1) {
+        for (uint32_t i = head; i != ENTRY_POOL_NIL; i = link[i].next) {
+            if (v1(*entry(i)))
+                return entry(i);
+        }
+        return NULL;
+    }
+
+    template <typename... A> T *emplace_back(A &&... v1) {
+        uint32_t i = allocate(std::forward<A>(v1)...);
+        link[i].prev = tail;
+        link[i].next = ENTRY_POOL_NIL;
+        if (tail != ENTRY_POOL_NIL)
+            link[tail].next = i;
+        else
+            head = i;
+        tail = i;
+        return entry(i);
+    }
+
+    template <typename... A> T *emplace_front(A &&... v1) {
+        uint32_t i = allocate(std::forward<A>(v1)...);
+        link[i].prev = ENTRY_POOL_NIL;
+        link[i].next = head;
+        if (head != ENTRY_POOL_NIL)
+            link[head].prev = i;
+        else
+            tail = i;
+        head = i;
+        return entry(i);
+    }
+
+    void pop_front() { erase(front()); }
+    void pop_back() { erase(back()); }
+
+    // destroys v1 and returns its slot to the free list
+    void erase(T *v1) {
+        uint32_t i = index_of(v1);
+        if (link[i].keyed)
+            unlink_key(i);
+        unlink(i);
+        v1->~T();
+        link[i].next = free_head;
+        free_head = i;
+        num_entries--;
+    }
+
+    void move_to_back(T *v1) {
+        uint32_t i = index_of(v1);
+        if (i == tail)
+            return;
+        unlink(i);
+        link[i].prev = tail;
+        link[i].next = ENTRY_POOL_NIL;
+        link[tail].next = i;
+        tail = i;
+    }
+
+    void move_to_front(T *v1) {
+        uint32_t i = index_of(v1);
+        if (i == head)
+            return;
+        unlink(i);
+        link[i].prev = ENTRY_POOL_NIL;
+        link[i].next = head;
+        link[head].prev = i;
+        head = i;
+    }
+
+    void clear() {
+        while (head != ENTRY_POOL_NIL)
+            pop_front();
+    }
+
+    // key index, only for pools created with keyed = true
+    // v1 goes to the end of the chain of v2, a previous key of v1 is dropped
+    void set_key(T *v1, uint64_t v2) {
+        assert(keyed);
+        uint32_t i = index_of(v1);
+        if (link[i].keyed)
+            unlink_key(i);
+        link[i].keyed = true;
+        link[i].key = v2;
+        link[i].next_key = ENTRY_POOL_NIL;
+
+        uint64_t *first = keys.find(v2);
+        if (first == NULL) {
+            keys.insert(v2, i);
+            link[i].prev_key = i;
+        } else {
+            uint32_t last = link[*first].prev_key;
+            link[last].next_key = i;
+            link[i].prev_key = last;
+            link[*first].prev_key = i;
+        }
+    }
+
+    // first entry with key v1, NULL if none
+    T *find(uint64_t v1) {
+        assert(keyed);
+        uint64_t *i = keys.find(v1);
+        return i ? entry(*i) : NULL;
+    }
+
+    // next entry with the same key as v1, NULL at the end of the chain
+    T *next_with_key(T *v1) { return entry(link[index_of(v1)].next_key); }
+
+  private:
+    // prev_key of the first entry of a chain points to the last one
+    class LINK {
+      public:
+        uint32_t prev, next;
+        uint32_t prev_key, next_key;
+        bool keyed;
+        uint64_t key;
+    };
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type STORAGE;
+
+    std::vector<STORAGE> slot;
+    std::vector<LINK> link;
+    FLAT_MAP keys;
+    uint32_t head, tail, free_head, num_entries;
+    bool keyed;
+
+    T *entry(uint32_t i) { return i == ENTRY_POOL_NIL ? NULL : reinterpret_cast<T *>(&slot[i]); }
+
+    uint32_t index_of(T *v1) {
+        uint32_t i = reinterpret_cast<STORAGE *>(v1) - &slot[0];
+        assert(i < slot.size());
+        return i;
+    }
+
+    template <typename... A> uint32_t allocate(A &&... v1) {
+        assert(free_head != ENTRY_POOL_NIL);
+        uint32_t i = free_head;
+        free_head = link[i].next;
+        new (&slot[i]) T(std::forward<A>(v1)...);
+        link[i].keyed = false;
+        num_entries++;
+        return i;
+    }
+
+    void unlink_key(uint32_t i) {
+        uint64_t *first = keys.find(link[i].key);
+        uint32_t next_key = link[i].next_key;
+        if (*first == i) {
+            if (next_key == ENTRY_POOL_NIL)
+                keys.erase(link[i].key);
+            else {
+                link[next_key].prev_key = link[i].prev_key;
+                *first = next_key;
+            }
+        } else {
+            link[link[i].prev_key].next_key = next_key;
+            if (next_key != ENTRY_POOL_NIL)
+                link[next_key].prev_key = link[i].prev_key;
+            else
+                link[*first].prev_key = link[i].prev_key;
+        }
+        link[i].keyed = false;
+    }
+
+    void unlink(uint32_t i) {
+        if (link[i].prev != ENTRY_POOL_NIL)
+            link[link[i].prev].next = link[i].next;
+        else
+            head = link[i].next;
+        if (link[i].next != ENTRY_POOL_NIL)
+            link[link[i].next].prev = link[i].prev;
+        else
+            tail = link[i].prev;
+    }
+};
+
+#endif
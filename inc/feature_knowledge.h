@@ -3,7 +3,10 @@
 
 #include <string>
 #include "scooby_helper.h"
+#include "fixed_point_q.h"
+#include "util.h"
 #define FK_MAX_TILINGS 32
+#define FK_ROW_ALIGN 16 /* in actions: float rows start on a 64B line, fixed-point rows on 32B */
 
 typedef enum
 {
@@ -41,9 +44,18 @@ private:
 	float m_weight;
 	float m_weight_gradient;
 	uint32_t m_hash_type;
+	HashZoo::hash_fn m_hash; /* m_hash_type, resolved at construction */
 
 	uint32_t m_num_tilings, m_num_tiles;
-	float ***m_qtable;
+	/* Q-table is one [tiling][tile][action] block, with action rows padded to m_row_size actions */
+	uint32_t m_row_size;
+	float *m_qtable;
+	float *m_q_sum; /* one row of scratch for retrieveQ */
+	/* le_enable_fixed_point: Q-values live in m_qtable_fx, same layout */
+	bool m_fixed_point;
+	FixedPointQ m_fixed;
+	int16_t *m_qtable_fx;
+	int32_t *m_q_sum_fx;
 	bool m_enable_tiling_offset;
 
 	float min_weight, max_weight;
@@ -57,7 +69,10 @@ private:
 private:
 	float getQ(uint32_t tiling, uint32_t tile_index, uint32_t action);
 	void setQ(uint32_t tiling, uint32_t tile_index, uint32_t action, float value);
+	inline float* getRow(uint32_t tiling, uint32_t tile_index) {return m_qtable + ((uint64_t)tiling * m_num_tiles + tile_index) * m_row_size;}
+	inline int16_t* getRowFx(uint32_t tiling, uint32_t tile_index) {return m_qtable_fx + ((uint64_t)tiling * m_num_tiles + tile_index) * m_row_size;}
 	uint32_t get_tile_index(uint32_t tiling, State *state);
+	void get_tile_indices(State *state, uint32_t *tile_index);
 	string get_feature_string(State *state);
 
 	/* feature index generators */
@@ -90,9 +105,10 @@ public:
 	FeatureKnowledge(FeatureType feature_type, float alpha, float gamma, uint32_t actions, float weight, float weight_gradient, uint32_t num_tilings, uint32_t num_tiles, bool zero_init, uint32_t hash_type, int32_t enable_tiling_offset);
 	~FeatureKnowledge();
 	float retrieveQ(State *state, uint32_t action_index);
+	void retrieveQ(State *state, float *q_values); /* Q-values of all actions, hashes the state once per tiling */
 	void updateQ(State *state1, uint32_t action1, int32_t reward, State *state2, uint32_t action2);
 	static string getFeatureString(FeatureType type);
-	uint32_t getMaxAction(State *state); /* Called by featurewise engine only to get a consensus from all the features */
+	uint32_t getMaxAction(const float *q_values); /* Called by featurewise engine only to get a consensus from all the features */
 
 	/* weight manipulation */
 	inline void increase_weight() {m_weight = m_weight + m_weight_gradient * m_weight; if(m_weight < min_weight) min_weight = m_weight;}
@@ -100,6 +116,8 @@ public:
 	inline float get_weight() {return m_weight;}
 	inline float get_min_weight() {return min_weight;}
 	inline float get_max_weight() {return max_weight;}
+
+	void checkpoint(CHECKPOINT &cp);
 };
 
 #endif /* FEATURE_KNOWLEDGE */
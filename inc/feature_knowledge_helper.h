@@ -15,14 +15,14 @@ uint32_t FeatureKnowledge::process_PC(uint32_t tiling, uint64_t pc)
 {
 	uint32_t raw_index = folded_xor(pc, 2); /* 32-b folded XOR */
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
 uint32_t FeatureKnowledge::process_offset(uint32_t tiling, uint32_t offset)
 {
 	if(m_enable_tiling_offset) offset = offset ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, offset);
+	uint32_t hashed_index = m_hash(offset);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -30,7 +30,7 @@ uint32_t FeatureKnowledge::process_delta(uint32_t tiling, int32_t delta)
 {
 	uint32_t unsigned_delta = (delta < 0) ? (((-1) * delta) + (1 << (DELTA_BITS - 1))) : delta;
 	if(m_enable_tiling_offset) unsigned_delta = unsigned_delta ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, unsigned_delta);
+	uint32_t hashed_index = m_hash(unsigned_delta);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -38,7 +38,7 @@ uint32_t FeatureKnowledge::process_address(uint32_t tiling, uint64_t address)
 {
 	uint32_t raw_index = folded_xor(address, 2); /* 32-b folded XOR */
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -49,7 +49,7 @@ uint32_t FeatureKnowledge::process_PC_offset(uint32_t tiling, uint64_t pc, uint3
 	tmp += offset;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -60,7 +60,7 @@ uint32_t FeatureKnowledge::process_PC_address(uint32_t tiling, uint64_t pc, uint
 	tmp ^= address;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -71,28 +71,28 @@ uint32_t FeatureKnowledge::process_PC_page(uint32_t tiling, uint64_t pc, uint64_
 	tmp ^= page;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
 uint32_t FeatureKnowledge::process_PC_path(uint32_t tiling, uint32_t pc_path)
 {
 	if(m_enable_tiling_offset) pc_path = pc_path ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, pc_path);
+	uint32_t hashed_index = m_hash(pc_path);
 	return (hashed_index % m_num_tiles);
 }
 
 uint32_t FeatureKnowledge::process_delta_path(uint32_t tiling, uint32_t delta_path)
 {
 	if(m_enable_tiling_offset) delta_path = delta_path ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, delta_path);
+	uint32_t hashed_index = m_hash(delta_path);
 	return (hashed_index % m_num_tiles);
 }
 
 uint32_t FeatureKnowledge::process_offset_path(uint32_t tiling, uint32_t offset_path)
 {
 	if(m_enable_tiling_offset) offset_path = offset_path ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, offset_path);
+	uint32_t hashed_index = m_hash(offset_path);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -104,7 +104,7 @@ uint32_t FeatureKnowledge::process_PC_delta(uint32_t tiling, uint64_t pc, int32_
 	tmp += unsigned_delta;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -116,7 +116,7 @@ uint32_t FeatureKnowledge::process_PC_offset_delta(uint32_t tiling, uint64_t pc,
 	tmp = tmp << 7; tmp += unsigned_delta;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -124,7 +124,7 @@ uint32_t FeatureKnowledge::process_Page(uint32_t tiling, uint64_t page)
 {
 	uint32_t raw_index = folded_xor(page, 2); /* 32-b folded XOR */
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 
 }
@@ -136,7 +136,7 @@ uint32_t FeatureKnowledge::process_PC_Path_Offset(uint32_t tiling, uint32_t pc_p
 	tmp += offset;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -147,7 +147,7 @@ uint32_t FeatureKnowledge::process_PC_Path_Offset_Path(uint32_t tiling, uint32_t
 	tmp += offset_path;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -159,7 +159,7 @@ uint32_t FeatureKnowledge::process_PC_Path_Delta(uint32_t tiling, uint32_t pc_pa
 	tmp += unsigned_delta;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -170,7 +170,7 @@ uint32_t FeatureKnowledge::process_PC_Path_Delta_Path(uint32_t tiling, uint32_t
 	tmp += delta_path;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -181,7 +181,7 @@ uint32_t FeatureKnowledge::process_PC_Path_Offset_Path_Delta_Path(uint32_t tilin
 	tmp = tmp << 10; tmp ^= delta_path;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -192,7 +192,7 @@ uint32_t FeatureKnowledge::process_Offset_Path_PC(uint32_t tiling, uint32_t offs
 	tmp += pc;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
@@ -203,7 +203,7 @@ uint32_t FeatureKnowledge::process_Delta_Path_PC(uint32_t tiling, uint32_t delta
 	tmp += pc;
 	uint32_t raw_index = folded_xor(tmp, 2);
 	if(m_enable_tiling_offset) raw_index = raw_index ^ tiling_offset[tiling];
-	uint32_t hashed_index = HashZoo::getHash(m_hash_type, raw_index);
+	uint32_t hashed_index = m_hash(raw_index);
 	return (hashed_index % m_num_tiles);
 }
 
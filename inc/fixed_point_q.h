@@ -0,0 +1,62 @@
+#ifndef FIXED_POINT_Q_H
+#define FIXED_POINT_Q_H
+
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+
+/* fraction bits of alpha and gamma inside the fixed-point SARSA update */
+#define FIXED_Q_COEFF_BITS 16
+
+/*
+ * Fixed-point Q-value format of the learning engines (le_enable_fixed_point)
+ * A Q-value is a sign bit, int_bits integer bits and frac_bits fraction bits, held in an int16_t.
+ * Conversions and updates saturate at the largest magnitude the format can hold,
+ * so a Q-value pinned at the limit stays there instead of wrapping around.
+ */
+class FixedPointQ
+{
+private:
+	uint32_t m_int_bits, m_frac_bits;
+	int32_t m_max_value, m_min_value;
+	int64_t m_alpha, m_gamma; /* with FIXED_Q_COEFF_BITS fraction bits */
+
+	/* arithmetic shift right, rounding half up */
+	static int64_t round_shift(int64_t value, uint32_t shift) {return (value + ((int64_t)1 << (shift - 1))) >> shift;}
+
+public:
+	FixedPointQ() : m_int_bits(0), m_frac_bits(0), m_max_value(0), m_min_value(0), m_alpha(0), m_gamma(0) {}
+
+	void init(uint32_t int_bits, uint32_t frac_bits, float alpha, float gamma)
+	{
+		assert(frac_bits > 0 && int_bits + frac_bits <= 15);
+		m_int_bits = int_bits;
+		m_frac_bits = frac_bits;
+		m_max_value = (1 << (int_bits + frac_bits)) - 1;
+		m_min_value = -(1 << (int_bits + frac_bits));
+		m_alpha = llround((double)alpha * (1 << FIXED_Q_COEFF_BITS));
+		m_gamma = llround((double)gamma * (1 << FIXED_Q_COEFF_BITS));
+	}
+
+	inline int16_t saturate(int64_t value) const
+	{
+		if(value > m_max_value) return m_max_value;
+		if(value < m_min_value) return m_min_value;
+		return (int16_t)value;
+	}
+	inline int16_t from_float(float value) const {return saturate(llround((double)value * (1 << m_frac_bits)));}
+	/* also converts the int32_t sum of several Q-values */
+	inline float to_float(int32_t value) const {return (float)value / (1 << m_frac_bits);}
+
+	/* SARSA: Q(s1,a1) + alpha * (reward + gamma * Q(s2,a2) - Q(s1,a1)) */
+	inline int16_t sarsa(int16_t q1, int32_t reward, int16_t q2) const
+	{
+		int64_t target = (int64_t)reward * (1 << m_frac_bits) + round_shift(m_gamma * q2, FIXED_Q_COEFF_BITS);
+		return saturate(q1 + round_shift(m_alpha * (target - q1), FIXED_Q_COEFF_BITS));
+	}
+
+	uint32_t int_bits() const {return m_int_bits;}
+	uint32_t frac_bits() const {return m_frac_bits;}
+};
+
+#endif /* FIXED_POINT_Q_H */
@@ -0,0 +1,124 @@
+#ifndef FLAT_MAP_H
+#define FLAT_MAP_H
+
+#include <stdint.h>
+#include <assert.h>
+#include <vector>
+#include "checkpoint.h"
+
+#define FLAT_MAP_EMPTY UINT64_MAX
+#define FLAT_MAP_INITIAL_SIZE 1024
+
+// open-addressing hash map from uint64_t to uint64_t with linear probing
+// key and value share a slot in one flat array, so a lookup usually touches a single cache line
+// UINT64_MAX is reserved to mark empty slots and cannot be used as a key
+class FLAT_MAP {
+  public:
+    FLAT_MAP() {
+        slot.resize(FLAT_MAP_INITIAL_SIZE);
+        mask = FLAT_MAP_INITIAL_SIZE - 1;
+        num_entries = 0;
+    };
+
+    // sized up front for small maps with a known bound on the number of keys
+    FLAT_MAP(uint64_t max_entries) {
+        uint64_t n = 16;
+        while (n < 2*max_entries)
+            n *= 2;
+        slot.resize(n);
+        mask = n - 1;
+        num_entries = 0;
+    };
+
+    uint64_t size() { return num_entries; }
+
+    // value stored for key, NULL if key is not present
+    uint64_t *find(uint64_t key) {
+        for (uint64_t i = hash(key) & mask; slot[i].key != FLAT_MAP_EMPTY; i = (i+1) & mask) {
+            if (slot[i].key == key)
+                return &slot[i].value;
+        }
+        return NULL;
+    }
+
+    // key must not be present yet
+    void insert(uint64_t key, uint64_t value) {
+        assert(key != FLAT_MAP_EMPTY);
+
+        // kept at most half full so probe sequences stay short
+        if (2*(num_entries+1) > slot.size())
+            grow();
+
+        uint64_t i = hash(key) & mask;
+        while (slot[i].key != FLAT_MAP_EMPTY)
+            i = (i+1) & mask;
+        slot[i].key = key;
+        slot[i].value = value;
+        num_entries++;
+    }
+
+    void erase(uint64_t key) {
+        uint64_t i = hash(key) & mask;
+        while (slot[i].key != key) {
+            assert(slot[i].key != FLAT_MAP_EMPTY);
+            i = (i+1) & mask;
+        }
+
+        // backward-shift deletion: pull later entries of the probe sequence into the hole,
+        // so no tombstones are left behind
+        uint64_t hole = i;
+        for (uint64_t j = (i+1) & mask; slot[j].key != FLAT_MAP_EMPTY; j = (j+1) & mask) {
+            uint64_t home = hash(slot[j].key) & mask;
+            if (((j - home) & mask) >= ((j - hole) & mask)) {
+                slot[hole] = slot[j];
+                hole = j;
+            }
+        }
+        slot[hole].key = FLAT_MAP_EMPTY;
+        num_entries--;
+    }
+
+    void checkpoint(CHECKPOINT &cp) {
+        cp.vector_entries(slot);
+        cp.scalar(num_entries);
+        mask = slot.size() - 1;
+    }
+
+  private:
+    class SLOT {
+      public:
+        uint64_t key, value;
+
+        SLOT() {
+            key = FLAT_MAP_EMPTY;
+            value = 0;
+        };
+    };
+
+    std::vector<SLOT> slot;
+    uint64_t mask, num_entries;
+
+    static uint64_t hash(uint64_t key) {
+        // splitmix64 finalizer, page numbers are dense in their low bits
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return key;
+    }
+
+    void grow() {
+        std::vector<SLOT> old;
+        old.swap(slot);
+        slot.resize(2*old.size());
+        mask = slot.size() - 1;
+        num_entries = 0;
+        for (uint64_t i=0; i<old.size(); i++) {
+            if (old[i].key != FLAT_MAP_EMPTY)
+                insert(old[i].key, old[i].value);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef HISTORY_BUFFER_H
+#define HISTORY_BUFFER_H
+
+#include <stdint.h>
+#include <vector>
+#include "checkpoint.h"
+
+// history of accessed addresses (Domino's history buffer, sdomino's GHB), addressed by
+// pointers that count every insertion
+// with a capacity, only the last `capacity` blocks are kept in a ring, and pointers
+// to blocks that have been overwritten since are no longer valid
+class History_buffer
+{
+    std::vector<uint64_t> data;
+    uint64_t capacity;
+    uint64_t count = 0;
+
+public:
+    History_buffer(uint64_t capacity = 0) : capacity(capacity)
+    {
+        if (capacity)
+            data.resize(capacity);
+    }
+    uint64_t push(uint64_t address)
+    {
+        if (capacity)
+            data[count % capacity] = address;
+        else
+            data.emplace_back(address);
+        return count++;
+    }
+    uint64_t size()
+    {
+        return count;
+    }
+    bool valid(uint64_t pointer)
+    {
+        return pointer < count && (capacity == 0 || count - pointer <= capacity);
+    }
+    uint64_t operator[](uint64_t pointer)
+    {
+        return capacity ? data[pointer % capacity] : data[pointer];
+    }
+    void checkpoint(CHECKPOINT &cp)
+    {
+        cp.check(capacity, "history buffer capacity");
+        cp.vector_entries(data);
+        cp.scalar(count);
+    }
+};
+
+#endif /* HISTORY_BUFFER_H */
@@ -0,0 +1,65 @@
+#ifndef INTERVAL_STATS_H
+#define INTERVAL_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define INTERVAL_STATS_VERSION 1
+
+// time series of registered counters (--interval_stats_file)
+// every epoch the main loop takes one sample: the uncore cycle followed by the current value of
+// each column, read through the stats registry, so any counter a component registers can be traced
+// samples go to a ring preallocated at open(), split in two halves: when a half is full it is
+// handed to a writer thread that appends it to the file, while sampling goes on in the other half
+// the main loop only waits if the writer is still busy with that other half by then
+//
+// file layout, native byte order:
+//   char[8] "CSINTVL", uint32_t version, uint32_t number of columns N, uint64_t epoch in cycles
+//   N times: uint32_t length, name (not terminated)
+//   records of N+1 uint64_t: cycle, column 0, ..., column N-1
+class INTERVAL_STATS {
+  public:
+    INTERVAL_STATS();
+    ~INTERVAL_STATS();
+
+    // samples the registry entries named in v2 every v3 cycles into file v1, buffering v4 samples
+    void open(const char *v1, std::vector<std::string> &v2, uint64_t v3, uint32_t v4);
+    bool enabled() { return file != NULL; }
+    uint64_t next_cycle() { return next_sample_cycle; }
+
+    // called once per uncore cycle v1 is at or past next_cycle()
+    void sample(uint64_t v1);
+
+    // writes what is left and stops the writer
+    void close();
+
+  private:
+    FILE *file;
+    std::vector<std::function<uint64_t()> > columns;
+    uint64_t epoch, next_sample_cycle;
+
+    // ring of samples, record i at buffer[i * width]
+    std::vector<uint64_t> buffer;
+    uint32_t width, half, fill;
+
+    // halves handed to the writer, and how many records each holds
+    std::thread *writer;
+    std::mutex lock;
+    std::condition_variable handed, written;
+    bool pending[2];
+    uint32_t pending_records[2];
+    bool writer_exit;
+
+    void hand_off(uint32_t v1, uint32_t v2);
+    void write_halves();
+};
+
+extern INTERVAL_STATS interval_stats;
+
+#endif
@@ -78,8 +78,11 @@ public:
 	~IPCP_L1();
 	void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, std::vector<uint64_t> &pref_addr);
 	void dump_stats();
+	void register_stats(std::string section);
 	void print_config();
 	void cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
+	void save(CHECKPOINT &cp);
+	void load(CHECKPOINT &cp);
 };
 
 #endif /* IPCP_L1_H */
@@ -8,6 +8,8 @@
 #include <algorithm>
 #include "prefetcher.h"
 #include "cache.h"
+#include "flat_map.h"
+#include "bakshalipour_framework.h"
 
 
 // #define TU_WAY_COUNT 256
@@ -133,45 +135,191 @@ public:
     }
 };
 
+// entries of one off-chip mapping, stored by value in a flat array and found through a FLAT_MAP
+// from key to slot; the slots of erased entries are reused
+template <class T> class MetadataTable
+{
+public:
+    T *find(uint64_t key){
+        uint64_t *slot = index.find(key);
+        return slot ? &entries[*slot] : NULL;
+    }
+    // key must not be present yet
+    T *insert(uint64_t key){
+        uint64_t slot;
+        if (free_slots.empty()){
+            slot = entries.size();
+            entries.emplace_back();
+        }else{
+            slot = free_slots.back();
+            free_slots.pop_back();
+            entries[slot] = T();
+        }
+        index.insert(key, slot);
+        return &entries[slot];
+    }
+    void erase(uint64_t key){
+        uint64_t *slot = index.find(key);
+        if (slot == NULL)
+            return;
+        free_slots.push_back(*slot);
+        index.erase(key);
+    }
+    void clear(){
+        index = FLAT_MAP();
+        entries.clear();
+        free_slots.clear();
+    }
+    uint64_t size(){ return index.size(); }
+    void checkpoint(CHECKPOINT &cp){
+        index.checkpoint(cp);
+        cp.vector_entries(entries);
+        cp.vector_entries(free_slots);
+    }
+
+private:
+    FLAT_MAP index;
+    vector<T> entries;
+    vector<uint64_t> free_slots;
+};
+
+// on-chip cache of one off-chip mapping, in lines of `line_entries` consecutive keys
+// a line missing on chip is read from DRAM, and one that was written is written back on eviction
+// with no lines, all metadata is on chip and nothing is counted
+class MetadataCache
+{
+public:
+    // a disabled cache (size 0) ignores ways
+    MetadataCache(int size, int ways, int line_entries)
+    : size(size), line_entries(line_entries), lines(TableGeometry(size > 0, size, ways)), hits(0), misses(0), writebacks(0){}
+    bool enabled(){ return size > 0; }
+
+    // returns whether the line of key was on chip, it is afterwards
+    bool access(uint64_t key, bool write){
+        if (!enabled())
+            return true;
+        uint64_t line = key / line_entries;
+        LRUSetAssociativeCache<bool>::Entry *entry = lines.find(line);
+        bool hit = (entry != NULL);
+        if (hit){
+            hits++;
+            entry->data = entry->data || write;
+        }else{
+            misses++;
+            LRUSetAssociativeCache<bool>::Entry victim = lines.insert(line, write);
+            if (victim.valid && victim.data)
+                writebacks++;
+        }
+        lines.set_mru(line);
+        return hit;
+    }
+    void checkpoint(CHECKPOINT &cp){
+        cp.check(size, "ISB metadata cache size");
+        cp.check(line_entries, "ISB metadata line entries");
+        if (enabled())
+            lines.checkpoint(cp);
+        cp.scalar(hits);
+        cp.scalar(misses);
+        cp.scalar(writebacks);
+    }
+
+private:
+    int size;
+    int line_entries;
+    LRUSetAssociativeCache<bool> lines; // data is the dirty bit
+
+public:
+    uint64_t hits, misses, writebacks;
+};
+
+// unique keys accessed within consecutive windows of 1k, 10k, 100k and 1M accesses
+class AccessWindows
+{
+public:
+    static const int NUM_WINDOWS = 4;
+
+    AccessWindows() : total(0){
+        for (int i = 0; i < NUM_WINDOWS; i++)
+            window[i] = 1;
+    }
+    void access(uint64_t key){
+        static const uint64_t length[NUM_WINDOWS] = {1000, 10000, 100000, 1000000};
+        frequency[key]++;
+        total++;
+        for (int i = 0; i < NUM_WINDOWS; i++){
+            keys[i].insert(key);
+            if (total % length[i] == 0){
+                unique[i].insert(pair<uint64_t, uint64_t>(window[i], keys[i].size()));
+                window[i]++;
+                keys[i].clear();
+            }
+        }
+    }
+    // average number of unique keys in the completed windows of size i
+    double average_unique(int i){
+        uint64_t sum = 0;
+        for (map<uint64_t, uint64_t>::iterator it = unique[i].begin(); it != unique[i].end(); ++it)
+            sum += it->second;
+        return unique[i].empty() ? 0.0 : (double)sum / unique[i].size();
+    }
+    uint64_t distinct_keys(){ return frequency.size(); }
+    void checkpoint(CHECKPOINT &cp){
+        cp.scalar(total);
+        cp.array(window, NUM_WINDOWS);
+        for (int i = 0; i < NUM_WINDOWS; i++){
+            cp.set_entries(keys[i]);
+            cp.map_entries(unique[i]);
+        }
+        cp.map_entries(frequency);
+    }
+
+private:
+    uint64_t total, window[NUM_WINDOWS];
+    set<uint64_t> keys[NUM_WINDOWS];
+    map<uint64_t, uint64_t> unique[NUM_WINDOWS]; // window number -> unique keys in it
+    map<uint64_t, uint64_t> frequency;           // accesses per key
+};
+
 class OffChipInfo{
 public:
-    OffChipInfo(int debug_level = 0):debug_level(debug_level){
+    OffChipInfo(int debug_level, bool window_stats, int cache_size, int cache_ways, int line_entries)
+    : debug_level(debug_level), window_stats(window_stats),
+      ps_cache(cache_size, cache_ways, line_entries), sp_cache(cache_size, cache_ways, line_entries){
         reset();
-	    win1k_ps = win10k_ps = win100k_ps = win1m_ps = win1k_sp = win10k_sp = win100k_sp = win1m_sp = 1;
-	    total_access_counter_ps = total_access_counter_sp = 0;
     }
     
     void reset(){
         ps_map.clear();
         sp_map.clear();
     }
-    bool get_structural_address(uint64_t phy_addr, unsigned int& str_addr);
-    bool get_physical_address(uint64_t& phy_addr, unsigned int str_addr);
+    // with metadata_miss, the lookup is on the prediction path: it fails if the metadata is not on chip,
+    // and reports so, as the mapping only arrives after the prefetch would be useful
+    bool get_structural_address(uint64_t phy_addr, unsigned int& str_addr, bool *metadata_miss = NULL);
+    // the off-chip mapping itself, without going through the modeled ps_cache
+    bool find_structural_address(uint64_t phy_addr, unsigned int& str_addr);
+    bool get_physical_address(uint64_t& phy_addr, unsigned int str_addr, bool *metadata_miss = NULL);
     void update(uint64_t phy_addr, unsigned int str_addr);
     // void update_physical(uint64_t phy_addr, unsigned int str_addr);
     // void update_structural(uint64_t phy_addr, unsigned int str_addr);
     void invalidate(uint64_t phy_addr, unsigned int str_addr);
     int increase_confidence(uint64_t phy_addr);
     int lower_confidence(uint64_t phy_addr);
-    void print_stats();
+    void register_stats();
+    void checkpoint(CHECKPOINT &cp);
 
 private:
     int debug_level = 0;
-    map<uint64_t,PS_Entry*> ps_map;
-    map<unsigned int,SP_Entry*> sp_map;
+    MetadataTable<PS_Entry> ps_map;
+    MetadataTable<SP_Entry> sp_map;
 
     // Stats
-    map<uint64_t, uint64_t> ps_map_access_frequency;
-	map<unsigned int, uint64_t> sp_map_access_frequency;
-	
-    //Windows within which we are trying to capture the number of unique accesses to ps_map and sp_map. 
-	uint64_t win1k_ps, win10k_ps, win100k_ps, win1m_ps, total_access_counter_ps, win1k_sp, win10k_sp, win100k_sp, win1m_sp, total_access_counter_sp;
+    // unique accesses to ps_map and sp_map per window, only kept with ISB_window_stats
+    bool window_stats;
+    AccessWindows ps_windows, sp_windows;
 
-	set<uint64_t> win1k_ps_access_keys, win10k_ps_access_keys, win100k_ps_access_keys, win1m_ps_access_keys;
-	set<unsigned int> win1k_sp_access_keys, win10k_sp_access_keys, win100k_sp_access_keys, win1m_sp_access_keys;
-
-	//Not total accesses, but unique accesses.
-	map<uint64_t, uint64_t> win1k_ps_map_accesses, win10k_ps_map_accesses, win100k_ps_map_accesses, win1m_ps_map_accesses, win1k_sp_map_accesses, win10k_sp_map_accesses, win100k_sp_map_accesses, win1m_sp_map_accesses;
+public:
+    // modeled on-chip PS and SP caches
+    MetadataCache ps_cache, sp_cache;
 };
 
 class ISB : public Prefetcher{
@@ -182,6 +330,9 @@ public:
     void register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
     void dump_stats();
     void print_config();
+    void register_stats(string section);
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
 
 private:
     unsigned int train(unsigned int str_addr_A, uint64_t phy_addr_B);
@@ -210,11 +361,12 @@ private:
     // Stat
     uint64_t exceed_stream_alloc = 0;
     uint64_t stream_divergence_count = 0;
-    unsigned int total_access = 0;
-    unsigned int predictions = 0;
-    unsigned int no_prediction = 0;
-    unsigned int stream_end = 0;
-    unsigned int no_translation = 0;
+    uint64_t total_access = 0;
+    uint64_t predictions = 0;
+    uint64_t no_prediction = 0;
+    uint64_t stream_end = 0;
+    uint64_t no_translation = 0;
+    uint64_t metadata_miss = 0;
     unsigned int reuse = 0;
 };
 
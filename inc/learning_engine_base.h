@@ -45,7 +45,12 @@ protected:
 public:
 	LearningEngineBase(Prefetcher *p, float alpha, float gamma, float epsilon, uint32_t actions, uint32_t states, uint64_t seed, std::string policy, std::string type);
 	virtual ~LearningEngineBase(){};
+	/* counters go to the stats registry section the parent prefetcher has open,
+	 * dump_stats() only finishes the traces and score plots */
+	virtual void register_stats() = 0;
 	virtual void dump_stats() = 0;
+	/* Q-values, RNG and counters for --checkpoint_save/--checkpoint_load, traces restart */
+	virtual void checkpoint(CHECKPOINT &cp) = 0;
 
 	inline void setAlpha(float alpha){m_alpha = alpha;}
 	inline float getAlpha(){return m_alpha;}
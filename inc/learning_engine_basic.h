@@ -5,6 +5,7 @@
 #include <string.h>
 #include "prefetcher.h"
 #include "learning_engine_base.h"
+#include "fixed_point_q.h"
 
 #define MAX_ACTIONS 64
 
@@ -33,6 +34,10 @@ private:
     std::uniform_int_distribution<int> *actiongen;
 
 	float **qtable;
+	/* le_enable_fixed_point: Q-values live in qtable_fx instead */
+	bool fixed_point;
+	FixedPointQ fixed;
+	int16_t **qtable_fx;
 
 	/* tracing related knobs */
 	uint32_t trace_interval;
@@ -64,7 +69,7 @@ private:
 	void updateQ(uint32_t state, uint32_t action, float value);
 	std::string getStringQ(uint32_t state);
 	uint32_t getMaxAction(uint32_t state);
-	void print_aux_stats();
+	uint32_t count_used_states();
 	void dump_state_trace(uint32_t state);
 	void plot_scores();
 	void dump_action_trace(uint32_t action);
@@ -75,7 +80,9 @@ public:
 
 	uint32_t chooseAction(uint32_t state);
 	void learn(uint32_t state1, uint32_t action1, int32_t reward, uint32_t state2, uint32_t action2);
+	void register_stats();
 	void dump_stats();
+	void checkpoint(CHECKPOINT &cp);
 };
 
 #endif /* LEARNING_ENGINE */
@@ -9,6 +9,7 @@ class LearningEngineFeaturewise : public LearningEngineBase
 {
 private:
 	FeatureKnowledge* m_feature_knowledges[NumFeatureTypes];
+	float m_feature_q_values[NumFeatureTypes][MAX_ACTIONS]; /* per-feature Q-values of the state last consulted */
 	float m_max_q_value;
 
 	std::default_random_engine m_generator;
@@ -56,7 +57,7 @@ private:
 	void init_knobs();
 	void init_stats();
 	uint32_t getMaxAction(State *state, float &max_q, float &max_to_avg_q_ratio, vector<bool> &consensus_vec);
-	float consultQ(State *state, uint32_t action);
+	void consultQ(State *state, float *q_values);
 	void gather_stats(float max_q, float max_to_avg_q_ratio);
 	void action_selection_consensus(State *state, uint32_t selected_action, vector<bool> &consensus_vec);
 	void adjust_feature_weights(vector<bool> consensus_vec, RewardType reward_type);
@@ -68,7 +69,9 @@ public:
 	~LearningEngineFeaturewise();
 	uint32_t chooseAction(State *state, float &max_to_avg_q_ratio, vector<bool> &consensus_vec);
 	void learn(State *state1, uint32_t action1, int32_t reward, State *state2, uint32_t action2, vector<bool> consensus_vec, RewardType reward_type);
+	void register_stats();
 	void dump_stats();
+	void checkpoint(CHECKPOINT &cp);
 };
 
 #endif /* LEARNING_ENGINE_FEATUREWISE_H */
@@ -32,6 +32,12 @@ class AccessMapData {
     vector<int> prefetch_map;
 
     deque<int> hist_queue;
+
+    void checkpoint(CHECKPOINT &cp) {
+        cp.vector_entries(access_map);
+        cp.vector_entries(prefetch_map);
+        cp.deque_entries(hist_queue);
+    }
 };
 
 class AccessMapTable : public LRUSetAssociativeCache<AccessMapData> {
@@ -134,6 +140,10 @@ class AccessMapTable : public LRUSetAssociativeCache<AccessMapData> {
         return Super::log(headers);
     }
 
+    void checkpoint(CHECKPOINT &cp) {
+        Super::checkpoint(cp, [](CHECKPOINT &cp, AccessMapData &data) { data.checkpoint(cp); });
+    }
+
   private:
     /* @override */
     void write_data(Entry &entry, Table &table, int row) {
@@ -203,6 +213,7 @@ private:
 private:
 	void init_knobs();
 	void init_stats();
+	void checkpoint(CHECKPOINT &cp);
 
 public:
 	MLOP(string type, CACHE *cache);
@@ -210,7 +221,10 @@ public:
 	void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, std::vector<uint64_t> &pref_addr);
 	void register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
 	void dump_stats();
+	void register_stats(string section);
 	void print_config();
+	void save(CHECKPOINT &cp);
+	void load(CHECKPOINT &cp);
 
 	void access(uint64_t block_number);
 	void prefetch(CACHE *cache, uint64_t block_number, std::vector<uint64_t> &pref_addr);
@@ -220,7 +234,6 @@ public:
     void log();
     void track(uint64_t block_number);
     void reset_stats();
-    void print_stats();
 };
 
 # endif /* MLOP_H */
@@ -1,9 +1,9 @@
 #ifndef NEXT_LINE
 #define NEXT_LINE
 
-#include <deque>
 #include <random>
 #include "prefetcher.h"
+#include "entry_pool.h"
 using namespace std;
 
 #define MAX_DELTAS 16
@@ -22,7 +22,7 @@ public:
 class NextLinePrefetcher : public Prefetcher
 {
 private:
-	deque<NL_PTEntry*> prefetch_tracker;
+	ENTRY_POOL<NL_PTEntry> prefetch_tracker; /* keyed by address, FIFO */
 	vector<float> delta_probability;
 	default_random_engine generator;
 	uniform_real_distribution<float> *deltagen;
@@ -89,7 +89,10 @@ public:
 	void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
 	void register_fill(uint64_t address);
 	void dump_stats();
+	void register_stats(string section);
 	void print_config();
+	void save(CHECKPOINT &cp);
+	void load(CHECKPOINT &cp);
 };
 
 
@@ -3,6 +3,7 @@
 
 #include "cache.h"
 #include "instruction.h"
+#include "trace_reader.h"
 
 #ifdef CRC2_COMPILE
 #define STAT_PRINTING_PERIOD 1000000
@@ -37,9 +38,8 @@ class O3_CPU {
     uint32_t cpu;
 
     // trace
-    FILE *trace_file;
+    TRACE_READER *trace_reader;
     char trace_string[1024];
-    char gunzip_command[1024];
 
     // instruction
     input_instr current_instr;
@@ -55,6 +55,12 @@ class O3_CPU {
 
     uint64_t last_num_ins, last_ins_in_epoch, next_measure_ipc_cycle;
 
+#ifdef ENABLE_PROFILE
+    // see register_profile() in main.cc
+    PROFILE_SITE profile_handle_branch, profile_fetch_instruction, profile_schedule_instruction, profile_execute_instruction,
+                 profile_schedule_memory_instruction, profile_execute_memory_instruction, profile_update_rob, profile_retire_rob;
+#endif
+
     // reorder buffer, load/store queue, register file
     CORE_BUFFER ROB{"ROB", ROB_SIZE};
     LOAD_STORE_QUEUE LQ{"LQ", LQ_SIZE}, SQ{"SQ", SQ_SIZE};
@@ -95,7 +101,7 @@ class O3_CPU {
         cpu = 0;
 
         // trace
-        trace_file = NULL;
+        trace_reader = NULL;
 
         // instruction
         instr_unique_id = 0;
@@ -198,6 +204,13 @@ class O3_CPU {
     void broadcast_ipc(uint8_t ipc);
     void update_rob();
     void retire_rob();
+    void checkpoint(CHECKPOINT &cp);
+
+    // idle-cycle skipping
+    uint64_t next_event_cycle(uint64_t current);
+    uint8_t  memory_scheduling_pending(uint32_t begin, uint32_t end, uint64_t now, uint32_t &searched, uint64_t &next),
+             lsq_pending(uint32_t rob_index);
+    void fast_forward(uint64_t cycles);
 
     uint32_t  add_to_rob(ooo_model_instr *arch_instr),
               check_rob(uint64_t instr_id);
@@ -207,7 +220,8 @@ class O3_CPU {
     // branch predictor
     uint8_t predict_branch(uint64_t ip);
     void    initialize_branch_predictor(),
-            last_branch_result(uint64_t ip, uint8_t taken); 
+            last_branch_result(uint64_t ip, uint8_t taken),
+            checkpoint_branch_predictor(CHECKPOINT &cp);
 };
 
 extern O3_CPU ooo_cpu[NUM_CPUS];
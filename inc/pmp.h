@@ -8,6 +8,7 @@
 #include "prefetcher.h"
 #include "cache.h"
 #include "bakshalipour_framework.h"
+#include "block_pattern.h"
 
 using namespace std;
 
@@ -96,10 +97,10 @@ private:
 };
 
 template <class T>
-string pmp_pattern_to_string(const vector<T> &pattern)
+string pmp_pattern_to_string(const T &pattern)
 {
     ostringstream oss;
-    for (unsigned i = 0; i < pattern.size(); i += 1)
+    for (int i = 0; i < pattern.size(); i += 1)
         oss << int(pattern[i]);
     return oss.str();
 }
@@ -109,7 +110,7 @@ class ATDataPMP
 public:
     uint64_t pc;
     int offset;
-    vector<bool> pattern;
+    BlockPattern pattern;
 };
 
 class ATPMP : public LRUSetAssociativeCache<ATDataPMP>
@@ -143,7 +144,7 @@ public:
                 cerr << "[AccumulationTable::set_pattern] Not found!" << dec << endl;
             return false;
         }
-        entry->data.pattern[offset] = true;
+        entry->data.pattern.set(offset);
         Super::set_mru(key);
         if (this->debug_level >= 2)
             cerr << "[AccumulationTable::set_pattern] OK!" << dec << endl;
@@ -158,8 +159,8 @@ public:
                  << ", offset=" << dec << offset << dec << endl;
         uint64_t key = this->build_key(region_number);
         // assert(!Super::find(key));
-        vector<bool> pattern(this->pattern_len, false);
-        pattern[offset] = true;
+        BlockPattern pattern(this->pattern_len);
+        pattern.set(offset);
         Entry old_entry = Super::insert(key, {pc, offset, pattern});
         Super::set_mru(key);
         return old_entry;
@@ -203,17 +204,6 @@ private:
     /*===============================================================*/
 };
 
-template <class T>
-vector<T> pmp_rotate(const vector<T> &x, int n)
-{
-    vector<T> y;
-    int len = x.size();
-    n = n % len;
-    for (int i = 0; i < len; i += 1)
-        y.push_back(x[(i - n + len) % len]);
-    return y;
-}
-
 class PatternTable
 {
 public:
@@ -222,7 +212,7 @@ public:
         if (this->debug_level >= 1)
             cerr << "PT::PT(pattern_len=" << pattern_len << ", debug_level=" << debug_level << endl;
     }
-    void merge(int key, vector<bool> pattern)
+    void merge(int key, const BlockPattern &pattern)
     {
         key = key < 0 ? -key : key;
         if (this->debug_level >= 2)
@@ -230,11 +220,8 @@ public:
                  << ", pattern=" << pmp_pattern_to_string(pattern) << ")" << dec << endl;
         // assert((int)pattern.size() == this->pattern_len);
         vector<int> &old = table[key % pattern_len];
-        for (size_t i = 0; i < pattern_len; i++)
-        {
-            if (pattern[i])
-                old[i]++;
-        }
+        for (uint64_t bits = pattern.word(); bits; bits &= bits - 1)
+            old[__builtin_ctzll(bits)]++;
         if (old[0] == counter_max)
         {
             for (size_t i = 0; i < pattern_len; i++)
@@ -244,25 +231,33 @@ public:
         }
     }
 
-    vector<int> extrate(int key)
+    FillPattern extrate(int key)
     {
         key = key < 0 ? -key : key;
         if (this->debug_level >= 2)
             cerr << "PT::extrate(key=" << dec << key << endl;
-        vector<int> old = table[key % pattern_len];
+        const vector<int> &old = table[key % pattern_len];
         if (!old[0])
-            return vector<int>();
-        vector<int> result(pattern_len, 0);
+            return FillPattern();
+        FillPattern result(pattern_len);
         for (size_t i = 1; i < pattern_len; i++)
         {
             if (old[i] >= l1_thresh * old[0])
-                result[i] = FILL_L1;
+                result.set(i, FILL_L1);
             else if (old[i] >= l2_thresh * old[0])
-                result[i] = FILL_L2;
+                result.set(i, FILL_L2);
         }
         return result;
     }
 
+    /* saves or restores the counters for --checkpoint_save/--checkpoint_load */
+    void checkpoint(CHECKPOINT &cp)
+    {
+        cp.check(pattern_len, "pmp pattern table length");
+        for (int i = 0; i < pattern_len; i++)
+            cp.vector_entries(table[i]);
+    }
+
 private:
     int pattern_len, counter_max;
     vector<vector<int>> table;
@@ -274,7 +269,7 @@ class PSDataPMP
 {
 public:
     /* contains the prefetch fill level for each block of spatial region */
-    vector<int> pattern;
+    FillPattern pattern;
 };
 
 class PSPMP : public LRUSetAssociativeCache<PSDataPMP>
@@ -290,7 +285,7 @@ public:
                  << ", debug_level=" << debug_level << ", num_ways=" << num_ways << ")" << dec << endl;
     }
 
-    void insert(uint64_t region_number, vector<int> pattern)
+    void insert(uint64_t region_number, const FillPattern &pattern)
     {
         if (this->debug_level >= 2)
             cerr << "PrefetchStreamer::insert(region_number=0x" << hex << region_number
@@ -324,11 +319,11 @@ public:
         }
         Super::set_mru(key);
         int pf_issued = 0;
-        vector<int> &pattern = entry->data.pattern;
-        pattern[region_offset] = 0; /* accessed block will be automatically fetched if necessary (miss) */
+        FillPattern &pattern = entry->data.pattern;
+        pattern.set(region_offset, 0); /* accessed block will be automatically fetched if necessary (miss) */
         int pf_offset;
         /* prefetch blocks that are close to the recent access first (locality!) */
-        for (int d = 1; d < this->pattern_len; d += 1)
+        for (int d = 1; d < this->pattern_len && pattern.any(); d += 1)
         {
             /* prefer positive strides */
             for (int sgn = +1; sgn >= -1; sgn -= 2)
@@ -341,7 +336,7 @@ public:
                     {
                         cache->prefetch_line(0, base_addr, pf_address, pattern[pf_offset], 0);
                         pf_issued += 1;
-                        pattern[pf_offset] = 0;
+                        pattern.set(pf_offset, 0);
                     }
                     else
                     {
@@ -390,7 +385,10 @@ public:
     void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, std::vector<uint64_t> &pref_addr);
     void register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
     void dump_stats();
+    void register_stats(string section);
     void print_config();
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
 
     /**
      * Updates PMP's state based on the most recent LOAD access.
@@ -409,12 +407,13 @@ private:
      * @return The appropriate prefetch level for all blocks based on PHT output or an empty vector
      *         if no blocks should be prefetched
      */
-    vector<int> find_in_pht(uint64_t pc, uint64_t address);
+    FillPattern find_in_pht(uint64_t pc, uint64_t address);
 
     void insert_in_pht(const ATPMP::Entry &entry);
 
     void init_knobs();
     void init_stats();
+    void checkpoint(CHECKPOINT &cp);
 
     /*======================*/
     CACHE *parent = NULL;
@@ -21,6 +21,7 @@ public:
 private:
 	void init_knobs();
 	void init_stats();
+	void set_cross_pointers();
 
 public:
 	SPP_PPF_dev(std::string type, CACHE *cache);
@@ -29,6 +30,8 @@ public:
 	void dump_stats();
 	void print_config();
 	void cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
+	void save(CHECKPOINT &cp);
+	void load(CHECKPOINT &cp);
 };
 
 #endif /* PPF_DEV_H */
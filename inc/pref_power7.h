@@ -84,7 +84,10 @@ public :
     ~POWER7_Pref();
     void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
     void dump_stats();
+    void register_stats(string section);
     void print_config();
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
 };
 
 #endif /* PREF_POWER7 */
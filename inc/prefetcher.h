@@ -3,19 +3,37 @@
 
 #include <string>
 #include <vector>
+#include "profile.h"
+
+class CHECKPOINT;
 
 class Prefetcher
 {
 protected:
 	std::string type;
+	std::string stats_section; /* see register_stats() */
 
 public:
+#ifdef ENABLE_PROFILE
+	PROFILE_SITE profile; /* invoke_prefetcher() from the multi L1D/L2C dispatchers */
+#endif
+
 	Prefetcher(std::string _type) {type = _type;}
 	~Prefetcher(){}
 	std::string get_type() {return type;}
 	virtual void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, std::vector<uint64_t> &pref_addr) = 0;
 	virtual void dump_stats() = 0;
 	virtual void print_config() = 0;
+
+	/* end-of-run counters for the stats registry (--stats_json_file), under the given section.
+	 * A prefetcher that registers them prints dump_stats() from the registry too,
+	 * the others only show up in the text dump. */
+	virtual void register_stats(std::string section) {stats_section = section;}
+
+	/* warmed-up state carried by --checkpoint_save/--checkpoint_load,
+	 * load() reads back exactly what save() wrote */
+	virtual void save(CHECKPOINT &cp) = 0;
+	virtual void load(CHECKPOINT &cp) = 0;
 };
 
 #endif /* PREFETCHER_H */
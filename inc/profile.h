@@ -0,0 +1,76 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <string>
+
+// self-profiling of the simulator (make profile=1, which defines ENABLE_PROFILE)
+// PROFILE_SCOPE(site) times the rest of the enclosing block with the time-stamp counter and
+// counts one call of site; a scope entered inside another one is charged to itself only, so the
+// self ticks of all sites add up to the time spent in them without double counting
+// sites are registered once under a name and reported in the PROFILE section of the stats
+// registry, as calls, self ticks and share of the main loop; without ENABLE_PROFILE the sites
+// do not exist and PROFILE_SCOPE expands to nothing
+class PROFILE_SITE {
+  public:
+    uint64_t calls, ticks, self_ticks;
+
+    PROFILE_SITE() : calls(0), ticks(0), self_ticks(0){};
+};
+
+#ifdef ENABLE_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t profile_clock() { return __rdtsc(); }
+#else
+#include <time.h>
+static inline uint64_t profile_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+class PROFILE_TIMER {
+  public:
+    PROFILE_TIMER(PROFILE_SITE *v1) : site(v1), parent(current), children(0) {
+        current = this;
+        start = profile_clock();
+    };
+    ~PROFILE_TIMER() {
+        uint64_t elapsed = profile_clock() - start;
+        site->calls++;
+        site->ticks += elapsed;
+        site->self_ticks += elapsed - children;
+        if (parent)
+            parent->children += elapsed;
+        current = parent;
+    };
+
+  private:
+    PROFILE_SITE *site;
+    PROFILE_TIMER *parent;
+    uint64_t start, children;
+
+    // innermost timer of the thread, cores under --parallel_cores keep their own
+    static thread_local PROFILE_TIMER *current;
+};
+
+// the main loop, whose ticks the shares are relative to
+extern PROFILE_SITE profile_main_loop;
+
+// adds site v2 to the PROFILE section as v1
+void profile_register(const std::string &v1, PROFILE_SITE *v2);
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(site) PROFILE_TIMER PROFILE_CONCAT(profile_timer_, __LINE__)(&(site))
+
+#else
+
+#define PROFILE_SCOPE(site)
+
+#endif
+
+#endif
@@ -11,14 +11,15 @@
 #include "prefetcher.h"
 #include "cache.h"
 #include "bakshalipour_framework.h"
+#include "block_pattern.h"
 
 using namespace std;
 
 template <class T>
-string rb_pattern_to_string(const vector<T> &pattern)
+string rb_pattern_to_string(const T &pattern)
 {
     ostringstream oss;
-    for (unsigned i = 0; i < pattern.size(); i += 1)
+    for (int i = 0; i < pattern.size(); i += 1)
         oss << int(pattern[i]);
     return oss.str();
 }
@@ -28,7 +29,7 @@ class FTDataRB
 public:
     uint64_t pc;
     int offset;
-    vector<bool> pattern_prefetch;
+    BlockPattern pattern_prefetch;
 };
 
 class FTRB : public LRUSetAssociativeCache<FTDataRB>
@@ -62,7 +63,7 @@ public:
         return entry;
     }
 
-    void insert(uint64_t region_number, uint64_t pc, int offset, vector<bool> pattern_prefetch)
+    void insert(uint64_t region_number, uint64_t pc, int offset, BlockPattern pattern_prefetch)
     {
         if (this->debug_level >= 2)
             cerr << "FT::insert(region_number=0x" << hex << region_number << ", pc=0x" << pc
@@ -120,8 +121,8 @@ class ATDataRB
 public:
     uint64_t pc;
     int offset;
-    vector<bool> pattern;
-    vector<bool> pattern_prefetch;
+    BlockPattern pattern;
+    BlockPattern pattern_prefetch;
 };
 
 class ATRB : public LRUSetAssociativeCache<ATDataRB>
@@ -155,7 +156,7 @@ public:
                 cerr << "[AT::set_pattern] Not found!" << dec << endl;
             return false;
         }
-        entry->data.pattern[offset] = true;
+        entry->data.pattern.set(offset);
         Super::set_mru(key);
         if (this->debug_level >= 2)
             cerr << "[AT::set_pattern] OK!" << dec << endl;
@@ -163,7 +164,7 @@ public:
     }
 
     /* NOTE: `region_number` is probably truncated since it comes from the filter table */
-    Entry insert(uint64_t region_number, uint64_t pc, int offset, vector<bool> pattern_prefetch)
+    Entry insert(uint64_t region_number, uint64_t pc, int offset, BlockPattern pattern_prefetch)
     {
         if (this->debug_level >= 2)
             cerr << "AT::insert(region_number=0x" << hex << region_number << ", pc=0x" << pc
@@ -172,8 +173,8 @@ public:
                  << dec << endl;
         uint64_t key = this->build_key(region_number);
         // assert(!Super::find(key));
-        vector<bool> pattern(this->pattern_len, false);
-        pattern[offset] = true;
+        BlockPattern pattern(this->pattern_len);
+        pattern.set(offset);
         Entry old_entry = Super::insert(key, {pc, offset, pattern, pattern_prefetch});
 #ifdef SHORT_ACCUMULATION
         event_to_region[(offset << 16) | (pc & (1 << 16 - 1))] = region_number;
@@ -182,7 +183,7 @@ public:
         return old_entry;
     }
 
-    Entry insert(uint64_t region_number, uint64_t pc, int offset, vector<bool> pattern, vector<bool> pattern_prefetch)
+    Entry insert(uint64_t region_number, uint64_t pc, int offset, BlockPattern pattern, BlockPattern pattern_prefetch)
     {
         if (this->debug_level >= 2)
             cerr << "AT::insert(region_number=0x" << hex << region_number
@@ -268,21 +269,10 @@ enum EventPB
     MISS_PB = 2
 };
 
-template <class T>
-vector<T> rb_rotate(const vector<T> &x, int n)
-{
-    vector<T> y;
-    int len = x.size();
-    n = n % len;
-    for (int i = 0; i < len; i += 1)
-        y.push_back(x[(i - n + len) % len]);
-    return y;
-}
-
 class PHTDataRB
 {
 public:
-    vector<bool> pattern;
+    BlockPattern pattern;
 };
 
 class PHTRB : public LRUSetAssociativeCache<PHTDataRB>
@@ -291,7 +281,7 @@ class PHTRB : public LRUSetAssociativeCache<PHTDataRB>
 
 public:
     PHTRB(int size, int pattern_len, int pc_width, int min_addr_width, int max_addr_width, int debug_level = 0, int num_ways = 16)
-        : Super(size, num_ways, debug_level), pattern_len(pattern_len), pc_width(pc_width), min_addr_width(min_addr_width), max_addr_width(max_addr_width)
+        : Super(size, num_ways, debug_level), pattern_len(pattern_len), pc_width(pc_width), min_addr_width(min_addr_width), max_addr_width(max_addr_width), last_event(MISS_PB)
     {
         // assert(this->pc_width >= 0);
         // assert(this->min_addr_width >= 0);
@@ -307,14 +297,14 @@ public:
                  << dec << endl;
     }
 
-    void insert(uint64_t pc, uint64_t address, vector<bool> pattern)
+    void insert(uint64_t pc, uint64_t address, BlockPattern pattern)
     {
         if (this->debug_level >= 2)
             cerr << "PHT::insert(pc=0x" << hex << pc << ", address=0x" << address
                  << ", pattern=" << rb_pattern_to_string(pattern) << ")" << dec << endl;
         // assert((int)pattern.size() == this->pattern_len);
         int offset = address % this->pattern_len;
-        pattern = rb_rotate(pattern, -offset);
+        pattern = pattern.rotate(-offset);
         uint64_t key = this->build_key(pc, address);
         Super::insert(key, {pattern});
         Super::set_mru(key);
@@ -326,17 +316,18 @@ public:
         return Super::erase(key);
     }
 
-    vector<vector<bool>> find(uint64_t pc, uint64_t address)
+    /* `matches` is refilled with the un-rotated patterns of the PC+Address match or of all PC+Offset matches */
+    void find(uint64_t pc, uint64_t address, vector<BlockPattern> &matches)
     {
         if (this->debug_level >= 2)
             cerr << "PHT::find(pc=0x" << hex << pc << ", address=0x" << address << ")" << dec << endl;
         uint64_t key = this->build_key(pc, address);
         uint64_t index = key % this->num_sets;
         uint64_t tag = key / this->num_sets;
-        auto &set = this->entries[index];
+        auto *set = this->set_entries(index);
         uint64_t min_tag_mask = (1 << (this->pc_width + this->min_addr_width - this->index_len)) - 1;
         uint64_t max_tag_mask = (1 << (this->pc_width + this->max_addr_width - this->index_len)) - 1;
-        vector<vector<bool>> matches;
+        matches.clear();
         this->last_event = MISS_PB;
         for (int i = 0; i < this->num_ways; i += 1)
         {
@@ -344,7 +335,7 @@ public:
                 continue;
             bool min_match = ((set[i].tag & min_tag_mask) == (tag & min_tag_mask));
             bool max_match = ((set[i].tag & max_tag_mask) == (tag & max_tag_mask));
-            vector<bool> &cur_pattern = set[i].data.pattern;
+            const BlockPattern &cur_pattern = set[i].data.pattern;
             if (max_match)
             {
                 this->last_event = PC_ADDRESS_PB;
@@ -361,8 +352,7 @@ public:
         }
         int offset = address % this->pattern_len;
         for (int i = 0; i < (int)matches.size(); i += 1)
-            matches[i] = rb_rotate(matches[i], +offset);
-        return matches;
+            matches[i] = matches[i].rotate(+offset);
     }
 
     EventPB get_last_event() { return this->last_event; }
@@ -426,7 +416,7 @@ class PBDataRB
 {
 public:
     /* contains the prefetch fill level for each block of spatial region */
-    vector<int> pattern;
+    FillPattern pattern;
 };
 
 class PBRB : public LRUSetAssociativeCache<PBDataRB>
@@ -442,7 +432,7 @@ public:
                  << ", debug_level=" << debug_level << ", num_ways=" << num_ways << ")" << dec << endl;
     }
 
-    void insert(uint64_t region_number, vector<int> pattern)
+    void insert(uint64_t region_number, const FillPattern &pattern)
     {
         if (this->debug_level >= 2)
             cerr << "PB::insert(region_number=0x" << hex << region_number
@@ -456,11 +446,7 @@ public:
         }
         else
         {
-            for (size_t i = 0; i < pattern.size(); i++)
-            {
-                if (pattern[i])
-                    entry->data.pattern[i] = pattern[i];
-            }
+            entry->data.pattern.merge(pattern);
         }
         Super::set_mru(key);
     }
@@ -490,13 +476,13 @@ public:
         
         Super::set_mru(key);
         int pf_issued = 0;
-        vector<int> &pattern = entry->data.pattern;
+        FillPattern &pattern = entry->data.pattern;
         if (this->debug_level >= 2)
             cerr << "[PB::prefetch] Found! pattern: " << rb_pattern_to_string(pattern) << dec << endl;
-        pattern[region_offset] = 0; /* accessed block will be automatically fetched if necessary (miss) */
+        pattern.set(region_offset, 0); /* accessed block will be automatically fetched if necessary (miss) */
         int pf_offset;
         /* prefetch blocks that are close to the recent access first (locality!) */
-        for (int d = 1; d < this->pattern_len; d += 1)
+        for (int d = 1; d < this->pattern_len && pattern.any(); d += 1)
         {
             /* prefer positive strides */
             for (int sgn = +1; sgn >= -1; sgn -= 2)
@@ -509,7 +495,7 @@ public:
                     {
                         cache->prefetch_line(0, base_addr, pf_address, pattern[pf_offset], 0);
                         pf_issued += 1;
-                        pattern[pf_offset] = 0;
+                        pattern.set(pf_offset, 0);
                     }
                     else
                     {
@@ -559,8 +545,11 @@ public:
     void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, std::vector<uint64_t> &pref_addr);
     void register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
     void dump_stats();
+    void register_stats(string section);
     void reset_stats();
     void print_config();
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
 
     /**
      * Updates RSA's state based on the most recent LOAD access.
@@ -579,14 +568,15 @@ private:
      * @return The appropriate prefetch level for all blocks based on PHT output or an empty vector
      *         if no blocks should be prefetched
      */
-    vector<int> find_in_pht(uint64_t pc, uint64_t address, int &next_ft_level);
+    FillPattern find_in_pht(uint64_t pc, uint64_t address, int &next_ft_level);
 
     void insert_in_pht(const ATRB::Entry &entry, int at_level);
 
-    vector<int> vote(const vector<vector<bool>> &x);
+    FillPattern vote(const vector<BlockPattern> &x);
 
     void init_knobs();
     void init_stats();
+    void checkpoint(CHECKPOINT &cp);
 
     /*======================*/
     CACHE *parent = NULL;
@@ -596,15 +586,18 @@ private:
     vector<ATRB> at;
     vector<PHTRB> pht;
     PBRB pb;
+    /* scratch buffers reused by find_in_pht() */
+    vector<BlockPattern> pht_matches;
+    vector<FillPattern> level_pattern;
     float thresh;
     int default_insert_level;
     int debug_level = 0;
 
     // stat
-    int count_eu_check = 0;
-    int count_region_expand = 0;
-    int count_su_check = 0;
-    int count_region_shrink = 0;
+    uint64_t count_eu_check = 0;
+    uint64_t count_region_expand = 0;
+    uint64_t count_su_check = 0;
+    uint64_t count_region_shrink = 0;
     bool warmup_complete_reset = false;
 
 };
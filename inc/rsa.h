@@ -11,6 +11,7 @@
 #include "prefetcher.h"
 #include "cache.h"
 #include "bakshalipour_framework.h"
+#include "block_pattern.h"
 
 using namespace std;
 
@@ -103,10 +104,10 @@ private:
 };
 
 template <class T>
-string rsa_pattern_to_string(const vector<T> &pattern)
+string rsa_pattern_to_string(const T &pattern)
 {
     ostringstream oss;
-    for (unsigned i = 0; i < pattern.size(); i += 1)
+    for (int i = 0; i < pattern.size(); i += 1)
         oss << int(pattern[i]);
     return oss.str();
 }
@@ -116,7 +117,7 @@ class ATData
 public:
     uint64_t pc_first;
     int offset_first;
-    vector<bool> pattern;
+    BlockPattern pattern;
     bool is_level_up;
     uint64_t pc_second;
     int offset_second;
@@ -153,7 +154,7 @@ public:
                 cerr << "[AT::set_pattern] Not found!" << dec << endl;
             return false;
         }
-        entry->data.pattern[offset] = true;
+        entry->data.pattern.set(offset);
         Super::set_mru(key);
         if (this->debug_level >= 2)
             cerr << "[AT::set_pattern] OK!" << dec << endl;
@@ -168,8 +169,8 @@ public:
                  << ", offset=" << dec << offset << dec << endl;
         uint64_t key = this->build_key(region_number);
         // assert(!Super::find(key));
-        vector<bool> pattern(this->pattern_len, false);
-        pattern[offset] = true;
+        BlockPattern pattern(this->pattern_len);
+        pattern.set(offset);
         Entry old_entry = Super::insert(key, {pc, offset, pattern, false, 0, 0});
 #ifdef SHORT_ACCUMULATION
         event_to_region[(offset << 16) | (pc & (1 << 16 - 1))] = region_number;
@@ -178,7 +179,7 @@ public:
         return old_entry;
     }
 
-    Entry insert(uint64_t region_number, uint64_t pc_first, int offset_first, uint64_t pc_second, int offset_second, vector<bool> pattern)
+    Entry insert(uint64_t region_number, uint64_t pc_first, int offset_first, uint64_t pc_second, int offset_second, BlockPattern pattern)
     {
         if (this->debug_level >= 2)
             cerr << "AT::insert(region_number=0x" << hex << region_number
@@ -256,21 +257,10 @@ private:
     /*===============================================================*/
 };
 
-template <class T>
-vector<T> rsa_rotate(const vector<T> &x, int n)
-{
-    vector<T> y;
-    int len = x.size();
-    n = n % len;
-    for (int i = 0; i < len; i += 1)
-        y.push_back(x[(i - n + len) % len]);
-    return y;
-}
-
 class PHTData
 {
 public:
-    vector<bool> pattern;
+    BlockPattern pattern;
 };
 
 class PHT : public LRUSetAssociativeCache<PHTData>
@@ -294,19 +284,19 @@ public:
                  << dec << endl;
     }
 
-    void insert(uint64_t pc, int offset, vector<bool> pattern)
+    void insert(uint64_t pc, int offset, BlockPattern pattern)
     {
         if (this->debug_level >= 2)
             cerr << "PHT::insert(pc=0x" << hex << pc << ", offset=" << offset
                  << ", pattern=" << rsa_pattern_to_string(pattern) << ")" << dec << endl;
         // assert((int)pattern.size() == this->pattern_len);
-        pattern = rsa_rotate(pattern, -offset);
+        pattern = pattern.rotate(-offset);
         uint64_t key = this->build_key(pc, offset);
         Super::insert(key, {pattern});
         Super::set_mru(key);
     }
 
-    vector<bool> find(uint64_t pc, int offset)
+    BlockPattern find(uint64_t pc, int offset)
     {
         if (this->debug_level >= 2)
             cerr << "PHT::find(pc=0x" << hex << pc << ", offset=" << dec << offset << ")" << dec << endl;
@@ -316,10 +306,9 @@ public:
         {
             if (this->debug_level >= 2)
                 cerr << "[PHT::find] Not found!" << dec << endl;
-            return vector<bool>();
+            return BlockPattern();
         }
-        vector<bool> pattern = entry->data.pattern;
-        pattern = rsa_rotate(pattern, +offset);
+        BlockPattern pattern = entry->data.pattern.rotate(+offset);
         Super::set_mru(key);
         return pattern;
     }
@@ -371,7 +360,7 @@ class PBData
 {
 public:
     /* contains the prefetch fill level for each block of spatial region */
-    vector<bool> pattern;
+    BlockPattern pattern;
 };
 
 class PB : public LRUSetAssociativeCache<PBData>
@@ -387,7 +376,7 @@ public:
                  << ", debug_level=" << debug_level << ", num_ways=" << num_ways << ")" << dec << endl;
     }
 
-    void insert(uint64_t region_number, vector<bool> pattern)
+    void insert(uint64_t region_number, const BlockPattern &pattern)
     {
         if (this->debug_level >= 2)
             cerr << "PB::insert(region_number=0x" << hex << region_number
@@ -401,11 +390,7 @@ public:
         }
         else
         {
-            for (size_t i = 0; i < pattern.size(); i++)
-            {
-                if (pattern[i])
-                    entry->data.pattern[i] = pattern[i];
-            }
+            entry->data.pattern = entry->data.pattern | pattern;
         }
         Super::set_mru(key);
     }
@@ -434,11 +419,11 @@ public:
         }
         Super::set_mru(key);
         int pf_issued = 0;
-        vector<bool> &pattern = entry->data.pattern;
-        pattern[region_offset] = 0; /* accessed block will be automatically fetched if necessary (miss) */
+        BlockPattern &pattern = entry->data.pattern;
+        pattern.reset(region_offset); /* accessed block will be automatically fetched if necessary (miss) */
         int pf_offset;
         /* prefetch blocks that are close to the recent access first (locality!) */
-        for (int d = 1; d < this->pattern_len; d += 1)
+        for (int d = 1; d < this->pattern_len && pattern.any(); d += 1)
         {
             /* prefer positive strides */
             for (int sgn = +1; sgn >= -1; sgn -= 2)
@@ -451,7 +436,7 @@ public:
                     {
                         cache->prefetch_line(0, base_addr, pf_address, FILL_L2, 0);
                         pf_issued += 1;
-                        pattern[pf_offset] = 0;
+                        pattern.reset(pf_offset);
                     }
                     else
                     {
@@ -500,7 +485,10 @@ public:
     void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, std::vector<uint64_t> &pref_addr);
     void register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
     void dump_stats();
+    void register_stats(string section);
     void print_config();
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
 
     /**
      * Updates RSA's state based on the most recent LOAD access.
@@ -519,12 +507,13 @@ private:
      * @return The appropriate prefetch level for all blocks based on PHT output or an empty vector
      *         if no blocks should be prefetched
      */
-    vector<bool> find_in_pht(uint64_t pc, uint64_t address, int &next_ft_level);
+    BlockPattern find_in_pht(uint64_t pc, uint64_t address, int &next_ft_level);
 
     void insert_in_pht(const AT::Entry &entry, int at_level);
 
     void init_knobs();
     void init_stats();
+    void checkpoint(CHECKPOINT &cp);
 
     /*======================*/
     CACHE *parent = NULL;
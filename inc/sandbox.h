@@ -21,8 +21,9 @@ public:
 class SandboxPrefetcher : public Prefetcher
 {
 private:
-	deque<Score*> evaluated_offsets;
+	vector<Score> evaluated_offsets;
 	deque<int32_t> non_evaluated_offsets;
+	vector<Score> pos_offsets, neg_offsets; /* reused by every access */
 	uint32_t pref_degree; /* degree per direction */
 	struct
 	{
@@ -34,6 +35,7 @@ private:
 	/* Bloom Filter */
 	uint32_t opt_hash_functions;
 	bf::basic_bloom_filter *bf;
+	vector<uint64_t> filter_adds; /* since the last clear, the filter's bits are rebuilt from these on restore */
 
 	/* stats */
 	struct
@@ -73,21 +75,24 @@ private:
 	void init_evaluated_offsets();
 	void init_non_evaluated_offsets();
 	void reset_eval();
-	void get_offset_list_sorted(vector<Score*> &pos_offsets, vector<Score*> &neg_offsets);
-	void generate_prefetch(vector<Score*> offset_list, uint32_t pref_degree, uint64_t page, uint32_t offset, vector<uint64_t> &pref_addr);
-	void destroy_offset_list(vector<Score*> offset_list);
+	void get_offset_list_sorted(vector<Score> &pos_offsets, vector<Score> &neg_offsets);
+	void generate_prefetch(const vector<Score> &offset_list, uint32_t pref_degree, uint64_t page, uint32_t offset, vector<uint64_t> &pref_addr);
 	uint64_t generate_address(uint64_t page, uint32_t offset, int32_t delta, uint32_t lookahead = 1);
 	void end_of_round();
 	void filter_add(uint64_t address);
 	bool filter_lookup(uint64_t address);
 	void record_pref_stats(int32_t offset, uint32_t pref_count);
+	void checkpoint(CHECKPOINT &cp);
 
 public:
 	SandboxPrefetcher(string type);
 	~SandboxPrefetcher();
 	void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
 	void dump_stats();
+	void register_stats(string section);
 	void print_config();
+	void save(CHECKPOINT &cp);
+	void load(CHECKPOINT &cp);
 };
 
 #endif /* SANDBOX_PREFETCHER_H */
@@ -7,6 +7,7 @@
 #include "cache.h"
 #include "prefetcher.h"
 #include "scooby_helper.h"
+#include "entry_pool.h"
 #include "learning_engine_basic.h"
 #include "learning_engine_featurewise.h"
 
@@ -23,10 +24,13 @@ class LearningEngine;
 class Scooby : public Prefetcher
 {
 private:
-	deque<Scooby_STEntry*> signature_table;
+	ENTRY_POOL<Scooby_STEntry> signature_table; /* keyed by page, LRU first */
 	LearningEngineBasic *brain;
 	LearningEngineFeaturewise *brain_featurewise;
-	deque<Scooby_PTEntry*> prefetch_tracker;
+	ENTRY_POOL<Scooby_PTEntry> prefetch_tracker; /* keyed by address, FIFO */
+	/* the victim of a tracker eviction trains the agent at the next eviction,
+	 * so it is copied out of prefetch_tracker before its slot is reused */
+	Scooby_PTEntry last_evicted;
 	Scooby_PTEntry *last_evicted_tracker;
 	uint8_t bw_level;
 	uint8_t core_ipc;
@@ -158,6 +162,7 @@ private:
 private:
 	void init_knobs();
 	void init_stats();
+	void checkpoint(CHECKPOINT &cp);
 
 	void update_global_state(uint64_t pc, uint64_t page, uint32_t offset, uint64_t address);
 	Scooby_STEntry* update_local_state(uint64_t pc, uint64_t page, uint32_t offset, uint64_t address);
@@ -183,7 +188,10 @@ public:
 	void register_fill(uint64_t address);
 	void register_prefetch_hit(uint64_t address);
 	void dump_stats();
+	void register_stats(string section);
 	void print_config();
+	void save(CHECKPOINT &cp);
+	void load(CHECKPOINT &cp);
 	int32_t getAction(uint32_t action_index);
 	void update_bw(uint8_t bw_level);
 	void update_ipc(uint8_t ipc);
@@ -12,6 +12,8 @@ using namespace std;
 
 #define MAX_HOP_COUNT 16
 
+class CHECKPOINT;
+
 typedef enum
 {
 	PC = 0,
@@ -145,6 +147,8 @@ public:
 	void track_prefetch(uint32_t offset, int32_t pref_offset);
 	void insert_action_tracker(int32_t pref_offset);
 	bool search_action_tracker(int32_t action, int32_t &conf);
+	/* saves or restores the entry for --checkpoint_save/--checkpoint_load */
+	void checkpoint(CHECKPOINT &cp);
 };
 
 class Scooby_PTEntry
@@ -173,6 +177,8 @@ public:
 		has_reward = false;
 	}
 	~Scooby_PTEntry(){}
+	/* a restored entry owns a new copy of its state */
+	void checkpoint(CHECKPOINT &cp);
 };
 
 /* some data structures to mine information from workloads */
@@ -194,7 +200,8 @@ public:
 	void record_access(uint64_t pc, uint64_t address, uint64_t page, uint32_t offset, uint8_t bw_level);
 	void record_trigger_access(uint64_t page, uint64_t pc, uint32_t offset);
 	void record_access_knowledge(Scooby_STEntry *stentry);
-	void dump_stats();
+	void register_stats();
+	void checkpoint(CHECKPOINT &cp);
 };
 
 /* auxiliary functions */
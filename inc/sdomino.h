@@ -1,87 +1,103 @@
 #include <stdio.h>
 #include "cache.h"
-#include <map>
-#include <set>
+#include "bakshalipour_framework.h"
+#include "history_buffer.h"
 #include <cassert>
-#include <set>
-#define DEGREE 4
+
+// most (address, pointer) slots an EIT entry can be configured with
+#define SDOMINO_MAX_EIT_SLOTS 8
 
 using namespace std;
 
 // #define HYBRID
 
+// Enhanced Index Table entry: the last addresses seen after the entry's address, each with the
+// GHB pointer of that occurrence and the time it was last updated; slots beyond the configured
+// count stay invalid, so every scan is over a few inline slots
 struct EIT_Entry
 {
 public:
-    map<uint64_t, uint64_t> address_pointer_pair;
-    map<uint64_t, uint64_t> access_time;
+    uint64_t address[SDOMINO_MAX_EIT_SLOTS];
+    uint64_t pointer[SDOMINO_MAX_EIT_SLOTS];
+    uint64_t access_time[SDOMINO_MAX_EIT_SLOTS]; // 0 marks an invalid slot
     uint64_t timer;
-    uint64_t most_recent_addr;
+    int most_recent;
 
     EIT_Entry()
     {
         timer = 0;
-        most_recent_addr = 0;
-        address_pointer_pair.clear();
-        access_time.clear();
+        most_recent = 0;
+        for (int i = 0; i < SDOMINO_MAX_EIT_SLOTS; i++)
+        {
+            address[i] = 0;
+            pointer[i] = 0;
+            access_time[i] = 0;
+        }
     }
 
-    uint64_t get_ghb_pointer(uint64_t curr_addr)
+    int find(uint64_t curr_addr, int num_slots)
     {
-        if (address_pointer_pair.find(curr_addr) != address_pointer_pair.end())
-            return address_pointer_pair[curr_addr];
+        int slot = -1;
+        for (int i = 0; i < num_slots; i++)
+            slot = (access_time[i] && address[i] == curr_addr) ? i : slot;
+        return slot;
+    }
 
-        assert(address_pointer_pair.find(most_recent_addr) != address_pointer_pair.end());
-        return address_pointer_pair[most_recent_addr];
+    uint64_t get_ghb_pointer(uint64_t curr_addr, int num_slots)
+    {
+        int slot = find(curr_addr, num_slots);
+        if (slot < 0)
+            slot = most_recent;
+        assert(access_time[slot]);
+        return pointer[slot];
     }
 
-    void remove_oldest()
+    // an invalid slot has time 0, so the oldest slot is also the first free one
+    int remove_oldest(int num_slots)
     {
-        uint64_t oldest = timer + 1;
-        uint64_t replace_addr;
-        for (map<uint64_t, uint64_t>::iterator it = access_time.begin(); it != access_time.end(); it++)
-        {
-            if (it->second < oldest)
-            {
-                oldest = it->second;
-                replace_addr = it->first;
-            }
-        }
-        assert(oldest < (timer + 1));
-        assert(address_pointer_pair.find(replace_addr) != address_pointer_pair.end());
-        address_pointer_pair.erase(replace_addr);
-        access_time.erase(replace_addr);
+        int oldest = 0;
+        for (int i = 1; i < num_slots; i++)
+            oldest = (access_time[i] < access_time[oldest]) ? i : oldest;
+        return oldest;
     }
 
-    void update(uint64_t curr_addr, uint64_t pointer)
+    void update(uint64_t curr_addr, uint64_t ghb_pointer, int num_slots)
     {
         timer++;
-#ifdef EIT_ENTRY_LIMIT
-        if (address_pointer_pair.find(curr_addr) == address_pointer_pair.end())
-            if (address_pointer_pair.size() >= 3)
-                remove_oldest();
-
-        assert(address_pointer_pair.size() <= 3);
-        assert(access_time.size() <= 3);
-#endif
-        address_pointer_pair[curr_addr] = pointer;
-        access_time[curr_addr] = timer;
-        most_recent_addr = curr_addr;
+        int slot = find(curr_addr, num_slots);
+        if (slot < 0)
+            slot = remove_oldest(num_slots);
+        address[slot] = curr_addr;
+        pointer[slot] = ghb_pointer;
+        access_time[slot] = timer;
+        most_recent = slot;
     }
 };
 
 class sdomino : public Prefetcher
 {
-    vector<uint64_t> GHB;
-    map<uint64_t, EIT_Entry> index_table;
+    // the GHB is a ring of sdomino_ghb_size addresses, the EIT a set-associative LRU table
+    History_buffer GHB;
+    LRUSetAssociativeCache<EIT_Entry> index_table;
     uint64_t last_address;
 
+    int eit_slots;
+    unsigned int degree;
+
     void domino_train(uint64_t curr_addr, uint64_t last_addr)
     {
-        GHB.push_back(curr_addr);
-        assert(GHB.size() >= 1);
+        uint64_t ghb_pointer = GHB.push(curr_addr);
 
-        index_table[last_addr].update(curr_addr, (GHB.size() - 1));
+        // addresses are block aligned, the EIT is indexed by the block number
+        uint64_t key = last_addr >> LOG2_BLOCK_SIZE;
+        LRUSetAssociativeCache<EIT_Entry>::Entry *entry = index_table.find(key);
+        if (entry == NULL)
+        {
+            index_table.insert(key, EIT_Entry());
+            entry = index_table.find(key);
+        }
+        index_table.set_mru(key);
+        entry->data.update(curr_addr, ghb_pointer, eit_slots);
     }
 
     vector<uint64_t> domino_predict(uint64_t curr_addr, uint64_t last_addr)
@@ -89,13 +105,20 @@ class sdomino : public Prefetcher
         vector<uint64_t> candidates;
         candidates.clear();
 
-        if (index_table.find(last_addr) != index_table.end())
+        uint64_t key = last_addr >> LOG2_BLOCK_SIZE;
+        LRUSetAssociativeCache<EIT_Entry>::Entry *entry = index_table.find(key);
+        if (entry != NULL)
         {
-            uint64_t index = index_table[last_addr].get_ghb_pointer(curr_addr);
+            index_table.set_mru(key);
+            uint64_t index = entry->data.get_ghb_pointer(curr_addr, eit_slots);
+
+            // a pointer into history the GHB has wrapped over predicts nothing
+            if (!GHB.valid(index))
+                stale_pointer++;
 
-            for (unsigned int i = 1; i <= 32; i++)
+            for (unsigned int i = 1; i <= degree && GHB.valid(index); i++)
             {
-                if ((index + i) >= GHB.size())
+                if (!GHB.valid(index + i))
                     break;
                 uint64_t candidate_phy_addr = GHB[index + i];
                 candidates.push_back(candidate_phy_addr);
@@ -112,13 +135,16 @@ public:
     void invoke_prefetcher(uint64_t ip, uint64_t addr, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
     void register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
     void dump_stats();
-    void print_config() {};
-
-    unsigned int total_access;
-    unsigned int predictions;
-    unsigned int no_prediction;
-    uint64_t addr_context[2];
-    uint64_t pointer;
+    void print_config();
+    void register_stats(string section);
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
+    void checkpoint(CHECKPOINT &cp);
+
+    uint64_t total_access;
+    uint64_t predictions;
+    uint64_t no_prediction;
+    uint64_t stale_pointer;
 
     CACHE *parent = NULL;
 };
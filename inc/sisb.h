@@ -1,8 +1,47 @@
 #include "cache.h"
+#include "bakshalipour_framework.h"
+#include "stats.h"
 #include <unordered_map>
 
 using namespace std;
 
+// next-address mapping of the bounded mapping cache, with its confidence (0 to 3)
+class sisb_mapping
+{
+public:
+    uint64_t next = 0;
+    uint32_t confidence = 0;
+};
+
+// set-associative mapping cache, either LRU or evicting the least confident way of the set;
+// with confidence, every eviction ages the other ways so stale mappings do not stay forever
+class sisb_mapping_cache : public LRUSetAssociativeCache<sisb_mapping>
+{
+    typedef LRUSetAssociativeCache<sisb_mapping> Super;
+
+public:
+    sisb_mapping_cache(const TableGeometry &geometry, bool by_confidence)
+        : Super(geometry), by_confidence(by_confidence) {}
+
+protected:
+    int select_victim(uint64_t index)
+    {
+        if (!by_confidence)
+            return Super::select_victim(index);
+        Super::Entry *set = this->set_entries(index);
+        int victim = 0;
+        for (int i = 1; i < this->num_ways; i++)
+            if (set[i].data.confidence < set[victim].data.confidence)
+                victim = i;
+        for (int i = 0; i < this->num_ways; i++)
+            if (i != victim && set[i].data.confidence)
+                set[i].data.confidence--;
+        return victim;
+    }
+
+    bool by_confidence;
+};
+
 class sisb : public Prefetcher
 {
 public:
@@ -14,7 +53,21 @@ public:
     // mapping cache (maps address to next address)
     unordered_map<uint64_t, uint64_t> cache;
 
-    /* performance metadata */
+    // sisb_bounded: the same two tables, set-associative and of fixed size
+    bool bounded;
+    LRUSetAssociativeCache<uint64_t> bounded_tu;
+    sisb_mapping_cache bounded_cache;
+    uint64_t bounded_mappings = 0;
+
+    uint32_t degree;
+
+    /* metadata stats */
+    uint64_t tu_hit = 0, tu_miss = 0, tu_evict = 0;
+    uint64_t train_hit = 0, train_miss = 0, mapping_evict = 0;
+    uint64_t predict_hit = 0, predict_miss = 0;
+
+    /* performance metadata, kept for the pcs sampled by sisb_pc_stats_sample only */
+    uint32_t pc_stats_sample;
     unordered_map<uint64_t, uint64_t> outstanding;
     unordered_map<uint64_t, uint32_t> issued;
     unordered_map<uint64_t, uint32_t> untimely;
@@ -22,22 +75,131 @@ public:
     unordered_map<uint64_t, uint32_t> total;
     uint64_t divergence = 0;
 
+    bool sample_pc(uint64_t pc)
+    {
+        return pc_stats_sample && ((pc * 0x9e3779b97f4a7c15ULL) >> 32) % pc_stats_sample == 0;
+    }
+
+    /* last address of pc, returns false if the training unit has none */
+    bool get_last_address(uint64_t pc, uint64_t &last_addr)
+    {
+        if (bounded)
+        {
+            LRUSetAssociativeCache<uint64_t>::Entry *entry = bounded_tu.find(pc);
+            if (entry == NULL)
+            {
+                tu_miss++;
+                return false;
+            }
+            tu_hit++;
+            bounded_tu.set_mru(pc);
+            last_addr = entry->data;
+            return true;
+        }
+        unordered_map<uint64_t, uint64_t>::iterator it = tu.find(pc);
+        if (it == tu.end())
+        {
+            tu_miss++;
+            return false;
+        }
+        tu_hit++;
+        last_addr = it->second;
+        return true;
+    }
+
+    void set_last_address(uint64_t pc, uint64_t addr)
+    {
+        if (bounded)
+        {
+            LRUSetAssociativeCache<uint64_t>::Entry old = bounded_tu.insert(pc, addr);
+            if (old.valid && old.key != pc)
+                tu_evict++;
+            bounded_tu.set_mru(pc);
+            return;
+        }
+        tu[pc] = addr;
+    }
+
+    /* records that addr was followed by next */
+    void train_mapping(uint64_t addr, uint64_t next)
+    {
+        if (bounded)
+        {
+            sisb_mapping_cache::Entry *entry = bounded_cache.find(addr);
+            if (entry)
+            {
+                train_hit++;
+                if (entry->data.next != next)
+                {
+                    divergence++;
+                    entry->data.next = next;
+                    entry->data.confidence = 0;
+                }
+                else if (entry->data.confidence < 3)
+                    entry->data.confidence++;
+            }
+            else
+            {
+                train_miss++;
+                sisb_mapping mapping;
+                mapping.next = next;
+                sisb_mapping_cache::Entry old = bounded_cache.insert(addr, mapping);
+                if (old.valid)
+                    mapping_evict++;
+                else
+                    bounded_mappings++;
+            }
+            bounded_cache.set_mru(addr);
+            return;
+        }
+
+        unordered_map<uint64_t, uint64_t>::iterator it = cache.find(addr);
+        if (it != cache.end())
+        {
+            train_hit++;
+            if (it->second != next)
+                divergence++;
+            it->second = next;
+        }
+        else
+        {
+            train_miss++;
+            cache[addr] = next;
+        }
+    }
+
     /* get most specific prediction possible */
     uint64_t get_prediction(uint64_t pc, uint64_t addr)
     {
-        if (cache.find(addr) != cache.end())
+        if (bounded)
+        {
+            sisb_mapping_cache::Entry *entry = bounded_cache.find(addr);
+            if (entry == NULL)
+            {
+                predict_miss++;
+                return 0;
+            }
+            predict_hit++;
+            bounded_cache.set_mru(addr);
+            return entry->data.next;
+        }
+        unordered_map<uint64_t, uint64_t>::iterator it = cache.find(addr);
+        if (it != cache.end())
         {
-            return cache[addr];
+            predict_hit++;
+            return it->second;
         }
         else
         {
+            predict_miss++;
             return 0;
         }
     }
 
     void l2c_notify_useful(uint64_t addr, uint64_t pc)
     {
-        accurate[pc]++;
+        if (sample_pc(pc))
+            accurate[pc]++;
     }
 
     void sisb_prefetcher_initialize()
@@ -52,28 +214,26 @@ public:
             return;
 
         // initialize values
-        if (issued.find(pc) == issued.end())
+        bool sampled = sample_pc(pc);
+        if (sampled)
         {
-            issued[pc] = 0;
-            untimely[pc] = 0;
-            accurate[pc] = 0;
-            total[pc] = 0;
+            if (issued.find(pc) == issued.end())
+            {
+                issued[pc] = 0;
+                untimely[pc] = 0;
+                accurate[pc] = 0;
+                total[pc] = 0;
+            }
+            total[pc]++;
         }
-        total[pc]++;
 
         uint64_t addr_B = addr >> LOG2_BLOCK_SIZE;
 
         /* training */
-        if (tu.find(pc) != tu.end())
-        {
-            uint64_t last_addr = tu[pc];
-            if (cache.find(last_addr) != cache.end() && cache[last_addr] != addr_B)
-            {
-                divergence++;
-            }
-            cache[last_addr] = addr_B;
-        }
-        tu[pc] = addr_B;
+        uint64_t last_addr;
+        if (get_last_address(pc, last_addr))
+            train_mapping(last_addr, addr_B);
+        set_last_address(pc, addr_B);
 
         /* prediction */
         uint64_t pred = get_prediction(pc, addr_B);
@@ -86,8 +246,11 @@ public:
             prefetch_candidates.push_back(pred);
             pred >>= LOG2_BLOCK_SIZE;
             // if (was_issued) {
-            outstanding[pred] = pc;
-            issued[pc]++;
+            if (sampled)
+            {
+                outstanding[pred] = pc;
+                issued[pc]++;
+            }
             count++;
             //}
 
@@ -98,6 +261,8 @@ public:
 
     void sisb_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr)
     {
+        if (outstanding.empty())
+            return;
         uint64_t addr_B = addr >> LOG2_BLOCK_SIZE;
         if (outstanding.find(addr_B) != outstanding.end())
         {
@@ -122,15 +287,35 @@ public:
         flag = true;
 
         cout << "performance stats:" << endl;
-        uint32_t mappings = cache.size();
+        uint32_t mappings = bounded ? bounded_mappings : cache.size();
         cout << "mapping cache size: " << (mappings) << endl;
         cout << "divergence: " << divergence << endl;
+        if (pc_stats_sample)
+        {
+            uint64_t all_issued = 0, all_untimely = 0, all_total = 0;
+            for (unordered_map<uint64_t, uint32_t>::iterator it = issued.begin(); it != issued.end(); ++it)
+            {
+                all_issued += it->second;
+                all_untimely += untimely[it->first];
+                all_total += total[it->first];
+            }
+            cout << "sampled pcs: " << issued.size() << endl;
+            cout << "sampled accesses: " << all_total << endl;
+            cout << "sampled issued: " << all_issued << endl;
+            cout << "sampled untimely: " << all_untimely << endl;
+        }
+        cout << endl;
+        stats_registry.print(stats_section, cout);
     };
     void invoke_prefetcher(uint64_t ip, uint64_t addr, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
     void register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr);
     void dump_stats();
-    void print_config(){};
+    void print_config();
+    void register_stats(string section);
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
+    void checkpoint(CHECKPOINT &cp);
     sisb(string type, CACHE *cache);
 
     CACHE *parent = NULL;
-};
\ No newline at end of file
+};
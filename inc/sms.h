@@ -5,6 +5,7 @@
 #include <deque>
 #include "bitmap.h"
 #include "prefetcher.h"
+#include "entry_pool.h"
 
 using namespace std;
 
@@ -68,9 +69,9 @@ public:
 class SMSPrefetcher : public Prefetcher
 {
 private:
-	deque<FTEntry*> filter_table;
-	deque<ATEntry*> acc_table;
-	vector<deque<PHTEntry*> > pht;
+	ENTRY_POOL<FTEntry> filter_table; /* keyed by page, FIFO */
+	ENTRY_POOL<ATEntry> acc_table; /* keyed by page, in insertion order */
+	vector<ENTRY_POOL<PHTEntry> > pht;
 	uint32_t pht_sets;
 	deque<uint64_t> pref_buffer;
 
@@ -116,21 +117,21 @@ private:
 	void init_knobs();
 	void init_stats();
 
-	deque<FTEntry*>::iterator search_filter_table(uint64_t page);
-	deque<FTEntry*>::iterator search_victim_filter_table();
-	void evict_filter_table(deque<FTEntry*>::iterator victim);
+	FTEntry* search_filter_table(uint64_t page);
+	FTEntry* search_victim_filter_table();
+	void evict_filter_table(FTEntry *victim);
 	void insert_filter_table(uint64_t pc, uint64_t page, uint32_t offset);
 
-	deque<ATEntry*>::iterator search_acc_table(uint64_t page);
-	deque<ATEntry*>::iterator search_victim_acc_table();
-	void evict_acc_table(deque<ATEntry*>::iterator victim);
-	void update_age_acc_table(deque<ATEntry*>::iterator current);
+	ATEntry* search_acc_table(uint64_t page);
+	ATEntry* search_victim_acc_table();
+	void evict_acc_table(ATEntry *victim);
+	void update_age_acc_table(ATEntry *current);
 	void insert_acc_table(FTEntry *ftentry, uint32_t offset);
 	
-	deque<PHTEntry*>::iterator search_pht(uint64_t signature, int32_t *set);
-	deque<PHTEntry*>::iterator search_victim_pht(int32_t set);
-	void evcit_pht(int32_t set, deque<PHTEntry*>::iterator victim);
-	void update_age_pht(int32_t set, deque<PHTEntry*>::iterator current);
+	PHTEntry* search_pht(uint64_t signature, int32_t *set);
+	PHTEntry* search_victim_pht(int32_t set);
+	void evcit_pht(int32_t set, PHTEntry *victim);
+	void update_age_pht(int32_t set, PHTEntry *current);
 	void insert_pht_table(ATEntry *atentry);
 
 	uint64_t create_signature(uint64_t pc, uint32_t offset);
@@ -143,7 +144,10 @@ public:
 	~SMSPrefetcher();
 	void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
 	void dump_stats();
+	void register_stats(string section);
 	void print_config();
+	void save(CHECKPOINT &cp);
+	void load(CHECKPOINT &cp);
 };
 
 #endif /* SMS_H */
\ No newline at end of file
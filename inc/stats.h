@@ -0,0 +1,100 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// registry of the end-of-run statistics
+// components register every counter once, before the simulation starts, under a named section:
+// a pointer to the live counter, or a function for values derived at the end (totals, ratios)
+// print() renders a section as the plain "name value" text dump the scripts already parse,
+// and write_json() writes all sections to one JSON file (--stats_json_file) for structured rollups
+class STATS {
+  public:
+    STATS() : current(0), live(true){};
+
+    // following registrations go to section v1, created on first use
+    void section(const std::string &v1);
+
+    void counter(const std::string &v1, uint64_t *v2);
+    void value(const std::string &v1, std::function<uint64_t()> v2);
+    // v3 is the printf format of the value in the text dump, the stream default if NULL
+    void ratio(const std::string &v1, std::function<double()> v2, const char *v3 = NULL);
+    // v2[0..v3) is printed as v1_0, v1_1, ...
+    void histogram(const std::string &v1, uint64_t *v2, uint32_t v3);
+    // v2[0..v3) is printed on one line as "v1 v2[0],v2[1],...,"
+    void row(const std::string &v1, uint64_t *v2, uint32_t v3);
+
+    // entries only known at the end of the run (map-backed or sparse distributions),
+    // printed in the order v2 returns them; JSON gets one object named v1 holding all of them
+    typedef std::vector<std::pair<std::string, uint64_t>> VALUES;
+    typedef std::vector<std::pair<std::string, std::vector<uint64_t>>> ROWS;
+    // one "name value" line per entry, or printf(v3, name, value) if v3 is given
+    void values(const std::string &v1, std::function<VALUES()> v2, const char *v3 = NULL);
+    // one "name v0,v1,...," line per entry
+    void rows(const std::string &v1, std::function<ROWS()> v2);
+    // empty line in the text dump
+    void blank();
+    // line holding only v1 in the text dump, e.g. the heading of a legacy table
+    void line(const std::string &v1);
+    // the text dump labels the last registration v1 instead of its name ("label value"),
+    // so legacy dumps keep their wording while JSON uses the name; an empty v1 keeps it out of the text dump
+    void label(const std::string &v1);
+    // following counters and values are snapshots only filled at the end of the run (ROI totals),
+    // so reader() refuses them until at_end(false)
+    void at_end(bool v1);
+
+    bool has_section(const std::string &v1);
+    void print(const std::string &v1, std::ostream &out);
+    void write_json(const char *file_name);
+
+    // live value of the counter, value or histogram bucket (name_i) named v1 in any section,
+    // or in the given one for v1 = "section:name"
+    // an empty function, with the reason in v2, if there is none or it is not live:
+    // ratios, rows, end-of-run values and rows, and at_end() snapshots are only rendered in the dump
+    std::function<uint64_t()> reader(const std::string &v1, std::string &v2);
+    // names of the counters and values of section v1
+    std::vector<std::string> names(const std::string &v1);
+
+  private:
+    enum KIND { COUNTER, VALUE, RATIO, HISTOGRAM, ROW, VALUES_AT_END, ROWS_AT_END, BLANK, LINE };
+
+    class ENTRY {
+      public:
+        ENTRY() : labeled(false), format(NULL){};
+
+        KIND kind;
+        bool live;
+        std::string name;
+        bool labeled;
+        std::string text;
+        const char *format;
+        uint64_t *counter;
+        uint32_t size;
+        std::function<uint64_t()> value;
+        std::function<double()> ratio;
+        std::function<VALUES()> values;
+        std::function<ROWS()> rows;
+    };
+
+    class SECTION {
+      public:
+        std::string name;
+        std::vector<ENTRY> entries;
+    };
+
+    std::vector<SECTION> sections;
+    uint32_t current;
+    bool live;
+
+    SECTION *find(const std::string &v1);
+    void add(ENTRY &v1);
+};
+
+extern STATS stats_registry;
+
+#endif
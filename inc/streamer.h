@@ -1,8 +1,8 @@
 #ifndef STREAMER_H
 #define STREAMER_H
 
-#include <deque>
 #include "prefetcher.h"
+#include "entry_pool.h"
 using namespace std;
 
 class Stream_Tracker
@@ -27,7 +27,7 @@ public:
 class Streamer : public Prefetcher
 {
 private:
-    deque<Stream_Tracker*> trackers;
+    ENTRY_POOL<Stream_Tracker> trackers; /* keyed by page, LRU first */
 
     struct 
     {
@@ -58,7 +58,10 @@ public:
     ~Streamer();
     void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
     void dump_stats();
+    void register_stats(std::string section);
     void print_config();
+    void save(CHECKPOINT &cp);
+    void load(CHECKPOINT &cp);
 };
 
 #endif /* STREAMER_H */
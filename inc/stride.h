@@ -1,9 +1,9 @@
 #ifndef STRIDE_H
 #define STRIDE_H
 
-#include <deque>
 #include <vector>
 #include "prefetcher.h"
+#include "entry_pool.h"
 
 using namespace std;
 
@@ -25,7 +25,7 @@ class Tracker
 class StridePrefetcher : public Prefetcher
 {
 private:
-   deque<Tracker*> trackers;
+   ENTRY_POOL<Tracker> trackers; /* keyed by pc, most recent first */
 
    /* stats */
    struct
@@ -63,7 +63,10 @@ public:
    ~StridePrefetcher();
    void invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr);
    void dump_stats();
+   void register_stats(std::string section);
    void print_config();
+   void save(CHECKPOINT &cp);
+   void load(CHECKPOINT &cp);
 };
 
 
@@ -0,0 +1,152 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// number of trace records decoded per chunk, and chunks decoded ahead of the core
+#define TRACE_CHUNK_RECORDS 16384
+#define TRACE_READ_AHEAD_CHUNKS 8
+
+// trace cache image: a page-sized header followed by the decoded records
+#define TRACE_CACHE_MAGIC "CSTRACE"
+#define TRACE_CACHE_VERSION 1
+#define TRACE_CACHE_HEADER_SIZE 4096
+
+// --fanout_config: chunks of a trace shared between the decoding parent and its children
+#define TRACE_FANOUT_CHUNKS 8
+#define TRACE_FANOUT_MAX_CONSUMERS 64
+
+class TRACE_DECODER;
+
+class TRACE_CACHE_HEADER {
+  public:
+    char magic[8];
+    uint32_t version,
+             record_size,
+             source_crc,
+             reserved;
+    uint64_t num_records,
+             source_size;
+};
+
+// ring of decoded chunks of one trace in memory shared across fork()
+// chunk s sits in slot s % TRACE_FANOUT_CHUNKS and is overwritten only once every child has
+// released it; the counters are lock-free atomics, which are safe in shared memory
+class TRACE_FANOUT_RING {
+  public:
+    uint32_t record_size;
+    std::atomic<uint64_t> produced;                                  // chunks published
+    std::atomic<uint64_t> consumed[TRACE_FANOUT_MAX_CONSUMERS];      // chunks released, per child
+    uint32_t num_records[TRACE_FANOUT_CHUNKS];
+    bool end_of_trace[TRACE_FANOUT_CHUNKS];
+
+    uint8_t *chunk_data(uint64_t seq) {
+        return (uint8_t *)this + HEADER_SIZE + (seq % TRACE_FANOUT_CHUNKS) * TRACE_CHUNK_RECORDS * record_size;
+    };
+
+    static const size_t HEADER_SIZE = 4096;
+};
+
+// single-pass multi-configuration simulation (--fanout_config)
+// the parent decodes every trace once into a shared ring and forks one child per config
+// file; the children run as independent simulators whose TRACE_READERs read the shared
+// rings, so the decompression is paid once per sweep instead of once per config
+// the parent keeps at most TRACE_FANOUT_CHUNKS chunks ahead of the slowest child
+class TRACE_FANOUT {
+  public:
+    TRACE_FANOUT(std::vector<std::string> &v1, uint32_t v2, uint32_t v3);
+
+    // parent: decodes until every child in v1 has exited, returns the number that failed
+    uint32_t produce(std::vector<pid_t> &v1);
+
+    // child: index of this child among the consumers, and the ring of its next trace
+    void attach(uint32_t v1);
+    TRACE_FANOUT_RING *next_ring();
+    uint32_t consumer;
+
+  private:
+    std::vector<std::string> traces;
+    std::vector<TRACE_FANOUT_RING *> rings;
+    uint32_t record_size, num_consumers, attached;
+};
+
+// set in the children of --fanout_config, their trace readers attach to its rings
+extern TRACE_FANOUT *trace_fanout;
+
+// in-process trace decompression
+// a background thread streams records out of the compressed trace (gz, xz, or zst)
+// into a ring of chunks, and the core consumes whole chunks straight from memory
+// with --trace_cache_dir, the trace is instead decoded once into an uncompressed image
+// that every later run maps read-only, so concurrent jobs share it through the page cache
+// in a child of --fanout_config, the records come from the parent's shared ring instead
+class TRACE_READER {
+  public:
+    TRACE_READER(const char *v1, uint32_t v2);
+    ~TRACE_READER();
+
+    // returns the next record, or NULL once when the end of the trace is reached
+    // the following call starts over from the beginning of the trace
+    const uint8_t *next_record();
+
+    // records handed out since the trace was last (re)started, and fast-forward by as many
+    // used to put a restored core back where the checkpointed one stopped reading
+    uint64_t position();
+    void skip(uint64_t num_records);
+
+  private:
+    class CHUNK {
+      public:
+        uint8_t *data;
+        uint32_t num_records;
+        bool full, end_of_trace;
+
+        CHUNK() {
+            data = NULL;
+            num_records = 0;
+            full = false;
+            end_of_trace = false;
+        };
+    };
+
+    const uint32_t RECORD_SIZE;
+    TRACE_DECODER *decoder;
+    CHUNK chunk[TRACE_READ_AHEAD_CHUNKS];
+
+    // trace cache image
+    uint8_t *image;
+    uint64_t image_records, image_pos;
+    size_t image_bytes;
+
+    // --fanout_config ring
+    TRACE_FANOUT_RING *ring;
+    uint8_t *ring_data;
+    uint64_t ring_seq;
+
+    // consumer side
+    CHUNK *current;
+    uint32_t read_index, read_pos;
+    uint64_t records_read;
+    bool end_reported;
+
+    // producer side
+    uint32_t write_index;
+    bool stop;
+    std::mutex lock;
+    std::condition_variable chunk_full, chunk_empty;
+    std::thread worker;
+
+    void decode_loop();
+    const uint8_t *next_ring_record();
+    void open_trace_cache(const char *trace_name, const char *cache_dir);
+    bool map_trace_cache(const char *image_name, const TRACE_CACHE_HEADER &expected);
+    void build_trace_cache(const char *trace_name, const char *image_name, const TRACE_CACHE_HEADER &expected);
+};
+
+#endif
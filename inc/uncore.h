@@ -8,6 +8,45 @@
 
 //#define DRC_MSHR_SIZE 48
 
+// per-core entry point into the LLC for --parallel_cores
+// while the cores run a cycle on their own threads, an L2C only appends its requests to its own port,
+// and after the cycle barrier the main thread moves them into the LLC queues in the core order of that cycle
+// requests the LLC has no room for stay in the port, in order, and keep counting against the LLC queue
+class LLC_PORT : public MEMORY {
+  public:
+    CACHE *llc;
+
+    // requests in the order the L2C issued them, with the LLC queue each one is headed for
+    vector<PACKET> pending;
+    vector<uint8_t> pending_queue;
+    uint32_t num_pending[4];
+    uint64_t wq_full;
+
+    LLC_PORT() {
+        llc = NULL;
+        for (uint32_t i=0; i<4; i++)
+            num_pending[i] = 0;
+        wq_full = 0;
+    };
+
+    int  add_rq(PACKET *packet),
+         add_wq(PACKET *packet),
+         add_pq(PACKET *packet);
+
+    void return_data(PACKET *packet),
+         operate(),
+         increment_WQ_FULL(uint64_t address);
+
+    uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
+             get_size(uint8_t queue_type, uint64_t address);
+
+    void drain();
+    void checkpoint(CHECKPOINT &cp);
+
+  private:
+    int enqueue(uint8_t queue_type, PACKET *packet);
+};
+
 // uncore
 class UNCORE {
   public:
@@ -18,10 +57,15 @@ class UNCORE {
     // DRAM
     MEMORY_CONTROLLER DRAM{"DRAM"}; 
 
+    // L2C side of the LLC, one port per core
+    LLC_PORT port[NUM_CPUS];
+
     // cycle
     uint64_t cycle;
 
     UNCORE(); 
+
+    void checkpoint(CHECKPOINT &cp);
 };
 
 extern UNCORE uncore;
@@ -2,12 +2,34 @@
 #define UTIL_H
 
 #include <cstdint>
+#include <cassert>
 #include <string>
 #include <sstream>
 #include <vector>
 
 void gen_random(char *s, const int len);
-uint32_t folded_xor(uint64_t value, uint32_t num_folds);
+/* inline so the constant num_folds of the callers folds the loop away */
+inline uint32_t folded_xor(uint64_t value, uint32_t num_folds)
+{
+	assert(num_folds > 1);
+	assert((num_folds & (num_folds-1)) == 0); /* has to be power of 2 */
+	uint32_t mask = 0;
+	uint32_t bits_in_fold = 64/num_folds;
+	if(num_folds == 2)
+	{
+		mask = 0xffffffff;
+	}
+	else
+	{
+		mask = (1ul << bits_in_fold) - 1;
+	}
+	uint32_t folded_value = 0;
+	for(uint32_t fold = 0; fold < num_folds; ++fold)
+	{
+		folded_value = folded_value ^ ((value >> (fold * bits_in_fold)) & mask);
+	}
+	return folded_value;
+}
 
 template <class T> std::string array_to_string(std::vector<T> array, bool hex = false, uint32_t size = 0)
 {
@@ -71,6 +93,10 @@ public:
     static uint32_t four_hybrid11(uint32_t key);
     static uint32_t four_hybrid12(uint32_t key);
 
+    typedef uint32_t (*hash_fn)(uint32_t key);
+    static uint32_t identity(uint32_t key);
+    /* resolves a selector once, for callers that keep hashing with the same function */
+    static hash_fn getHashFunction(uint32_t selector);
     static uint32_t getHash(uint32_t selector, uint32_t key);
 };
 
@@ -1,6 +1,8 @@
 #include <iostream>
 #include "Domino.h"
+#include "stats.h"
 #include "champsim.h"
+#include "checkpoint.h"
 
 namespace knob
 {
@@ -8,20 +10,48 @@ namespace knob
   extern uint32_t Domino_degree;
   extern uint32_t Domino_super_entry_size;
   extern uint32_t Domino_debug_level;
+  extern bool Domino_bounded;
+  extern uint32_t Domino_history_size;
+  extern uint32_t Domino_index_table_size;
+  extern uint32_t Domino_index_table_ways;
+  extern uint32_t Domino_prefetch_filter_size;
+  extern uint32_t Domino_prefetch_filter_ways;
+}
+
+// bits needed to tell n things apart
+static uint32_t domino_bits(uint64_t n)
+{
+  uint32_t bits = 0;
+  while ((1ull << bits) < n)
+    bits++;
+  return bits;
 }
 
 Domino::Domino(string type, CACHE *cache) : Prefetcher(type), parent(cache),
                                             match_candidate_valid(false),
-                                            history_buffer(),
+                                            history_buffer(knob::Domino_bounded ? knob::Domino_history_size : 0),
                                             active_stream(knob::Domino_active_stream_size, &history_buffer, knob::Domino_debug_level),
+                                            bounded_index_table(TableGeometry(knob::Domino_bounded, knob::Domino_index_table_size, knob::Domino_index_table_ways)),
+                                            prefetch_filter(TableGeometry(knob::Domino_bounded, knob::Domino_prefetch_filter_size, knob::Domino_prefetch_filter_ways)),
                                             degree(knob::Domino_degree),
                                             super_entry_size(knob::Domino_super_entry_size), debug_level(knob::Domino_debug_level)
 {
   init_knobs();
   init_stats();
   last_address = 0;
-  match_candidate = nullptr;
+  match_candidate = 0;
   match_candidate_valid = false;
+
+  bounded = knob::Domino_bounded;
+  if (bounded && (knob::Domino_history_size == 0
+                  || knob::Domino_index_table_ways == 0 || knob::Domino_prefetch_filter_ways == 0
+                  || knob::Domino_index_table_size % knob::Domino_index_table_ways
+                  || knob::Domino_prefetch_filter_size % knob::Domino_prefetch_filter_ways))
+  {
+    cerr << "*** DOMINO NEEDS A HISTORY AND TABLES OF WHOLE SETS ***" << endl;
+    assert(0);
+  }
+
   cout << "Init Domino!" << endl;
   print_config();
 }
@@ -36,6 +66,33 @@ void Domino::print_config()
        << "Domino_super_entry_size" << knob::Domino_super_entry_size
        << "Domino_degree" << knob::Domino_degree
        << "Domino_debug_level" << knob::Domino_debug_level;
+  if (!knob::Domino_bounded)
+    return;
+
+  // metadata storage: block addresses are stored whole, table tags without their index bits
+  uint32_t address_bits = 64 - LOG2_BLOCK_SIZE;
+  uint32_t pointer_bits = domino_bits(knob::Domino_history_size);
+  uint32_t super_entry_bits = 1 + address_bits + pointer_bits + domino_bits(knob::Domino_super_entry_size);
+  uint64_t eit_sets = knob::Domino_index_table_size / knob::Domino_index_table_ways;
+  uint64_t eit_entry_bits = 1 + (address_bits - domino_bits(eit_sets)) + domino_bits(knob::Domino_index_table_ways)
+                            + knob::Domino_super_entry_size * super_entry_bits;
+  uint64_t filter_sets = knob::Domino_prefetch_filter_size / knob::Domino_prefetch_filter_ways;
+  uint64_t filter_entry_bits = 1 + (address_bits - domino_bits(filter_sets)) + domino_bits(knob::Domino_prefetch_filter_ways);
+  uint64_t history_bits = (uint64_t)knob::Domino_history_size * address_bits;
+  uint64_t eit_bits = knob::Domino_index_table_size * eit_entry_bits;
+  uint64_t filter_bits = knob::Domino_prefetch_filter_size * filter_entry_bits;
+
+  cout << endl
+       << "Domino_bounded " << knob::Domino_bounded << endl
+       << "Domino_history_size " << knob::Domino_history_size << endl
+       << "Domino_index_table_size " << knob::Domino_index_table_size << endl
+       << "Domino_index_table_ways " << knob::Domino_index_table_ways << endl
+       << "Domino_prefetch_filter_size " << knob::Domino_prefetch_filter_size << endl
+       << "Domino_prefetch_filter_ways " << knob::Domino_prefetch_filter_ways << endl
+       << "Domino_history_storage_KB " << history_bits / 8192.0 << endl
+       << "Domino_index_table_storage_KB " << eit_bits / 8192.0 << endl
+       << "Domino_prefetch_filter_storage_KB " << filter_bits / 8192.0 << endl
+       << "Domino_total_storage_KB " << (history_bits + eit_bits + filter_bits) / 8192.0 << endl;
 }
 
 void Domino::init_knobs()
@@ -48,15 +105,17 @@ void Domino::init_stats()
 
 bool Domino::match_second_address(uint64_t second_address, vector<uint64_t> &pref_addr)
 {
-  if (match_candidate_valid)
+  // a bounded index table may have replaced the candidate since it was found
+  Super_Entry *candidate = match_candidate_valid ? find_index(match_candidate) : NULL;
+  if (candidate)
   {
     if (debug_level >= 2)
     {
       cout << "Candidate content: " << endl;
-      match_candidate->print_content();
+      candidate->print_content();
     }
     uint64_t pointer;
-    if (match_candidate->find(second_address, pointer))
+    if (candidate->find(second_address, pointer) && history_buffer.valid(pointer))
     {
       set<uint64_t> stream_address;
       if (debug_level >= 2)
@@ -69,7 +128,7 @@ bool Domino::match_second_address(uint64_t second_address, vector<uint64_t> &pre
       int i;
       for (i = 1; i <= degree; i++)
       {
-        if (pointer + i < history_buffer.size())
+        if (history_buffer.valid(pointer + i))
         {
           pref_addr.emplace_back(history_buffer[pointer + i] << LOG2_BLOCK_SIZE);
           stream_address.insert(history_buffer[pointer + i]);
@@ -94,17 +153,18 @@ bool Domino::match_second_address(uint64_t second_address, vector<uint64_t> &pre
 
 bool Domino::seach_first_address(uint64_t first_address, vector<uint64_t> &pref_addr)
 {
-  if (index_table.find(first_address) != index_table.end())
+  Super_Entry *candidate = find_index(first_address);
+  if (candidate)
   {
-    match_candidate = &(index_table[first_address]);
+    match_candidate = first_address;
     match_candidate_valid = true;
-    uint64_t prefetched_addr = match_candidate->get_mru_addr();
+    uint64_t prefetched_addr = candidate->get_mru_addr();
     pref_addr.emplace_back(prefetched_addr << LOG2_BLOCK_SIZE);
     if (debug_level >= 2)
     {
       cout << "Replay::Successfully match 1st address! address=0x" << hex << first_address << ", mru_address=0x" << hex << prefetched_addr << endl;
       cout << "Candidate content:" << endl;
-      match_candidate->print_content();
+      candidate->print_content();
     }
     return true;
   }
@@ -117,7 +177,7 @@ bool Domino::seach_first_address(uint64_t first_address, vector<uint64_t> &pref_
 void Domino::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr)
 {
   uint64_t block_address = address >> LOG2_BLOCK_SIZE;
-  if (cache_hit && prefetched_address.find(block_address) == prefetched_address.end())
+  if (cache_hit && !is_prefetched(block_address))
     return;
   if (block_address == last_address)
     return;
@@ -139,24 +199,25 @@ void Domino::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit,
   for (size_t i = 0; i < pref_addr.size(); i++)
   {
     // parent->prefetch_line(pc, address, pref_addr[i] << LOG2_BLOCK_SIZE, FILL_L2, 0);
-    prefetched_address.insert(pref_addr[i] >> LOG2_BLOCK_SIZE);
+    set_prefetched(pref_addr[i] >> LOG2_BLOCK_SIZE);
   }
 
   // record
-  history_buffer.emplace_back(block_address);
+  uint64_t pointer = history_buffer.push(block_address);
   if (debug_level >= 2)
   {
-    cout << "Record::Insert HB! pointer=" << dec << history_buffer.size() - 1 << endl;
+    cout << "Record::Insert HB! pointer=" << dec << pointer << endl;
   }
   if (last_address != 0)
   {
-    if (index_table.find(last_address) != index_table.end())
+    Super_Entry *super_entry = find_index(last_address);
+    if (super_entry)
     {
       if (debug_level >= 2)
       {
         cout << "Record::Hit IT! last_addr=0x" << hex << last_address << endl;
       }
-      index_table[last_address].insert(block_address, history_buffer.size() - 1);
+      super_entry->insert(block_address, pointer);
     }
     else
     {
@@ -164,20 +225,133 @@ void Domino::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit,
       {
         cout << "Record::Miss IT! last_addr=0x" << hex << last_address << endl;
       }
-      Super_Entry super_entry(last_address, block_address, history_buffer.size() - 1, super_entry_size, debug_level);
-      // index_table[last_address] = super_entry;
-      index_table.insert(make_pair(last_address, super_entry));
-      // cout << "Insert IT!" << endl;
+      insert_index(last_address, Super_Entry(last_address, block_address, pointer, super_entry_size, debug_level));
     }
   }
   last_address = block_address;
 }
 
+Super_Entry *Domino::find_index(uint64_t first_address)
+{
+  if (bounded)
+  {
+    LRUSetAssociativeCache<Super_Entry>::Entry *entry = bounded_index_table.find(first_address);
+    if (!entry)
+      return NULL;
+    bounded_index_table.set_mru(first_address);
+    return &entry->data;
+  }
+
+  map<uint64_t, Super_Entry>::iterator it = index_table.find(first_address);
+  return it != index_table.end() ? &it->second : NULL;
+}
+
+void Domino::insert_index(uint64_t first_address, const Super_Entry &super_entry)
+{
+  if (bounded)
+  {
+    bounded_index_table.insert(first_address, super_entry);
+    bounded_index_table.set_mru(first_address);
+    return;
+  }
+  index_table.insert(make_pair(first_address, super_entry));
+}
+
+bool Domino::is_prefetched(uint64_t block_address)
+{
+  if (bounded)
+    return prefetch_filter.find(block_address) != NULL;
+  return prefetched_address.find(block_address) != prefetched_address.end();
+}
+
+void Domino::set_prefetched(uint64_t block_address)
+{
+  if (bounded)
+  {
+    prefetch_filter.insert(block_address, true);
+    prefetch_filter.set_mru(block_address);
+    return;
+  }
+  prefetched_address.insert(block_address);
+}
+
+void Domino::clear_prefetched(uint64_t block_address)
+{
+  if (bounded)
+  {
+    prefetch_filter.erase(block_address);
+    return;
+  }
+  prefetched_address.erase(block_address);
+}
+
 void Domino::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr)
 {
-  prefetched_address.erase(evicted_addr >> LOG2_BLOCK_SIZE);
+  clear_prefetched(evicted_addr >> LOG2_BLOCK_SIZE);
+}
+
+void Domino::register_stats(string section)
+{
+  // Domino keeps no counters, its section stays empty
+  stats_section = section;
+  stats_registry.section(section);
 }
 
 void Domino::dump_stats()
 {
+  stats_registry.print(stats_section, cout);
+}
+
+void Domino::save(CHECKPOINT &cp)
+{
+  checkpoint(cp);
+}
+
+void Domino::load(CHECKPOINT &cp)
+{
+  checkpoint(cp);
+}
+
+// walks the history, the index table and the streams in the same order for save and restore,
+// of the bounded and unbounded structures only the ones in use
+void Domino::checkpoint(CHECKPOINT &cp)
+{
+  history_buffer.checkpoint(cp);
+  cp.scalar(last_address);
+  cp.scalar(match_candidate);
+  cp.scalar(match_candidate_valid);
+  active_stream.checkpoint(cp);
+
+  cp.check(bounded, "Domino bounded");
+  cp.check(super_entry_size, "Domino super entry size");
+  if (bounded)
+  {
+    bounded_index_table.checkpoint(cp, [](CHECKPOINT &cp, Super_Entry &super_entry) { super_entry.checkpoint(cp); });
+    prefetch_filter.checkpoint(cp);
+    return;
+  }
+
+  uint64_t num_entries = index_table.size();
+  cp.scalar(num_entries);
+  if (cp.saving())
+  {
+    for (map<uint64_t, Super_Entry>::iterator it = index_table.begin(); it != index_table.end(); ++it)
+    {
+      uint64_t first_address = it->first;
+      cp.scalar(first_address);
+      it->second.checkpoint(cp);
+    }
+  }
+  else
+  {
+    index_table.clear();
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+      uint64_t first_address = 0;
+      cp.scalar(first_address);
+      map<uint64_t, Super_Entry>::iterator it = index_table.insert(index_table.end(), make_pair(first_address, Super_Entry()));
+      it->second.checkpoint(cp);
+    }
+  }
+  cp.set_entries(prefetched_address);
 }
@@ -1,6 +1,8 @@
 #include <algorithm>
 #include "ampm.h"
+#include "stats.h"
 #include "champsim.h"
+#include "checkpoint.h"
 
 namespace knob
 {
@@ -37,6 +39,7 @@ AMPM::AMPM(string type) : Prefetcher(type)
 {
     init_knobs();
     init_stats();
+    page_buffer.init(knob::ampm_pb_size, true);
 }
 
 void AMPM::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr)
@@ -46,33 +49,27 @@ void AMPM::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, u
 
     stats.invoke_called++;
 
-    AMPM_PB_Entry *pb_entry = NULL;
-    auto it = find_if(page_buffer.begin(), page_buffer.end(), [page](AMPM_PB_Entry *pb_entry){return pb_entry->page_id == page;});
+    AMPM_PB_Entry *pb_entry = page_buffer.find(page);
     
     /* page already tracked */
-    if(it != page_buffer.end())
+    if(pb_entry)
     {
-        pb_entry = (*it);
-        pb_entry->page_id = page;
         pb_entry->bitmap[offset] = true;
-        page_buffer.erase(it);
-        page_buffer.push_back(pb_entry);
+        page_buffer.move_to_back(pb_entry);
         stats.pb.hit++;
     }
     else
     {
         if(page_buffer.size() >= knob::ampm_pb_size)
         {
-            pb_entry = page_buffer.front();
             page_buffer.pop_front();
-            delete(pb_entry);
             stats.pb.evict++;
         }
 
-        pb_entry = new AMPM_PB_Entry();
+        pb_entry = page_buffer.emplace_back();
+        page_buffer.set_key(pb_entry, page);
         pb_entry->page_id = page;
         pb_entry->bitmap[offset] = true;
-        page_buffer.push_back(pb_entry);
         stats.pb.insert++;
     }
 
@@ -209,40 +206,77 @@ void AMPM::issue_prefetch(vector<uint64_t> &pref_addr)
 	stats.pref_buffer.issued += pref_addr.size();
 }
 
-void AMPM::dump_stats()
+void AMPM::register_stats(string section)
 {
-    cout << "ampm.invoke_called " << stats.invoke_called << endl
-         << "ampm.pb.hit " << stats.pb.hit << endl
-         << "ampm.pb.evict " << stats.pb.evict << endl
-         << "ampm.pb.insert " << stats.pb.insert << endl
-         << "ampm.pred.total " << stats.pred.total << endl
-         << "ampm.pred.degree_reached_pos " << stats.pred.degree_reached_pos << endl
-         << "ampm.pred.degree_reached_neg " << stats.pred.degree_reached_neg << endl
-         << endl;
+    stats_section = section;
+    stats_registry.section(section);
+    stats_registry.counter("ampm.invoke_called", &stats.invoke_called);
+    stats_registry.counter("ampm.pb.hit", &stats.pb.hit);
+    stats_registry.counter("ampm.pb.evict", &stats.pb.evict);
+    stats_registry.counter("ampm.pb.insert", &stats.pb.insert);
+    stats_registry.counter("ampm.pred.total", &stats.pred.total);
+    stats_registry.counter("ampm.pred.degree_reached_pos", &stats.pred.degree_reached_pos);
+    stats_registry.counter("ampm.pred.degree_reached_neg", &stats.pred.degree_reached_neg);
+    stats_registry.blank();
+    /* nonzero prediction offsets only, positive ones first */
+    stats_registry.values("ampm.pred.histogram", [this]() {
+        assert(stats.pred.pos_histogram[0] == 0);
+        assert(stats.pred.neg_histogram[0] == 0);
+        STATS::VALUES values;
+        for(uint32_t index = 0; index < MAX_OFFSETS; ++index)
+        {
+            if(stats.pred.pos_histogram[index])
+            {
+                values.push_back(make_pair("ampm.pred.histogram." + to_string(index), stats.pred.pos_histogram[index]));
+            }
+        }
+        for (uint32_t index = 0; index < MAX_OFFSETS; ++index)
+        {
+            if (stats.pred.neg_histogram[index])
+            {
+                values.push_back(make_pair("ampm.pred.histogram.-" + to_string(index), stats.pred.neg_histogram[index]));
+            }
+        }
+        return values;
+    });
+    stats_registry.blank();
+    stats_registry.counter("ampm.pref_buffer.hit", &stats.pref_buffer.hit);
+    stats_registry.counter("ampm.pref_buffer.dropped", &stats.pref_buffer.dropped);
+    stats_registry.counter("ampm.pref_buffer.insert", &stats.pref_buffer.insert);
+    stats_registry.counter("ampm.pref_buffer.issued", &stats.pref_buffer.issued);
+    stats_registry.counter("ampm.pref.total", &stats.pref.total);
+    stats_registry.blank();
+}
 
-    assert(stats.pred.pos_histogram[0] == 0);
-    assert(stats.pred.neg_histogram[0] == 0);
+void AMPM::dump_stats()
+{
+    stats_registry.print(stats_section, cout);
+}
 
-    for(uint32_t index = 0; index < MAX_OFFSETS; ++index)
+void AMPM::save(CHECKPOINT &cp)
+{
+    uint64_t num_entries = page_buffer.size();
+    cp.scalar(num_entries);
+    for(auto it = page_buffer.begin(); it != page_buffer.end(); ++it)
     {
-        if(stats.pred.pos_histogram[index])
-        {
-            cout << "ampm.pred.histogram." << index << " " << stats.pred.pos_histogram[index] << endl;
-        }
+        cp.scalar(*it);
     }
-    for (uint32_t index = 0; index < MAX_OFFSETS; ++index)
+    cp.deque_entries(pref_buffer);
+    cp.scalar(stats);
+}
+
+void AMPM::load(CHECKPOINT &cp)
+{
+    page_buffer.clear();
+
+    uint64_t num_entries = 0;
+    cp.scalar(num_entries);
+    for(uint64_t index = 0; index < num_entries; ++index)
     {
-        if (stats.pred.neg_histogram[index])
-        {
-            cout << "ampm.pred.histogram.-" << index << " " << stats.pred.neg_histogram[index] << endl;
-        }
+        AMPM_PB_Entry *pb_entry = page_buffer.emplace_back();
+        cp.scalar(*pb_entry);
+        page_buffer.set_key(pb_entry, pb_entry->page_id);
     }
-    cout << endl;
-
-    cout << "ampm.pref_buffer.hit " << stats.pref_buffer.hit << endl
-        << "ampm.pref_buffer.dropped " << stats.pref_buffer.dropped << endl
-        << "ampm.pref_buffer.insert " << stats.pref_buffer.insert << endl
-        << "ampm.pref_buffer.issued " << stats.pref_buffer.issued << endl
-        << "ampm.pref.total " << stats.pref.total << endl
-        << endl;
-}
\ No newline at end of file
+    cp.deque_entries(pref_buffer);
+    cp.scalar(stats);
+}
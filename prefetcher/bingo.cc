@@ -1,7 +1,9 @@
 #include <iostream>
 #include "cache.h"
 #include "champsim.h"
+#include "checkpoint.h"
 #include "bingo.h"
+#include "stats.h"
 #include <set>
 
 namespace knob
@@ -91,7 +93,7 @@ void Bingo::access(uint64_t block_number, uint64_t pc)
    {
       /* trigger access */
       this->filter_table.insert(region_number, pc, region_offset);
-      vector<int> pattern = this->find_in_pht(pc, block_number);
+      FillPattern pattern = this->find_in_pht(pc, block_number);
       if (pattern.empty())
       {
          /* nothing to prefetch */
@@ -214,38 +216,57 @@ void Bingo::reset_stats()
    this->vote_cnt = 0;
 }
 
-void Bingo::print_stats()
+void Bingo::register_stats(string section)
 {
-   cout << "[Bingo] PHT Access: " << this->pht_access_cnt << endl;
-   cout << "[Bingo] PHT Hit PC+Addr: " << this->pht_pc_address_cnt << endl;
-   cout << "[Bingo] PHT Hit PC+Offs: " << this->pht_pc_offset_cnt << endl;
-   cout << "[Bingo] PHT Miss: " << this->pht_miss_cnt << endl;
-
-   cout << "[Bingo] Prefetch PC+Addr: " << this->prefetch_cnt[PC_ADDRESS] << endl;
-   cout << "[Bingo] Prefetch PC+Offs: " << this->prefetch_cnt[PC_OFFSET] << endl;
-
-   cout << "[Bingo] Useful PC+Addr: " << this->useful_cnt[PC_ADDRESS] << endl;
-   cout << "[Bingo] Useful PC+Offs: " << this->useful_cnt[PC_OFFSET] << endl;
-
-   cout << "[Bingo] Useless PC+Addr: " << this->useless_cnt[PC_ADDRESS] << endl;
-   cout << "[Bingo] Useless PC+Offs: " << this->useless_cnt[PC_OFFSET] << endl;
-
-   double l1_pref_per_region = 1.0 * this->pref_level_cnt[FILL_L1] / this->region_pref_cnt;
-   double l2_pref_per_region = 1.0 * this->pref_level_cnt[FILL_L2] / this->region_pref_cnt;
-   double l3_pref_per_region = 1.0 * this->pref_level_cnt[FILL_LLC] / this->region_pref_cnt;
-   double no_pref_per_region = (double)this->pattern_len - (l1_pref_per_region + l2_pref_per_region + l3_pref_per_region);
-
-   cout << "[Bingo] L1 Prefetch per Region: " << l1_pref_per_region << endl;
-   cout << "[Bingo] L2 Prefetch per Region: " << l2_pref_per_region << endl;
-   cout << "[Bingo] L3 Prefetch per Region: " << l3_pref_per_region << endl;
-   cout << "[Bingo] No Prefetch per Region: " << no_pref_per_region << endl;
-
-   double voter_mean = 1.0 * this->voter_sum / this->vote_cnt;
-   double voter_sqr_mean = 1.0 * this->voter_sqr_sum / this->vote_cnt;
-   double voter_sd = sqrt(voter_sqr_mean - square(voter_mean));
-   cout << "[Bingo] Number of Voters Mean: " << voter_mean << endl;
-   cout << "[Bingo] Number of Voters SD: " << voter_sd << endl;
-   cout << endl;
+   stats_section = section;
+   stats_registry.section(section);
+   stats_registry.counter("bingo_pht_access", &this->pht_access_cnt);
+   stats_registry.label("[Bingo] PHT Access:");
+   stats_registry.counter("bingo_pht_hit_pc_addr", &this->pht_pc_address_cnt);
+   stats_registry.label("[Bingo] PHT Hit PC+Addr:");
+   stats_registry.counter("bingo_pht_hit_pc_offs", &this->pht_pc_offset_cnt);
+   stats_registry.label("[Bingo] PHT Hit PC+Offs:");
+   stats_registry.counter("bingo_pht_miss", &this->pht_miss_cnt);
+   stats_registry.label("[Bingo] PHT Miss:");
+
+   stats_registry.counter("bingo_prefetch_pc_addr", &this->prefetch_cnt[PC_ADDRESS]);
+   stats_registry.label("[Bingo] Prefetch PC+Addr:");
+   stats_registry.counter("bingo_prefetch_pc_offs", &this->prefetch_cnt[PC_OFFSET]);
+   stats_registry.label("[Bingo] Prefetch PC+Offs:");
+
+   stats_registry.counter("bingo_useful_pc_addr", &this->useful_cnt[PC_ADDRESS]);
+   stats_registry.label("[Bingo] Useful PC+Addr:");
+   stats_registry.counter("bingo_useful_pc_offs", &this->useful_cnt[PC_OFFSET]);
+   stats_registry.label("[Bingo] Useful PC+Offs:");
+
+   stats_registry.counter("bingo_useless_pc_addr", &this->useless_cnt[PC_ADDRESS]);
+   stats_registry.label("[Bingo] Useless PC+Addr:");
+   stats_registry.counter("bingo_useless_pc_offs", &this->useless_cnt[PC_OFFSET]);
+   stats_registry.label("[Bingo] Useless PC+Offs:");
+
+   stats_registry.ratio("bingo_l1_pref_per_region", [this]() { return 1.0 * this->pref_level_cnt[FILL_L1] / this->region_pref_cnt; });
+   stats_registry.label("[Bingo] L1 Prefetch per Region:");
+   stats_registry.ratio("bingo_l2_pref_per_region", [this]() { return 1.0 * this->pref_level_cnt[FILL_L2] / this->region_pref_cnt; });
+   stats_registry.label("[Bingo] L2 Prefetch per Region:");
+   stats_registry.ratio("bingo_l3_pref_per_region", [this]() { return 1.0 * this->pref_level_cnt[FILL_LLC] / this->region_pref_cnt; });
+   stats_registry.label("[Bingo] L3 Prefetch per Region:");
+   stats_registry.ratio("bingo_no_pref_per_region", [this]() {
+      double l1_pref_per_region = 1.0 * this->pref_level_cnt[FILL_L1] / this->region_pref_cnt;
+      double l2_pref_per_region = 1.0 * this->pref_level_cnt[FILL_L2] / this->region_pref_cnt;
+      double l3_pref_per_region = 1.0 * this->pref_level_cnt[FILL_LLC] / this->region_pref_cnt;
+      return (double)this->pattern_len - (l1_pref_per_region + l2_pref_per_region + l3_pref_per_region);
+   });
+   stats_registry.label("[Bingo] No Prefetch per Region:");
+
+   stats_registry.ratio("bingo_voters_mean", [this]() { return 1.0 * this->voter_sum / this->vote_cnt; });
+   stats_registry.label("[Bingo] Number of Voters Mean:");
+   stats_registry.ratio("bingo_voters_sd", [this]() {
+      double voter_mean = 1.0 * this->voter_sum / this->vote_cnt;
+      double voter_sqr_mean = 1.0 * this->voter_sqr_sum / this->vote_cnt;
+      return sqrt(voter_sqr_mean - square(voter_mean));
+   });
+   stats_registry.label("[Bingo] Number of Voters SD:");
+   stats_registry.blank();
 }
 
 /**
@@ -253,29 +274,28 @@ void Bingo::print_stats()
  * @return The appropriate prefetch level for all blocks based on PHT output or an empty vector
  *         if no blocks should be prefetched
  */
-vector<int> Bingo::find_in_pht(uint64_t pc, uint64_t address)
+FillPattern Bingo::find_in_pht(uint64_t pc, uint64_t address)
 {
    if (this->debug_level >= 2)
    {
       cerr << "[Bingo] find_in_pht(pc=0x" << hex << pc << ", address=0x" << address << ")" << dec << endl;
    }
-   vector<vector<bool>> matches = this->pht.find(pc, address);
+   vector<BlockPattern> &matches = this->pht_matches;
+   this->pht.find(pc, address, matches);
    this->pht_access_cnt += 1;
    Event pht_last_event = this->pht.get_last_event();
    uint64_t region_number = address / this->pattern_len;
    if (pht_last_event != MISS)
       this->pht_events[region_number] = pht_last_event;
-   vector<int> pattern;
+   FillPattern pattern;
    if (pht_last_event == PC_ADDRESS)
    {
       // cerr << "PC_ADDRESS, 0x" << hex << address << endl;
       this->pht_pc_address_cnt += 1;
       // assert(matches.size() == 1); /* there can only be 1 PC+Address match */
       // assert(matches[0].size() == (unsigned)this->pattern_len);
-      pattern.resize(this->pattern_len, 0);
-      for (int i = 0; i < this->pattern_len; i += 1)
-         if (matches[0][i])
-            pattern[i] = pc_address_fill_level;
+      pattern = FillPattern(this->pattern_len);
+      pattern.set_blocks(matches[0], pc_address_fill_level);
    }
    else if (pht_last_event == PC_OFFSET)
    {
@@ -295,9 +315,8 @@ vector<int> Bingo::find_in_pht(uint64_t pc, uint64_t address)
    if (pht_last_event != MISS)
    {
       this->region_pref_cnt += 1;
-      for (int i = 0; i < (int)pattern.size(); i += 1)
-         if (pattern[i] != 0)
-            this->pref_level_cnt[pattern[i]] += 1;
+      for (uint64_t bits = pattern.blocks().word(); bits; bits &= bits - 1)
+         this->pref_level_cnt[pattern[__builtin_ctzll(bits)]] += 1;
       // assert(this->pref_level_cnt.size() <= 3); /* L1, L2, L3 */
    }
    /* ===== */
@@ -313,7 +332,7 @@ void Bingo::insert_in_pht(const AccumulationTable::Entry &entry)
    {
       cerr << "[Bingo] insert_in_pht(pc=0x" << hex << pc << ", address=0x" << address << ")" << dec << endl;
    }
-   const vector<bool> &pattern = entry.data.pattern;
+   const BlockPattern &pattern = entry.data.pattern;
 
 #ifdef PATTERN_RECORD
    uint64_t record_key = ((pc & ((1 << knob::bingo_pc_width) - 1)) << knob::bingo_max_addr_width) + (address & ((1 << knob::bingo_max_addr_width) - 1));
@@ -333,7 +352,7 @@ void Bingo::insert_in_pht(const AccumulationTable::Entry &entry)
  * @return  The appropriate prefetch level for all blocks based on BINGO's voting thresholds or
  *          an empty vector if no blocks should be prefetched
  */
-vector<int> Bingo::vote(const vector<vector<bool>> &x)
+FillPattern Bingo::vote(const vector<BlockPattern> &x)
 {
    if (this->debug_level >= 2)
       cerr << "Bingo::vote(...)" << endl;
@@ -342,7 +361,7 @@ vector<int> Bingo::vote(const vector<vector<bool>> &x)
    {
       if (this->debug_level >= 2)
          cerr << "[Bingo::vote] There are no voters." << endl;
-      return vector<int>();
+      return FillPattern();
    }
    /* stats */
    this->vote_cnt += 1;
@@ -355,36 +374,27 @@ vector<int> Bingo::vote(const vector<vector<bool>> &x)
       for (int i = 0; i < n; i += 1)
          cerr << "<" << setw(3) << i + 1 << "> " << pattern_to_string(x[i]) << endl;
    }
-   bool pf_flag = false;
-   vector<int> res(this->pattern_len, 0);
-   for (int i = 0; i < n; i += 1)
-      // assert((int)x[i].size() == this->pattern_len);
-      for (int i = 0; i < this->pattern_len; i += 1)
-      {
-         int cnt = 0;
-         for (int j = 0; j < n; j += 1)
-            if (x[j][i])
-               cnt += 1;
-         double p = 1.0 * cnt / n;
-         if (p >= knob::bingo_l1d_thresh)
-            // lyq: l2 prefetcher can't fill to l1
-            res[i] = FILL_L2;
-         // res[i] = FILL_L1;
-         else if (p >= knob::bingo_l2c_thresh)
-            res[i] = FILL_L2;
-         else if (p >= knob::bingo_llc_thresh)
-            res[i] = FILL_LLC;
-         else
-            res[i] = 0;
-         if (res[i] != 0)
-            pf_flag = true;
-      }
+   FillPattern res(this->pattern_len);
+   int cnt[PATTERN_MAX_BLOCKS] = {0};
+   count_votes(x, cnt);
+   for (int i = 0; i < this->pattern_len; i += 1)
+   {
+      double p = 1.0 * cnt[i] / n;
+      if (p >= knob::bingo_l1d_thresh)
+         // lyq: l2 prefetcher can't fill to l1
+         res.set(i, FILL_L2);
+      // res.set(i, FILL_L1);
+      else if (p >= knob::bingo_l2c_thresh)
+         res.set(i, FILL_L2);
+      else if (p >= knob::bingo_llc_thresh)
+         res.set(i, FILL_LLC);
+   }
    if (this->debug_level >= 2)
    {
       cerr << "<res> " << pattern_to_string(res) << endl;
    }
-   if (!pf_flag)
-      return vector<int>();
+   if (!res.any())
+      return FillPattern();
    return res;
 }
 
@@ -430,7 +440,7 @@ void Bingo::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t pre
 
 void Bingo::dump_stats()
 {
-   print_stats();
+   stats_registry.print(stats_section, cout);
 
 #ifdef PATTERN_RECORD
    for (auto &t : pattern_record)
@@ -455,3 +465,44 @@ void Bingo::dump_stats()
    cerr << "PHT_MIN_USE_LATENCY " << pht.min_cycle << endl;
 #endif
 }
+
+void Bingo::save(CHECKPOINT &cp)
+{
+   checkpoint(cp);
+}
+
+void Bingo::load(CHECKPOINT &cp)
+{
+   checkpoint(cp);
+}
+
+/* walks the tables and the stats in the same order for save and restore, pht_matches is rebuilt on use */
+void Bingo::checkpoint(CHECKPOINT &cp)
+{
+   filter_table.checkpoint(cp);
+   accumulation_table.checkpoint(cp);
+   pht.checkpoint(cp);
+   pf_streamer.checkpoint(cp);
+#ifdef TRACK_FIRST_USE
+   cp.scalar(accumulation_table.track_count);
+   cp.scalar(accumulation_table.track_cycle);
+   cp.scalar(accumulation_table.min_cycle);
+   cp.scalar(pht.track_count);
+   cp.scalar(pht.track_cycle);
+   cp.scalar(pht.min_cycle);
+#endif
+
+   cp.map_entries(pht_events);
+   cp.scalar(pht_access_cnt);
+   cp.scalar(pht_pc_address_cnt);
+   cp.scalar(pht_pc_offset_cnt);
+   cp.scalar(pht_miss_cnt);
+   cp.array(prefetch_cnt, 2);
+   cp.array(useful_cnt, 2);
+   cp.array(useless_cnt, 2);
+   cp.map_entries(pref_level_cnt);
+   cp.scalar(region_pref_cnt);
+   cp.scalar(vote_cnt);
+   cp.scalar(voter_sum);
+   cp.scalar(voter_sqr_sum);
+}
@@ -1,6 +1,8 @@
 #include <iostream>
 #include "bop.h"
+#include "stats.h"
 #include "champsim.h"
+#include "checkpoint.h"
 
 namespace knob
 {
@@ -227,19 +229,49 @@ void BOPrefetcher::insert_rr(uint64_t address)
 	rr.push_back(address);
 }
 
+void BOPrefetcher::register_stats(string section)
+{
+	stats_section = section;
+	stats_registry.section(section);
+	stats_registry.counter("bop_end_phase_max_round", &stats.end_phase.max_round);
+	stats_registry.counter("bop_end_phase_max_score", &stats.end_phase.max_score);
+	stats_registry.counter("bop_total_phases", &stats.total_phases);
+	stats_registry.counter("bop_fill_called", &stats.fill.called);
+	stats_registry.counter("bop_fill_insert_rr", &stats.fill.insert_rr);
+	stats_registry.counter("bop_insert_rr_hit", &stats.insert_rr.hit);
+	stats_registry.counter("bop_insert_rr_evict", &stats.insert_rr.evict);
+	stats_registry.counter("bop_insert_rr_insert", &stats.insert_rr.insert);
+	stats_registry.counter("bop_pref_buffer_buffered", &stats.pref_buffer.buffered);
+	stats_registry.counter("bop_pref_buffer_spilled", &stats.pref_buffer.spilled);
+	stats_registry.counter("bop_pref_buffer_issued", &stats.pref_buffer.issued);
+	stats_registry.counter("bop_pref_issued", &stats.pref_issued);
+	stats_registry.blank();
+}
+
 void BOPrefetcher::dump_stats()
 {
-	cout << "bop_end_phase_max_round " << stats.end_phase.max_round << endl
-		<< "bop_end_phase_max_score " << stats.end_phase.max_score << endl
-		<< "bop_total_phases " << stats.total_phases << endl
-		<< "bop_fill_called " << stats.fill.called << endl
-		<< "bop_fill_insert_rr " << stats.fill.insert_rr << endl
-		<< "bop_insert_rr_hit " << stats.insert_rr.hit << endl
-		<< "bop_insert_rr_evict " << stats.insert_rr.evict << endl
-		<< "bop_insert_rr_insert " << stats.insert_rr.insert << endl
-		<< "bop_pref_buffer_buffered " << stats.pref_buffer.buffered << endl
-		<< "bop_pref_buffer_spilled " << stats.pref_buffer.spilled << endl
-		<< "bop_pref_buffer_issued " << stats.pref_buffer.issued << endl
-		<< "bop_pref_issued " << stats.pref_issued << endl
-		<< endl;
+	stats_registry.print(stats_section, cout);
+}
+
+void BOPrefetcher::save(CHECKPOINT &cp)
+{
+	checkpoint(cp);
+}
+
+void BOPrefetcher::load(CHECKPOINT &cp)
+{
+	checkpoint(cp);
+}
+
+/* walks the RR table, the scores of the running phase and the stats in the same order for save and restore */
+void BOPrefetcher::checkpoint(CHECKPOINT &cp)
+{
+	cp.deque_entries(rr);
+	cp.check(knob::bop_candidates.size(), "bop candidates");
+	cp.vector_entries(scores);
+	cp.deque_entries(pref_buffer);
+	cp.scalar(round_counter);
+	cp.scalar(candidate_ptr);
+	cp.vector_entries(best_offsets);
+	cp.scalar(stats);
 }
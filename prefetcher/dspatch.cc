@@ -3,7 +3,9 @@
 #include <iomanip>
 #include "champsim.h"
 #include "util.h"
+#include "checkpoint.h"
 #include "dspatch.h"
+#include "stats.h"
 #include "memory_class.h"
 
 #if 0
@@ -63,13 +65,10 @@ DSPatch::DSPatch(string type) : Prefetcher(type)
 	/* init bw to lowest value */
 	bw_bucket = 0;
 
+	page_buffer.init(knob::dspatch_pb_size, true);
+
 	/* init SPT */
-	spt = (DSPatch_SPTEntry**)calloc(knob::dspatch_num_spt_entries, sizeof(DSPatch_SPTEntry**));
-	assert(spt);
-	for(uint32_t index = 0; index < knob::dspatch_num_spt_entries; ++index)
-	{
-		spt[index] = new DSPatch_SPTEntry();
-	}
+	spt = new DSPatch_SPTEntry[knob::dspatch_num_spt_entries];
 }
 
 DSPatch::~DSPatch()
@@ -122,21 +121,20 @@ void DSPatch::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit
 		if(page_buffer.size() >= knob::dspatch_pb_size)
 		{
 			pbentry = page_buffer.front();
-			page_buffer.pop_front();
 			add_to_spt(pbentry);
 			// if(knob::dspatch_enable_debug)
 			// {
 			// 	debug_pbentry(pbentry);
 			// }
-			delete pbentry;
+			page_buffer.pop_front();
 			stats.pb.evict++;
 		}
-		pbentry = new DSPatch_PBEntry();
+		pbentry = page_buffer.emplace_back();
+		page_buffer.set_key(pbentry, page);
 		pbentry->page = page;
 		pbentry->trigger_pc = pc;
 		pbentry->trigger_offset = offset;
 		pbentry->bmp_real[offset] = true;
-		page_buffer.push_back(pbentry);
 		stats.pb.insert++;
 
 		/* trigger prefetch */
@@ -167,7 +165,7 @@ void DSPatch::generate_prefetch(uint64_t pc, uint64_t page, uint32_t offset, uin
 	uint32_t spt_index = get_spt_index(signature);
 	assert(spt_index < knob::dspatch_num_spt_entries);
 	
-	sptentry = spt[spt_index];
+	sptentry = &spt[spt_index];
 	candidate = select_bitmap(sptentry, bmp_pred);
 	stats.gen_pref.selection_dist[candidate]++;
 	MYLOG("pc %lx sig %lx spt_index %u candidate %s", pc, signature, spt_index, Map_DSPatch_pref_candidate(candidate));
@@ -234,8 +232,7 @@ DSPatch_pref_candidate DSPatch::select_bitmap(DSPatch_SPTEntry *sptentry, Bitmap
 
 DSPatch_PBEntry* DSPatch::search_pb(uint64_t page)
 {
-	auto it = find_if(page_buffer.begin(), page_buffer.end(), [page](DSPatch_PBEntry *pbentry){return pbentry->page == page;});
-	return it != page_buffer.end() ? (*it) : NULL;
+	return page_buffer.find(page);
 }
 
 void DSPatch::buffer_prefetch(vector<uint64_t> pref_addr)
@@ -322,7 +319,7 @@ void DSPatch::add_to_spt(DSPatch_PBEntry *pbentry)
 	uint64_t signature = create_signature(trigger_pc, 0xdeadbeef, trigger_offset);
 	uint32_t spt_index = get_spt_index(signature);
 	assert(spt_index < knob::dspatch_num_spt_entries);
-	DSPatch_SPTEntry *sptentry = spt[spt_index];
+	DSPatch_SPTEntry *sptentry = &spt[spt_index];
 	MYLOG("page %lx trigger_pc %lx trigger_offset %u sig %lx spt_index %u", pbentry->page, trigger_pc, trigger_offset, signature, spt_index);
 
 	bmp_real = BitmapHelper::rotate_right(bmp_real, trigger_offset, knob::dspatch_num_cachelines_in_region);
@@ -447,43 +444,79 @@ DSPatch_pref_candidate DSPatch::dyn_selection(DSPatch_SPTEntry *sptentry, Bitmap
 	return candidate;
 }
 
+void DSPatch::register_stats(string section)
+{
+	stats_section = section;
+	stats_registry.section(section);
+	stats_registry.counter("dspatch.pb.lookup", &stats.pb.lookup);
+	stats_registry.counter("dspatch.pb.hit", &stats.pb.hit);
+	stats_registry.counter("dspatch.pb.evict", &stats.pb.evict);
+	stats_registry.counter("dspatch.pb.insert", &stats.pb.insert);
+	stats_registry.blank();
+	stats_registry.counter("dspatch.gen_pref.called", &stats.gen_pref.called);
+	stats_registry.counter("dspatch.gen_pref.reset", &stats.gen_pref.reset);
+	stats_registry.counter("dspatch.gen_pref.total", &stats.gen_pref.total);
+	stats_registry.blank();
+	stats_registry.counter("dspatch.dyn_selection.called", &stats.dyn_selection.called);
+	stats_registry.counter("dspatch.dyn_selection.none", &stats.dyn_selection.none);
+	stats_registry.counter("dspatch.dyn_selection.accp_reason1", &stats.dyn_selection.accp_reason1);
+	stats_registry.counter("dspatch.dyn_selection.accp_reason2", &stats.dyn_selection.accp_reason2);
+	stats_registry.counter("dspatch.dyn_selection.covp_reason1", &stats.dyn_selection.covp_reason1);
+	stats_registry.counter("dspatch.dyn_selection.covp_reason2", &stats.dyn_selection.covp_reason2);
+	stats_registry.blank();
+	stats_registry.counter("dspatch.spt.called", &stats.spt.called);
+	stats_registry.counter("dspatch.spt.or_count_incr", &stats.spt.or_count_incr);
+	stats_registry.counter("dspatch.spt.measure_covP_incr", &stats.spt.measure_covP_incr);
+	stats_registry.counter("dspatch.spt.bmp_cov_reset", &stats.spt.bmp_cov_reset);
+	stats_registry.counter("dspatch.spt.bmp_cov_update", &stats.spt.bmp_cov_update);
+	stats_registry.counter("dspatch.spt.measure_accP_incr", &stats.spt.measure_accP_incr);
+	stats_registry.counter("dspatch.spt.measure_accP_decr", &stats.spt.measure_accP_decr);
+	stats_registry.counter("dspatch.spt.bmp_acc_update", &stats.spt.bmp_acc_update);
+	stats_registry.blank();
+	stats_registry.counter("dspatch.pref_buffer.spilled", &stats.pref_buffer.spilled);
+	stats_registry.counter("dspatch.pref_buffer.buffered", &stats.pref_buffer.buffered);
+	stats_registry.counter("dspatch.pref_buffer.issued", &stats.pref_buffer.issued);
+	stats_registry.blank();
+	stats_registry.counter("dspatch.bw.called", &stats.bw.called);
+	stats_registry.row("dspatch.bw.bw_histogram", stats.bw.bw_histogram, DSPATCH_MAX_BW_LEVEL);
+	stats_registry.blank();
+}
+
 void DSPatch::dump_stats()
 {
-	cout << "dspatch.pb.lookup " << stats.pb.lookup << endl
-		<< "dspatch.pb.hit " << stats.pb.hit << endl
-		<< "dspatch.pb.evict " << stats.pb.evict << endl
-		<< "dspatch.pb.insert " << stats.pb.insert << endl
-		<< endl
-		<< "dspatch.gen_pref.called " << stats.gen_pref.called << endl
-		<< "dspatch.gen_pref.reset " << stats.gen_pref.reset << endl
-		<< "dspatch.gen_pref.total " << stats.gen_pref.total << endl
-		<< endl
-		<< "dspatch.dyn_selection.called " << stats.dyn_selection.called << endl
-		<< "dspatch.dyn_selection.none " << stats.dyn_selection.none << endl
-		<< "dspatch.dyn_selection.accp_reason1 " << stats.dyn_selection.accp_reason1 << endl
-		<< "dspatch.dyn_selection.accp_reason2 " << stats.dyn_selection.accp_reason2 << endl
-		<< "dspatch.dyn_selection.covp_reason1 " << stats.dyn_selection.covp_reason1 << endl
-		<< "dspatch.dyn_selection.covp_reason2 " << stats.dyn_selection.covp_reason2 << endl
-		<< endl
-		<< "dspatch.spt.called " << stats.spt.called << endl
-		<< "dspatch.spt.or_count_incr " << stats.spt.or_count_incr << endl
-		<< "dspatch.spt.measure_covP_incr " << stats.spt.measure_covP_incr << endl
-		<< "dspatch.spt.bmp_cov_reset " << stats.spt.bmp_cov_reset << endl
-		<< "dspatch.spt.bmp_cov_update " << stats.spt.bmp_cov_update << endl
-		<< "dspatch.spt.measure_accP_incr " << stats.spt.measure_accP_incr << endl
-		<< "dspatch.spt.measure_accP_decr " << stats.spt.measure_accP_decr << endl
-		<< "dspatch.spt.bmp_acc_update " << stats.spt.bmp_acc_update << endl
-		<< endl
-		<< "dspatch.pref_buffer.spilled " << stats.pref_buffer.spilled << endl
-		<< "dspatch.pref_buffer.buffered " << stats.pref_buffer.buffered << endl
-		<< "dspatch.pref_buffer.issued " << stats.pref_buffer.issued << endl
-		<< endl;
+	stats_registry.print(stats_section, cout);
+}
+
+void DSPatch::save(CHECKPOINT &cp)
+{
+	uint64_t num_entries = page_buffer.size();
+	cp.scalar(num_entries);
+	for(auto it = page_buffer.begin(); it != page_buffer.end(); ++it)
+	{
+		cp.scalar(*it);
+	}
+	cp.check(knob::dspatch_num_spt_entries, "dspatch spt entries");
+	cp.array(spt, knob::dspatch_num_spt_entries);
+	cp.deque_entries(pref_buffer);
+	cp.scalar(bw_bucket);
+	cp.scalar(stats);
+}
+
+void DSPatch::load(CHECKPOINT &cp)
+{
+	page_buffer.clear();
 
-	cout << "dspatch.bw.called " << stats.bw.called << endl
-		<< "dspatch.bw.bw_histogram ";
-	for(uint32_t index = 0; index < DSPATCH_MAX_BW_LEVEL; ++index)
+	uint64_t num_entries = 0;
+	cp.scalar(num_entries);
+	for(uint64_t index = 0; index < num_entries; ++index)
 	{
-		cout << stats.bw.bw_histogram[index] << ",";
+		DSPatch_PBEntry *pbentry = page_buffer.emplace_back();
+		cp.scalar(*pbentry);
+		page_buffer.set_key(pbentry, pbentry->page);
 	}
-	cout << endl << endl;
+	cp.check(knob::dspatch_num_spt_entries, "dspatch spt entries");
+	cp.array(spt, knob::dspatch_num_spt_entries);
+	cp.deque_entries(pref_buffer);
+	cp.scalar(bw_bucket);
+	cp.scalar(stats);
 }
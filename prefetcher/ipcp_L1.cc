@@ -1,4 +1,6 @@
 #include "ipcp_L1.h"
+#include "checkpoint.h"
+#include "stats.h"
 
 namespace knob
 {
@@ -363,7 +365,35 @@ void IPCP_L1::cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t pref
 
 }
 
+void IPCP_L1::register_stats(string section)
+{
+	stats_section = section;
+	stats_registry.section(section);
+}
+
 void IPCP_L1::dump_stats()
 {
+	stats_registry.print(stats_section, cout);
+}
+
+void IPCP_L1::save(CHECKPOINT &cp)
+{
+	cp.scalar(trackers_l1);
+	cp.scalar(DPT_l1);
+	cp.scalar(ghb_l1);
+	cp.scalar(prev_cpu_cycle);
+	cp.scalar(num_misses);
+	cp.scalar(mpkc);
+	cp.scalar(spec_nl);
+}
 
+void IPCP_L1::load(CHECKPOINT &cp)
+{
+	cp.scalar(trackers_l1);
+	cp.scalar(DPT_l1);
+	cp.scalar(ghb_l1);
+	cp.scalar(prev_cpu_cycle);
+	cp.scalar(num_misses);
+	cp.scalar(mpkc);
+	cp.scalar(spec_nl);
 }
@@ -1,4 +1,6 @@
 #include "ipcp_L2.h"
+#include "checkpoint.h"
+#include "stats.h"
 
 namespace knob
 {
@@ -137,7 +139,25 @@ void IPCP_L2::cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t pref
 
 }
 
+void IPCP_L2::register_stats(string section)
+{
+	stats_section = section;
+	stats_registry.section(section);
+}
+
 void IPCP_L2::dump_stats()
 {
+	stats_registry.print(stats_section, cout);
+}
+
+void IPCP_L2::save(CHECKPOINT &cp)
+{
+	cp.scalar(spec_nl_l2);
+	cp.scalar(trackers);
+}
 
+void IPCP_L2::load(CHECKPOINT &cp)
+{
+	cp.scalar(spec_nl_l2);
+	cp.scalar(trackers);
 }
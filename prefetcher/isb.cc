@@ -2,6 +2,8 @@
 #include "champsim.h"
 #include "isb.h"
 #include "cache.h"
+#include "checkpoint.h"
+#include "stats.h"
 
 #define TRAIN_ON_CACHE_MISSES
 #define L2_PREFETCH_FILL_LEVEL FILL_L2
@@ -13,16 +15,32 @@ namespace knob
     extern uint32_t ISB_stream_max_lenth_bits;
     extern uint32_t ISB_degree;
     extern uint32_t ISB_debug_level;
+    extern bool ISB_window_stats;
+    extern uint32_t ISB_metadata_cache_size;
+    extern uint32_t ISB_metadata_cache_ways;
+    extern uint32_t ISB_metadata_line_entries;
 }
 
-bool OffChipInfo::get_structural_address(uint64_t phy_addr, unsigned int &str_addr)
+bool OffChipInfo::get_structural_address(uint64_t phy_addr, unsigned int &str_addr, bool *metadata_miss)
 {
     if (debug_level >= 2)
     {
         cout << "OffChipInfo::get_structural_address. Search phy_addr=0x" << hex << phy_addr << endl;
     }
-    map<uint64_t, PS_Entry *>::iterator ps_iter = ps_map.find(phy_addr);
-    if (ps_iter == ps_map.end())
+    bool on_chip = ps_cache.access(phy_addr, false);
+    if (metadata_miss)
+    {
+        *metadata_miss = !on_chip;
+        if (!on_chip)
+            return false;
+    }
+    return find_structural_address(phy_addr, str_addr);
+}
+
+bool OffChipInfo::find_structural_address(uint64_t phy_addr, unsigned int &str_addr)
+{
+    PS_Entry *ps_entry = ps_map.find(phy_addr);
+    if (ps_entry == NULL)
     {
         if (debug_level >= 2)
         {
@@ -32,42 +50,11 @@ bool OffChipInfo::get_structural_address(uint64_t phy_addr, unsigned int &str_ad
     }
     else
     {
-        if (ps_iter->second->valid)
+        if (ps_entry->valid)
         {
-            str_addr = ps_iter->second->str_addr;
-            ps_map_access_frequency[phy_addr] = ps_map_access_frequency[phy_addr] + 1;
-
-            win1k_ps_access_keys.insert(phy_addr);
-            win10k_ps_access_keys.insert(phy_addr);
-            win100k_ps_access_keys.insert(phy_addr);
-            win1m_ps_access_keys.insert(phy_addr);
-
-            total_access_counter_ps++;
-
-            if (total_access_counter_ps % 1000 == 0)
-            {
-                win1k_ps_map_accesses.insert(pair<uint64_t, uint64_t>(win1k_ps, win1k_ps_access_keys.size()));
-                win1k_ps++;
-                win1k_ps_access_keys.clear();
-            }
-            if (total_access_counter_ps % 10000 == 0)
-            {
-                win10k_ps_map_accesses.insert(pair<uint64_t, uint64_t>(win10k_ps, win10k_ps_access_keys.size()));
-                win10k_ps++;
-                win10k_ps_access_keys.clear();
-            }
-            if (total_access_counter_ps % 100000 == 0)
-            {
-                win100k_ps_map_accesses.insert(pair<uint64_t, uint64_t>(win100k_ps, win100k_ps_access_keys.size()));
-                win100k_ps++;
-                win100k_ps_access_keys.clear();
-            }
-            if (total_access_counter_ps % 1000000 == 0)
-            {
-                win1m_ps_map_accesses.insert(pair<uint64_t, uint64_t>(win1m_ps, win1m_ps_access_keys.size()));
-                win1m_ps++;
-                win1m_ps_access_keys.clear();
-            }
+            str_addr = ps_entry->str_addr;
+            if (window_stats)
+                ps_windows.access(phy_addr);
             if (debug_level >= 2)
             {
                 cout << "OffChipInfo::get_structural_address. Found! str_addr=" << dec << str_addr << endl;
@@ -86,14 +73,21 @@ bool OffChipInfo::get_structural_address(uint64_t phy_addr, unsigned int &str_ad
     }
 }
 
-bool OffChipInfo::get_physical_address(uint64_t &phy_addr, unsigned int str_addr)
+bool OffChipInfo::get_physical_address(uint64_t &phy_addr, unsigned int str_addr, bool *metadata_miss)
 {
     if (debug_level >= 2)
     {
         cout << "OffChipInfo::get_physical_address. Search str_addr=" << dec << str_addr << endl;
     }
-    std::map<unsigned int, SP_Entry *>::iterator sp_iter = sp_map.find(str_addr);
-    if (sp_iter == sp_map.end())
+    bool on_chip = sp_cache.access(str_addr, false);
+    if (metadata_miss)
+    {
+        *metadata_miss = !on_chip;
+        if (!on_chip)
+            return false;
+    }
+    SP_Entry *sp_entry = sp_map.find(str_addr);
+    if (sp_entry == NULL)
     {
         if (debug_level >= 2)
         {
@@ -103,42 +97,11 @@ bool OffChipInfo::get_physical_address(uint64_t &phy_addr, unsigned int str_addr
     }
     else
     {
-        if (sp_iter->second->valid)
+        if (sp_entry->valid)
         {
-            phy_addr = sp_iter->second->phy_addr;
-            sp_map_access_frequency[str_addr] = sp_map_access_frequency[str_addr] + 1;
-
-            win1k_sp_access_keys.insert(str_addr);
-            win10k_sp_access_keys.insert(str_addr);
-            win100k_sp_access_keys.insert(str_addr);
-            win1m_sp_access_keys.insert(str_addr);
-
-            total_access_counter_sp++;
-
-            if (total_access_counter_sp % 1000 == 0)
-            {
-                win1k_sp_map_accesses.insert(pair<uint64_t, uint64_t>(win1k_sp, win1k_sp_access_keys.size()));
-                win1k_sp++;
-                win1k_sp_access_keys.clear();
-            }
-            if (total_access_counter_sp % 10000 == 0)
-            {
-                win10k_sp_map_accesses.insert(pair<uint64_t, uint64_t>(win10k_sp, win10k_sp_access_keys.size()));
-                win10k_sp++;
-                win10k_sp_access_keys.clear();
-            }
-            if (total_access_counter_sp % 100000 == 0)
-            {
-                win100k_sp_map_accesses.insert(pair<uint64_t, uint64_t>(win100k_sp, win100k_sp_access_keys.size()));
-                win100k_sp++;
-                win100k_sp_access_keys.clear();
-            }
-            if (total_access_counter_sp % 1000000 == 0)
-            {
-                win1m_sp_map_accesses.insert(pair<uint64_t, uint64_t>(win1m_sp, win1m_sp_access_keys.size()));
-                win1m_sp++;
-                win1m_sp_access_keys.clear();
-            }
+            phy_addr = sp_entry->phy_addr;
+            if (window_stats)
+                sp_windows.access(str_addr);
             if (debug_level >= 2)
             {
                 cout << "OffChipInfo::get_physical_address. Found! phy_addr=" << hex << phy_addr << endl;
@@ -164,32 +127,18 @@ void OffChipInfo::update(uint64_t phy_addr, unsigned int str_addr)
     }
 
     // PS Map Update
-    std::map<uint64_t, PS_Entry *>::iterator ps_iter = ps_map.find(phy_addr);
-    if (ps_iter == ps_map.end())
-    {
-        PS_Entry *ps_entry = new PS_Entry();
-        ps_map[phy_addr] = ps_entry;
-        ps_map[phy_addr]->set(str_addr);
-        ps_map_access_frequency[phy_addr] = 0;
-    }
-    else
-    {
-        ps_iter->second->set(str_addr);
-    }
+    ps_cache.access(phy_addr, true);
+    PS_Entry *ps_entry = ps_map.find(phy_addr);
+    if (ps_entry == NULL)
+        ps_entry = ps_map.insert(phy_addr);
+    ps_entry->set(str_addr);
 
     // SP Map Update
-    std::map<unsigned int, SP_Entry *>::iterator sp_iter = sp_map.find(str_addr);
-    if (sp_iter == sp_map.end())
-    {
-        SP_Entry *sp_entry = new SP_Entry();
-        sp_map[str_addr] = sp_entry;
-        sp_map[str_addr]->set(phy_addr);
-        sp_map_access_frequency[str_addr] = 0;
-    }
-    else
-    {
-        sp_iter->second->set(phy_addr);
-    }
+    sp_cache.access(str_addr, true);
+    SP_Entry *sp_entry = sp_map.find(str_addr);
+    if (sp_entry == NULL)
+        sp_entry = sp_map.insert(str_addr);
+    sp_entry->set(phy_addr);
 }
 
 // void OffChipInfo::update_physical(uint64_t phy_addr, unsigned int str_addr){
@@ -232,30 +181,12 @@ void OffChipInfo::invalidate(uint64_t phy_addr, unsigned int str_addr)
     }
 
     // PS Map Invalidate
-    std::map<uint64_t, PS_Entry *>::iterator ps_iter = ps_map.find(phy_addr);
-    if (ps_iter != ps_map.end())
-    {
-        ps_iter->second->reset();
-        delete ps_iter->second;
-        ps_map.erase(ps_iter);
-    }
-    else
-    {
-        // TODO TBD
-    }
+    ps_cache.access(phy_addr, true);
+    ps_map.erase(phy_addr);
 
     // SP Map Invalidate
-    std::map<unsigned int, SP_Entry *>::iterator sp_iter = sp_map.find(str_addr);
-    if (sp_iter != sp_map.end())
-    {
-        sp_iter->second->reset();
-        delete sp_iter->second;
-        sp_map.erase(sp_iter);
-    }
-    else
-    {
-        // TODO TBD
-    }
+    sp_cache.access(str_addr, true);
+    sp_map.erase(str_addr);
 }
 
 int OffChipInfo::increase_confidence(uint64_t phy_addr)
@@ -264,10 +195,11 @@ int OffChipInfo::increase_confidence(uint64_t phy_addr)
     {
         cout << "OffChipInfo::increase_confidence, phy_addr=0x" << hex << phy_addr << endl;
     }
-    std::map<uint64_t, PS_Entry *>::iterator ps_iter = ps_map.find(phy_addr);
-    if (ps_iter != ps_map.end())
+    ps_cache.access(phy_addr, true);
+    PS_Entry *ps_entry = ps_map.find(phy_addr);
+    if (ps_entry != NULL)
     {
-        return ps_iter->second->increase_confidence();
+        return ps_entry->increase_confidence();
     }
     else
     {
@@ -283,10 +215,11 @@ int OffChipInfo::lower_confidence(uint64_t phy_addr)
         cout << "OffChipInfo::lower_confidence, phy_addr=0x" << hex << phy_addr << endl;
     }
 
-    std::map<uint64_t, PS_Entry *>::iterator ps_iter = ps_map.find(phy_addr);
-    if (ps_iter != ps_map.end())
+    ps_cache.access(phy_addr, true);
+    PS_Entry *ps_entry = ps_map.find(phy_addr);
+    if (ps_entry != NULL)
     {
-        return ps_iter->second->lower_confidence();
+        return ps_entry->lower_confidence();
     }
     else
     {
@@ -295,7 +228,45 @@ int OffChipInfo::lower_confidence(uint64_t phy_addr)
     }
 }
 
-void OffChipInfo::print_stats() {}
+void OffChipInfo::register_stats()
+{
+    stats_registry.value("ps_map_entries", [this]() { return ps_map.size(); });
+    stats_registry.value("sp_map_entries", [this]() { return sp_map.size(); });
+    if (ps_cache.enabled())
+    {
+        stats_registry.counter("ps_cache_hit", &ps_cache.hits);
+        stats_registry.counter("ps_cache_miss", &ps_cache.misses);
+        stats_registry.counter("ps_cache_writeback", &ps_cache.writebacks);
+        stats_registry.counter("sp_cache_hit", &sp_cache.hits);
+        stats_registry.counter("sp_cache_miss", &sp_cache.misses);
+        stats_registry.counter("sp_cache_writeback", &sp_cache.writebacks);
+    }
+    if (window_stats)
+    {
+        static const char *window_name[AccessWindows::NUM_WINDOWS] = {"1k", "10k", "100k", "1m"};
+        stats_registry.value("ps_map_distinct_keys", [this]() { return ps_windows.distinct_keys(); });
+        stats_registry.value("sp_map_distinct_keys", [this]() { return sp_windows.distinct_keys(); });
+        for (int i = 0; i < AccessWindows::NUM_WINDOWS; i++)
+        {
+            stats_registry.ratio(string("ps_win") + window_name[i] + "_unique_avg", [this, i]() { return ps_windows.average_unique(i); });
+            stats_registry.ratio(string("sp_win") + window_name[i] + "_unique_avg", [this, i]() { return sp_windows.average_unique(i); });
+        }
+    }
+}
+
+void OffChipInfo::checkpoint(CHECKPOINT &cp)
+{
+    ps_map.checkpoint(cp);
+    sp_map.checkpoint(cp);
+    cp.check(window_stats, "ISB window stats");
+    if (window_stats)
+    {
+        ps_windows.checkpoint(cp);
+        sp_windows.checkpoint(cp);
+    }
+    ps_cache.checkpoint(cp);
+    sp_cache.checkpoint(cp);
+}
 
 unsigned int ISB::train(unsigned int str_addr_A, uint64_t phy_addr_B)
 {
@@ -432,7 +403,14 @@ vector<uint64_t> ISB::predict(uint64_t trigger_phy_addr, unsigned int trigger_st
                 stream_end++;
                 break;
             }
-            bool ret = off_chip_info.get_physical_address(candidate_phy_addr, str_addr_candidate);
+            bool missed;
+            bool ret = off_chip_info.get_physical_address(candidate_phy_addr, str_addr_candidate, &missed);
+            if (missed)
+            {
+                // the rest of the stream comes with the line being read
+                metadata_miss++;
+                break;
+            }
             if (ret)
             {
                 ideal++;
@@ -452,7 +430,13 @@ vector<uint64_t> ISB::predict(uint64_t trigger_phy_addr, unsigned int trigger_st
             if (str_addr_candidate == trigger_str_addr)
                 continue;
 
-            bool ret = off_chip_info.get_physical_address(candidate_phy_addr, str_addr_candidate);
+            bool missed;
+            bool ret = off_chip_info.get_physical_address(candidate_phy_addr, str_addr_candidate, &missed);
+            if (missed)
+            {
+                metadata_miss++;
+                break;
+            }
             if (ret)
             // if(ret && ((candidate_phy_addr >> 12) == (trigger_phy_addr >> 12)) )
             {
@@ -540,10 +524,17 @@ unsigned int ISB::assign_structural_addr()
 }
 
 ISB::ISB(string type, CACHE *cache) : Prefetcher(type), parent(cache),
-                                      off_chip_info(knob::ISB_debug_level),
+                                      off_chip_info(knob::ISB_debug_level, knob::ISB_window_stats, knob::ISB_metadata_cache_size,
+                                                    knob::ISB_metadata_cache_ways, knob::ISB_metadata_line_entries),
                                       stream_max_lenth(knob::ISB_stream_max_lenth), stream_max_lenth_bits(knob::ISB_stream_max_lenth_bits),
                                       is_restrict_region(knob::ISB_is_restrict_region), degree(knob::ISB_degree), debug_level(knob::ISB_debug_level)
 {
+    if (knob::ISB_metadata_cache_size && (knob::ISB_metadata_cache_ways == 0 || knob::ISB_metadata_line_entries == 0
+                                          || knob::ISB_metadata_cache_size % knob::ISB_metadata_cache_ways))
+    {
+        cerr << "*** ISB METADATA CACHE MUST HOLD WHOLE SETS OF NON-EMPTY LINES ***" << endl;
+        assert(0);
+    }
     alloc_counter = 0;
     last_address = 0;
     cout << "Init ISB!" << endl;
@@ -556,10 +547,33 @@ void ISB::print_config()
          << "ISB_stream_max_lenth_bits " << knob::ISB_stream_max_lenth_bits << endl
          << "ISB_is_restrict_region " << knob::ISB_is_restrict_region << endl
          << "ISB_degree " << knob::ISB_degree << endl
-         << "ISB_debug_level " << knob::ISB_debug_level << endl;
+         << "ISB_debug_level " << knob::ISB_debug_level << endl
+         << "ISB_window_stats " << knob::ISB_window_stats << endl
+         << "ISB_metadata_cache_size " << knob::ISB_metadata_cache_size << endl
+         << "ISB_metadata_cache_ways " << knob::ISB_metadata_cache_ways << endl
+         << "ISB_metadata_line_entries " << knob::ISB_metadata_line_entries << endl;
 };
 
-void ISB::dump_stats(){};
+void ISB::register_stats(string section)
+{
+    stats_section = section;
+    stats_registry.section(section);
+    stats_registry.counter("total_access", &total_access);
+    stats_registry.counter("predictions", &predictions);
+    stats_registry.counter("no_prediction", &no_prediction);
+    stats_registry.counter("stream_end", &stream_end);
+    stats_registry.counter("no_translation", &no_translation);
+    stats_registry.counter("exceed_stream_alloc", &exceed_stream_alloc);
+    stats_registry.counter("stream_divergence", &stream_divergence_count);
+    stats_registry.counter("metadata_miss", &metadata_miss);
+    off_chip_info.register_stats();
+    stats_registry.blank();
+}
+
+void ISB::dump_stats()
+{
+    stats_registry.print(stats_section, cout);
+}
 
 void ISB::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, std::vector<uint64_t> &pref_addr)
 {
@@ -594,9 +608,15 @@ void ISB::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, ui
         std::cout << "ISB::access. Address=0x" << std::hex << addr_B << ", pc=0x" << std::hex << key << std::endl;
 
     unsigned int str_addr_B = 0;
-    bool str_addr_B_exists = off_chip_info.get_structural_address(addr_B, str_addr_B);
-
-    if (str_addr_B_exists)
+    bool missed;
+    bool str_addr_B_exists = off_chip_info.get_structural_address(addr_B, str_addr_B, &missed);
+    if (missed)
+    {
+        metadata_miss++;
+        // training needs the mapping anyway, and waits for it; the miss was already accounted
+        str_addr_B_exists = off_chip_info.find_structural_address(addr_B, str_addr_B);
+    }
+    else if (str_addr_B_exists)
     {
         vector<uint64_t> candidates = predict(addr_B, str_addr_B, pc);
         unsigned int num_prefetched = 0;
@@ -617,7 +637,7 @@ void ISB::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, ui
                 break;
         }
     }
-    else
+    if (!str_addr_B_exists || missed)
         no_prediction++;
 
     unsigned int str_addr_A;
@@ -640,4 +660,60 @@ void ISB::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, ui
     return;
 }
 
-void ISB::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr){};
\ No newline at end of file
+void ISB::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr){};
+
+void ISB::save(CHECKPOINT &cp)
+{
+    uint64_t num_entries = training_unit.size();
+    cp.scalar(num_entries);
+    for (TUCache::iterator it = training_unit.begin(); it != training_unit.end(); ++it)
+    {
+        uint64_t key = it->first;
+        cp.scalar(key);
+        cp.scalar(*it->second);
+    }
+    off_chip_info.checkpoint(cp);
+    cp.scalar(alloc_counter);
+    cp.scalar(last_address);
+
+    cp.scalar(exceed_stream_alloc);
+    cp.scalar(stream_divergence_count);
+    cp.scalar(total_access);
+    cp.scalar(predictions);
+    cp.scalar(no_prediction);
+    cp.scalar(stream_end);
+    cp.scalar(no_translation);
+    cp.scalar(metadata_miss);
+    cp.scalar(reuse);
+}
+
+void ISB::load(CHECKPOINT &cp)
+{
+    for (TUCache::iterator it = training_unit.begin(); it != training_unit.end(); ++it)
+        delete it->second;
+    training_unit.clear();
+
+    uint64_t num_entries = 0;
+    cp.scalar(num_entries);
+    for (uint64_t i = 0; i < num_entries; i++)
+    {
+        uint64_t key = 0;
+        cp.scalar(key);
+        TrainingUnitEntry *entry = new TrainingUnitEntry;
+        cp.scalar(*entry);
+        training_unit.insert(training_unit.end(), make_pair(key, entry));
+    }
+    off_chip_info.checkpoint(cp);
+    cp.scalar(alloc_counter);
+    cp.scalar(last_address);
+
+    cp.scalar(exceed_stream_alloc);
+    cp.scalar(stream_divergence_count);
+    cp.scalar(total_access);
+    cp.scalar(predictions);
+    cp.scalar(no_prediction);
+    cp.scalar(stream_end);
+    cp.scalar(no_translation);
+    cp.scalar(metadata_miss);
+    cp.scalar(reuse);
+}
@@ -1,6 +1,8 @@
 #include <iostream>
 #include "mlop.h"
+#include "stats.h"
 #include "champsim.h"
+#include "checkpoint.h"
 
 namespace knob
 {
@@ -362,34 +364,47 @@ void MLOP::reset_stats() {
 	this->max_score_ri_sqr_sum = 0;
 }
 
-void MLOP::print_stats() {
-	cout << "[MLOP] History of tracked zone:" << endl;
-	for (auto &x : this->zone_life)
-		cout << x << endl;
-
-	double pf_degree_mean = 1.0 * this->pf_degree_sum / this->round_cnt;
-	double pf_degree_sqr_mean = 1.0 * this->pf_degree_sqr_sum / this->round_cnt;
-	double pf_degree_sd = sqrt(pf_degree_sqr_mean - square(pf_degree_mean));
-	cout << "[MLOP] Prefetch Degree Mean: " << pf_degree_mean << endl;
-	cout << "[MLOP] Prefetch Degree SD: " << pf_degree_sd << endl;
-
-	double max_score_le_mean = 1.0 * this->max_score_le_sum / this->round_cnt;
-	double max_score_le_sqr_mean = 1.0 * this->max_score_le_sqr_sum / this->round_cnt;
-	double max_score_le_sd = sqrt(max_score_le_sqr_mean - square(max_score_le_mean));
-	cout << "[MLOP] Max Score Left Mean (%): " << 100.0 * max_score_le_mean / NUM_UPDATES << endl;
-	cout << "[MLOP] Max Score Left SD (%): " << 100.0 * max_score_le_sd / NUM_UPDATES << endl;
-
-	double max_score_ri_mean = 1.0 * this->max_score_ri_sum / this->round_cnt;
-	double max_score_ri_sqr_mean = 1.0 * this->max_score_ri_sqr_sum / this->round_cnt;
-	double max_score_ri_sd = sqrt(max_score_ri_sqr_mean - square(max_score_ri_mean));
-	cout << "[MLOP] Max Score Right Mean (%): " << 100.0 * max_score_ri_mean / NUM_UPDATES << endl;
-	cout << "[MLOP] Max Score Right SD (%): " << 100.0 * max_score_ri_sd / NUM_UPDATES << endl;
-	cout << endl;
+void MLOP::register_stats(string section) {
+	stats_section = section;
+	stats_registry.section(section);
+	/* JSON only, the legacy dump has no rounds line */
+	stats_registry.counter("mlop_rounds", &this->round_cnt);
+	stats_registry.label("");
+	stats_registry.ratio("mlop_pf_degree_mean", [this]() { return 1.0 * this->pf_degree_sum / this->round_cnt; });
+	stats_registry.label("[MLOP] Prefetch Degree Mean:");
+	stats_registry.ratio("mlop_pf_degree_sd", [this]() {
+		double pf_degree_mean = 1.0 * this->pf_degree_sum / this->round_cnt;
+		double pf_degree_sqr_mean = 1.0 * this->pf_degree_sqr_sum / this->round_cnt;
+		return sqrt(pf_degree_sqr_mean - square(pf_degree_mean));
+	});
+	stats_registry.label("[MLOP] Prefetch Degree SD:");
+	stats_registry.ratio("mlop_max_score_left_mean_perc", [this]() { return 100.0 * (1.0 * this->max_score_le_sum / this->round_cnt) / NUM_UPDATES; });
+	stats_registry.label("[MLOP] Max Score Left Mean (%):");
+	stats_registry.ratio("mlop_max_score_left_sd_perc", [this]() {
+		double max_score_le_mean = 1.0 * this->max_score_le_sum / this->round_cnt;
+		double max_score_le_sqr_mean = 1.0 * this->max_score_le_sqr_sum / this->round_cnt;
+		return 100.0 * sqrt(max_score_le_sqr_mean - square(max_score_le_mean)) / NUM_UPDATES;
+	});
+	stats_registry.label("[MLOP] Max Score Left SD (%):");
+	stats_registry.ratio("mlop_max_score_right_mean_perc", [this]() { return 100.0 * (1.0 * this->max_score_ri_sum / this->round_cnt) / NUM_UPDATES; });
+	stats_registry.label("[MLOP] Max Score Right Mean (%):");
+	stats_registry.ratio("mlop_max_score_right_sd_perc", [this]() {
+		double max_score_ri_mean = 1.0 * this->max_score_ri_sum / this->round_cnt;
+		double max_score_ri_sqr_mean = 1.0 * this->max_score_ri_sqr_sum / this->round_cnt;
+		return 100.0 * sqrt(max_score_ri_sqr_mean - square(max_score_ri_mean)) / NUM_UPDATES;
+	});
+	stats_registry.label("[MLOP] Max Score Right SD (%):");
+	stats_registry.blank();
 }
 
 void MLOP::dump_stats()
 {
-	print_stats();
+	/* state trace of the first tracked zones, not a counter */
+	cout << "[MLOP] History of tracked zone:" << endl;
+	for (auto &x : this->zone_life)
+		cout << x << endl;
+
+	stats_registry.print(stats_section, cout);
 }
 
 /* Base-class virtual function */
@@ -442,3 +457,42 @@ void MLOP::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t pref
 	/* stats */
 	track(evicted_block_number);
 }
+
+void MLOP::save(CHECKPOINT &cp)
+{
+	checkpoint(cp);
+}
+
+void MLOP::load(CHECKPOINT &cp)
+{
+	checkpoint(cp);
+}
+
+/* walks the access map table, the scores of the running round and the stats in the same order for save and restore */
+void MLOP::checkpoint(CHECKPOINT &cp)
+{
+	access_map_table->checkpoint(cp);
+	cp.check(PF_DEGREE, "mlop degree");
+	for (uint32_t i = 0; i < PF_DEGREE; i += 1) {
+		cp.vector_entries(pf_offset[i]);
+		cp.vector_entries(offset_scores[i]);
+	}
+	cp.vector_entries(pf_level);
+	cp.scalar(update_cnt);
+
+	cp.scalar(tracking);
+	cp.scalar(tracked_zone_number);
+	cp.scalar(zone_cnt);
+	uint64_t num_lives = zone_life.size();
+	cp.scalar(num_lives);
+	zone_life.resize(num_lives);
+	for (uint64_t i = 0; i < num_lives; i += 1)
+		cp.str(zone_life[i]);
+	cp.scalar(round_cnt);
+	cp.scalar(pf_degree_sum);
+	cp.scalar(pf_degree_sqr_sum);
+	cp.scalar(max_score_le_sum);
+	cp.scalar(max_score_le_sqr_sum);
+	cp.scalar(max_score_ri_sum);
+	cp.scalar(max_score_ri_sqr_sum);
+}
@@ -5,6 +5,8 @@
 #include <strings.h>
 #include "next_line.h"
 #include "champsim.h"
+#include "checkpoint.h"
+#include "stats.h"
 
 namespace knob
 {
@@ -69,6 +71,7 @@ NextLinePrefetcher::NextLinePrefetcher(string type) : Prefetcher(type)
 
 	generator.seed(knob::next_line_seed);
 	deltagen = new std::uniform_real_distribution<float>(0.0, 1.0);
+	prefetch_tracker.init(knob::next_line_pt_size, true);
 
 	if(knob::next_line_enable_trace)
 	{
@@ -158,12 +161,11 @@ bool NextLinePrefetcher::track(uint64_t address)
 		if(prefetch_tracker.size() >= knob::next_line_pt_size)
 		{
 			stats.track.evict++;
-			NL_PTEntry *ptentry = prefetch_tracker.front();
+			measure_stats(prefetch_tracker.front());
 			prefetch_tracker.pop_front();
-			measure_stats(ptentry);
-			delete ptentry;
 		}
-		prefetch_tracker.push_back(new NL_PTEntry(address, false));
+		NL_PTEntry *ptentry = prefetch_tracker.emplace_back(address, false);
+		prefetch_tracker.set_key(ptentry, address);
 		stats.track.insert++;
 		return true;
 	}
@@ -176,8 +178,7 @@ bool NextLinePrefetcher::track(uint64_t address)
 
 NL_PTEntry* NextLinePrefetcher::search_pt(uint64_t address)
 {
-	auto it = find_if(prefetch_tracker.begin(), prefetch_tracker.end(), [address](NL_PTEntry *ptentry){return ptentry->address == address;});
-	return it != prefetch_tracker.end() ? (*it) : NULL;
+	return prefetch_tracker.find(address);
 }
 
 void NextLinePrefetcher::register_fill(uint64_t address)
@@ -242,30 +243,71 @@ void NextLinePrefetcher::measure_stats(NL_PTEntry *ptentry)
 	}
 }
 
-void NextLinePrefetcher::dump_stats()
+void NextLinePrefetcher::register_stats(string section)
 {
+	stats_section = section;
+	stats_registry.section(section);
 	for(uint32_t index = 0; index < knob::next_line_deltas.size(); ++index)
 	{
-		cout << "next_line_delta_" << knob::next_line_deltas[index] << "_select " << stats.predict.select[index] << endl;
-		cout << "next_line_delta_" << knob::next_line_deltas[index] << "_issue " << stats.predict.issue[index] << endl;
-		cout << "next_line_delta_" << knob::next_line_deltas[index] << "_tracker_hit " << stats.predict.tracker_hit[index] << endl;
-		cout << "next_line_delta_" << knob::next_line_deltas[index] << "_out_of_bounds " << stats.predict.out_of_bounds[index] << endl;
+		string prefix = "next_line_delta_" + to_string(knob::next_line_deltas[index]);
+		stats_registry.counter(prefix + "_select", &stats.predict.select[index]);
+		stats_registry.counter(prefix + "_issue", &stats.predict.issue[index]);
+		stats_registry.counter(prefix + "_tracker_hit", &stats.predict.tracker_hit[index]);
+		stats_registry.counter(prefix + "_out_of_bounds", &stats.predict.out_of_bounds[index]);
 	}
 
-	cout<< "next_line_track_called " << stats.track.called << endl
-		<< "next_line_track_pt_miss " << stats.track.pt_miss << endl
-		<< "next_line_track_pt_hit " << stats.track.pt_hit << endl
-		<< "next_line_track_evict " << stats.track.evict << endl
-		<< "next_line_track_insert " << stats.track.insert << endl
-		<< "next_line_register_fill_called " << stats.register_fill.called << endl
-		<< "next_line_register_fill_fill " << stats.register_fill.fill << endl
-		<< "next_line_record_demand_called " << stats.record_demand.called << endl
-		<< "next_line_record_demand_hit " << stats.record_demand.hit << endl
-		<< "next_line_record_demand_timely " << stats.record_demand.timely << endl
-		<< "next_line_record_demand_untimely " << stats.record_demand.untimely << endl
-		<< "next_line_pref_total " << stats.pref.total << endl
-		<< "next_line_pref_timely " << stats.pref.timely << endl
-		<< "next_line_pref_untimely " << stats.pref.untimely << endl
-		<< "next_line_pref_incorrect " << stats.pref.incorrect << endl
-		<< endl;
-}
\ No newline at end of file
+	stats_registry.counter("next_line_track_called", &stats.track.called);
+	stats_registry.counter("next_line_track_pt_miss", &stats.track.pt_miss);
+	stats_registry.counter("next_line_track_pt_hit", &stats.track.pt_hit);
+	stats_registry.counter("next_line_track_evict", &stats.track.evict);
+	stats_registry.counter("next_line_track_insert", &stats.track.insert);
+	stats_registry.counter("next_line_register_fill_called", &stats.register_fill.called);
+	stats_registry.counter("next_line_register_fill_fill", &stats.register_fill.fill);
+	stats_registry.counter("next_line_record_demand_called", &stats.record_demand.called);
+	stats_registry.counter("next_line_record_demand_hit", &stats.record_demand.hit);
+	stats_registry.counter("next_line_record_demand_timely", &stats.record_demand.timely);
+	stats_registry.counter("next_line_record_demand_untimely", &stats.record_demand.untimely);
+	stats_registry.counter("next_line_pref_total", &stats.pref.total);
+	stats_registry.counter("next_line_pref_timely", &stats.pref.timely);
+	stats_registry.counter("next_line_pref_untimely", &stats.pref.untimely);
+	stats_registry.counter("next_line_pref_incorrect", &stats.pref.incorrect);
+	stats_registry.blank();
+}
+
+void NextLinePrefetcher::dump_stats()
+{
+	stats_registry.print(stats_section, cout);
+}
+void NextLinePrefetcher::save(CHECKPOINT &cp)
+{
+	uint64_t num_entries = prefetch_tracker.size();
+	cp.scalar(num_entries);
+	for(auto it = prefetch_tracker.begin(); it != prefetch_tracker.end(); ++it)
+	{
+		cp.scalar(*it);
+	}
+	cp.engine(generator);
+	cp.engine(*deltagen);
+	cp.scalar(trace_timestamp);
+	cp.scalar(trace_interval);
+	cp.scalar(stats);
+}
+
+void NextLinePrefetcher::load(CHECKPOINT &cp)
+{
+	prefetch_tracker.clear();
+
+	uint64_t num_entries = 0;
+	cp.scalar(num_entries);
+	for(uint64_t index = 0; index < num_entries; ++index)
+	{
+		NL_PTEntry *ptentry = prefetch_tracker.emplace_back(0, false);
+		cp.scalar(*ptentry);
+		prefetch_tracker.set_key(ptentry, ptentry->address);
+	}
+	cp.engine(generator);
+	cp.engine(*deltagen);
+	cp.scalar(trace_timestamp);
+	cp.scalar(trace_interval);
+	cp.scalar(stats);
+}
@@ -1,7 +1,9 @@
 #include <iostream>
 #include "cache.h"
 #include "champsim.h"
+#include "checkpoint.h"
 #include "pmp.h"
+#include "stats.h"
 
 namespace knob
 {
@@ -67,7 +69,7 @@ void PMP::access(uint64_t block_number, uint64_t pc)
     {
         /* trigger access */
         this->ft.insert(region_number, pc, region_offset);
-        vector<int> pattern = this->find_in_pht(pc, block_number);
+        FillPattern pattern = this->find_in_pht(pc, block_number);
         if (pattern.empty())
         {
             /* nothing to prefetch */
@@ -141,30 +143,27 @@ void PMP::log()
     cerr << this->ps.log();
 }
 
-vector<int> PMP::find_in_pht(uint64_t pc, uint64_t address)
+FillPattern PMP::find_in_pht(uint64_t pc, uint64_t address)
 {
     if (this->debug_level >= 2)
     {
         cerr << "[PMP] find_in_pht(pc=0x" << hex << pc << ", address=0x" << address << ")" << dec << endl;
     }
     int offset = address % this->pattern_len;
-    vector<int> opt_pattern = this->opt.extrate(offset);
-    vector<int> ppt_pattern = this->ppt.extrate(pc);
+    FillPattern opt_pattern = this->opt.extrate(offset);
+    FillPattern ppt_pattern = this->ppt.extrate(pc);
     if (opt_pattern.empty() || ppt_pattern.empty())
-        return vector<int>();
-    vector<int> result(this->pattern_len, 0);
-    for (size_t i = 0; i < result.size(); i++)
+        return FillPattern();
+    FillPattern result(this->pattern_len);
+    for (uint64_t bits = opt_pattern.blocks().word(); bits; bits &= bits - 1)
     {
-        if (opt_pattern[i])
-        {
-            if (ppt_pattern[i / 2])
-                result[i] = FILL_L2;
-            else
-                result[i] = FILL_LLC;
-        }
+        int i = __builtin_ctzll(bits);
+        if (ppt_pattern[i / 2])
+            result.set(i, FILL_L2);
+        else
+            result.set(i, FILL_LLC);
     }
-    result = pmp_rotate(result, offset);
-    return result;
+    return result.rotate(offset);
 }
 
 void PMP::insert_in_pht(const ATPMP::Entry &entry)
@@ -175,13 +174,12 @@ void PMP::insert_in_pht(const ATPMP::Entry &entry)
     {
         cerr << "[PMP] insert_in_pht(pc=0x" << hex << pc << ", offset=" << dec << offset << ")" << endl;
     }
-    vector<bool> opt_pattern = entry.data.pattern;
-    opt_pattern = pmp_rotate(opt_pattern, -offset);
-    vector<bool> ppt_pattern(this->pattern_len / 2, 0);
-    for (size_t i = 0; i < ppt_pattern.size(); i++)
+    BlockPattern opt_pattern = entry.data.pattern.rotate(-offset);
+    BlockPattern ppt_pattern(this->pattern_len / 2);
+    for (int i = 0; i < ppt_pattern.size(); i++)
     {
         if (opt_pattern[2 * i] || opt_pattern[2 * i + 1])
-            ppt_pattern[i] = true;
+            ppt_pattern.set(i);
     }
     this->opt.merge(offset, opt_pattern);
     this->ppt.merge(pc, ppt_pattern);
@@ -224,6 +222,32 @@ void PMP::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefe
    eviction(evicted_block_number);
 }
 
-void PMP::dump_stats() {
-   
+void PMP::register_stats(string section)
+{
+   stats_section = section;
+   stats_registry.section(section);
+}
+
+void PMP::dump_stats()
+{
+   stats_registry.print(stats_section, cout);
+}
+
+void PMP::save(CHECKPOINT &cp)
+{
+   checkpoint(cp);
+}
+
+void PMP::load(CHECKPOINT &cp)
+{
+   checkpoint(cp);
+}
+
+void PMP::checkpoint(CHECKPOINT &cp)
+{
+   ft.checkpoint(cp);
+   at.checkpoint(cp);
+   opt.checkpoint(cp);
+   ppt.checkpoint(cp);
+   ps.checkpoint(cp);
 }
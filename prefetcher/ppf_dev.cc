@@ -1,5 +1,6 @@
 #include "ppf_dev.h"
 #include "champsim.h"
+#include "checkpoint.h"
 #include "memory_class.h"
 using namespace std;
 using namespace spp_ppf;
@@ -45,14 +46,17 @@ SPP_PPF_dev::SPP_PPF_dev(std::string type, CACHE *cache) : Prefetcher(type), m_p
          << "PERC_THRESH_LO: " << knob::ppf_perc_threshold_lo << endl
          << endl;
 
-    /* set cross-pointers */
+    set_cross_pointers();
+}
+
+void SPP_PPF_dev::set_cross_pointers()
+{
     ST.ghr = &GHR;
     PT.ghr = &GHR;
     PT.perc = &PERC;
     PT.filter = &FILTER;
     FILTER.ghr = &GHR;
     FILTER.perc = &PERC;
-
 }
 
 SPP_PPF_dev::~SPP_PPF_dev()
@@ -231,4 +235,24 @@ void SPP_PPF_dev::cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t
 void SPP_PPF_dev::dump_stats()
 {
 
-}
\ No newline at end of file
+}
+
+void SPP_PPF_dev::save(CHECKPOINT &cp)
+{
+    cp.scalar(ST);
+    cp.scalar(PT);
+    cp.scalar(FILTER);
+    cp.scalar(GHR);
+    cp.scalar(PERC);
+}
+
+/* the tables are plain arrays apart from their cross-pointers, which point into the saving run */
+void SPP_PPF_dev::load(CHECKPOINT &cp)
+{
+    cp.scalar(ST);
+    cp.scalar(PT);
+    cp.scalar(FILTER);
+    cp.scalar(GHR);
+    cp.scalar(PERC);
+    set_cross_pointers();
+}
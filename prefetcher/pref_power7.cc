@@ -1,6 +1,7 @@
 #include <iostream>
 #include "pref_power7.h"
 #include "champsim.h"
+#include "checkpoint.h"
 
 namespace knob
 {
@@ -261,6 +262,14 @@ Config POWER7_Pref::get_winner_config()
     return min_cfg;
 }
 
+/* the component prefetchers never print their own stats, they only go to the JSON stats */
+void POWER7_Pref::register_stats(string section)
+{
+    stats_section = section;
+    streamer->register_stats(section + "_streamer");
+    stride->register_stats(section + "_stride");
+}
+
 void POWER7_Pref::dump_stats()
 {
     cout << "power7.called " << stats.called << endl 
@@ -284,3 +293,29 @@ void POWER7_Pref::dump_stats()
         << "power7.pred.stride " << stats.pred.stride << endl
         << endl;
 }
+
+void POWER7_Pref::save(CHECKPOINT &cp)
+{
+    cp.scalar(config);
+    cp.scalar(mode);
+    cp.scalar(access_counter);
+    cp.array(cycle_stats, Config::NumConfigs);
+    cp.scalar(cycle_stamp);
+    cp.scalar(stats);
+    streamer->save(cp);
+    stride->save(cp);
+}
+
+void POWER7_Pref::load(CHECKPOINT &cp)
+{
+    cp.scalar(config);
+    cp.scalar(mode);
+    cp.scalar(access_counter);
+    cp.array(cycle_stats, Config::NumConfigs);
+    cp.scalar(cycle_stamp);
+    cp.scalar(stats);
+    streamer->load(cp);
+    stride->load(cp);
+    /* the component degrees follow the restored config */
+    set_params();
+}
@@ -2,7 +2,9 @@
 #include <vector>
 #include "cache.h"
 #include "champsim.h"
+#include "checkpoint.h"
 #include "rb.h"
+#include "stats.h"
 
 namespace knob
 {
@@ -42,6 +44,7 @@ RB::RB(string type, CACHE *cache) : Prefetcher(type), parent(cache),
 {
     init_knobs();
     init_stats();
+    level_pattern.resize(levels);
     for (int i = 0; i < levels; i++)
     {
         ft.emplace_back(FTRB(knob::rb_ft_size[i], pattern_len[i], knob::rb_debug_level));
@@ -70,18 +73,6 @@ std::ostream &operator<<(std::ostream &os, const std::vector<T> &vec)
     return os;
 }
 
-template <typename T>
-std::vector<T> operator+(const std::vector<T> &v1, const std::vector<T> &v2)
-{
-    std::vector<T> result;
-    result.reserve(v1.size() + v2.size()); // 预分配足够的空间
-
-    result.insert(result.end(), v1.begin(), v1.end()); // 将v1的元素添加到result中
-    result.insert(result.end(), v2.begin(), v2.end()); // 将v2的元素添加到result中
-
-    return result;
-}
-
 void RB::print_config()
 {
     cout << "rb_levels" << knob::rb_levels << endl
@@ -163,17 +154,11 @@ void RB::access(uint64_t block_number, uint64_t pc)
             cerr << "[RB] Miss FT!" << endl;
         }
         int pht_hit_level = -1;
-        vector<int> pattern = this->find_in_pht(pc, block_number, pht_hit_level);
+        FillPattern pattern = this->find_in_pht(pc, block_number, pht_hit_level);
         int ft_insert_level = pht_hit_level < 0 ? knob::rb_default_insert_level : pht_hit_level;
-        vector<bool> pattern_prefetch(this->pattern_len[ft_insert_level], false);
+        BlockPattern pattern_prefetch(this->pattern_len[ft_insert_level]);
         if (!pattern.empty())
-        {
-            for (size_t i = 0; i < pattern_prefetch.size(); i++)
-            {
-                if (pattern[i] == FILL_L1 || pattern[i] == FILL_L2 || pattern[i] == FILL_LLC)
-                    pattern_prefetch[i] = true;
-            }
-        }
+            pattern_prefetch = BlockPattern(pattern_prefetch.size(), pattern.blocks().word());
 
         uint64_t region_number = block_number / this->ft[ft_insert_level].get_pattern_len();
         int region_offset = block_number % this->ft[ft_insert_level].get_pattern_len();
@@ -186,12 +171,9 @@ void RB::access(uint64_t block_number, uint64_t pc)
             {
                 cerr << "[RB] Hit PHT! pattern: " << rb_pattern_to_string(pattern) << endl;
             }
-            vector<int> expand_pattern(pattern_len[levels - 1], 0);
+            FillPattern expand_pattern(pattern_len[levels - 1]);
             int start = (block_number % pattern_len[levels - 1]) / pattern.size() * pattern.size();
-            for (size_t i = 0; i < pattern.size(); i++)
-            {
-                expand_pattern[start + i] = pattern[i];
-            }
+            expand_pattern.copy_at(start, pattern);
             this->pb.insert(block_number / this->pattern_len[levels - 1], expand_pattern);
         }
         return;
@@ -211,8 +193,8 @@ void RB::access(uint64_t block_number, uint64_t pc)
         uint64_t region_insert = region_number;
         uint64_t pc_trigger;
         int offset_trigger;
-        vector<bool> pattern_insert(this->at[ft_hit_level].get_pattern_len(), 0);
-        vector<bool> pattern_prefetch = entry->data.pattern_prefetch;
+        BlockPattern pattern_insert(this->at[ft_hit_level].get_pattern_len());
+        BlockPattern pattern_prefetch = entry->data.pattern_prefetch;
         ATRB::Entry *old_entry = nullptr;
         if (ft_hit_level != levels - 1)
         {
@@ -226,13 +208,9 @@ void RB::access(uint64_t block_number, uint64_t pc)
                     region_insert >>= 1;
                     pc_trigger = old_entry->data.pc;
                     offset_trigger = old_entry->data.offset;
-                    pattern_insert.resize(this->at[insert_at_level].get_pattern_len());
-                    for (size_t i = 0; i < old_entry->data.pattern.size(); i++)
-                    {
-                        pattern_insert[i] = old_entry->data.pattern[i];
-                    }
-                    pattern_insert[entry->data.offset + pattern_insert.size() / 2] = 1;
-                    pattern_insert[region_offset + pattern_insert.size() / 2] = 1;
+                    pattern_insert = BlockPattern(this->at[insert_at_level].get_pattern_len(), old_entry->data.pattern.word());
+                    pattern_insert.set(entry->data.offset + pattern_insert.size() / 2);
+                    pattern_insert.set(region_offset + pattern_insert.size() / 2);
                     pattern_prefetch = old_entry->data.pattern_prefetch + entry->data.pattern_prefetch;
                     if (debug_level >= 2)
                     {
@@ -241,17 +219,17 @@ void RB::access(uint64_t block_number, uint64_t pc)
                     }
                     // remove the two pattern in pht, merge them and insert to the higher level
                     uint64_t new_address = hash_index(old_entry->key, this->at[ft_hit_level].get_index_len()) * this->pattern_len[ft_hit_level] + old_entry->data.offset;
-                    vector<bool> left_pattern, right_pattern;
+                    BlockPattern left_pattern, right_pattern;
                     PHTRB::Entry *left_entry = this->pht[ft_hit_level].erase(old_entry->data.pc, new_address);
                     PHTRB::Entry *right_entry = this->pht[ft_hit_level].erase(pc, block_number);
                     if (left_entry)
                         left_pattern = left_entry->data.pattern;
                     else
-                        left_pattern = vector<bool>(pattern_len[ft_hit_level], 0);
+                        left_pattern = BlockPattern(pattern_len[ft_hit_level]);
                     if (right_entry)
                         right_pattern = right_entry->data.pattern;
                     else
-                        right_pattern = vector<bool>(pattern_len[ft_hit_level], 0);
+                        right_pattern = BlockPattern(pattern_len[ft_hit_level]);
                     if (left_entry || right_entry)
                     {
                         this->pht[insert_at_level].insert(old_entry->data.pc, new_address, left_pattern + right_pattern);
@@ -268,13 +246,10 @@ void RB::access(uint64_t block_number, uint64_t pc)
                     region_insert >>= 1;
                     pc_trigger = old_entry->data.pc;
                     offset_trigger = old_entry->data.offset + this->at[ft_hit_level].get_pattern_len();
-                    pattern_insert.resize(this->at[insert_at_level].get_pattern_len());
-                    for (size_t i = 0; i < old_entry->data.pattern.size(); i++)
-                    {
-                        pattern_insert[i + pattern_insert.size() / 2] = old_entry->data.pattern[i];
-                    }
-                    pattern_insert[entry->data.offset] = 1;
-                    pattern_insert[region_offset] = 1;
+                    int half = this->at[insert_at_level].get_pattern_len() / 2;
+                    pattern_insert = BlockPattern(this->at[insert_at_level].get_pattern_len(), old_entry->data.pattern.word() << half);
+                    pattern_insert.set(entry->data.offset);
+                    pattern_insert.set(region_offset);
                     pattern_prefetch = entry->data.pattern_prefetch + old_entry->data.pattern_prefetch;
                     if (debug_level >= 2)
                     {
@@ -283,17 +258,17 @@ void RB::access(uint64_t block_number, uint64_t pc)
                     }
                     // remove the two pattern in pht, merge them and insert to the higher level
                     uint64_t new_address = hash_index(old_entry->key, this->at[ft_hit_level].get_index_len()) * this->pattern_len[ft_hit_level] + old_entry->data.offset;
-                    vector<bool> left_pattern, right_pattern;
+                    BlockPattern left_pattern, right_pattern;
                     PHTRB::Entry *left_entry = this->pht[ft_hit_level].erase(pc, block_number);
                     PHTRB::Entry *right_entry = this->pht[ft_hit_level].erase(old_entry->data.pc, new_address);
                     if (left_entry)
                         left_pattern = left_entry->data.pattern;
                     else
-                        left_pattern = vector<bool>(pattern_len[ft_hit_level], 0);
+                        left_pattern = BlockPattern(pattern_len[ft_hit_level]);
                     if (right_entry)
                         right_pattern = right_entry->data.pattern;
                     else
-                        right_pattern = vector<bool>(pattern_len[ft_hit_level], 0);
+                        right_pattern = BlockPattern(pattern_len[ft_hit_level]);
                     if (left_entry || right_entry)
                     {
                         this->pht[insert_at_level].insert(old_entry->data.pc, new_address, left_pattern + right_pattern);
@@ -384,23 +359,23 @@ void RB::log()
     cerr << this->pb.log();
 }
 
-vector<int> RB::find_in_pht(uint64_t pc, uint64_t address, int &hit_level)
+FillPattern RB::find_in_pht(uint64_t pc, uint64_t address, int &hit_level)
 {
     if (this->debug_level >= 2)
     {
         cerr << "[RB] find_in_pht(pc=0x" << hex << pc << ", address=0x" << address << ")" << dec << endl;
     }
-    vector<vector<int>> pattern(levels, vector<int>());
+    vector<FillPattern> &pattern = this->level_pattern;
+    vector<BlockPattern> &matches = this->pht_matches;
     for (size_t i = 0; i < levels; i++)
     {
-        vector<vector<bool>> matches = this->pht[i].find(pc, address);
+        pattern[i] = FillPattern();
+        this->pht[i].find(pc, address, matches);
         EventPB pht_last_event = this->pht[i].get_last_event();
         if (pht_last_event == PC_ADDRESS_PB)
         {
-            vector<int> res(this->pattern_len[i], 0);
-            for (int j = 0; j < this->pattern_len[i]; j++)
-                if (matches[0][j])
-                    res[j] = FILL_L2;
+            FillPattern res(this->pattern_len[i]);
+            res.set_blocks(matches[0], FILL_L2);
             hit_level = i;
             if (debug_level >= 2)
             {
@@ -439,37 +414,23 @@ vector<int> RB::find_in_pht(uint64_t pc, uint64_t address, int &hit_level)
         cerr << "[RB] find_in_pht: ALL MISS!" << dec << endl;
     }
     hit_level = -1;
-    return vector<int>();
+    return FillPattern();
 }
 
-bool check_half_zero_pb(const vector<bool> &v, int l, int r)
+bool check_half_zero_pb(const BlockPattern &v, int l, int r)
 {
-    for (size_t i = l; i < r; i++)
-    {
-        if (v[i])
-            return false;
-    }
-    return true;
+    return v.none(l, r);
 }
 
-vector<bool> vector_or_pb(const vector<bool> &v1, const vector<bool> &v2, int l, int r)
+BlockPattern vector_or_pb(const BlockPattern &v1, const BlockPattern &v2, int l, int r)
 {
-    vector<bool> result(r - l);
-    for (size_t i = 0; i < result.size(); i++)
-    {
-        result[i] = v1[l + i] || v2[l + i];
-    }
-    return result;
+    return (v1 | v2).sub(l, r);
 }
 
-bool compare_or_pb(const vector<bool> &x, const vector<bool> &y, int l, int r)
+bool compare_or_pb(const BlockPattern &x, const BlockPattern &y, int l, int r)
 {
-    int count = 0;
-    for (size_t i = l; i < r; i++)
-    {
-        if (!x[i] ^ y[i])
-            count++;
-    }
+    /* blocks where both patterns agree */
+    int count = (r - l) - x.count_diff(y, l, r);
     if (knob::rb_debug_level >= 1)
     {
         cerr << "count=" << count << ", r=" << r << ", l=" << l << ", thresh=" << knob::rb_or_thresh << endl;
@@ -479,14 +440,10 @@ bool compare_or_pb(const vector<bool> &x, const vector<bool> &y, int l, int r)
     return true;
 }
 
-bool compare_accuracy_pb(const vector<bool> &x, const vector<bool> &y, int l, int r)
+bool compare_accuracy_pb(const BlockPattern &x, const BlockPattern &y, int l, int r)
 {
-    int count = 0;
-    for (size_t i = l; i < r; i++)
-    {
-        if (!x[i] ^ y[i])
-            count++;
-    }
+    /* blocks where both patterns agree */
+    int count = (r - l) - x.count_diff(y, l, r);
     if (knob::rb_debug_level >= 1)
     {
         cerr << "count=" << count << ", r=" << r << ", l=" << l << ", thresh=" << knob::rb_accuracy_thresh << endl;
@@ -496,14 +453,9 @@ bool compare_accuracy_pb(const vector<bool> &x, const vector<bool> &y, int l, in
     return true;
 }
 
-vector<bool> sub_vector_pb(const vector<bool> &v, int l, int r)
+BlockPattern sub_vector_pb(const BlockPattern &v, int l, int r)
 {
-    vector<bool> result(r - l);
-    for (size_t i = 0; i < result.size(); i++)
-    {
-        result[i] = v[l + i];
-    }
-    return result;
+    return v.sub(l, r);
 }
 
 void RB::insert_in_pht(const ATRB::Entry &entry, int at_level)
@@ -514,8 +466,8 @@ void RB::insert_in_pht(const ATRB::Entry &entry, int at_level)
     int offset = entry.data.offset;
     uint64_t region_number = hash_index(entry.key, this->at[at_level].get_index_len());
     uint64_t address = region_number * this->pattern_len[at_level] + entry.data.offset;
-    vector<bool> new_pattern = entry.data.pattern;
-    vector<bool> old_pattern = entry.data.pattern_prefetch;
+    const BlockPattern &new_pattern = entry.data.pattern;
+    const BlockPattern &old_pattern = entry.data.pattern_prefetch;
 
     if (at_level == 0)
     {
@@ -661,7 +613,7 @@ void RB::insert_in_pht(const ATRB::Entry &entry, int at_level)
     }
 }
 
-vector<int> RB::vote(const vector<vector<bool>> &x)
+FillPattern RB::vote(const vector<BlockPattern> &x)
 {
     if (this->debug_level >= 2)
         cerr << "RB::vote(...)" << endl;
@@ -670,7 +622,7 @@ vector<int> RB::vote(const vector<vector<bool>> &x)
     {
         if (this->debug_level >= 2)
             cerr << "[RB::vote] There are no voters." << endl;
-        return vector<int>();
+        return FillPattern();
     }
     if (this->debug_level >= 2)
     {
@@ -678,32 +630,23 @@ vector<int> RB::vote(const vector<vector<bool>> &x)
         for (int i = 0; i < n; i += 1)
             cerr << "<" << setw(3) << i + 1 << "> " << rb_pattern_to_string(x[i]) << endl;
     }
-    bool pf_flag = false;
-    vector<int> res(x[0].size(), 0);
-    for (int i = 0; i < n; i += 1)
-        // assert((int)x[i].size() == this->pattern_len);
-        for (int i = 0; i < x[0].size(); i += 1)
-        {
-            int cnt = 0;
-            for (int j = 0; j < n; j += 1)
-                if (x[j][i])
-                    cnt += 1;
-            double p = 1.0 * cnt / n;
-            if (p >= knob::rb_l2c_thresh)
-                res[i] = FILL_L2;
-            else if (p >= knob::rb_llc_thresh)
-                res[i] = FILL_LLC;
-            else
-                res[i] = 0;
-            if (res[i] != 0)
-                pf_flag = true;
-        }
+    FillPattern res(x[0].size());
+    int cnt[PATTERN_MAX_BLOCKS] = {0};
+    count_votes(x, cnt);
+    for (int i = 0; i < res.size(); i += 1)
+    {
+        double p = 1.0 * cnt[i] / n;
+        if (p >= knob::rb_l2c_thresh)
+            res.set(i, FILL_L2);
+        else if (p >= knob::rb_llc_thresh)
+            res.set(i, FILL_LLC);
+    }
     if (this->debug_level >= 2)
     {
         cerr << "<res> " << rb_pattern_to_string(res) << endl;
     }
-    if (!pf_flag)
-        return vector<int>();
+    if (!res.any())
+        return FillPattern();
     return res;
 }
 
@@ -751,12 +694,48 @@ void RB::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefet
     eviction(evicted_block_number);
 }
 
+void RB::register_stats(string section)
+{
+    stats_section = section;
+    stats_registry.section(section);
+    stats_registry.counter("EU_check_num", &count_eu_check);
+    stats_registry.counter("Region_expand_num", &count_region_expand);
+    stats_registry.counter("SU_check_num", &count_su_check);
+    stats_registry.counter("Region_shrink_num", &count_region_shrink);
+    stats_registry.blank();
+}
+
 void RB::dump_stats()
 {
-    cout << "EU_check_num " << count_eu_check << endl
-         << "Region_expand_num " << count_region_expand << endl
-         << "SU_check_num " << count_su_check << endl
-         << "Region_shrink_num " << count_region_shrink << endl << endl;
+    stats_registry.print(stats_section, cout);
+}
+
+void RB::save(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+void RB::load(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+/* walks the tables in the same order for save and restore, the scratch buffers are rebuilt on use */
+void RB::checkpoint(CHECKPOINT &cp)
+{
+    cp.check(levels, "rb levels");
+    for (int i = 0; i < levels; i++)
+    {
+        ft[i].checkpoint(cp);
+        at[i].checkpoint(cp);
+        pht[i].checkpoint(cp);
+    }
+    pb.checkpoint(cp);
+    cp.scalar(count_eu_check);
+    cp.scalar(count_region_expand);
+    cp.scalar(count_su_check);
+    cp.scalar(count_region_shrink);
+    cp.scalar(warmup_complete_reset);
 }
 
 void RB::reset_stats(){
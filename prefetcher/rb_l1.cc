@@ -2,7 +2,9 @@
 #include <vector>
 #include "cache.h"
 #include "champsim.h"
+#include "checkpoint.h"
 #include "rb_l1.h"
+#include "stats.h"
 
 namespace knob
 {
@@ -42,6 +44,7 @@ RB_L1::RB_L1(string type, CACHE *cache) : Prefetcher(type), parent(cache),
 {
     init_knobs();
     init_stats();
+    level_pattern.resize(levels);
     for (int i = 0; i < levels; i++)
     {
         ft.emplace_back(FTRB_L1(knob::rb_l1_ft_size[i], pattern_len[i], knob::rb_l1_debug_level));
@@ -70,18 +73,6 @@ std::ostream &operator<<(std::ostream &os, const std::vector<T> &vec)
     return os;
 }
 
-template <typename T>
-std::vector<T> operator+(const std::vector<T> &v1, const std::vector<T> &v2)
-{
-    std::vector<T> result;
-    result.reserve(v1.size() + v2.size()); // 预分配足够的空间
-
-    result.insert(result.end(), v1.begin(), v1.end()); // 将v1的元素添加到result中
-    result.insert(result.end(), v2.begin(), v2.end()); // 将v2的元素添加到result中
-
-    return result;
-}
-
 void RB_L1::print_config()
 {
     cout << "rb_l1_levels" << knob::rb_l1_levels << endl
@@ -155,17 +146,11 @@ void RB_L1::access(uint64_t block_number, uint64_t pc)
         }
 #endif
         int pht_hit_level = -1;
-        vector<int> pattern = this->find_in_pht(pc, block_number, pht_hit_level);
+        FillPattern pattern = this->find_in_pht(pc, block_number, pht_hit_level);
         int ft_insert_level = pht_hit_level < 0 ? knob::rb_l1_default_insert_level : pht_hit_level;
-        vector<bool> pattern_prefetch(this->pattern_len[ft_insert_level], false);
+        BlockPattern pattern_prefetch(this->pattern_len[ft_insert_level]);
         if (!pattern.empty())
-        {
-            for (size_t i = 0; i < pattern_prefetch.size(); i++)
-            {
-                if (pattern[i])
-                    pattern_prefetch[i] = true;
-            }
-        }
+            pattern_prefetch = BlockPattern(pattern_prefetch.size(), pattern.blocks().word());
 
         uint64_t region_number = block_number / this->ft[ft_insert_level].get_pattern_len();
         int region_offset = block_number % this->ft[ft_insert_level].get_pattern_len();
@@ -174,12 +159,9 @@ void RB_L1::access(uint64_t block_number, uint64_t pc)
         // daixiugai
         if (!pattern.empty())
         {
-            vector<int> expand_pattern(pattern_len[levels - 1], 0);
+            FillPattern expand_pattern(pattern_len[levels - 1]);
             int start = (block_number % pattern_len[levels - 1]) / pattern.size() * pattern.size();
-            for (size_t i = 0; i < pattern.size(); i++)
-            {
-                expand_pattern[start + i] = pattern[i];
-            }
+            expand_pattern.copy_at(start, pattern);
 
             this->pb.insert(block_number / this->pattern_len[levels - 1], expand_pattern);
         }
@@ -195,8 +177,8 @@ void RB_L1::access(uint64_t block_number, uint64_t pc)
         uint64_t region_insert = region_number;
         uint64_t pc_trigger;
         int offset_trigger;
-        vector<bool> pattern_insert(this->at[ft_hit_level].get_pattern_len(), 0);
-        vector<bool> pattern_prefetch = entry->data.pattern_prefetch;
+        BlockPattern pattern_insert(this->at[ft_hit_level].get_pattern_len());
+        BlockPattern pattern_prefetch = entry->data.pattern_prefetch;
         ATRB_L1::Entry *old_entry = nullptr;
         if (ft_hit_level != levels - 1)
         {
@@ -209,13 +191,9 @@ void RB_L1::access(uint64_t block_number, uint64_t pc)
                     region_insert >>= 1;
                     pc_trigger = old_entry->data.pc;
                     offset_trigger = old_entry->data.offset;
-                    pattern_insert.resize(this->at[insert_at_level].get_pattern_len());
-                    for (size_t i = 0; i < old_entry->data.pattern.size(); i++)
-                    {
-                        pattern_insert[i] = old_entry->data.pattern[i];
-                    }
-                    pattern_insert[entry->data.offset + pattern_insert.size() / 2] = 1;
-                    pattern_insert[region_offset + pattern_insert.size() / 2] = 1;
+                    pattern_insert = BlockPattern(this->at[insert_at_level].get_pattern_len(), old_entry->data.pattern.word());
+                    pattern_insert.set(entry->data.offset + pattern_insert.size() / 2);
+                    pattern_insert.set(region_offset + pattern_insert.size() / 2);
                     pattern_prefetch = old_entry->data.pattern_prefetch + entry->data.pattern_prefetch;
                     if (debug_level >= 2)
                     {
@@ -224,17 +202,17 @@ void RB_L1::access(uint64_t block_number, uint64_t pc)
                     }
                     // remove the two pattern in pht, merge them and insert to the higher level
                     uint64_t new_address = hash_index(old_entry->key, this->at[ft_hit_level].get_index_len()) * this->pattern_len[ft_hit_level] + old_entry->data.offset;
-                    vector<bool> left_pattern, right_pattern;
+                    BlockPattern left_pattern, right_pattern;
                     PHTRB_L1::Entry *left_entry = this->pht[ft_hit_level].erase(old_entry->data.pc, new_address);
                     PHTRB_L1::Entry *right_entry = this->pht[ft_hit_level].erase(pc, block_number);
                     if (left_entry)
                         left_pattern = left_entry->data.pattern;
                     else
-                        left_pattern = vector<bool>(pattern_len[ft_hit_level], 0);
+                        left_pattern = BlockPattern(pattern_len[ft_hit_level]);
                     if (right_entry)
                         right_pattern = right_entry->data.pattern;
                     else
-                        right_pattern = vector<bool>(pattern_len[ft_hit_level], 0);
+                        right_pattern = BlockPattern(pattern_len[ft_hit_level]);
                     if (left_entry || right_entry)
                     {
                         this->pht[insert_at_level].insert(old_entry->data.pc, new_address, left_pattern + right_pattern);
@@ -250,13 +228,10 @@ void RB_L1::access(uint64_t block_number, uint64_t pc)
                     region_insert >>= 1;
                     pc_trigger = old_entry->data.pc;
                     offset_trigger = old_entry->data.offset + this->at[ft_hit_level].get_pattern_len();
-                    pattern_insert.resize(this->at[insert_at_level].get_pattern_len());
-                    for (size_t i = 0; i < old_entry->data.pattern.size(); i++)
-                    {
-                        pattern_insert[i + pattern_insert.size() / 2] = old_entry->data.pattern[i];
-                    }
-                    pattern_insert[entry->data.offset] = 1;
-                    pattern_insert[region_offset] = 1;
+                    int half = this->at[insert_at_level].get_pattern_len() / 2;
+                    pattern_insert = BlockPattern(this->at[insert_at_level].get_pattern_len(), old_entry->data.pattern.word() << half);
+                    pattern_insert.set(entry->data.offset);
+                    pattern_insert.set(region_offset);
                     pattern_prefetch = entry->data.pattern_prefetch + old_entry->data.pattern_prefetch;
                     if (debug_level >= 2)
                     {
@@ -265,17 +240,17 @@ void RB_L1::access(uint64_t block_number, uint64_t pc)
                     }
                     // remove the two pattern in pht, merge them and insert to the higher level
                     uint64_t new_address = hash_index(old_entry->key, this->at[ft_hit_level].get_index_len()) * this->pattern_len[ft_hit_level] + old_entry->data.offset;
-                    vector<bool> left_pattern, right_pattern;
+                    BlockPattern left_pattern, right_pattern;
                     PHTRB_L1::Entry *left_entry = this->pht[ft_hit_level].erase(pc, block_number);
                     PHTRB_L1::Entry *right_entry = this->pht[ft_hit_level].erase(old_entry->data.pc, new_address);
                     if (left_entry)
                         left_pattern = left_entry->data.pattern;
                     else
-                        left_pattern = vector<bool>(pattern_len[ft_hit_level], 0);
+                        left_pattern = BlockPattern(pattern_len[ft_hit_level]);
                     if (right_entry)
                         right_pattern = right_entry->data.pattern;
                     else
-                        right_pattern = vector<bool>(pattern_len[ft_hit_level], 0);
+                        right_pattern = BlockPattern(pattern_len[ft_hit_level]);
                     if (left_entry || right_entry)
                     {
                         this->pht[insert_at_level].insert(old_entry->data.pc, new_address, left_pattern + right_pattern);
@@ -366,23 +341,23 @@ void RB_L1::log()
     cerr << this->pb.log();
 }
 
-vector<int> RB_L1::find_in_pht(uint64_t pc, uint64_t address, int &hit_level)
+FillPattern RB_L1::find_in_pht(uint64_t pc, uint64_t address, int &hit_level)
 {
     if (this->debug_level >= 2)
     {
         cerr << "[RB_L1] find_in_pht(pc=0x" << hex << pc << ", address=0x" << address << ")" << dec << endl;
     }
-    vector<vector<int>> pattern(levels, vector<int>());
+    vector<FillPattern> &pattern = this->level_pattern;
+    vector<BlockPattern> &matches = this->pht_matches;
     for (size_t i = 0; i < levels; i++)
     {
-        vector<vector<bool>> matches = this->pht[i].find(pc, address);
+        pattern[i] = FillPattern();
+        this->pht[i].find(pc, address, matches);
         EventPB_L1 pht_last_event = this->pht[i].get_last_event();
         if (pht_last_event == PC_ADDRESS_PB_L1)
         {
-            vector<int> res(this->pattern_len[i], 0);
-            for (int j = 0; j < this->pattern_len[i]; j++)
-                if (matches[0][j])
-                    res[j] = FILL_L2;
+            FillPattern res(this->pattern_len[i]);
+            res.set_blocks(matches[0], FILL_L2);
             hit_level = i;
             if (debug_level >= 2)
             {
@@ -421,37 +396,23 @@ vector<int> RB_L1::find_in_pht(uint64_t pc, uint64_t address, int &hit_level)
         cerr << "[RB_L1] find_in_pht: ALL MISS!" << dec << endl;
     }
     hit_level = -1;
-    return vector<int>();
+    return FillPattern();
 }
 
-bool check_half_zero_pb_l1(const vector<bool> &v, int l, int r)
+bool check_half_zero_pb_l1(const BlockPattern &v, int l, int r)
 {
-    for (size_t i = l; i < r; i++)
-    {
-        if (v[i])
-            return false;
-    }
-    return true;
+    return v.none(l, r);
 }
 
-vector<bool> vector_or_pb_l1(const vector<bool> &v1, const vector<bool> &v2, int l, int r)
+BlockPattern vector_or_pb_l1(const BlockPattern &v1, const BlockPattern &v2, int l, int r)
 {
-    vector<bool> result(r - l);
-    for (size_t i = 0; i < result.size(); i++)
-    {
-        result[i] = v1[l + i] || v2[l + i];
-    }
-    return result;
+    return (v1 | v2).sub(l, r);
 }
 
-bool compare_or_pb_l1(const vector<bool> &x, const vector<bool> &y, int l, int r)
+bool compare_or_pb_l1(const BlockPattern &x, const BlockPattern &y, int l, int r)
 {
-    int count = 0;
-    for (size_t i = l; i < r; i++)
-    {
-        if (!x[i] ^ y[i])
-            count++;
-    }
+    /* blocks where both patterns agree */
+    int count = (r - l) - x.count_diff(y, l, r);
     if (knob::rb_l1_debug_level >= 1)
     {
         cerr << "count=" << count << ", r=" << r << ", l=" << l << ", thresh=" << knob::rb_l1_or_thresh << endl;
@@ -461,14 +422,10 @@ bool compare_or_pb_l1(const vector<bool> &x, const vector<bool> &y, int l, int r
     return true;
 }
 
-bool compare_accuracy_pb_l1(const vector<bool> &x, const vector<bool> &y, int l, int r)
+bool compare_accuracy_pb_l1(const BlockPattern &x, const BlockPattern &y, int l, int r)
 {
-    int count = 0;
-    for (size_t i = l; i < r; i++)
-    {
-        if (!x[i] ^ y[i])
-            count++;
-    }
+    /* blocks where both patterns agree */
+    int count = (r - l) - x.count_diff(y, l, r);
     if (knob::rb_l1_debug_level >= 1)
     {
         cerr << "count=" << count << ", r=" << r << ", l=" << l << ", thresh=" << knob::rb_l1_accuracy_thresh << endl;
@@ -478,14 +435,9 @@ bool compare_accuracy_pb_l1(const vector<bool> &x, const vector<bool> &y, int l,
     return true;
 }
 
-vector<bool> sub_vector_pb_l1(const vector<bool> &v, int l, int r)
+BlockPattern sub_vector_pb_l1(const BlockPattern &v, int l, int r)
 {
-    vector<bool> result(r - l);
-    for (size_t i = 0; i < result.size(); i++)
-    {
-        result[i] = v[l + i];
-    }
-    return result;
+    return v.sub(l, r);
 }
 
 void RB_L1::insert_in_pht(const ATRB_L1::Entry &entry, int at_level)
@@ -495,8 +447,8 @@ void RB_L1::insert_in_pht(const ATRB_L1::Entry &entry, int at_level)
     int offset = entry.data.offset;
     uint64_t region_number = hash_index(entry.key, this->at[at_level].get_index_len());
     uint64_t address = region_number * this->pattern_len[at_level] + entry.data.offset;
-    vector<bool> new_pattern = entry.data.pattern;
-    vector<bool> old_pattern = entry.data.pattern_prefetch;
+    const BlockPattern &new_pattern = entry.data.pattern;
+    const BlockPattern &old_pattern = entry.data.pattern_prefetch;
 
     if (old_pattern.empty())
     {
@@ -585,7 +537,7 @@ void RB_L1::insert_in_pht(const ATRB_L1::Entry &entry, int at_level)
     }
 }
 
-vector<int> RB_L1::vote(const vector<vector<bool>> &x)
+FillPattern RB_L1::vote(const vector<BlockPattern> &x)
 {
     if (this->debug_level >= 2)
         cerr << "RB_L1::vote(...)" << endl;
@@ -594,7 +546,7 @@ vector<int> RB_L1::vote(const vector<vector<bool>> &x)
     {
         if (this->debug_level >= 2)
             cerr << "[RB_L1::vote] There are no voters." << endl;
-        return vector<int>();
+        return FillPattern();
     }
     if (this->debug_level >= 2)
     {
@@ -602,32 +554,23 @@ vector<int> RB_L1::vote(const vector<vector<bool>> &x)
         for (int i = 0; i < n; i += 1)
             cerr << "<" << setw(3) << i + 1 << "> " << rb_l1_pattern_to_string(x[i]) << endl;
     }
-    bool pf_flag = false;
-    vector<int> res(x[0].size(), 0);
-    for (int i = 0; i < n; i += 1)
-        // assert((int)x[i].size() == this->pattern_len);
-        for (int i = 0; i < x[0].size(); i += 1)
-        {
-            int cnt = 0;
-            for (int j = 0; j < n; j += 1)
-                if (x[j][i])
-                    cnt += 1;
-            double p = 1.0 * cnt / n;
-            if (p >= knob::rb_l1_l2c_thresh)
-                res[i] = FILL_L1;
-            else if (p >= knob::rb_l1_llc_thresh)
-                res[i] = FILL_L2;
-            else
-                res[i] = 0;
-            if (res[i] != 0)
-                pf_flag = true;
-        }
+    FillPattern res(x[0].size());
+    int cnt[PATTERN_MAX_BLOCKS] = {0};
+    count_votes(x, cnt);
+    for (int i = 0; i < res.size(); i += 1)
+    {
+        double p = 1.0 * cnt[i] / n;
+        if (p >= knob::rb_l1_l2c_thresh)
+            res.set(i, FILL_L1);
+        else if (p >= knob::rb_l1_llc_thresh)
+            res.set(i, FILL_L2);
+    }
     if (this->debug_level >= 2)
     {
         cerr << "<res> " << rb_l1_pattern_to_string(res) << endl;
     }
-    if (!pf_flag)
-        return vector<int>();
+    if (!res.any())
+        return FillPattern();
     return res;
 }
 
@@ -671,7 +614,36 @@ void RB_L1::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t pre
     eviction(evicted_block_number);
 }
 
+void RB_L1::register_stats(string section)
+{
+    stats_section = section;
+    stats_registry.section(section);
+}
+
 void RB_L1::dump_stats()
 {
-    // print_stats();
+    stats_registry.print(stats_section, cout);
+}
+
+void RB_L1::save(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+void RB_L1::load(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+/* walks the tables in the same order for save and restore, the scratch buffers are rebuilt on use */
+void RB_L1::checkpoint(CHECKPOINT &cp)
+{
+    cp.check(levels, "rb_l1 levels");
+    for (int i = 0; i < levels; i++)
+    {
+        ft[i].checkpoint(cp);
+        at[i].checkpoint(cp);
+        pht[i].checkpoint(cp);
+    }
+    pb.checkpoint(cp);
 }
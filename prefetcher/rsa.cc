@@ -2,7 +2,9 @@
 #include <vector>
 #include "cache.h"
 #include "champsim.h"
+#include "checkpoint.h"
 #include "rsa.h"
+#include "stats.h"
 
 namespace knob
 {
@@ -133,7 +135,7 @@ void RSA::access(uint64_t block_number, uint64_t pc)
         }
 #endif
         int pht_hit_level = -1;
-        vector<bool> pattern = this->find_in_pht(pc, block_number, pht_hit_level);
+        BlockPattern pattern = this->find_in_pht(pc, block_number, pht_hit_level);
         int ft_insert_level = pht_hit_level < 0 ? knob::rsa_default_insert_level : pht_hit_level;
 
         uint64_t region_number = block_number / this->ft[ft_insert_level].get_pattern_len();
@@ -143,12 +145,8 @@ void RSA::access(uint64_t block_number, uint64_t pc)
         // daixiugai
         if (!pattern.empty())
         {
-            vector<bool> expand_pattern(pattern_len[levels - 1], 0);
             int start = (block_number % pattern_len[levels - 1]) / pattern.size() * pattern.size();
-            for (size_t i = 0; i < pattern.size(); i++)
-            {
-                expand_pattern[start + i] = pattern[i];
-            }
+            BlockPattern expand_pattern(pattern_len[levels - 1], pattern.word() << start);
 
             this->pb.insert(block_number / this->pattern_len[levels - 1], expand_pattern);
         }
@@ -164,7 +162,7 @@ void RSA::access(uint64_t block_number, uint64_t pc)
         uint64_t region_insert = region_number;
         uint64_t pc_first, pc_second = entry->data.pc;
         int offset_first, offset_second = entry->data.offset;
-        vector<bool> pattern_insert(this->at[ft_hit_level].get_pattern_len(), 0);
+        BlockPattern pattern_insert(this->at[ft_hit_level].get_pattern_len());
         AT::Entry *old_entry = nullptr;
         if (ft_hit_level != levels - 1)
         {
@@ -178,13 +176,9 @@ void RSA::access(uint64_t block_number, uint64_t pc)
                     pc_first = old_entry->data.pc_first;
                     offset_first = old_entry->data.offset_first;
                     offset_second += this->at[ft_hit_level].get_pattern_len();
-                    pattern_insert.resize(this->at[insert_at_level].get_pattern_len());
-                    for (size_t i = 0; i < old_entry->data.pattern.size(); i++)
-                    {
-                        pattern_insert[i] = old_entry->data.pattern[i];
-                    }
-                    pattern_insert[entry->data.offset + pattern_insert.size() / 2] = 1;
-                    pattern_insert[region_offset + pattern_insert.size() / 2] = 1;
+                    pattern_insert = BlockPattern(this->at[insert_at_level].get_pattern_len(), old_entry->data.pattern.word());
+                    pattern_insert.set(entry->data.offset + pattern_insert.size() / 2);
+                    pattern_insert.set(region_offset + pattern_insert.size() / 2);
                 }
             }
             else
@@ -196,13 +190,10 @@ void RSA::access(uint64_t block_number, uint64_t pc)
                     region_insert >>= 1;
                     pc_first = old_entry->data.pc_first;
                     offset_first = old_entry->data.offset_first + this->at[ft_hit_level].get_pattern_len();
-                    pattern_insert.resize(this->at[insert_at_level].get_pattern_len());
-                    for (size_t i = 0; i < old_entry->data.pattern.size(); i++)
-                    {
-                        pattern_insert[i + pattern_insert.size() / 2] = old_entry->data.pattern[i];
-                    }
-                    pattern_insert[entry->data.offset] = 1;
-                    pattern_insert[region_offset] = 1;
+                    int half = this->at[insert_at_level].get_pattern_len() / 2;
+                    pattern_insert = BlockPattern(this->at[insert_at_level].get_pattern_len(), old_entry->data.pattern.word() << half);
+                    pattern_insert.set(entry->data.offset);
+                    pattern_insert.set(region_offset);
                 }
             }
         }
@@ -289,13 +280,13 @@ void RSA::log()
     cerr << this->pb.log();
 }
 
-vector<bool> RSA::find_in_pht(uint64_t pc, uint64_t address, int &hit_level)
+BlockPattern RSA::find_in_pht(uint64_t pc, uint64_t address, int &hit_level)
 {
     if (this->debug_level >= 2)
     {
         cerr << "[RSA] find_in_pht(pc=0x" << hex << pc << ", address=0x" << address << ")" << dec << endl;
     }
-    vector<bool> pattern;
+    BlockPattern pattern;
     for (size_t i = 0; i < levels; i++)
     {
         int offset = address % this->pht[i].get_pattern_len();
@@ -307,62 +298,30 @@ vector<bool> RSA::find_in_pht(uint64_t pc, uint64_t address, int &hit_level)
         }
     }
     hit_level = -1;
-    return vector<bool>();
-}
-
-template <typename T>
-std::vector<T> operator+(const std::vector<T> &v1, const std::vector<T> &v2)
-{
-    std::vector<T> result;
-    result.reserve(v1.size() + v2.size()); // 预分配足够的空间
-
-    result.insert(result.end(), v1.begin(), v1.end()); // 将v1的元素添加到result中
-    result.insert(result.end(), v2.begin(), v2.end()); // 将v2的元素添加到result中
-
-    return result;
+    return BlockPattern();
 }
 
-bool check_half_zero(const vector<bool> &v, int l, int r)
+bool check_half_zero(const BlockPattern &v, int l, int r)
 {
-    for (size_t i = l; i < r; i++)
-    {
-        if (v[i])
-            return false;
-    }
-    return true;
+    return v.none(l, r);
 }
 
-vector<bool> vector_or(const vector<bool> &v1, const vector<bool> &v2, int l, int r)
+BlockPattern vector_or(const BlockPattern &v1, const BlockPattern &v2, int l, int r)
 {
-    vector<bool> result(r - l);
-    for (size_t i = 0; i < result.size(); i++)
-    {
-        result[i] = v1[l + i] || v2[l + i];
-    }
-    return result;
+    return (v1 | v2).sub(l, r);
 }
 
-bool compare_accuracy(const vector<bool> &x, const vector<bool> &y, int l, int r)
+bool compare_accuracy(const BlockPattern &x, const BlockPattern &y, int l, int r)
 {
-    int count = 0;
-    for (size_t i = l; i < r; i++)
-    {
-        if (x[i] ^ y[i])
-            count++;
-    }
+    int count = x.count_diff(y, l, r);
     if (count < (r - l) * knob::rsa_thresh)
         return false;
     return true;
 }
 
-vector<bool> sub_vector(const vector<bool> &v, int l, int r)
+BlockPattern sub_vector(const BlockPattern &v, int l, int r)
 {
-    vector<bool> result(r - l);
-    for (size_t i = 0; i < result.size(); i++)
-    {
-        result[i] = v[l + i];
-    }
-    return result;
+    return v.sub(l, r);
 }
 
 void RSA::insert_in_pht(const AT::Entry &entry, int at_level)
@@ -371,13 +330,13 @@ void RSA::insert_in_pht(const AT::Entry &entry, int at_level)
     {
         uint64_t pc = entry.data.pc_first;
         int offset = entry.data.offset_first;
-        vector<bool> new_pattern = entry.data.pattern;
-        vector<bool> old_pattern_first = this->pht[at_level - 1].find(entry.data.pc_first, entry.data.offset_first);
-        vector<bool> old_pattern_second = this->pht[at_level - 1].find(entry.data.pc_second, entry.data.offset_second);
+        BlockPattern new_pattern = entry.data.pattern;
+        BlockPattern old_pattern_first = this->pht[at_level - 1].find(entry.data.pc_first, entry.data.offset_first);
+        BlockPattern old_pattern_second = this->pht[at_level - 1].find(entry.data.pc_second, entry.data.offset_second);
         if (entry.data.offset_first < entry.data.offset_second)
         {
-            vector<bool> new_pattern_first = sub_vector(new_pattern, 0, new_pattern.size() / 2);
-            vector<bool> new_pattern_second = sub_vector(new_pattern, new_pattern.size() / 2, new_pattern.size());
+            BlockPattern new_pattern_first = sub_vector(new_pattern, 0, new_pattern.size() / 2);
+            BlockPattern new_pattern_second = sub_vector(new_pattern, new_pattern.size() / 2, new_pattern.size());
             if (!old_pattern_first.empty() && compare_accuracy(new_pattern_first, old_pattern_first, 0, new_pattern_first.size()))
             {
                 new_pattern_first = vector_or(new_pattern_first, old_pattern_first, 0, new_pattern_first.size());
@@ -391,8 +350,8 @@ void RSA::insert_in_pht(const AT::Entry &entry, int at_level)
         }
         else
         {
-            vector<bool> new_pattern_first = sub_vector(new_pattern, new_pattern.size() / 2, new_pattern.size());
-            vector<bool> new_pattern_second = sub_vector(new_pattern, 0, new_pattern.size() / 2);
+            BlockPattern new_pattern_first = sub_vector(new_pattern, new_pattern.size() / 2, new_pattern.size());
+            BlockPattern new_pattern_second = sub_vector(new_pattern, 0, new_pattern.size() / 2);
             if (!old_pattern_first.empty() && compare_accuracy(new_pattern_first, old_pattern_first, 0, new_pattern_first.size()))
             {
                 new_pattern_first = vector_or(new_pattern_first, old_pattern_first, 0, new_pattern_first.size());
@@ -411,8 +370,8 @@ void RSA::insert_in_pht(const AT::Entry &entry, int at_level)
     {
         uint64_t pc = entry.data.pc_first;
         int offset = entry.data.offset_first;
-        vector<bool> new_pattern = entry.data.pattern;
-        vector<bool> old_pattern = this->pht[at_level].find(pc, offset);
+        BlockPattern new_pattern = entry.data.pattern;
+        BlockPattern old_pattern = this->pht[at_level].find(pc, offset);
         if (old_pattern.empty())
         {
             this->pht[at_level].insert(pc, offset, new_pattern);
@@ -517,7 +476,44 @@ void RSA::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefe
     eviction(evicted_block_number);
 }
 
+void RSA::register_stats(string section)
+{
+    stats_section = section;
+    stats_registry.section(section);
+}
+
 void RSA::dump_stats()
 {
-    // print_stats();
+    stats_registry.print(stats_section, cout);
+}
+
+void RSA::save(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+void RSA::load(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+void RSA::checkpoint(CHECKPOINT &cp)
+{
+    cp.check(levels, "rsa levels");
+    for (int i = 0; i < levels; i++)
+    {
+        ft[i].checkpoint(cp);
+        at[i].checkpoint(cp);
+        pht[i].checkpoint(cp);
+    }
+    pb.checkpoint(cp);
+    cp.scalar(pht_access_cnt);
+    cp.scalar(pht_pc_address_cnt);
+    cp.scalar(pht_pc_offset_cnt);
+    cp.scalar(pht_miss_cnt);
+    cp.scalar(prefetch_cnt);
+    cp.scalar(useful_cnt);
+    cp.scalar(useless_cnt);
+    cp.map_entries(pref_level_cnt);
+    cp.scalar(region_pref_cnt);
 }
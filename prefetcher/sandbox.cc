@@ -4,7 +4,9 @@
 #include <stdlib.h>
 #include <cmath>
 #include "sandbox.h"
+#include "stats.h"
 #include "champsim.h"
+#include "checkpoint.h"
 
 namespace knob
 {
@@ -66,16 +68,18 @@ void SandboxPrefetcher::print_config()
 void SandboxPrefetcher::init_evaluated_offsets()
 {
 	/* select {-8,-1} and {+1,+8} offsets in the beginning */
+	evaluated_offsets.reserve(16);
 	for(int32_t index = 1; index <= 8; ++index)
 	{
-		Score *score = new Score(index);
-		evaluated_offsets.push_back(score);
+		evaluated_offsets.push_back(Score(index));
 	}
 	for(int32_t index = -8; index <= -1; ++index)
 	{
-		Score *score = new Score(index);
-		evaluated_offsets.push_back(score);
+		evaluated_offsets.push_back(Score(index));
 	}
+	pos_offsets.reserve(16);
+	neg_offsets.reserve(16);
+	filter_adds.reserve(knob::sandbox_num_access_in_phase);
 }
 
 void SandboxPrefetcher::init_non_evaluated_offsets()
@@ -96,6 +100,7 @@ void SandboxPrefetcher::reset_eval()
 	eval.total_demand = 0;
 	eval.filter_hit = 0;
 	bf->clear();
+	filter_adds.clear();
 }
 
 void SandboxPrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr)
@@ -123,19 +128,19 @@ void SandboxPrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t
 		stats.step1.filter_hit++;
 		eval.filter_hit++;
 		/* increment score */
-		evaluated_offsets[eval.curr_ptr]->score++;
+		evaluated_offsets[eval.curr_ptr].score++;
 		if(knob::sandbox_enable_stream_detect)
 		{
 			/* RBERA: TODO */
 			for(uint32_t index = 1; index <= knob::sandbox_stream_detect_length; ++index)
 			{
-				int32_t stream_offset = offset - (evaluated_offsets[eval.curr_ptr]->offset * index);
+				int32_t stream_offset = offset - (evaluated_offsets[eval.curr_ptr].offset * index);
 				if(stream_offset >= 0 && stream_offset < 64)
 				{
 					uint64_t stream_addr = (page << LOG2_PAGE_SIZE) + (stream_offset << LOG2_BLOCK_SIZE);
 					if(filter_lookup(stream_addr))
 					{
-						evaluated_offsets[eval.curr_ptr]->score++;
+						evaluated_offsets[eval.curr_ptr].score++;
 					}
 				}
 			}
@@ -143,7 +148,7 @@ void SandboxPrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t
 	}
 
 	/* Step 2: generate pseudo prefetch request and add to bloom filter */
-	uint32_t pref_offset = offset + evaluated_offsets[eval.curr_ptr]->offset;
+	uint32_t pref_offset = offset + evaluated_offsets[eval.curr_ptr].offset;
 	if(pref_offset >= 0 && pref_offset < 64)
 	{
 		uint64_t pseudo_pref_addr = (page << LOG2_PAGE_SIZE) + (pref_offset << LOG2_BLOCK_SIZE);
@@ -174,7 +179,6 @@ void SandboxPrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t
 	}
 
 	/* Step 4: generate actual prefetch reuqests based on the scores */
-	vector<Score*> pos_offsets, neg_offsets;
 	/* Following function does two job:
 	 * 1. Creates two separate lists of Scores based on posetive and negative offsets
 	 * 2. Sorts both offset lists based on ABSOLUTE offset value, as Snadbox prefers smaller offsets for prefetching */
@@ -184,9 +188,6 @@ void SandboxPrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t
 	uint32_t pos_pref = pref_addr.size();
 	generate_prefetch(neg_offsets, pref_degree, page, offset, pref_addr);
 	uint32_t neg_pref = pref_addr.size() - pos_pref;
-	/* destroy temporary lists */
-	destroy_offset_list(pos_offsets);
-	destroy_offset_list(neg_offsets);
 
 	stats.step4.pref_generated += pref_addr.size();
 	stats.step4.pref_generated_pos += pos_pref;
@@ -198,26 +199,28 @@ bool sort_function(Score *score1, Score *score2)
 	return (abs(score1->offset) < abs(score2->offset));
 }
 
-void SandboxPrefetcher::get_offset_list_sorted(vector<Score*> &pos_offsets, vector<Score*> &neg_offsets)
+void SandboxPrefetcher::get_offset_list_sorted(vector<Score> &pos_offsets, vector<Score> &neg_offsets)
 {
+	pos_offsets.clear();
+	neg_offsets.clear();
 	for(uint32_t index = 0; index < evaluated_offsets.size(); ++index)
 	{
-		assert(evaluated_offsets[index]->offset != 0);
-		if(evaluated_offsets[index]->offset > 0)
+		assert(evaluated_offsets[index].offset != 0);
+		if(evaluated_offsets[index].offset > 0)
 		{
-			pos_offsets.push_back(new Score(evaluated_offsets[index]->offset, evaluated_offsets[index]->score));
+			pos_offsets.push_back(evaluated_offsets[index]);
 		}
 		else
 		{
-			neg_offsets.push_back(new Score(evaluated_offsets[index]->offset, evaluated_offsets[index]->score));			
+			neg_offsets.push_back(evaluated_offsets[index]);
 		}
 	}
 
-	std::sort(pos_offsets.begin(), pos_offsets.end(), [](Score *score1, Score *score2){return abs(score1->offset) < abs(score2->offset);});
-	std::sort(neg_offsets.begin(), neg_offsets.end(), [](Score *score1, Score *score2){return abs(score1->offset) < abs(score2->offset);});
+	std::sort(pos_offsets.begin(), pos_offsets.end(), [](const Score &score1, const Score &score2){return abs(score1.offset) < abs(score2.offset);});
+	std::sort(neg_offsets.begin(), neg_offsets.end(), [](const Score &score1, const Score &score2){return abs(score1.offset) < abs(score2.offset);});
 }
 
-void SandboxPrefetcher::generate_prefetch(vector<Score*> offset_list, uint32_t pref_degree, uint64_t page, uint32_t offset, vector<uint64_t> &pref_addr)
+void SandboxPrefetcher::generate_prefetch(const vector<Score> &offset_list, uint32_t pref_degree, uint64_t page, uint32_t offset, vector<uint64_t> &pref_addr)
 {
 	uint32_t count = 0;
 	for(uint32_t index = 0; index < offset_list.size(); ++index)
@@ -229,14 +232,14 @@ void SandboxPrefetcher::generate_prefetch(vector<Score*> offset_list, uint32_t p
 				break;
 			}
 
-			if(offset_list[index]->score >= lookahead*knob::sandbox_num_access_in_phase)
+			if(offset_list[index].score >= lookahead*knob::sandbox_num_access_in_phase)
 			{
-				uint64_t addr = generate_address(page, offset, offset_list[index]->offset, lookahead);
+				uint64_t addr = generate_address(page, offset, offset_list[index].offset, lookahead);
 				if(addr != 0xdeadbeef)
 				{
 					pref_addr.push_back(addr);
 					count++;
-					record_pref_stats(offset_list[index]->offset, 1);
+					record_pref_stats(offset_list[index].offset, 1);
 				}
 			}
 		}
@@ -248,14 +251,6 @@ void SandboxPrefetcher::generate_prefetch(vector<Score*> offset_list, uint32_t p
 	}
 }
 
-void SandboxPrefetcher::destroy_offset_list(vector<Score*> offset_list)
-{
-	for(uint32_t index = 0; index < offset_list.size(); ++index)
-	{
-		delete offset_list[index];
-	}
-}
-
 uint64_t SandboxPrefetcher::generate_address(uint64_t page, uint32_t offset, int32_t delta, uint32_t lookahead)
 {
 	int32_t pref_offset = offset + delta * lookahead;
@@ -272,7 +267,7 @@ uint64_t SandboxPrefetcher::generate_address(uint64_t page, uint32_t offset, int
 void SandboxPrefetcher::end_of_round()
 {
 	/* sort evaluated offset list based on score */
-	std::sort(evaluated_offsets.begin(), evaluated_offsets.end(), [](Score *score1, Score *score2){return score1->score > score2->score;});
+	std::sort(evaluated_offsets.begin(), evaluated_offsets.end(), [](const Score &score1, const Score &score2){return score1.score > score2.score;});
 
 	/* cycle-out n lowest performing offsets */
 	for(uint32_t count = 0; count < knob::sandbox_num_cycle_offsets; ++count)
@@ -281,10 +276,8 @@ void SandboxPrefetcher::end_of_round()
 		{
 			break;
 		}
-		Score *score = evaluated_offsets.back();
+		non_evaluated_offsets.push_back(evaluated_offsets.back().offset);
 		evaluated_offsets.pop_back();
-		non_evaluated_offsets.push_back(score->offset);
-		delete score;
 	}
 
 	/* cycle-in next n non_evaluated_offsets */
@@ -292,14 +285,14 @@ void SandboxPrefetcher::end_of_round()
 	{
 		int32_t offset = non_evaluated_offsets.front();
 		non_evaluated_offsets.pop_front();
-		Score *score = new Score(offset);
-		evaluated_offsets.push_back(score);
+		evaluated_offsets.push_back(Score(offset));
 	}
 }
 
 void SandboxPrefetcher::filter_add(uint64_t address)
 {
 	bf->add(address);
+	filter_adds.push_back(address);
 }
 
 bool SandboxPrefetcher::filter_lookup(uint64_t address)
@@ -313,35 +306,62 @@ void SandboxPrefetcher::record_pref_stats(int32_t offset, uint32_t pref_count)
 	stats.pref_delta_dist[index] += pref_count;
 }
 
-void SandboxPrefetcher::dump_stats()
+void SandboxPrefetcher::register_stats(string section)
 {
-	cout << "sandbox_called " << stats.called << endl
-		<< "sandbox_step1_filter_lookup " << stats.step1.filter_lookup << endl
-		<< "sandbox_step1_filter_hit " << stats.step1.filter_hit << endl
-		<< "sandbox_step2_filter_add " << stats.step2.filter_add << endl
-		<< "sandbox_step3_end_of_phase " << stats.step3.end_of_phase << endl
-		<< "sandbox_step3_end_of_round " << stats.step3.end_of_round << endl
-		<< "sandbox_step4_pref_generated " << stats.step4.pref_generated << endl
-		<< "sandbox_step4_pref_generated_pos " << stats.step4.pref_generated_pos << endl
-		<< "sandbox_step4_pref_generated_neg " << stats.step4.pref_generated_neg << endl
-		<< endl;
-
-	for(uint32_t index = 0; index < 128; ++index)
-	{
-		if(!stats.pref_delta_dist[index])
+	stats_section = section;
+	stats_registry.section(section);
+	stats_registry.counter("sandbox_called", &stats.called);
+	stats_registry.counter("sandbox_step1_filter_lookup", &stats.step1.filter_lookup);
+	stats_registry.counter("sandbox_step1_filter_hit", &stats.step1.filter_hit);
+	stats_registry.counter("sandbox_step2_filter_add", &stats.step2.filter_add);
+	stats_registry.counter("sandbox_step3_end_of_phase", &stats.step3.end_of_phase);
+	stats_registry.counter("sandbox_step3_end_of_round", &stats.step3.end_of_round);
+	stats_registry.counter("sandbox_step4_pref_generated", &stats.step4.pref_generated);
+	stats_registry.counter("sandbox_step4_pref_generated_pos", &stats.step4.pref_generated_pos);
+	stats_registry.counter("sandbox_step4_pref_generated_neg", &stats.step4.pref_generated_neg);
+	stats_registry.blank();
+	/* nonzero offsets only */
+	stats_registry.values("sandbox_offset", [this]() {
+		STATS::VALUES values;
+		for(uint32_t index = 0; index < 128; ++index)
 		{
-			continue;
-		}
-		cout << "sandbox_offset_";
-		if(index >= 64)
-		{
-			cout << (int32_t)(64 - index);
-		}
-		else
-		{
-			cout << index;
+			if(!stats.pref_delta_dist[index])
+			{
+				continue;
+			}
+			int32_t offset = (index >= 64) ? (int32_t)(64 - index) : (int32_t)index;
+			values.push_back(make_pair("sandbox_offset_" + to_string(offset), stats.pref_delta_dist[index]));
 		}
-		cout << " " << stats.pref_delta_dist[index] << endl;
+		return values;
+	});
+	stats_registry.blank();
+}
+
+void SandboxPrefetcher::dump_stats()
+{
+	stats_registry.print(stats_section, cout);
+}
+void SandboxPrefetcher::save(CHECKPOINT &cp)
+{
+	checkpoint(cp);
+}
+
+void SandboxPrefetcher::load(CHECKPOINT &cp)
+{
+	checkpoint(cp);
+	bf->clear();
+	for(uint32_t index = 0; index < filter_adds.size(); ++index)
+	{
+		bf->add(filter_adds[index]);
 	}
-	cout << endl;
-}
\ No newline at end of file
+}
+
+/* walks the offsets, the running phase and the stats in the same order for save and restore */
+void SandboxPrefetcher::checkpoint(CHECKPOINT &cp)
+{
+	cp.vector_entries(evaluated_offsets);
+	cp.deque_entries(non_evaluated_offsets);
+	cp.scalar(eval);
+	cp.vector_entries(filter_adds);
+	cp.scalar(stats);
+}
@@ -1,10 +1,13 @@
 #include <assert.h>
 #include <algorithm>
 #include <iomanip>
+#include <sstream>
 #include "champsim.h"
 #include "cache.h"
+#include "checkpoint.h"
 #include "memory_class.h"
 #include "scooby.h"
+#include "stats.h"
 #include "util.h"
 
 #if 0
@@ -95,6 +98,9 @@ namespace knob
 	extern uint32_t le_action_trace_interval;
 	extern std::string le_action_trace_name;
 	extern bool     le_enable_action_plot;
+	extern bool     le_enable_fixed_point;
+	extern uint32_t le_fixed_point_int_bits;
+	extern uint32_t le_fixed_point_frac_bits;
 
 	/* Featurewise Engine knobs */
 	extern vector<int32_t> 	le_featurewise_active_features;
@@ -153,11 +159,14 @@ void Scooby::init_stats()
 	state_action_dist.clear();
 }
 
-Scooby::Scooby(string type) : Prefetcher(type)
+Scooby::Scooby(string type) : Prefetcher(type), last_evicted(0xdeadbeef, NULL, 0)
 {
 	init_knobs();
 	init_stats();
 
+	signature_table.init(knob::scooby_st_size, true);
+	prefetch_tracker.init(knob::scooby_pt_size, true);
+
 	recorder = new ScoobyRecorder();
 
 	last_evicted_tracker = NULL;
@@ -266,6 +275,9 @@ void Scooby::print_config()
 		<< "le_action_trace_interval " << knob::le_action_trace_interval << endl
 		<< "le_action_trace_name " << knob::le_action_trace_name << endl
 		<< "le_enable_action_plot " << knob::le_enable_action_plot << endl
+		<< "le_enable_fixed_point " << knob::le_enable_fixed_point << endl
+		<< "le_fixed_point_int_bits " << knob::le_fixed_point_int_bits << endl
+		<< "le_fixed_point_frac_bits " << knob::le_fixed_point_frac_bits << endl
 		<< endl
 		<< "le_featurewise_active_features " << print_active_features2(knob::le_featurewise_active_features) << endl
 		<< "le_featurewise_num_tilings " << array_to_string(knob::le_featurewise_num_tilings) << endl
@@ -346,15 +358,12 @@ void Scooby::update_global_state(uint64_t pc, uint64_t page, uint32_t offset, ui
 Scooby_STEntry* Scooby::update_local_state(uint64_t pc, uint64_t page, uint32_t offset, uint64_t address)
 {
 	stats.st.lookup++;
-	Scooby_STEntry *stentry = NULL;
-	auto st_index = find_if(signature_table.begin(), signature_table.end(), [page](Scooby_STEntry *stentry){return stentry->page == page;});
-	if(st_index != signature_table.end())
+	Scooby_STEntry *stentry = signature_table.find(page);
+	if(stentry)
 	{
 		stats.st.hit++;
-		stentry = (*st_index);
 		stentry->update(page, pc, offset, address);
-		signature_table.erase(st_index);
-		signature_table.push_back(stentry);
+		signature_table.move_to_back(stentry);
 		return stentry;
 	}
 	else
@@ -363,7 +372,6 @@ Scooby_STEntry* Scooby::update_local_state(uint64_t pc, uint64_t page, uint32_t
 		{
 			stats.st.evict++;
 			stentry = signature_table.front();
-			signature_table.pop_front();
 			if(knob::scooby_access_debug)
 			{
 				recorder->record_access_knowledge(stentry);
@@ -372,13 +380,13 @@ Scooby_STEntry* Scooby::update_local_state(uint64_t pc, uint64_t page, uint32_t
 					print_access_debug(stentry);
 				}
 			}
-			delete stentry;
+			signature_table.pop_front();
 		}
 
 		stats.st.insert++;
-		stentry = new Scooby_STEntry(page, pc, offset);
+		stentry = signature_table.emplace_back(page, pc, offset);
+		signature_table.set_key(stentry, page);
 		recorder->record_trigger_access(page, pc, offset);
-		signature_table.push_back(stentry);
 		return stentry;
 	}
 }
@@ -499,16 +507,7 @@ bool Scooby::track(uint64_t address, State *state, uint32_t action_index, Scooby
 	MYLOG("addr@%lx state %x act_idx %u act %d", address, state->value(), action_index, Actions[action_index]);
 	stats.track.called++;
 
-	bool new_addr = true;
-	vector<Scooby_PTEntry*> ptentries = search_pt(address, false);
-	if(ptentries.empty())
-	{
-		new_addr = true;
-	}
-	else
-	{
-		new_addr = false;
-	}
+	bool new_addr = (prefetch_tracker.find(address) == NULL);
 
 	if(!new_addr && address != 0xdeadbeef && !knob::scooby_enable_track_multiple)
 	{
@@ -524,7 +523,6 @@ bool Scooby::track(uint64_t address, State *state, uint32_t action_index, Scooby
 	{
 		stats.track.evict++;
 		ptentry = prefetch_tracker.front();
-		prefetch_tracker.pop_front();
 		MYLOG("victim_state %x victim_act_idx %u victim_act %d", ptentry->state->value(), ptentry->action_index, Actions[ptentry->action_index]);
 		if(last_evicted_tracker)
 		{
@@ -532,13 +530,14 @@ bool Scooby::track(uint64_t address, State *state, uint32_t action_index, Scooby
 			/* train the agent */
 			train(ptentry, last_evicted_tracker);
 			delete last_evicted_tracker->state;
-			delete last_evicted_tracker;
 		}
-		last_evicted_tracker = ptentry;
+		last_evicted = *ptentry;
+		last_evicted_tracker = &last_evicted;
+		prefetch_tracker.pop_front();
 	}
 
-	ptentry = new Scooby_PTEntry(address, state, action_index);
-	prefetch_tracker.push_back(ptentry);
+	ptentry = prefetch_tracker.emplace_back(address, state, action_index);
+	prefetch_tracker.set_key(ptentry, address);
 	assert(prefetch_tracker.size() <= knob::scooby_pt_size);
 
 	(*tracker) = ptentry;
@@ -576,11 +575,11 @@ uint32_t Scooby::get_dyn_pref_degree(float max_to_avg_q_ratio, uint64_t page, in
 
 	if(knob::scooby_multi_deg_select_type == 2)
 	{
-		auto st_index = find_if(signature_table.begin(), signature_table.end(), [page](Scooby_STEntry *stentry){return stentry->page == page;});
-		if(st_index != signature_table.end())
+		Scooby_STEntry *stentry = signature_table.find(page);
+		if(stentry)
 		{
 			int32_t conf = 0;
-			bool found = (*st_index)->search_action_tracker(action, conf);
+			bool found = stentry->search_action_tracker(action, conf);
 			vector<int32_t> conf_thresholds, deg_afterburning, deg_normal;
 
 			conf_thresholds = is_high_bw() ? knob::scooby_last_pref_offset_conf_thresholds_hbw : knob::scooby_last_pref_offset_conf_thresholds;
@@ -824,14 +823,12 @@ void Scooby::register_prefetch_hit(uint64_t address)
 
 vector<Scooby_PTEntry*> Scooby::search_pt(uint64_t address, bool search_all)
 {
+	/* trackers of one address are chained oldest first, as a FIFO scan would find them */
 	vector<Scooby_PTEntry*> entries;
-	for(uint32_t index = 0; index < prefetch_tracker.size(); ++index)
+	for(Scooby_PTEntry *ptentry = prefetch_tracker.find(address); ptentry; ptentry = prefetch_tracker.next_with_key(ptentry))
 	{
-		if(prefetch_tracker[index]->address == address)
-		{
-			entries.push_back(prefetch_tracker[index]);
-			if(!search_all) break;
-		}
+		entries.push_back(ptentry);
+		if(!search_all) break;
 	}
 	return entries;
 }
@@ -892,10 +889,10 @@ int32_t Scooby::getAction(uint32_t action_index)
 
 void Scooby::track_in_st(uint64_t page, uint32_t pred_offset, int32_t pref_offset)
 {
-	auto st_index = find_if(signature_table.begin(), signature_table.end(), [page](Scooby_STEntry *stentry){return stentry->page == page;});
-	if(st_index != signature_table.end())
+	Scooby_STEntry *stentry = signature_table.find(page);
+	if(stentry)
 	{
-		(*st_index)->track_prefetch(pred_offset, pref_offset);
+		stentry->track_prefetch(pred_offset, pref_offset);
 	}
 }
 
@@ -928,151 +925,164 @@ bool Scooby::is_high_bw()
 	return bw_level >= knob::scooby_high_bw_thresh ? true : false;
 }
 
-void Scooby::dump_stats()
+void Scooby::register_stats(string section)
 {
-	cout << "scooby_st_lookup " << stats.st.lookup << endl
-		<< "scooby_st_hit " << stats.st.hit << endl
-		<< "scooby_st_evict " << stats.st.evict << endl
-		<< "scooby_st_insert " << stats.st.insert << endl
-		<< "scooby_st_streaming " << stats.st.streaming << endl
-		<< endl
-
-		<< "scooby_predict_called " << stats.predict.called << endl
-		// << "scooby_predict_shaggy_called " << stats.predict.shaggy_called << endl
-		<< "scooby_predict_out_of_bounds " << stats.predict.out_of_bounds << endl;
-
+	stats_section = section;
+	stats_registry.section(section);
+	stats_registry.counter("scooby_st_lookup", &stats.st.lookup);
+	stats_registry.counter("scooby_st_hit", &stats.st.hit);
+	stats_registry.counter("scooby_st_evict", &stats.st.evict);
+	stats_registry.counter("scooby_st_insert", &stats.st.insert);
+	stats_registry.counter("scooby_st_streaming", &stats.st.streaming);
+	stats_registry.blank();
+
+	stats_registry.counter("scooby_predict_called", &stats.predict.called);
+	stats_registry.counter("scooby_predict_out_of_bounds", &stats.predict.out_of_bounds);
 	for(uint32_t index = 0; index < Actions.size(); ++index)
 	{
-		cout << "scooby_predict_action_" << Actions[index] << " " << stats.predict.action_dist[index] << endl;
-		cout << "scooby_predict_issue_action_" << Actions[index] << " " << stats.predict.issue_dist[index] << endl;
-		cout << "scooby_predict_hit_action_" << Actions[index] << " " << stats.predict.pred_hit[index] << endl;
-		cout << "scooby_predict_out_of_bounds_action_" << Actions[index] << " " << stats.predict.out_of_bounds_dist[index] << endl;
+		string action = to_string(Actions[index]);
+		stats_registry.counter("scooby_predict_action_" + action, &stats.predict.action_dist[index]);
+		stats_registry.counter("scooby_predict_issue_action_" + action, &stats.predict.issue_dist[index]);
+		stats_registry.counter("scooby_predict_hit_action_" + action, &stats.predict.pred_hit[index]);
+		stats_registry.counter("scooby_predict_out_of_bounds_action_" + action, &stats.predict.out_of_bounds_dist[index]);
 	}
-
-	cout << "scooby_predict_multi_deg_called " << stats.predict.multi_deg_called << endl
-		<< "scooby_predict_predicted " << stats.predict.predicted << endl
-		<< "scooby_predict_multi_deg " << stats.predict.multi_deg << endl;
+	stats_registry.counter("scooby_predict_multi_deg_called", &stats.predict.multi_deg_called);
+	stats_registry.counter("scooby_predict_predicted", &stats.predict.predicted);
+	stats_registry.counter("scooby_predict_multi_deg", &stats.predict.multi_deg);
 	for(uint32_t index = 2; index <= MAX_SCOOBY_DEGREE; ++index)
 	{
-		cout << "scooby_predict_multi_deg_" << index << " " << stats.predict.multi_deg_histogram[index] << endl;
+		stats_registry.counter("scooby_predict_multi_deg_" + to_string(index), &stats.predict.multi_deg_histogram[index]);
 	}
-	cout << endl;
+	stats_registry.blank();
 	for(uint32_t index = 1; index <= MAX_SCOOBY_DEGREE; ++index)
 	{
-		cout << "scooby_selected_deg_" << index << " " << stats.predict.deg_histogram[index] << endl;
+		stats_registry.counter("scooby_selected_deg_" + to_string(index), &stats.predict.deg_histogram[index]);
 	}
-	cout << endl;
+	stats_registry.blank();
 
+	/* per-state action distribution, most visited state first for the featurewise engine */
 	if(knob::scooby_enable_state_action_stats)
 	{
-		if(knob::scooby_enable_featurewise_engine)
-		{
-			std::vector<std::pair<string, vector<uint64_t> > > pairs;
-			for (auto itr = state_action_dist2.begin(); itr != state_action_dist2.end(); ++itr)
-			    pairs.push_back(*itr);
-			sort(pairs.begin(), pairs.end(), [](std::pair<string, vector<uint64_t>>& a, std::pair<string, vector<uint64_t>>& b){return a.second[knob::scooby_max_actions] > b.second[knob::scooby_max_actions];});
-			for(auto it = pairs.begin(); it != pairs.end(); ++it)
+		stats_registry.rows("scooby_state", [this]() {
+			STATS::ROWS rows;
+			if(knob::scooby_enable_featurewise_engine)
 			{
-				cout << "scooby_state_" << hex << it->first << dec << " ";
-				for(uint32_t index = 0; index < it->second.size(); ++index)
+				std::vector<std::pair<string, vector<uint64_t> > > pairs(state_action_dist2.begin(), state_action_dist2.end());
+				sort(pairs.begin(), pairs.end(), [](std::pair<string, vector<uint64_t>>& a, std::pair<string, vector<uint64_t>>& b){return a.second[knob::scooby_max_actions] > b.second[knob::scooby_max_actions];});
+				for(auto it = pairs.begin(); it != pairs.end(); ++it)
 				{
-					cout << it->second[index] << ",";
+					rows.push_back(make_pair("scooby_state_" + it->first, it->second));
 				}
-				cout << endl;
 			}
-		}
-		else
-		{
-			for(auto it = state_action_dist.begin(); it != state_action_dist.end(); ++it)
+			else
 			{
-				cout << "scooby_state_" << hex << it->first << dec << " ";
-				for(uint32_t index = 0; index < it->second.size(); ++index)
+				for(auto it = state_action_dist.begin(); it != state_action_dist.end(); ++it)
 				{
-					cout << it->second[index] << ",";
+					stringstream name;
+					name << "scooby_state_" << hex << it->first;
+					rows.push_back(make_pair(name.str(), it->second));
 				}
-				cout << endl;
 			}
-		}
+			return rows;
+		});
 	}
-	cout << endl;
+	stats_registry.blank();
 
-	for(auto it = action_deg_dist.begin(); it != action_deg_dist.end(); ++it)
-	{
-		cout << "scooby_action_" << it->first << "_deg_dist ";
-		for(uint32_t index = 0; index < MAX_SCOOBY_DEGREE; ++index)
+	stats_registry.rows("scooby_action_deg_dist", [this]() {
+		STATS::ROWS rows;
+		for(auto it = action_deg_dist.begin(); it != action_deg_dist.end(); ++it)
 		{
-			cout << it->second[index] << ",";
+			rows.push_back(make_pair("scooby_action_" + to_string(it->first) + "_deg_dist", it->second));
 		}
-		cout << endl;
-	}
-	cout << endl;
-
-	cout << "scooby_track_called " << stats.track.called << endl
-		<< "scooby_track_same_address " << stats.track.same_address << endl
-		<< "scooby_track_evict " << stats.track.evict << endl
-		<< endl
-
-		<< "scooby_reward_demand_called " << stats.reward.demand.called << endl
-		<< "scooby_reward_demand_pt_not_found " << stats.reward.demand.pt_not_found << endl
-		<< "scooby_reward_demand_pt_found " << stats.reward.demand.pt_found << endl
-		<< "scooby_reward_demand_pt_found_total " << stats.reward.demand.pt_found_total << endl
-		<< "scooby_reward_demand_has_reward " << stats.reward.demand.has_reward << endl
-		<< "scooby_reward_train_called " << stats.reward.train.called << endl
-		<< "scooby_reward_assign_reward_called " << stats.reward.assign_reward.called << endl
-		<< "scooby_reward_no_pref " << stats.reward.no_pref << endl
-		<< "scooby_reward_incorrect " << stats.reward.incorrect << endl
-		<< "scooby_reward_correct_untimely " << stats.reward.correct_untimely << endl
-		<< "scooby_reward_correct_timely " << stats.reward.correct_timely << endl
-		<< "scooby_reward_out_of_bounds " << stats.reward.out_of_bounds << endl
-		<< "scooby_reward_tracker_hit " << stats.reward.tracker_hit << endl
-		<< endl;
+		return rows;
+	});
+	stats_registry.blank();
+
+	stats_registry.counter("scooby_track_called", &stats.track.called);
+	stats_registry.counter("scooby_track_same_address", &stats.track.same_address);
+	stats_registry.counter("scooby_track_evict", &stats.track.evict);
+	stats_registry.blank();
+
+	stats_registry.counter("scooby_reward_demand_called", &stats.reward.demand.called);
+	stats_registry.counter("scooby_reward_demand_pt_not_found", &stats.reward.demand.pt_not_found);
+	stats_registry.counter("scooby_reward_demand_pt_found", &stats.reward.demand.pt_found);
+	stats_registry.counter("scooby_reward_demand_pt_found_total", &stats.reward.demand.pt_found_total);
+	stats_registry.counter("scooby_reward_demand_has_reward", &stats.reward.demand.has_reward);
+	stats_registry.counter("scooby_reward_train_called", &stats.reward.train.called);
+	stats_registry.counter("scooby_reward_assign_reward_called", &stats.reward.assign_reward.called);
+	stats_registry.counter("scooby_reward_no_pref", &stats.reward.no_pref);
+	stats_registry.counter("scooby_reward_incorrect", &stats.reward.incorrect);
+	stats_registry.counter("scooby_reward_correct_untimely", &stats.reward.correct_untimely);
+	stats_registry.counter("scooby_reward_correct_timely", &stats.reward.correct_timely);
+	stats_registry.counter("scooby_reward_out_of_bounds", &stats.reward.out_of_bounds);
+	stats_registry.counter("scooby_reward_tracker_hit", &stats.reward.tracker_hit);
+	stats_registry.blank();
 
 	for(uint32_t reward = 0; reward < RewardType::num_rewards; ++reward)
 	{
-		cout << "scooby_reward_" << getRewardTypeString((RewardType)reward) << "_low_bw " << stats.reward.compute_reward.dist[reward][0] << endl
-			<< "scooby_reward_" << getRewardTypeString((RewardType)reward) << "_high_bw " << stats.reward.compute_reward.dist[reward][1] << endl;
+		string name = string("scooby_reward_") + getRewardTypeString((RewardType)reward);
+		stats_registry.counter(name + "_low_bw", &stats.reward.compute_reward.dist[reward][0]);
+		stats_registry.counter(name + "_high_bw", &stats.reward.compute_reward.dist[reward][1]);
 	}
-	cout << endl;
+	stats_registry.blank();
 
 	for(uint32_t action = 0; action < Actions.size(); ++action)
 	{
-		cout << "scooby_reward_" << Actions[action] << " ";
-		for(uint32_t reward = 0; reward < RewardType::num_rewards; ++reward)
-		{
-			cout << stats.reward.dist[action][reward] << ",";
-		}
-		cout << endl;
+		stats_registry.row("scooby_reward_" + to_string(Actions[action]), stats.reward.dist[action], RewardType::num_rewards);
 	}
+	stats_registry.blank();
 
+	stats_registry.counter("scooby_train_called", &stats.train.called);
+	stats_registry.counter("scooby_train_compute_reward", &stats.train.compute_reward);
+	stats_registry.blank();
 
-	cout << endl
-		<< "scooby_train_called " << stats.train.called << endl
-		<< "scooby_train_compute_reward " << stats.train.compute_reward << endl
-		<< endl
+	stats_registry.counter("scooby_register_fill_called", &stats.register_fill.called);
+	stats_registry.counter("scooby_register_fill_set", &stats.register_fill.set);
+	stats_registry.counter("scooby_register_fill_set_total", &stats.register_fill.set_total);
+	stats_registry.blank();
 
-		<< "scooby_register_fill_called " << stats.register_fill.called << endl
-		<< "scooby_register_fill_set " << stats.register_fill.set << endl
-		<< "scooby_register_fill_set_total " << stats.register_fill.set_total << endl
-		<< endl
+	stats_registry.counter("scooby_register_prefetch_hit_called", &stats.register_prefetch_hit.called);
+	stats_registry.counter("scooby_register_prefetch_hit_set", &stats.register_prefetch_hit.set);
+	stats_registry.counter("scooby_register_prefetch_hit_set_total", &stats.register_prefetch_hit.set_total);
+	stats_registry.blank();
 
-		<< "scooby_register_prefetch_hit_called " << stats.register_prefetch_hit.called << endl
-		<< "scooby_register_prefetch_hit_set " << stats.register_prefetch_hit.set << endl
-		<< "scooby_register_prefetch_hit_set_total " << stats.register_prefetch_hit.set_total << endl
-		<< endl
+	stats_registry.counter("scooby_pref_issue_scooby", &stats.pref_issue.scooby);
+	stats_registry.blank();
 
-		<< "scooby_pref_issue_scooby " << stats.pref_issue.scooby << endl
-		// << "scooby_pref_issue_shaggy " << stats.pref_issue.shaggy << endl
-		<< endl;
+	stats_registry.values("scooby_target_action_state", [this]() {
+		STATS::VALUES values(target_action_state.begin(), target_action_state.end());
+		sort(values.begin(), values.end(), [](std::pair<string, uint64_t>& a, std::pair<string, uint64_t>& b){return a.second > b.second;});
+		return values;
+	});
 
-	std::vector<std::pair<string, uint64_t>> pairs;
-	for (auto itr = target_action_state.begin(); itr != target_action_state.end(); ++itr)
-	    pairs.push_back(*itr);
-	sort(pairs.begin(), pairs.end(), [](std::pair<string, uint64_t>& a, std::pair<string, uint64_t>& b){return a.second > b.second;});
-	for(auto it = pairs.begin(); it != pairs.end(); ++it)
+	if(brain_featurewise)
+	{
+		brain_featurewise->register_stats();
+	}
+	if(brain)
 	{
-		cout << it->first << "," << it->second << endl;
+		brain->register_stats();
 	}
+	recorder->register_stats();
 
+	stats_registry.counter("scooby_bw_epochs", &stats.bandwidth.epochs);
+	stats_registry.histogram("scooby_bw_level", stats.bandwidth.histogram, DRAM_BW_LEVELS);
+	stats_registry.blank();
+
+	stats_registry.counter("scooby_ipc_epochs", &stats.ipc.epochs);
+	stats_registry.histogram("scooby_ipc_level", stats.ipc.histogram, SCOOBY_MAX_IPC_LEVEL);
+	stats_registry.blank();
+
+	stats_registry.counter("scooby_cache_acc_epochs", &stats.cache_acc.epochs);
+	stats_registry.histogram("scooby_cache_acc_level", stats.cache_acc.histogram, CACHE_ACC_LEVELS);
+	stats_registry.blank();
+}
+
+void Scooby::dump_stats()
+{
+	stats_registry.print(stats_section, cout);
+
+	/* score plots of the engine traces */
 	if(brain_featurewise)
 	{
 		brain_featurewise->dump_stats();
@@ -1081,26 +1091,138 @@ void Scooby::dump_stats()
 	{
 		brain->dump_stats();
 	}
-	recorder->dump_stats();
+}
+
+template <typename K> static void checkpoint_key(CHECKPOINT &cp, K &key) { cp.scalar(key); }
+static void checkpoint_key(CHECKPOINT &cp, std::string &key) { cp.str(key); }
+
+template <typename K> static void checkpoint_dist(CHECKPOINT &cp, unordered_map<K, vector<uint64_t> > &dist)
+{
+	uint64_t num_keys = dist.size();
+	cp.scalar(num_keys);
+	cp.buckets(dist);
+	if(cp.saving())
+	{
+		auto order = cp.back_to_front(dist);
+		for(auto it = order.begin(); it != order.end(); ++it)
+		{
+			K key = (*it)->first;
+			checkpoint_key(cp, key);
+			cp.vector_entries((*it)->second);
+		}
+	}
+	else
+	{
+		for(uint64_t index = 0; index < num_keys; ++index)
+		{
+			K key;
+			checkpoint_key(cp, key);
+			cp.vector_entries(dist[key]);
+		}
+	}
+}
+
+void Scooby::save(CHECKPOINT &cp)
+{
+	checkpoint(cp);
+}
+
+void Scooby::load(CHECKPOINT &cp)
+{
+	checkpoint(cp);
+}
+
+/* the trackers own their states, so a restored tracker gets its own copy
+ * even where the saved trackers of one prediction shared a single state */
+void Scooby::checkpoint(CHECKPOINT &cp)
+{
+	uint64_t num_entries = signature_table.size();
+	cp.scalar(num_entries);
+	if(cp.saving())
+	{
+		for(auto it = signature_table.begin(); it != signature_table.end(); ++it)
+		{
+			it->checkpoint(cp);
+		}
+	}
+	else
+	{
+		signature_table.clear();
+		for(uint64_t index = 0; index < num_entries; ++index)
+		{
+			Scooby_STEntry *stentry = signature_table.emplace_back(0, 0, 0);
+			stentry->checkpoint(cp);
+			signature_table.set_key(stentry, stentry->page);
+		}
+	}
 
-	cout << "scooby_bw_epochs " << stats.bandwidth.epochs << endl;
-	for(uint32_t index = 0; index < DRAM_BW_LEVELS; ++index)
+	num_entries = prefetch_tracker.size();
+	cp.scalar(num_entries);
+	if(cp.saving())
 	{
-		cout << "scooby_bw_level_" << index << " " << stats.bandwidth.histogram[index] << endl;
+		for(auto it = prefetch_tracker.begin(); it != prefetch_tracker.end(); ++it)
+		{
+			it->checkpoint(cp);
+		}
+	}
+	else
+	{
+		prefetch_tracker.clear();
+		for(uint64_t index = 0; index < num_entries; ++index)
+		{
+			Scooby_PTEntry *ptentry = prefetch_tracker.emplace_back(0xdeadbeef, (State*)NULL, 0);
+			ptentry->checkpoint(cp);
+			prefetch_tracker.set_key(ptentry, ptentry->address);
+		}
 	}
-	cout << endl;
 
-	cout << "scooby_ipc_epochs " << stats.ipc.epochs << endl;
-	for(uint32_t index = 0; index < SCOOBY_MAX_IPC_LEVEL; ++index)
+	bool has_last_evicted = (last_evicted_tracker != NULL);
+	cp.scalar(has_last_evicted);
+	if(has_last_evicted)
 	{
-		cout << "scooby_ipc_level_" << index << " " << stats.ipc.histogram[index] << endl;
+		last_evicted.checkpoint(cp);
+		last_evicted_tracker = &last_evicted;
 	}
-	cout << endl;
 
-	cout << "scooby_cache_acc_epochs " << stats.cache_acc.epochs << endl;
-	for(uint32_t index = 0; index < CACHE_ACC_LEVELS; ++index)
+	cp.scalar(bw_level);
+	cp.scalar(core_ipc);
+	cp.scalar(acc_level);
+
+	cp.scalar(stats.st);
+	cp.scalar(stats.predict.called);
+	cp.scalar(stats.predict.out_of_bounds);
+	cp.vector_entries(stats.predict.action_dist);
+	cp.vector_entries(stats.predict.issue_dist);
+	cp.vector_entries(stats.predict.pred_hit);
+	cp.vector_entries(stats.predict.out_of_bounds_dist);
+	cp.scalar(stats.predict.predicted);
+	cp.scalar(stats.predict.multi_deg);
+	cp.scalar(stats.predict.multi_deg_called);
+	cp.array(stats.predict.multi_deg_histogram, MAX_SCOOBY_DEGREE+1);
+	cp.array(stats.predict.deg_histogram, MAX_SCOOBY_DEGREE+1);
+	cp.scalar(stats.track);
+	cp.scalar(stats.reward);
+	cp.scalar(stats.train);
+	cp.scalar(stats.register_fill);
+	cp.scalar(stats.register_prefetch_hit);
+	cp.scalar(stats.pref_issue);
+	cp.scalar(stats.bandwidth);
+	cp.scalar(stats.ipc);
+	cp.scalar(stats.cache_acc);
+
+	checkpoint_dist(cp, state_action_dist);
+	checkpoint_dist(cp, state_action_dist2);
+	checkpoint_dist(cp, action_deg_dist);
+
+	recorder->checkpoint(cp);
+
+	cp.check(knob::scooby_enable_featurewise_engine, "scooby featurewise engine");
+	if(brain_featurewise)
+	{
+		brain_featurewise->checkpoint(cp);
+	}
+	if(brain)
 	{
-		cout << "scooby_cache_acc_level_" << index << " " << stats.cache_acc.histogram[index] << endl;
+		brain->checkpoint(cp);
 	}
-	cout << endl;
 }
@@ -4,7 +4,9 @@
 #include <iomanip>
 #include <sstream>
 #include "champsim.h"
+#include "checkpoint.h"
 #include "scooby_helper.h"
+#include "stats.h"
 #include "util.h"
 #include "feature_knowledge.h"
 
@@ -362,6 +364,71 @@ bool Scooby_STEntry::search_action_tracker(int32_t action, int32_t &conf)
 	}
 }
 
+void Scooby_STEntry::checkpoint(CHECKPOINT &cp)
+{
+	cp.scalar(page);
+	cp.deque_entries(pcs);
+	cp.deque_entries(offsets);
+	cp.deque_entries(deltas);
+	cp.scalar(bmp_real);
+	cp.scalar(bmp_pred);
+	cp.set_entries(unique_pcs);
+	cp.set_entries(unique_deltas);
+	cp.scalar(trigger_pc);
+	cp.scalar(trigger_offset);
+	cp.scalar(streaming);
+
+	uint64_t num_trackers = action_tracker.size();
+	cp.scalar(num_trackers);
+	if(!cp.saving())
+	{
+		for(uint32_t index = 0; index < action_tracker.size(); ++index)
+		{
+			delete action_tracker[index];
+		}
+		action_tracker.clear();
+		for(uint64_t index = 0; index < num_trackers; ++index)
+		{
+			action_tracker.push_back(new ActionTracker(0, 0));
+		}
+	}
+	for(uint64_t index = 0; index < num_trackers; ++index)
+	{
+		cp.scalar(action_tracker[index]->action);
+		cp.scalar(action_tracker[index]->conf);
+	}
+	cp.set_entries(action_with_max_degree);
+	cp.set_entries(afterburning_actions);
+	cp.scalar(total_prefetches);
+}
+
+void Scooby_PTEntry::checkpoint(CHECKPOINT &cp)
+{
+	cp.scalar(address);
+	if(!cp.saving())
+	{
+		state = new State();
+	}
+	cp.scalar(*state);
+	cp.scalar(action_index);
+	cp.scalar(is_filled);
+	cp.scalar(pf_cache_hit);
+	cp.scalar(reward);
+	cp.scalar(reward_type);
+	cp.scalar(has_reward);
+
+	/* vector<bool> is packed, so it goes bit by bit */
+	uint64_t num_features = consensus_vec.size();
+	cp.scalar(num_features);
+	consensus_vec.resize(num_features);
+	for(uint64_t index = 0; index < num_features; ++index)
+	{
+		bool aligned = consensus_vec[index];
+		cp.scalar(aligned);
+		consensus_vec[index] = aligned;
+	}
+}
+
 void ScoobyRecorder::record_access(uint64_t pc, uint64_t address, uint64_t page, uint32_t offset, uint8_t bw_level)
 {
 	unique_pcs.insert(pc);
@@ -422,62 +489,68 @@ void ScoobyRecorder::record_access_knowledge(Scooby_STEntry *stentry)
 	}
 }
 
-void ScoobyRecorder::dump_stats()
+void ScoobyRecorder::checkpoint(CHECKPOINT &cp)
 {
-	cout << "unique_pcs " << unique_pcs.size() << endl
-		<< "unique_pages " << unique_pages.size() << endl
-		<< "unique_trigger_pcs " << unique_trigger_pcs.size() << endl
-		<< "total_bitmaps_seen " << total_bitmaps_seen << endl
-		<< "unique_bitmaps_seen " << unique_bitmaps_seen << endl
-		<< endl;
-
-	/* PC BW distribution */
-	// for(auto it = pc_bw_dist.begin(); it != pc_bw_dist.end(); ++it)
-	// {
-	// 	uint64_t sum = 0;
-	// 	cout << "PC_bw_dist_" << hex << it->first << dec << " ";
-	// 	for(uint32_t index = 0; index < DRAM_BW_LEVELS; ++index)
-	// 	{
-	// 		cout << it->second[index] << ",";
-	// 		sum += it->second[index];
-	// 	}
-	// 	cout << sum << endl;
-	// }
-	// cout << endl;
+	cp.set_entries(unique_pcs);
+	cp.set_entries(unique_trigger_pcs);
+	cp.set_entries(unique_pages);
+	cp.map_entries(access_bitmap_dist);
+	cp.array(&hop_delta_dist[0][0], (MAX_HOP_COUNT+1) * 127);
+	cp.scalar(total_bitmaps_seen);
+	cp.scalar(unique_bitmaps_seen);
+}
+
+void ScoobyRecorder::register_stats()
+{
+	stats_registry.value("unique_pcs", [this]() { return unique_pcs.size(); });
+	stats_registry.value("unique_pages", [this]() { return unique_pages.size(); });
+	stats_registry.value("unique_trigger_pcs", [this]() { return unique_trigger_pcs.size(); });
+	stats_registry.counter("total_bitmaps_seen", &total_bitmaps_seen);
+	stats_registry.counter("unique_bitmaps_seen", &unique_bitmaps_seen);
+	stats_registry.blank();
 
 	if(knob::scooby_access_debug)
 	{
-		std::vector<std::pair<uint64_t, uint64_t>> pairs;
-		for (auto itr = access_bitmap_dist.begin(); itr != access_bitmap_dist.end(); ++itr)
-		    pairs.push_back(*itr);
-
-		sort(pairs.begin(), pairs.end(), [](std::pair<uint64_t, uint64_t>& a, std::pair<uint64_t, uint64_t>& b){return a.second > b.second;});
-
-		cout << "Bitmap, #count" <<endl;
-		uint32_t total_occ = 0, top_20_occ = 0;;
-		for(uint32_t index = 0; index < pairs.size(); ++index)
-		{
-			total_occ += pairs[index].second;
-			if(index < 20)
+		/* the 20 most frequent access bitmaps and their share of all bitmaps */
+		stats_registry.line("Bitmap, #count");
+		stats_registry.values("bitmap_top_20", [this]() {
+			STATS::VALUES pairs;
+			for(auto itr = access_bitmap_dist.begin(); itr != access_bitmap_dist.end(); ++itr)
 			{
-				top_20_occ += pairs[index].second;
-				cout << hex << pairs[index].first << dec << "," << pairs[index].second << endl;
+				stringstream name;
+				name << hex << itr->first;
+				pairs.push_back(make_pair(name.str(), itr->second));
 			}
-		}
-		cout << "top_20_perc " << (float)top_20_occ/total_occ*100 << "%" << endl;
-		cout << std::endl;
+			sort(pairs.begin(), pairs.end(), [](std::pair<string, uint64_t>& a, std::pair<string, uint64_t>& b){return a.second > b.second;});
+			if(pairs.size() > 20)
+			{
+				pairs.resize(20);
+			}
+			return pairs;
+		}, "%s,%lu");
+		stats_registry.ratio("top_20_perc", [this]() {
+			std::vector<uint64_t> counts;
+			for(auto itr = access_bitmap_dist.begin(); itr != access_bitmap_dist.end(); ++itr)
+			{
+				counts.push_back(itr->second);
+			}
+			sort(counts.begin(), counts.end(), std::greater<uint64_t>());
+			uint64_t total_occ = 0, top_20_occ = 0;
+			for(uint32_t index = 0; index < counts.size(); ++index)
+			{
+				total_occ += counts[index];
+				if(index < 20) top_20_occ += counts[index];
+			}
+			return (float)top_20_occ/total_occ*100;
+		}, "%g%%");
+		stats_registry.blank();
 
 		/* delta statistics */
 		for(uint32_t hop = 1; hop <= MAX_HOP_COUNT; ++hop)
 		{
-			cout << "hop_" << hop << "_delta_dist ";
-			for(uint32_t index = 0; index < 127; ++index)
-			{
-				cout << hop_delta_dist[hop][index] << ",";
-			}
-			cout << endl;
+			stats_registry.row("hop_" + to_string(hop) + "_delta_dist", hop_delta_dist[hop], 127);
 		}
-		cout << std::endl;
+		stats_registry.blank();
 	}
 }
 
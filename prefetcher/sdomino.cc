@@ -1,15 +1,70 @@
 #include "cache.h"
 #include "sdomino.h"
+#include "checkpoint.h"
+#include "stats.h"
 
-sdomino::sdomino(string type, CACHE *cache) : Prefetcher(type), parent(cache)
+namespace knob
 {
+    extern uint32_t sdomino_ghb_size;
+    extern uint32_t sdomino_eit_size;
+    extern uint32_t sdomino_eit_ways;
+    extern uint32_t sdomino_eit_slots;
+    extern uint32_t sdomino_degree;
+}
+
+// bits needed to tell n things apart
+static uint32_t sdomino_bits(uint64_t n)
+{
+    uint32_t bits = 0;
+    while ((1ull << bits) < n)
+        bits++;
+    return bits;
+}
+
+sdomino::sdomino(string type, CACHE *cache) : Prefetcher(type),
+                                              GHB(knob::sdomino_ghb_size),
+                                              index_table(knob::sdomino_eit_size, knob::sdomino_eit_ways),
+                                              eit_slots(knob::sdomino_eit_slots), degree(knob::sdomino_degree),
+                                              parent(cache)
+{
+    if (knob::sdomino_ghb_size == 0 || knob::sdomino_eit_ways == 0 || knob::sdomino_eit_size % knob::sdomino_eit_ways
+        || knob::sdomino_eit_slots == 0 || knob::sdomino_eit_slots > SDOMINO_MAX_EIT_SLOTS)
+    {
+        cerr << "*** SDOMINO NEEDS A GHB, AN EIT OF WHOLE SETS AND 1 TO " << SDOMINO_MAX_EIT_SLOTS << " SLOTS PER ENTRY ***" << endl;
+        assert(0);
+    }
+
     last_address = 0;
-    GHB.clear();
-    index_table.clear();
 
     total_access = 0;
     predictions = 0;
     no_prediction = 0;
+    stale_pointer = 0;
+
+    print_config();
+}
+
+void sdomino::print_config()
+{
+    // storage: addresses are block addresses, EIT tags drop their index bits
+    uint32_t address_bits = 64 - LOG2_BLOCK_SIZE;
+    uint32_t pointer_bits = sdomino_bits(knob::sdomino_ghb_size);
+    uint64_t eit_sets = knob::sdomino_eit_size / knob::sdomino_eit_ways;
+    uint64_t slot_bits = address_bits + pointer_bits + sdomino_bits(knob::sdomino_eit_slots);
+    uint64_t eit_entry_bits = 1 + (address_bits - sdomino_bits(eit_sets)) + sdomino_bits(knob::sdomino_eit_ways)
+                              + knob::sdomino_eit_slots * slot_bits;
+    uint64_t ghb_bits = (uint64_t)knob::sdomino_ghb_size * address_bits;
+    uint64_t eit_bits = knob::sdomino_eit_size * eit_entry_bits;
+
+    cout << "sdomino_ghb_size " << knob::sdomino_ghb_size << endl
+         << "sdomino_eit_size " << knob::sdomino_eit_size << endl
+         << "sdomino_eit_ways " << knob::sdomino_eit_ways << endl
+         << "sdomino_eit_slots " << knob::sdomino_eit_slots << endl
+         << "sdomino_degree " << knob::sdomino_degree << endl
+         << "sdomino_ghb_storage_KB " << ghb_bits / 8192.0 << endl
+         << "sdomino_eit_storage_KB " << eit_bits / 8192.0 << endl
+         << "sdomino_total_storage_KB " << (ghb_bits + eit_bits) / 8192.0 << endl
+         << endl;
 }
 
 void sdomino::invoke_prefetcher(uint64_t ip, uint64_t addr, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr)
@@ -30,11 +85,9 @@ void sdomino::invoke_prefetcher(uint64_t ip, uint64_t addr, uint8_t cache_hit, u
     // Predict before training
     vector<uint64_t> candidates = domino_predict(addr_B, last_address);
 
-    int num_prefetched = 0;
-    uint64_t candidates_out;
+    unsigned int num_prefetched = 0;
     for (unsigned int i = 0; i < candidates.size(); i++)
     {
-        candidates_out = candidates[i];
         pref_addr.emplace_back(candidates[i]);
         // int ret = parent->prefetch_line(ip, addr, candidates[i], FILL_L2, 0);
         // if (ret == 1)
@@ -43,7 +96,7 @@ void sdomino::invoke_prefetcher(uint64_t ip, uint64_t addr, uint8_t cache_hit, u
         num_prefetched++;
 
         //}
-        if (num_prefetched >= DEGREE)
+        if (num_prefetched >= degree)
             break;
     }
 
@@ -58,6 +111,40 @@ void sdomino::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t p
 {
 }
 
+void sdomino::register_stats(string section)
+{
+    stats_section = section;
+    stats_registry.section(section);
+    stats_registry.counter("total_access", &total_access);
+    stats_registry.counter("predictions", &predictions);
+    stats_registry.counter("no_prediction", &no_prediction);
+    stats_registry.counter("stale_pointer", &stale_pointer);
+    stats_registry.blank();
+}
+
 void sdomino::dump_stats()
 {
+    stats_registry.print(stats_section, cout);
+}
+
+void sdomino::save(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+void sdomino::load(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+void sdomino::checkpoint(CHECKPOINT &cp)
+{
+    GHB.checkpoint(cp);
+    index_table.checkpoint(cp);
+    cp.check(eit_slots, "sdomino eit slots");
+    cp.scalar(last_address);
+    cp.scalar(total_access);
+    cp.scalar(predictions);
+    cp.scalar(no_prediction);
+    cp.scalar(stale_pointer);
 }
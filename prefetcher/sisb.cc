@@ -1,20 +1,29 @@
 #include "cache.h"
 #include "sisb.h"
-#define DEGREE 2
-// #define DEGREE 4
+#include "checkpoint.h"
 #include <iostream>
 #include <fstream>
 
+namespace knob
+{
+    extern uint32_t sisb_degree;
+    extern bool sisb_bounded;
+    extern uint32_t sisb_tu_size;
+    extern uint32_t sisb_tu_ways;
+    extern uint32_t sisb_cache_size;
+    extern uint32_t sisb_cache_ways;
+    extern string sisb_replacement;
+    extern uint32_t sisb_pc_stats_sample;
+}
+
 void sisb::invoke_prefetcher(uint64_t ip, uint64_t addr, uint8_t cache_hit, uint8_t type, vector<uint64_t> &pref_addr)
 {
-    uint64_t sisb_candidates_out;
     vector<uint64_t> sisb_candidates;
-    sisb_prefetcher_operate(addr, ip, cache_hit, type, DEGREE, sisb_candidates);
+    sisb_prefetcher_operate(addr, ip, cache_hit, type, degree, sisb_candidates);
     for (uint32_t i = 0; i < sisb_candidates.size(); i++)
     {
         // parent->prefetch_line(ip, addr, sisb_candidates[i], FILL_L2, 0);
         pref_addr.emplace_back(sisb_candidates[i]);
-        sisb_candidates_out = sisb_candidates[i];
     }
     return;
 }
@@ -25,12 +34,103 @@ void sisb::register_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t pref
     return;
 }
 
+void sisb::register_stats(string section)
+{
+    stats_section = section;
+    stats_registry.section(section);
+    stats_registry.counter("tu_hit", &tu_hit);
+    stats_registry.counter("tu_miss", &tu_miss);
+    stats_registry.counter("tu_evict", &tu_evict);
+    stats_registry.counter("mapping_train_hit", &train_hit);
+    stats_registry.counter("mapping_train_miss", &train_miss);
+    stats_registry.counter("mapping_predict_hit", &predict_hit);
+    stats_registry.counter("mapping_predict_miss", &predict_miss);
+    stats_registry.counter("mapping_evict", &mapping_evict);
+    stats_registry.counter("divergence", &divergence);
+    stats_registry.blank();
+}
+
 void sisb::dump_stats()
 {
     sisb_prefetcher_final_stats();
 }
 
-sisb::sisb(string type, CACHE *cache) : Prefetcher(type), parent(cache)
+void sisb::print_config()
+{
+    cout << "sisb_degree " << knob::sisb_degree << endl
+         << "sisb_bounded " << knob::sisb_bounded << endl
+         << "sisb_tu_size " << knob::sisb_tu_size << endl
+         << "sisb_tu_ways " << knob::sisb_tu_ways << endl
+         << "sisb_cache_size " << knob::sisb_cache_size << endl
+         << "sisb_cache_ways " << knob::sisb_cache_ways << endl
+         << "sisb_replacement " << knob::sisb_replacement << endl
+         << "sisb_pc_stats_sample " << knob::sisb_pc_stats_sample << endl
+         << endl;
+}
+
+sisb::sisb(string type, CACHE *cache) : Prefetcher(type),
+                                        bounded(knob::sisb_bounded),
+                                        bounded_tu(TableGeometry(knob::sisb_bounded, knob::sisb_tu_size, knob::sisb_tu_ways)),
+                                        bounded_cache(TableGeometry(knob::sisb_bounded, knob::sisb_cache_size, knob::sisb_cache_ways), knob::sisb_replacement == "confidence"),
+                                        degree(knob::sisb_degree),
+                                        pc_stats_sample(knob::sisb_pc_stats_sample),
+                                        parent(cache)
 {
+    if (knob::sisb_replacement != "lru" && knob::sisb_replacement != "confidence")
+    {
+        cerr << "*** UNKNOWN SISB REPLACEMENT POLICY: " << knob::sisb_replacement << " ***" << endl;
+        assert(0);
+    }
+    if (bounded && (knob::sisb_tu_ways == 0 || knob::sisb_tu_size % knob::sisb_tu_ways
+                    || knob::sisb_cache_ways == 0 || knob::sisb_cache_size % knob::sisb_cache_ways))
+    {
+        cerr << "*** SISB TABLES MUST HOLD WHOLE SETS ***" << endl;
+        assert(0);
+    }
     sisb_prefetcher_initialize();
+    print_config();
+}
+
+void sisb::save(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+void sisb::load(CHECKPOINT &cp)
+{
+    checkpoint(cp);
+}
+
+// walks the tables in use, the stats and the sampled pcs in the same order for save and restore
+void sisb::checkpoint(CHECKPOINT &cp)
+{
+    cp.check(bounded, "sisb bounded");
+    if (bounded)
+    {
+        bounded_tu.checkpoint(cp);
+        bounded_cache.checkpoint(cp);
+        cp.scalar(bounded_mappings);
+    }
+    else
+    {
+        cp.map_entries(tu);
+        cp.map_entries(cache);
+    }
+
+    cp.scalar(tu_hit);
+    cp.scalar(tu_miss);
+    cp.scalar(tu_evict);
+    cp.scalar(train_hit);
+    cp.scalar(train_miss);
+    cp.scalar(mapping_evict);
+    cp.scalar(predict_hit);
+    cp.scalar(predict_miss);
+
+    cp.check(pc_stats_sample, "sisb pc stats sample");
+    cp.map_entries(outstanding);
+    cp.map_entries(issued);
+    cp.map_entries(untimely);
+    cp.map_entries(accurate);
+    cp.map_entries(total);
+    cp.scalar(divergence);
 }
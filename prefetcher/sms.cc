@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <iomanip>
 #include "sms.h"
+#include "checkpoint.h"
+#include "stats.h"
 #include "champsim.h"
 
 using namespace std;
@@ -50,9 +52,15 @@ SMSPrefetcher::SMSPrefetcher(string type) : Prefetcher(type)
 	init_stats();
 	print_config();
 
+	filter_table.init(knob::sms_ft_size, true);
+	acc_table.init(knob::sms_at_size, true);
+
 	/* init PHT */
-	deque<PHTEntry*> d;
-	pht.resize(pht_sets, d);
+	pht.resize(pht_sets);
+	for(uint32_t index = 0; index < pht_sets; ++index)
+	{
+		pht[index].init(knob::sms_pht_assoc);
+	}
 }
 
 SMSPrefetcher::~SMSPrefetcher()
@@ -71,26 +79,26 @@ void SMSPrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cac
 	// 	<< " offset " << dec << setw(2) << offset
 	// 	<< endl;
 
-	auto at_index = search_acc_table(page);
+	ATEntry *atentry = search_acc_table(page);
 	stats.at.lookup++;
-	if(at_index != acc_table.end())
+	if(atentry)
 	{
 		/* accumulation table hit */
 		stats.at.hit++;
-		(*at_index)->pattern[offset] = 1;
-		update_age_acc_table(at_index);
+		atentry->pattern[offset] = 1;
+		update_age_acc_table(atentry);
 	}
 	else
 	{
 		/* search filter table */
-		auto ft_index = search_filter_table(page);
+		FTEntry *ftentry = search_filter_table(page);
 		stats.ft.lookup++;
-		if(ft_index != filter_table.end())
+		if(ftentry)
 		{
 			/* filter table hit */
 			stats.ft.hit++;
-			insert_acc_table((*ft_index), offset);
-			evict_filter_table(ft_index);
+			insert_acc_table(ftentry, offset);
+			evict_filter_table(ftentry);
 		}
 		else
 		{
@@ -113,9 +121,9 @@ void SMSPrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cac
 }
 
 /* Functions for Filter table */
-deque<FTEntry*>::iterator SMSPrefetcher::search_filter_table(uint64_t page)
+FTEntry* SMSPrefetcher::search_filter_table(uint64_t page)
 {
-	return find_if(filter_table.begin(), filter_table.end(), [page](FTEntry *ftentry){return (ftentry->page == page);});
+	return filter_table.find(page);
 }
 
 void SMSPrefetcher::insert_filter_table(uint64_t pc, uint64_t page, uint32_t offset)
@@ -128,30 +136,28 @@ void SMSPrefetcher::insert_filter_table(uint64_t pc, uint64_t page, uint32_t off
 		evict_filter_table(victim);
 	}
 
-	ftentry = new FTEntry();
+	ftentry = filter_table.emplace_back();
+	filter_table.set_key(ftentry, page);
 	ftentry->page = page;
 	ftentry->pc = pc;
 	ftentry->trigger_offset = offset;
-	filter_table.push_back(ftentry);
 }
 
-deque<FTEntry*>::iterator SMSPrefetcher::search_victim_filter_table()
+FTEntry* SMSPrefetcher::search_victim_filter_table()
 {
-	return filter_table.begin();
+	return filter_table.front();
 }
 
-void SMSPrefetcher::evict_filter_table(deque<FTEntry*>::iterator victim)
+void SMSPrefetcher::evict_filter_table(FTEntry *victim)
 {
 	stats.ft.evict++;
-	FTEntry *ftentry = (*victim);
 	filter_table.erase(victim);
-	delete ftentry;
 }
 
 /* Functions for Accumulation Table */
-deque<ATEntry*>::iterator SMSPrefetcher::search_acc_table(uint64_t page)
+ATEntry* SMSPrefetcher::search_acc_table(uint64_t page)
 {
-	return find_if(acc_table.begin(), acc_table.end(), [page](ATEntry *atentry){return (atentry->page == page);});	
+	return acc_table.find(page);
 }
 
 void SMSPrefetcher::insert_acc_table(FTEntry *ftentry, uint32_t offset)
@@ -164,38 +170,36 @@ void SMSPrefetcher::insert_acc_table(FTEntry *ftentry, uint32_t offset)
 		evict_acc_table(victim);
 	}
 
-	atentry = new ATEntry();
+	for(auto it = acc_table.begin(); it != acc_table.end(); ++it) it->age++;
+	atentry = acc_table.emplace_back();
+	acc_table.set_key(atentry, ftentry->page);
 	atentry->pc = ftentry->pc;
 	atentry->page = ftentry->page;
 	atentry->trigger_offset = ftentry->trigger_offset;
 	atentry->pattern[ftentry->trigger_offset] = 1;
 	atentry->pattern[offset] = 1;
 	atentry->age = 0;
-	for(uint32_t index = 0; index < acc_table.size(); ++index) acc_table[index]->age++;
-	acc_table.push_back(atentry);
 }
 
-deque<ATEntry*>::iterator SMSPrefetcher::search_victim_acc_table()
+ATEntry* SMSPrefetcher::search_victim_acc_table()
 {
 	uint32_t max_age = 0;
-	deque<ATEntry*>::iterator it, victim;
-	for(it = acc_table.begin(); it != acc_table.end(); ++it)
+	ATEntry *victim = NULL;
+	for(auto it = acc_table.begin(); it != acc_table.end(); ++it)
 	{
-		if((*it)->age >= max_age)
+		if(it->age >= max_age)
 		{
-			max_age	 = (*it)->age;
-			victim = it;
+			max_age	 = it->age;
+			victim = &(*it);
 		}
 	}
 	return victim;
 }
 
-void SMSPrefetcher::evict_acc_table(deque<ATEntry*>::iterator victim)
+void SMSPrefetcher::evict_acc_table(ATEntry *victim)
 {
 	stats.at.evict++;
-	ATEntry *atentry = (*victim);
-	insert_pht_table(atentry);
-	acc_table.erase(victim);
+	insert_pht_table(victim);
 
 	// cout << "[PHT_INSERT] pc " << hex << setw(10) << atentry->pc
 	// 	<< " page " << hex << setw(10) << atentry->page
@@ -203,16 +207,16 @@ void SMSPrefetcher::evict_acc_table(deque<ATEntry*>::iterator victim)
 	// 	<< " pattern " << BitmapHelper::to_string(atentry->pattern)
 	// 	<< endl;
 
-	delete(atentry);
+	acc_table.erase(victim);
 }
 
-void SMSPrefetcher::update_age_acc_table(deque<ATEntry*>::iterator current)
+void SMSPrefetcher::update_age_acc_table(ATEntry *current)
 {
 	for(auto it = acc_table.begin(); it != acc_table.end(); ++it)
 	{
-		(*it)->age++;
+		it->age++;
 	}
-	(*current)->age = 0;
+	current->age = 0;
 }
 
 /* Functions for Pattern History Table */
@@ -226,14 +230,14 @@ void SMSPrefetcher::insert_pht_table(ATEntry *atentry)
 	// 	<< endl;
 
 	int32_t set = -1;
-	auto pht_index = search_pht(signature, &set);
+	PHTEntry *phtentry = search_pht(signature, &set);
 	assert(set != -1);
-	if(pht_index != pht[set].end())
+	if(phtentry)
 	{
 		/* PHT hit */
 		stats.pht.hit++;
-		(*pht_index)->pattern = atentry->pattern;
-		update_age_pht(set, pht_index);
+		phtentry->pattern = atentry->pattern;
+		update_age_pht(set, phtentry);
 	}
 	else
 	{
@@ -246,51 +250,48 @@ void SMSPrefetcher::insert_pht_table(ATEntry *atentry)
 		}
 
 		stats.pht.insert++;
-		PHTEntry *phtentry = new PHTEntry();
+		for(auto it = pht[set].begin(); it != pht[set].end(); ++it) it->age = 0;
+		phtentry = pht[set].emplace_back();
 		phtentry->signature = signature;
 		phtentry->pattern = atentry->pattern;
 		phtentry->age = 0;
-		for(uint32_t index = 0; index < pht[set].size(); ++index) pht[set][index]->age = 0;
-		pht[set].push_back(phtentry);
 	}
 }
 
-deque<PHTEntry*>::iterator SMSPrefetcher::search_pht(uint64_t signature, int32_t *set)
+PHTEntry* SMSPrefetcher::search_pht(uint64_t signature, int32_t *set)
 {
 	(*set) = signature % pht_sets;
-	return find_if(pht[(*set)].begin(), pht[(*set)].end(), [signature](PHTEntry *phtentry){return (phtentry->signature == signature);});	
+	return pht[(*set)].find_if([signature](const PHTEntry &phtentry){return (phtentry.signature == signature);});
 }
 
-deque<PHTEntry*>::iterator SMSPrefetcher::search_victim_pht(int32_t set)
+PHTEntry* SMSPrefetcher::search_victim_pht(int32_t set)
 {
 	uint32_t max_age = 0;
-	deque<PHTEntry*>::iterator it, victim;
-	for(it = pht[set].begin(); it != pht[set].end(); ++it)
+	PHTEntry *victim = NULL;
+	for(auto it = pht[set].begin(); it != pht[set].end(); ++it)
 	{
-		if((*it)->age >= max_age)
+		if(it->age >= max_age)
 		{
-			max_age	 = (*it)->age;
-			victim = it;
+			max_age	 = it->age;
+			victim = &(*it);
 		}
 	}
 	return victim;
 }
 
-void SMSPrefetcher::update_age_pht(int32_t set, deque<PHTEntry*>::iterator current)
+void SMSPrefetcher::update_age_pht(int32_t set, PHTEntry *current)
 {
 	for(auto it = pht[set].begin(); it != pht[set].end(); ++it)
 	{
-		(*it)->age++;
+		it->age++;
 	}
-	(*current)->age = 0;
+	current->age = 0;
 }
 
-void SMSPrefetcher::evcit_pht(int32_t set, deque<PHTEntry*>::iterator victim)
+void SMSPrefetcher::evcit_pht(int32_t set, PHTEntry *victim)
 {
 	stats.pht.evict++;
-	PHTEntry *phtentry = (*victim);
 	pht[set].erase(victim);
-	delete phtentry;
 }
 
 uint64_t SMSPrefetcher::create_signature(uint64_t pc, uint32_t offset)
@@ -306,15 +307,14 @@ int SMSPrefetcher::generate_prefetch(uint64_t pc, uint64_t address, uint64_t pag
 	stats.generate_prefetch.called++;
 	uint64_t signature = create_signature(pc, offset);
 	int32_t set = -1;
-	auto pht_index = search_pht(signature, &set);
+	PHTEntry *phtentry = search_pht(signature, &set);
 	assert(set != -1);
-	if(pht_index == pht[set].end())
+	if(!phtentry)
 	{
 		stats.generate_prefetch.pht_miss++;
 		return 0;
 	}
 
-	PHTEntry *phtentry = (*pht_index);
 	for(uint32_t index = 0; index < BITMAP_MAX_SIZE; ++index)
 	{
 		if(phtentry->pattern[index] && offset != index)
@@ -323,7 +323,7 @@ int SMSPrefetcher::generate_prefetch(uint64_t pc, uint64_t address, uint64_t pag
 			pref_addr.push_back(addr);
 		}
 	}
-	update_age_pht(set, pht_index);
+	update_age_pht(set, phtentry);
 	stats.generate_prefetch.pref_generated += pref_addr.size();
 	return pref_addr.size();
 }
@@ -357,25 +357,101 @@ void SMSPrefetcher::issue_prefetch(vector<uint64_t> &pref_addr)
 	stats.pref_buffer.issued += pref_addr.size();
 }
 
+void SMSPrefetcher::register_stats(string section)
+{
+	stats_section = section;
+	stats_registry.section(section);
+	stats_registry.counter("sms.ft.lookup", &stats.ft.lookup);
+	stats_registry.counter("sms.ft.hit", &stats.ft.hit);
+	stats_registry.counter("sms.ft.insert", &stats.ft.insert);
+	stats_registry.counter("sms.ft.evict", &stats.ft.evict);
+	stats_registry.counter("sms.at.lookup", &stats.at.lookup);
+	stats_registry.counter("sms.at.hit", &stats.at.hit);
+	stats_registry.counter("sms.at.insert", &stats.at.insert);
+	stats_registry.counter("sms.at.evict", &stats.at.evict);
+	stats_registry.counter("sms.pht.lookup", &stats.pht.lookup);
+	stats_registry.counter("sms.pht.hit", &stats.pht.hit);
+	stats_registry.counter("sms.pht.insert", &stats.pht.insert);
+	stats_registry.counter("sms.pht.evict", &stats.pht.evict);
+	stats_registry.counter("sms.generate_prefetch.called", &stats.generate_prefetch.called);
+	stats_registry.counter("sms.generate_prefetch.pht_miss", &stats.generate_prefetch.pht_miss);
+	stats_registry.counter("sms.generate_prefetch.pref_generated", &stats.generate_prefetch.pref_generated);
+	stats_registry.counter("sms.pref_buffer.buffered", &stats.pref_buffer.buffered);
+	stats_registry.counter("sms.pref_buffer.spilled", &stats.pref_buffer.spilled);
+	stats_registry.counter("sms.pref_buffer.issued", &stats.pref_buffer.issued);
+	stats_registry.blank();
+}
+
 void SMSPrefetcher::dump_stats()
 {
-	cout << "sms.ft.lookup " << stats.ft.lookup << endl
-	<< "sms.ft.hit " << stats.ft.hit << endl
-	<< "sms.ft.insert " << stats.ft.insert << endl
-	<< "sms.ft.evict " << stats.ft.evict << endl
-	<< "sms.at.lookup " << stats.at.lookup << endl
-	<< "sms.at.hit " << stats.at.hit << endl
-	<< "sms.at.insert " << stats.at.insert << endl
-	<< "sms.at.evict " << stats.at.evict << endl
-	<< "sms.pht.lookup " << stats.pht.lookup << endl
-	<< "sms.pht.hit " << stats.pht.hit << endl
-	<< "sms.pht.insert " << stats.pht.insert << endl
-	<< "sms.pht.evict " << stats.pht.evict << endl
-	<< "sms.generate_prefetch.called " << stats.generate_prefetch.called << endl
-	<< "sms.generate_prefetch.pht_miss " << stats.generate_prefetch.pht_miss << endl
-	<< "sms.generate_prefetch.pref_generated " << stats.generate_prefetch.pref_generated << endl
-	<< "sms.pref_buffer.buffered " << stats.pref_buffer.buffered << endl
-	<< "sms.pref_buffer.spilled " << stats.pref_buffer.spilled << endl
-	<< "sms.pref_buffer.issued " << stats.pref_buffer.issued << endl
-	<< endl;
+	stats_registry.print(stats_section, cout);
+}
+
+void SMSPrefetcher::save(CHECKPOINT &cp)
+{
+	uint64_t num_entries = filter_table.size();
+	cp.scalar(num_entries);
+	for(auto it = filter_table.begin(); it != filter_table.end(); ++it)
+	{
+		cp.scalar(*it);
+	}
+
+	num_entries = acc_table.size();
+	cp.scalar(num_entries);
+	for(auto it = acc_table.begin(); it != acc_table.end(); ++it)
+	{
+		cp.scalar(*it);
+	}
+
+	cp.check(pht_sets, "sms pht sets");
+	for(uint32_t set = 0; set < pht_sets; ++set)
+	{
+		num_entries = pht[set].size();
+		cp.scalar(num_entries);
+		for(auto it = pht[set].begin(); it != pht[set].end(); ++it)
+		{
+			cp.scalar(*it);
+		}
+	}
+
+	cp.deque_entries(pref_buffer);
+	cp.scalar(stats);
+}
+
+void SMSPrefetcher::load(CHECKPOINT &cp)
+{
+	filter_table.clear();
+	acc_table.clear();
+
+	uint64_t num_entries = 0;
+	cp.scalar(num_entries);
+	for(uint64_t index = 0; index < num_entries; ++index)
+	{
+		FTEntry *ftentry = filter_table.emplace_back();
+		cp.scalar(*ftentry);
+		filter_table.set_key(ftentry, ftentry->page);
+	}
+
+	cp.scalar(num_entries);
+	for(uint64_t index = 0; index < num_entries; ++index)
+	{
+		ATEntry *atentry = acc_table.emplace_back();
+		cp.scalar(*atentry);
+		acc_table.set_key(atentry, atentry->page);
+	}
+
+	cp.check(pht_sets, "sms pht sets");
+	for(uint32_t set = 0; set < pht_sets; ++set)
+	{
+		pht[set].clear();
+		cp.scalar(num_entries);
+		for(uint64_t index = 0; index < num_entries; ++index)
+		{
+			PHTEntry *phtentry = pht[set].emplace_back();
+			cp.scalar(*phtentry);
+		}
+	}
+
+	cp.deque_entries(pref_buffer);
+	cp.scalar(stats);
 }
@@ -1,5 +1,7 @@
 #include <algorithm>
 #include "spp_dev2.h"
+#include "checkpoint.h"
+#include "stats.h"
 #include "champsim.h"
 #include "memory_class.h"
 using namespace std;
@@ -188,49 +190,95 @@ void SPP_dev2::cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t pre
 #endif
 }
 
+void SPP_dev2::register_stats(string section)
+{
+    stats_section = section;
+    stats_registry.section(section);
+    stats_registry.counter("spp.pref.total", &stats.pref.total);
+    stats_registry.counter("spp.pref.at_L2", &stats.pref.at_L2);
+    stats_registry.counter("spp.pref.at_LLC", &stats.pref.at_LLC);
+    stats_registry.blank();
+    stats_registry.counter("spp.depth.max", &stats.depth.max);
+    stats_registry.counter("spp.depth.min", &stats.depth.min);
+    stats_registry.value("spp.depth.avg", [this]() { return (uint32_t)((float)stats.depth.total/stats.depth.count); });
+    stats_registry.blank();
+    stats_registry.counter("spp.breadth.max", &stats.breadth.max);
+    stats_registry.counter("spp.breadth.min", &stats.breadth.min);
+    stats_registry.value("spp.breadth.avg", [this]() { return (uint32_t)((float)stats.breadth.total/stats.breadth.count); });
+    stats_registry.blank();
+
+    /* most frequent delta first */
+    stats_registry.values("delta", [this]() {
+        vector<pair<int32_t, uint64_t> > pairs(delta_histogram.begin(), delta_histogram.end());
+        sort(pairs.begin(), pairs.end(), [](pair<int32_t, uint64_t>& a, pair<int32_t, uint64_t>& b){return a.second > b.second;});
+        STATS::VALUES values;
+        for(uint32_t index = 0; index < pairs.size(); ++index)
+        {
+            values.push_back(make_pair("delta_" + to_string(pairs[index].first), pairs[index].second));
+        }
+        return values;
+    });
+    stats_registry.blank();
+
+    /* by depth, then most frequent delta first */
+    stats_registry.values("depth_delta", [this]() {
+        vector<pair<uint32_t, unordered_map<int32_t, uint64_t> > > pairs2(depth_delta_histogram.begin(), depth_delta_histogram.end());
+        sort(pairs2.begin(), pairs2.end(), [](pair<uint32_t, unordered_map<int32_t, uint64_t> >& a, pair<uint32_t, unordered_map<int32_t, uint64_t> >& b){return a.first < b.first;});
+        STATS::VALUES values;
+        for(uint32_t index = 0; index < pairs2.size(); ++index)
+        {
+            vector<pair<int32_t, uint64_t> > pairs3(pairs2[index].second.begin(), pairs2[index].second.end());
+            sort(pairs3.begin(), pairs3.end(), [](pair<int32_t, uint64_t>& a, pair<int32_t, uint64_t>& b){return a.second > b.second;});
+            for(uint32_t index2 = 0; index2 < pairs3.size(); ++index2)
+            {
+                values.push_back(make_pair("depth_" + to_string(pairs2[index].first) + "_delta_" + to_string(pairs3[index2].first), pairs3[index2].second));
+            }
+        }
+        return values;
+    });
+    stats_registry.blank();
+}
+
 void SPP_dev2::dump_stats()
 {
-    uint32_t avg_breadth = (float)stats.breadth.total/stats.breadth.count;
-    uint32_t avg_depth = (float)stats.depth.total/stats.depth.count;
-
-     cout << "spp.pref.total " << stats.pref.total << endl
-        << "spp.pref.at_L2 " << stats.pref.at_L2 << endl
-        << "spp.pref.at_LLC " << stats.pref.at_LLC << endl
-        << endl
-        << "spp.depth.max " << stats.depth.max << endl
-        << "spp.depth.min " << stats.depth.min << endl
-        << "spp.depth.avg " << avg_depth << endl
-        << endl
-        << "spp.breadth.max " << stats.breadth.max << endl
-        << "spp.breadth.min " << stats.breadth.min << endl
-        << "spp.breadth.avg " << avg_breadth << endl
-        << endl;
+    stats_registry.print(stats_section, cout);
+}
 
-    vector<pair<int32_t, uint64_t> > pairs;
-    for(auto it = delta_histogram.begin(); it != delta_histogram.end(); ++it)
-        pairs.push_back(*it);
-    sort(pairs.begin(), pairs.end(), [](pair<int32_t, uint64_t>& a, pair<int32_t, uint64_t>& b){return a.second > b.second;});
-    for(uint32_t index = 0; index < pairs.size(); ++index)
+void SPP_dev2::save(CHECKPOINT &cp)
+{
+    cp.scalar(ST);
+    cp.scalar(PT);
+    cp.scalar(FILTER);
+    cp.scalar(GHR);
+    cp.scalar(stats);
+    cp.map_entries(delta_histogram);
+    uint64_t num_depths = depth_delta_histogram.size();
+    cp.scalar(num_depths);
+    cp.buckets(depth_delta_histogram);
+    auto order = cp.back_to_front(depth_delta_histogram);
+    for (auto it = order.begin(); it != order.end(); ++it)
     {
-        cout << "delta_" << pairs[index].first << " " << pairs[index].second << endl;
+        uint32_t depth = (*it)->first;
+        cp.scalar(depth);
+        cp.map_entries((*it)->second);
     }
-    cout << endl;
+}
 
-    vector<pair<uint32_t, unordered_map<int32_t, uint64_t> > > pairs2;
-    for(auto it = depth_delta_histogram.begin(); it != depth_delta_histogram.end(); ++it)
-        pairs2.push_back(*it);
-    sort(pairs2.begin(), pairs2.end(), [](pair<uint32_t, unordered_map<int32_t, uint64_t> >& a, pair<uint32_t, unordered_map<int32_t, uint64_t> >& b){return a.first < b.first;});
-    for(uint32_t index = 0; index < pairs2.size(); ++index)
+void SPP_dev2::load(CHECKPOINT &cp)
+{
+    cp.scalar(ST);
+    cp.scalar(PT);
+    cp.scalar(FILTER);
+    cp.scalar(GHR);
+    cp.scalar(stats);
+    cp.map_entries(delta_histogram);
+    uint64_t num_depths = 0;
+    cp.scalar(num_depths);
+    cp.buckets(depth_delta_histogram);
+    for (uint64_t index = 0; index < num_depths; ++index)
     {
-        vector<pair<int32_t, uint64_t> > pairs3;
-        for(auto it = pairs2[index].second.begin(); it != pairs2[index].second.end(); ++it)
-            pairs3.push_back(*it);
-        sort(pairs3.begin(), pairs3.end(), [](pair<int32_t, uint64_t>& a, pair<int32_t, uint64_t>& b){return a.second > b.second;});
-
-        for(uint32_t index2 = 0; index2 < pairs3.size(); ++index2)
-        {
-            cout << "depth_" << pairs2[index].first << "_delta_" << pairs3[index2].first << " " << pairs3[index2].second << endl;
-        }
+        uint32_t depth = 0;
+        cp.scalar(depth);
+        cp.map_entries(depth_delta_histogram[depth]);
     }
-    cout << endl;
 }
@@ -2,6 +2,8 @@
 #include <algorithm>
 #include "streamer.h"
 #include "champsim.h"
+#include "checkpoint.h"
+#include "stats.h"
 
 namespace knob
 {
@@ -30,6 +32,7 @@ Streamer::Streamer(string type) : Prefetcher(type)
 {
     init_knobs();
     init_stats();
+    trackers.init(knob::streamer_num_trackers, true);
 }
 
 Streamer::~Streamer()
@@ -44,22 +47,19 @@ void Streamer::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hi
 
     stats.called++;
 
-    auto it = find_if(trackers.begin(), trackers.end(), [page](Stream_Tracker *tracker){return tracker->page == page;});
-    Stream_Tracker *tracker = (it != trackers.end()) ? (*it) : NULL;
+    Stream_Tracker *tracker = trackers.find(page);
 
     if(!tracker)
     {
         stats.tracker.missed++;
         if(trackers.size() >= knob::streamer_num_trackers)
         {
-            tracker = trackers.front();
             trackers.pop_front();
-            delete(tracker);
             stats.tracker.evict++;
         }
 
-        tracker = new Stream_Tracker(page, offset);
-        trackers.push_back(tracker);
+        tracker = trackers.emplace_back(page, offset);
+        trackers.set_key(tracker, page);
         stats.tracker.insert++;
         return;
     }
@@ -90,8 +90,7 @@ void Streamer::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hi
     tracker->last_offset = offset;
     tracker->last_dir = dir;
     /* update recency */
-    trackers.erase(it);
-    trackers.push_back(tracker);
+    trackers.move_to_back(tracker);
 
     /* generate prefetch */
     if(dir_match)
@@ -117,17 +116,50 @@ void Streamer::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t cache_hi
     return;
 }
 
+void Streamer::register_stats(std::string section)
+{
+    stats_section = section;
+    stats_registry.section(section);
+    stats_registry.counter("streamer.called", &stats.called);
+    stats_registry.counter("streamer.tracker.missed", &stats.tracker.missed);
+    stats_registry.counter("streamer.tracker.evict", &stats.tracker.evict);
+    stats_registry.counter("streamer.tracker.insert", &stats.tracker.insert);
+    stats_registry.counter("streamer.tracker.hit", &stats.tracker.hit);
+    stats_registry.counter("streamer.tracker.same_offset", &stats.tracker.same_offset);
+    stats_registry.counter("streamer.tracker.dir_match", &stats.tracker.dir_match);
+    stats_registry.counter("streamer.tracker.dir_mismatch", &stats.tracker.dir_mismatch);
+    stats_registry.counter("streamer.pred.dir_match", &stats.pred.dir_match);
+    stats_registry.counter("streamer.pred.total", &stats.pred.total);
+    stats_registry.blank();
+}
+
 void Streamer::dump_stats()
 {
-    cout << "streamer.called " << stats.called << endl
-         << "streamer.tracker.missed " << stats.tracker.missed << endl
-         << "streamer.tracker.evict " << stats.tracker.evict << endl
-         << "streamer.tracker.insert " << stats.tracker.insert << endl
-         << "streamer.tracker.hit " << stats.tracker.hit << endl
-         << "streamer.tracker.same_offset " << stats.tracker.same_offset << endl
-         << "streamer.tracker.dir_match " << stats.tracker.dir_match << endl
-         << "streamer.tracker.dir_mismatch " << stats.tracker.dir_mismatch << endl
-         << "streamer.pred.dir_match " << stats.pred.dir_match << endl
-         << "streamer.pred.total " << stats.pred.total << endl
-         << endl;
-}
\ No newline at end of file
+    stats_registry.print(stats_section, cout);
+}
+
+void Streamer::save(CHECKPOINT &cp)
+{
+    uint64_t num_trackers = trackers.size();
+    cp.scalar(num_trackers);
+    for(auto it = trackers.begin(); it != trackers.end(); ++it)
+    {
+        cp.scalar(*it);
+    }
+    cp.scalar(stats);
+}
+
+void Streamer::load(CHECKPOINT &cp)
+{
+    trackers.clear();
+
+    uint64_t num_trackers = 0;
+    cp.scalar(num_trackers);
+    for(uint64_t index = 0; index < num_trackers; ++index)
+    {
+        Stream_Tracker *tracker = trackers.emplace_back(0, 0);
+        cp.scalar(*tracker);
+        trackers.set_key(tracker, tracker->page);
+    }
+    cp.scalar(stats);
+}
@@ -1,6 +1,8 @@
 #include <algorithm>
 #include "stride.h"
 #include "champsim.h"
+#include "checkpoint.h"
+#include "stats.h"
 
 namespace knob
 {
@@ -20,7 +22,10 @@ void StridePrefetcher::init_stats()
 
 StridePrefetcher::StridePrefetcher(string type) : Prefetcher(type)
 {
+   init_knobs();
+   init_stats();
 
+   trackers.init(knob::stride_num_trackers, true);
 }
 
 StridePrefetcher::~StridePrefetcher()
@@ -43,31 +48,27 @@ void StridePrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t
 
    stats.tracker.lookup++;
 
-   Tracker *tracker = NULL;
-   auto it = find_if(trackers.begin(), trackers.end(), [pc](Tracker *t){return t->pc == pc;});
-   if(it == trackers.end())
+   Tracker *tracker = trackers.find(pc);
+   if(!tracker)
    {
       if(trackers.size() >= knob::stride_num_trackers)
       {
          /* evict */
-         Tracker *victim = trackers.back();
          trackers.pop_back();
-         delete victim;
          stats.tracker.evict++;
       }
 
-      tracker = new Tracker();
+      tracker = trackers.emplace_front();
+      trackers.set_key(tracker, pc);
       tracker->pc = pc;
       tracker->last_cl_addr = cl_addr;
       tracker->last_stride = 0;
-      trackers.push_front(tracker);
       stats.tracker.insert++;
       return;
    }
 
    stats.tracker.hit++;
    int32_t stride = 0;
-   tracker = (*it);
    if(cl_addr > tracker->last_cl_addr)
    {
       stride = cl_addr - tracker->last_cl_addr;
@@ -96,8 +97,7 @@ void StridePrefetcher::invoke_prefetcher(uint64_t pc, uint64_t address, uint8_t
    /* update tracker */
    tracker->last_stride = stride;
    tracker->last_cl_addr = cl_addr;
-   trackers.erase(it);
-   trackers.push_front(tracker);
+   trackers.move_to_front(tracker);
 }
 
 uint32_t StridePrefetcher::generate_prefetch(uint64_t address, int32_t stride, vector<uint64_t> &pref_addr)
@@ -125,16 +125,49 @@ uint32_t StridePrefetcher::generate_prefetch(uint64_t address, int32_t stride, v
    return count;
 }
 
+void StridePrefetcher::register_stats(std::string section)
+{
+   stats_section = section;
+   stats_registry.section(section);
+   stats_registry.counter("stride_tracker_lookup", &stats.tracker.lookup);
+   stats_registry.counter("stride_tracker_evict", &stats.tracker.evict);
+   stats_registry.counter("stride_tracker_insert", &stats.tracker.insert);
+   stats_registry.counter("stride_tracker_hit", &stats.tracker.hit);
+   stats_registry.counter("stride_stride_pos", &stats.stride.pos);
+   stats_registry.counter("stride_stride_neg", &stats.stride.neg);
+   stats_registry.counter("stride_stride_zero", &stats.stride.zero);
+   stats_registry.counter("stride_pref_stride_match", &stats.pref.stride_match);
+   stats_registry.counter("stride_pref_generated", &stats.pref.generated);
+   stats_registry.blank();
+}
+
 void StridePrefetcher::dump_stats()
 {
-   cout << "stride_tracker_lookup " << stats.tracker.lookup << endl
-      << "stride_tracker_evict " << stats.tracker.evict << endl
-      << "stride_tracker_insert " << stats.tracker.insert << endl
-      << "stride_tracker_hit " << stats.tracker.hit << endl
-      << "stride_stride_pos " << stats.stride.pos << endl
-      << "stride_stride_neg " << stats.stride.neg << endl
-      << "stride_stride_zero " << stats.stride.zero << endl
-      << "stride_pref_stride_match " << stats.pref.stride_match << endl
-      << "stride_pref_generated " << stats.pref.generated << endl
-      << endl;
+   stats_registry.print(stats_section, cout);
+}
+
+void StridePrefetcher::save(CHECKPOINT &cp)
+{
+   uint64_t num_trackers = trackers.size();
+   cp.scalar(num_trackers);
+   for(auto it = trackers.begin(); it != trackers.end(); ++it)
+   {
+      cp.scalar(*it);
+   }
+   cp.scalar(stats);
+}
+
+void StridePrefetcher::load(CHECKPOINT &cp)
+{
+   trackers.clear();
+
+   uint64_t num_trackers = 0;
+   cp.scalar(num_trackers);
+   for(uint64_t index = 0; index < num_trackers; ++index)
+   {
+      Tracker *tracker = trackers.emplace_back();
+      cp.scalar(*tracker);
+      trackers.set_key(tracker, tracker->pc);
+   }
+   cp.scalar(stats);
 }
@@ -1,4 +1,5 @@
 #include "cache.h"
+#include "checkpoint.h"
 
 // initialize replacement state
 void CACHE::llc_initialize_replacement(uint64_t rand_seed)
@@ -51,3 +52,8 @@ void CACHE::llc_replacement_final_stats()
 {
 
 }
+
+void CACHE::llc_checkpoint_replacement(CHECKPOINT &cp)
+{
+    // LRU state lives in the cache blocks
+}
@@ -0,0 +1,43 @@
+#!/usr/bin/perl
+
+use warnings;
+use strict;
+
+# prints the samples of a --interval_stats_file as CSV, one line per epoch
+# layout (see inc/interval_stats.h), native byte order:
+#   char[8] "CSINTVL", uint32 version, uint32 number of columns N, uint64 epoch
+#   N times: uint32 length, name
+#   records of N+1 uint64: cycle, column 0, ..., column N-1
+
+die "Usage: $0 <interval stats file>\n" unless @ARGV == 1;
+
+open(my $fh, "<:raw", $ARGV[0]) or die "Cannot open $ARGV[0]: $!\n";
+
+sub get
+{
+	my ($bytes) = @_;
+	my $buf;
+	my $n = read($fh, $buf, $bytes);
+	return undef unless defined $n and $n == $bytes;
+	return $buf;
+}
+
+my $header = get(24) or die "Truncated header\n";
+my ($magic, $version, $num_columns, $epoch) = unpack("Z8 L L Q", $header);
+die "Not an interval stats file\n" unless $magic eq "CSINTVL";
+die "Unsupported version $version\n" unless $version == 1;
+
+my @names = ("cycle");
+for (my $i = 0; $i < $num_columns; $i++)
+{
+	my $length = unpack("L", get(4));
+	push(@names, get($length));
+}
+print join(",", @names), "\n";
+
+my $record_size = 8 * ($num_columns + 1);
+while (defined(my $record = get($record_size)))
+{
+	print join(",", unpack("Q*", $record)), "\n";
+}
+close($fh);
@@ -1,13 +1,34 @@
 #include "block.h"
+#include "checkpoint.h"
+
+void PACKET_QUEUE::allocate()
+{
+    entry = new PACKET[SIZE];
+    busy.assign((SIZE + 63) / 64, 0);
+    where = FLAT_MAP(SIZE);
+    num_shadowed = 0;
+}
 
 int PACKET_QUEUE::check_queue(PACKET *packet)
 {
     if ((head == tail) && occupancy == 0)
         return -1;
 
+    if (num_shadowed == 0) {
+        uint64_t *index = where.find(queue_key(packet));
+        if (index == NULL)
+            return -1;
+
+        DP (if (warmup_complete[packet->cpu]) {
+        cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
+        cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[*index].instr_id << " index: " << *index;
+        cout << " cycle " << packet->event_cycle << endl; });
+        return *index;
+    }
+
     if (head < tail) {
         for (uint32_t i=head; i<tail; i++) {
-            if (NAME == "L1D_WQ") {
+            if (match_full_addr) {
                 if (entry[i].full_addr == packet->full_addr) {
                     DP (if (warmup_complete[packet->cpu]) {
                     cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
@@ -29,7 +50,7 @@ int PACKET_QUEUE::check_queue(PACKET *packet)
     }
     else {
         for (uint32_t i=head; i<SIZE; i++) {
-            if (NAME == "L1D_WQ") {
+            if (match_full_addr) {
                 if (entry[i].full_addr == packet->full_addr) {
                     DP (if (warmup_complete[packet->cpu]) {
                     cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
@@ -49,7 +70,7 @@ int PACKET_QUEUE::check_queue(PACKET *packet)
             }
         }
         for (uint32_t i=0; i<tail; i++) {
-            if (NAME == "L1D_WQ") {
+            if (match_full_addr) {
                 if (entry[i].full_addr == packet->full_addr) {
                     DP (if (warmup_complete[packet->cpu]) {
                     cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
@@ -82,6 +103,7 @@ void PACKET_QUEUE::add_queue(PACKET *packet)
 
     // add entry
     entry[tail] = *packet;
+    add_index(tail);
 
     DP ( if (warmup_complete[packet->cpu]) {
     cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id;
@@ -106,6 +128,8 @@ void PACKET_QUEUE::remove_queue(PACKET *packet)
     cout << " address: " << hex << packet->address << " full_addr: " << packet->full_addr << dec << " fill_level: " << packet->fill_level;
     cout << " head: " << head << " tail: " << tail << " occupancy: " << occupancy << " event_cycle: " << packet->event_cycle << endl; });
 
+    remove_index(packet - entry);
+
     // reset entry
     PACKET empty_packet;
     *packet = empty_packet;
@@ -115,3 +139,133 @@ void PACKET_QUEUE::remove_queue(PACKET *packet)
     if (head >= SIZE)
         head = 0;
 }
+
+int PACKET_QUEUE::check_address(uint64_t address)
+{
+    if (num_shadowed == 0) {
+        uint64_t *index = where.find(address);
+        return index ? *index : -1;
+    }
+
+    for (uint32_t i=next_busy(0); i<SIZE; i=next_busy(i+1)) {
+        if (entry[i].address == address)
+            return i;
+    }
+
+    return -1;
+}
+
+void PACKET_QUEUE::add_index(uint32_t index)
+{
+    busy[index / 64] |= 1ULL << (index % 64);
+
+    uint64_t key = queue_key(&entry[index]);
+    if (where.find(key))
+        num_shadowed++;
+    else
+        where.insert(key, index);
+}
+
+void PACKET_QUEUE::remove_index(uint32_t index)
+{
+    busy[index / 64] &= ~(1ULL << (index % 64));
+
+    uint64_t key = queue_key(&entry[index]);
+    uint64_t *found = where.find(key);
+    assert(found);
+    if (*found != index) {
+        num_shadowed--;
+        return;
+    }
+
+    // hand the address over to another entry still holding it, if any
+    if (num_shadowed) {
+        for (uint32_t i=next_busy(0); i<SIZE; i=next_busy(i+1)) {
+            if (queue_key(&entry[i]) == key) {
+                *found = i;
+                num_shadowed--;
+                return;
+            }
+        }
+    }
+
+    where.erase(key);
+}
+
+int PACKET_QUEUE::free_index()
+{
+    for (uint32_t word=0; word<busy.size(); word++) {
+        if (~busy[word]) {
+            uint32_t index = word*64 + __builtin_ctzll(~busy[word]);
+            return index < SIZE ? index : -1;
+        }
+    }
+
+    return -1;
+}
+
+void PACKET_QUEUE::checkpoint(CHECKPOINT &cp)
+{
+    cp.check(SIZE, (NAME + " size").c_str());
+
+    cp.scalar(write_mode);
+    cp.scalar(head);
+    cp.scalar(tail);
+    cp.scalar(occupancy);
+    cp.scalar(num_returned);
+    cp.scalar(next_fill_index);
+    cp.scalar(next_schedule_index);
+    cp.scalar(next_process_index);
+
+    cp.scalar(next_fill_cycle);
+    cp.scalar(next_schedule_cycle);
+    cp.scalar(next_process_cycle);
+    cp.scalar(ACCESS);
+    cp.scalar(FORWARD);
+    cp.scalar(MERGED);
+    cp.scalar(TO_CACHE);
+    cp.scalar(ROW_BUFFER_HIT);
+    cp.scalar(ROW_BUFFER_MISS);
+    cp.scalar(FULL);
+
+    cp.array(entry, SIZE);
+    cp.array(processed_packet, 2*MAX_READ_PER_CYCLE);
+    cp.vector_entries(busy);
+    where.checkpoint(cp);
+    cp.scalar(num_shadowed);
+}
+
+void CORE_BUFFER::checkpoint(CHECKPOINT &cp)
+{
+    cp.check(SIZE, (NAME + " size").c_str());
+
+    cp.scalar(head);
+    cp.scalar(tail);
+    cp.scalar(occupancy);
+    cp.scalar(last_read);
+    cp.scalar(last_fetch);
+    cp.scalar(last_scheduled);
+    cp.array(inorder_fetch, 2);
+    cp.array(next_fetch, 2);
+    cp.scalar(next_schedule);
+
+    cp.scalar(event_cycle);
+    cp.scalar(fetch_event_cycle);
+    cp.scalar(schedule_event_cycle);
+    cp.scalar(execute_event_cycle);
+    cp.scalar(lsq_event_cycle);
+    cp.scalar(retire_event_cycle);
+
+    cp.array(entry, SIZE);
+}
+
+void LOAD_STORE_QUEUE::checkpoint(CHECKPOINT &cp)
+{
+    cp.check(SIZE, (NAME + " size").c_str());
+
+    cp.scalar(occupancy);
+    cp.scalar(head);
+    cp.scalar(tail);
+
+    cp.array(entry, SIZE);
+}
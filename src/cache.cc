@@ -1,6 +1,7 @@
 #include <algorithm>
 #include "cache.h"
 #include "set.h"
+#include "checkpoint.h"
 
 uint64_t l2pf_access = 0;
 
@@ -15,6 +16,7 @@ namespace knob
     extern uint32_t semi_perfect_cache_page_buffer_size;
     extern bool measure_cache_acc;
     extern uint32_t measure_cache_acc_epoch;
+    extern bool parallel_cores;
 }
 
 void print_cache_config()
@@ -83,6 +85,8 @@ void print_cache_config()
 
 void CACHE::handle_fill()
 {
+    PROFILE_SCOPE(profile_handle_fill);
+
     // handle fill
     uint32_t fill_cpu = (MSHR.next_fill_index == MSHR_SIZE) ? NUM_CPUS : MSHR.entry[MSHR.next_fill_index].cpu;
     if (fill_cpu == NUM_CPUS)
@@ -309,6 +313,8 @@ void CACHE::handle_fill()
 
 void CACHE::handle_writeback()
 {
+    PROFILE_SCOPE(profile_handle_writeback);
+
     // handle write
     uint32_t writeback_cpu = WQ.entry[WQ.head].cpu;
     if (writeback_cpu == NUM_CPUS)
@@ -561,6 +567,8 @@ void CACHE::handle_writeback()
 
 void CACHE::handle_read()
 {
+    PROFILE_SCOPE(profile_handle_read);
+
     // handle read
     for (uint32_t i=0; i<MAX_READ; i++) 
     {
@@ -700,7 +708,12 @@ void CACHE::handle_read()
                         }
                         else // this is the last level 
                         { 
-                            if (cache_type == IS_STLB) 
+                            if ((cache_type == IS_STLB) && knob::parallel_cores)
+                            {
+                                // the page table is shared by all cores, see finish_page_walks()
+                                page_walks.push_back(RQ.entry[index]);
+                            }
+                            else if (cache_type == IS_STLB) 
                             {
                                 // TODO: need to differentiate page table walk and actual swap
                                 // emulate page table walk
@@ -860,6 +873,8 @@ void CACHE::handle_read()
 
 void CACHE::handle_prefetch()
 {
+    PROFILE_SCOPE(profile_handle_prefetch);
+
     // handle prefetch
     for (uint32_t i=0; i<MAX_READ; i++)
     {
@@ -1094,6 +1109,8 @@ void CACHE::handle_prefetch()
 
 void CACHE::operate()
 {
+    PROFILE_SCOPE(profile_operate);
+
     handle_fill();
     handle_writeback();
     reads_available_this_cycle = MAX_READ;
@@ -1106,6 +1123,51 @@ void CACHE::operate()
     handle_prefetch_feedback();
 }
 
+// earliest cycle after current at which operate() may change state, see O3_CPU::next_event_cycle()
+uint64_t CACHE::next_event_cycle(uint64_t current)
+{
+    uint64_t now = current + 1, next = UINT64_MAX;
+
+    if ((MSHR.next_fill_index != MSHR_SIZE) && (MSHR.entry[MSHR.next_fill_index].cpu != NUM_CPUS))
+        next = min(next, MSHR.next_fill_cycle);
+
+    if (WQ.occupancy && (WQ.entry[WQ.head].cpu != NUM_CPUS))
+        next = min(next, WQ.entry[WQ.head].event_cycle);
+
+    if (RQ.occupancy && (RQ.entry[RQ.head].cpu != NUM_CPUS))
+        next = min(next, RQ.entry[RQ.head].event_cycle);
+
+    if (PQ.occupancy && (PQ.entry[PQ.head].cpu != NUM_CPUS))
+        next = min(next, PQ.entry[PQ.head].event_cycle);
+
+    // handle_prefetch_feedback() counts operate() calls rather than core cycles
+    if (knob::measure_cache_acc)
+        next = min(next, (next_measure_cycle > cycle) ? (current + next_measure_cycle - cycle) : now);
+
+    return max(next, now);
+}
+
+// operate() calls skipped by the main loop, all of which would have found nothing to do
+void CACHE::fast_forward(uint64_t cycles)
+{
+    cycle += cycles;
+    reads_available_this_cycle = MAX_READ;
+}
+
+// page walks of this cycle, run by the main thread after the cycle barrier in the core order of the cycle
+// the walk itself is the same as in handle_read(), its data only lands in the MSHR a little later in the cycle
+void CACHE::finish_page_walks()
+{
+    for (uint32_t i=0; i<page_walks.size(); i++) {
+        uint64_t pa = va_to_pa(page_walks[i].cpu, page_walks[i].instr_id, page_walks[i].full_addr, page_walks[i].address);
+
+        page_walks[i].data = pa >> LOG2_PAGE_SIZE;
+        page_walks[i].event_cycle = current_core_cycle[page_walks[i].cpu];
+        return_data(&page_walks[i]);
+    }
+    page_walks.clear();
+}
+
 uint32_t CACHE::get_set(uint64_t address)
 {
     return (uint32_t) (address & ((1 << lg2(NUM_SET)) - 1)); 
@@ -1361,6 +1423,7 @@ int CACHE::add_rq(PACKET *packet)
 #endif
 
     RQ.entry[index] = *packet;
+    RQ.add_index(index);
 
     // ADD LATENCY
     if (RQ.entry[index].event_cycle < current_core_cycle[packet->cpu])
@@ -1414,6 +1477,7 @@ int CACHE::add_wq(PACKET *packet)
     }
 
     WQ.entry[index] = *packet;
+    WQ.add_index(index);
 
     // ADD LATENCY
     if (WQ.entry[index].event_cycle < current_core_cycle[packet->cpu])
@@ -1578,6 +1642,7 @@ int CACHE::add_pq(PACKET *packet)
 #endif
 
     PQ.entry[index] = *packet;
+    PQ.add_index(index);
 
     // ADD LATENCY
     if (PQ.entry[index].event_cycle < current_core_cycle[packet->cpu])
@@ -1655,7 +1720,7 @@ void CACHE::update_fill_cycle()
     // update next_fill_cycle
     uint64_t min_cycle = UINT64_MAX;
     uint32_t min_index = MSHR.SIZE;
-    for (uint32_t i=0; i<MSHR.SIZE; i++) {
+    for (uint32_t i=MSHR.next_busy(0); i<MSHR.SIZE; i=MSHR.next_busy(i+1)) {
         if ((MSHR.entry[i].returned == COMPLETED) && (MSHR.entry[i].event_cycle < min_cycle)) {
             min_cycle = MSHR.entry[i].event_cycle;
             min_index = i;
@@ -1684,16 +1749,15 @@ void CACHE::update_fill_cycle()
 int CACHE::check_mshr(PACKET *packet)
 {
     // search mshr
-    for (uint32_t index=0; index<MSHR_SIZE; index++) {
-        if (MSHR.entry[index].address == packet->address) {
-            
-            DP ( if (warmup_complete[packet->cpu]) {
-            cout << "[" << NAME << "_MSHR] " << __func__ << " same entry instr_id: " << packet->instr_id << " prior_id: " << MSHR.entry[index].instr_id;
-            cout << " address: " << hex << packet->address;
-            cout << " full_addr: " << packet->full_addr << dec << endl; });
+    int index = MSHR.check_address(packet->address);
+    if (index != -1) {
 
-            return index;
-        }
+        DP ( if (warmup_complete[packet->cpu]) {
+        cout << "[" << NAME << "_MSHR] " << __func__ << " same entry instr_id: " << packet->instr_id << " prior_id: " << MSHR.entry[index].instr_id;
+        cout << " address: " << hex << packet->address;
+        cout << " full_addr: " << packet->full_addr << dec << endl; });
+
+        return index;
     }
 
     DP ( if (warmup_complete[packet->cpu]) {
@@ -1712,25 +1776,21 @@ int CACHE::check_mshr(PACKET *packet)
 
 void CACHE::add_mshr(PACKET *packet)
 {
-    uint32_t index = 0;
-
     packet->cycle_enqueued = current_core_cycle[packet->cpu];
 
     // search mshr
-    for (index=0; index<MSHR_SIZE; index++) {
-        if (MSHR.entry[index].address == 0) {
-            
-            MSHR.entry[index] = *packet;
-            MSHR.entry[index].returned = INFLIGHT;
-            MSHR.occupancy++;
+    int index = MSHR.free_index();
+    if (index != -1) {
 
-            DP ( if (warmup_complete[packet->cpu]) {
-            cout << "[" << NAME << "_MSHR] " << __func__ << " instr_id: " << packet->instr_id;
-            cout << " address: " << hex << packet->address << " full_addr: " << packet->full_addr << dec;
-            cout << " index: " << index << " occupancy: " << MSHR.occupancy << endl; });
+        MSHR.entry[index] = *packet;
+        MSHR.entry[index].returned = INFLIGHT;
+        MSHR.add_index(index);
+        MSHR.occupancy++;
 
-            break;
-        }
+        DP ( if (warmup_complete[packet->cpu]) {
+        cout << "[" << NAME << "_MSHR] " << __func__ << " instr_id: " << packet->instr_id;
+        cout << " address: " << hex << packet->address << " full_addr: " << packet->full_addr << dec;
+        cout << " index: " << index << " occupancy: " << MSHR.occupancy << endl; });
     }
 
     /* Get b/w buckets from LLC MSHR occupancy */
@@ -1901,4 +1961,101 @@ void CACHE::broadcast_acc(uint32_t acc_level)
         case IS_L2C:    return l2c_prefetcher_broadcast_acc(acc_level);
         case IS_LLC:    return llc_prefetcher_broadcast_acc(acc_level);
     }
-}
\ No newline at end of file
+}
+// a prefetcher's state is only restored into a prefetcher of the same type in the same slot,
+// so a checkpoint warmed up without (or with other) prefetchers can seed any ROI configuration.
+// A prefetcher of the same type that saved nothing cannot be restored and stops the run
+static void checkpoint_prefetchers(CHECKPOINT &cp, string cache_name, vector<Prefetcher*> &prefetchers)
+{
+    uint64_t num_saved = prefetchers.size();
+    cp.scalar(num_saved);
+
+    vector<bool> restored(prefetchers.size(), false);
+    for (uint64_t i=0; i<num_saved; i++) {
+        string type;
+        if (cp.saving())
+            type = prefetchers[i]->get_type();
+        cp.str(type);
+
+        uint64_t blob = cp.begin_blob();
+        if (cp.saving()) {
+            prefetchers[i]->save(cp);
+            cp.end_blob(blob);
+        }
+        else if (i < prefetchers.size() && type == prefetchers[i]->get_type()) {
+            if (!blob) {
+                cerr << "*** CHECKPOINT HAS NO STATE FOR " << cache_name << " PREFETCHER " << type << " ***" << endl;
+                assert(0);
+            }
+            uint64_t start = cp.position();
+            prefetchers[i]->load(cp);
+            if (cp.position() != start + blob) {
+                cerr << "*** CHECKPOINT IS CORRUPTED: " << cache_name << " prefetcher " << type << " ***" << endl;
+                assert(0);
+            }
+            restored[i] = true;
+        }
+        else
+            cp.skip(blob);
+    }
+
+    if (!cp.saving()) {
+        for (uint32_t i=0; i<prefetchers.size(); i++)
+            if (!restored[i])
+                cout << cache_name << " prefetcher " << prefetchers[i]->get_type() << " has no state in the checkpoint and starts cold" << endl;
+    }
+}
+
+void CACHE::checkpoint(CHECKPOINT &cp)
+{
+    cp.section(NAME.c_str());
+    cp.check(NUM_SET, (NAME + " sets").c_str());
+    cp.check(NUM_WAY, (NAME + " ways").c_str());
+
+    for (uint32_t i=0; i<NUM_SET; i++)
+        cp.array(block[i], NUM_WAY);
+
+    WQ.checkpoint(cp);
+    RQ.checkpoint(cp);
+    PQ.checkpoint(cp);
+    MSHR.checkpoint(cp);
+    PROCESSED.checkpoint(cp);
+
+    cp.scalar(LATENCY);
+    cp.scalar(reads_available_this_cycle);
+
+    cp.scalar(pf_requested);
+    cp.scalar(pf_dropped);
+    cp.scalar(pf_issued);
+    cp.scalar(pf_filled);
+    cp.scalar(pf_useful);
+    cp.scalar(pf_useless);
+    cp.scalar(pf_late);
+    cp.scalar(bw_compute_epoch);
+
+    cp.array(ACCESS, NUM_TYPES);
+    cp.array(HIT, NUM_TYPES);
+    cp.array(MISS, NUM_TYPES);
+    cp.array(MSHR_MERGED, NUM_TYPES);
+    cp.array(STALL, NUM_TYPES);
+    cp.array(&sim_access[0][0], NUM_CPUS*NUM_TYPES);
+    cp.array(&sim_hit[0][0], NUM_CPUS*NUM_TYPES);
+    cp.array(&sim_miss[0][0], NUM_CPUS*NUM_TYPES);
+    cp.array(&roi_access[0][0], NUM_CPUS*NUM_TYPES);
+    cp.array(&roi_hit[0][0], NUM_CPUS*NUM_TYPES);
+    cp.array(&roi_miss[0][0], NUM_CPUS*NUM_TYPES);
+    cp.scalar(total_miss_latency);
+
+    cp.deque_entries(page_buffer);
+
+    cp.scalar(cycle);
+    cp.scalar(next_measure_cycle);
+    cp.scalar(pf_useful_epoch);
+    cp.scalar(pf_filled_epoch);
+    cp.scalar(pref_acc);
+    cp.scalar(total_acc_epochs);
+    cp.array(acc_epoch_hist, CACHE_ACC_LEVELS);
+
+    checkpoint_prefetchers(cp, NAME, prefetchers);
+    checkpoint_prefetchers(cp, NAME, l1d_prefetchers);
+}
@@ -0,0 +1,173 @@
+#include <iostream>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "checkpoint.h"
+
+using namespace std;
+
+#define CHECKPOINT_IO_SIZE (1 << 24)
+
+// default rand() state: 31 words of TYPE_3 plus the word encoding its position
+#define LIBC_RAND_STATE_SIZE 128
+
+CHECKPOINT::CHECKPOINT() : SAVING(true)
+{
+    pos = 0;
+
+    char magic[8] = CHECKPOINT_MAGIC;
+    bytes(magic, sizeof(magic));
+    check(CHECKPOINT_VERSION, "version");
+}
+
+CHECKPOINT::CHECKPOINT(const char *file_name) : SAVING(false)
+{
+    pos = 0;
+
+    gzFile file = gzopen(file_name, "rb");
+    if (file == NULL) {
+        cerr << "*** CANNOT OPEN CHECKPOINT: " << file_name << " ***" << endl;
+        assert(0);
+    }
+
+    int ret;
+    do {
+        size_t used = image.size();
+        image.resize(used + CHECKPOINT_IO_SIZE);
+        ret = gzread(file, &image[used], CHECKPOINT_IO_SIZE);
+        if (ret < 0) {
+            int err;
+            cerr << "*** CANNOT READ CHECKPOINT: " << file_name << " " << gzerror(file, &err) << " ***" << endl;
+            assert(0);
+        }
+        image.resize(used + ret);
+    } while (ret > 0);
+    gzclose(file);
+
+    char magic[8];
+    if (image.size() < sizeof(magic)) {
+        cerr << "*** NOT A CHAMPSIM CHECKPOINT: " << file_name << " ***" << endl;
+        assert(0);
+    }
+    bytes(magic, sizeof(magic));
+    if (strcmp(magic, CHECKPOINT_MAGIC)) {
+        cerr << "*** NOT A CHAMPSIM CHECKPOINT: " << file_name << " ***" << endl;
+        assert(0);
+    }
+    check(CHECKPOINT_VERSION, "version");
+}
+
+void CHECKPOINT::write_file(const char *file_name)
+{
+    assert(SAVING);
+
+    // written under a temporary name and published with rename,
+    // so a concurrent restore never sees a partial image
+    string tmp_name = string(file_name) + ".tmp." + to_string(getpid());
+    gzFile file = gzopen(tmp_name.c_str(), "wb1");
+    if (file == NULL) {
+        cerr << "*** CANNOT CREATE CHECKPOINT: " << tmp_name << " ***" << endl;
+        assert(0);
+    }
+
+    for (size_t done = 0; done < image.size(); ) {
+        size_t len = image.size() - done;
+        if (len > CHECKPOINT_IO_SIZE)
+            len = CHECKPOINT_IO_SIZE;
+        if (gzwrite(file, &image[done], len) != (int)len) {
+            cerr << "*** CANNOT WRITE CHECKPOINT: " << tmp_name << " ***" << endl;
+            assert(0);
+        }
+        done += len;
+    }
+
+    if (gzclose(file) != Z_OK || rename(tmp_name.c_str(), file_name)) {
+        cerr << "*** CANNOT WRITE CHECKPOINT: " << file_name << " ***" << endl;
+        unlink(tmp_name.c_str());
+        assert(0);
+    }
+}
+
+void CHECKPOINT::bytes(void *data, size_t len)
+{
+    if (SAVING) {
+        image.resize(pos + len);
+        memcpy(&image[pos], data, len);
+    }
+    else {
+        if (pos + len > image.size()) {
+            cerr << "*** CHECKPOINT IS TRUNCATED ***" << endl;
+            assert(0);
+        }
+        memcpy(data, &image[pos], len);
+    }
+    pos += len;
+}
+
+void CHECKPOINT::str(string &s)
+{
+    uint64_t len = s.size();
+    scalar(len);
+    if (!SAVING)
+        s.resize(len);
+    if (len)
+        bytes(&s[0], len);
+}
+
+void CHECKPOINT::check(uint64_t value, const char *what)
+{
+    uint64_t saved = value;
+    scalar(saved);
+    if (saved != value) {
+        cerr << "*** CHECKPOINT DOES NOT MATCH THIS CONFIGURATION: " << what << " is " << saved << " in the checkpoint but " << value << " here ***" << endl;
+        assert(0);
+    }
+}
+
+void CHECKPOINT::section(const char *name)
+{
+    string s = name;
+    str(s);
+    if (s != name) {
+        cerr << "*** CHECKPOINT IS CORRUPTED: expected section " << name << " but found " << s << " ***" << endl;
+        assert(0);
+    }
+}
+
+void CHECKPOINT::libc_rand()
+{
+    // swapping in a scratch state hands back the active one,
+    // whose first word then also encodes the position of the generator
+    char scratch[LIBC_RAND_STATE_SIZE];
+    char *active = initstate(1, scratch, sizeof(scratch));
+    bytes(active, LIBC_RAND_STATE_SIZE);
+    setstate(active);
+}
+
+uint64_t CHECKPOINT::begin_blob()
+{
+    uint64_t len = 0;
+    uint64_t start = pos;
+    scalar(len);
+    return SAVING ? start : len;
+}
+
+void CHECKPOINT::end_blob(uint64_t start)
+{
+    assert(SAVING);
+    uint64_t len = pos - start - sizeof(uint64_t);
+    memcpy(&image[start], &len, sizeof(len));
+}
+
+void CHECKPOINT::skip(uint64_t len)
+{
+    assert(!SAVING);
+    if (pos + len > image.size()) {
+        cerr << "*** CHECKPOINT IS TRUNCATED ***" << endl;
+        assert(0);
+    }
+    pos += len;
+}
@@ -1,4 +1,6 @@
 #include "dram_controller.h"
+#include "checkpoint.h"
+#include <algorithm>
 
 // initialized in main.cc
 uint32_t DRAM_MTPS, DRAM_DBUS_RETURN_TIME, DRAM_DBUS_MAX_CAS,
@@ -21,49 +23,142 @@ void print_dram_config()
         << endl;
 }
 
-void MEMORY_CONTROLLER::reset_remain_requests(PACKET_QUEUE *queue, uint32_t channel)
+void DRAM_QUEUE_INDEX::init(PACKET_QUEUE *v1)
 {
-    for (uint32_t i=0; i<queue->SIZE; i++) {
-        if (queue->entry[i].scheduled) {
+    queue = v1;
+    coord.resize(queue->SIZE);
+    clear();
+}
 
-            uint64_t op_addr = queue->entry[i].address;
-            uint32_t op_cpu = queue->entry[i].cpu,
-                     op_channel = dram_get_channel(op_addr), 
-                     op_rank = dram_get_rank(op_addr), 
-                     op_bank = dram_get_bank(op_addr), 
-                     op_row = dram_get_row(op_addr);
+void DRAM_QUEUE_INDEX::clear()
+{
+    for (uint32_t b=0; b<DRAM_RANKS*DRAM_BANKS; b++) {
+        pending[b].clear();
+        hit_valid[b] = 0;
+    }
+    scheduled.clear();
+}
 
-#ifdef DEBUG_PRINT
-            //uint32_t op_column = dram_get_column(op_addr);
-#endif
+int DRAM_QUEUE_INDEX::oldest_hit(uint32_t b, uint32_t open_row)
+{
+    if (hit_valid[b] && (hit_row[b] == open_row))
+        return hit_index[b];
 
-            // update open row
-            if ((bank_request[op_channel][op_rank][op_bank].cycle_available - tCAS) <= current_core_cycle[op_cpu])
-                bank_request[op_channel][op_rank][op_bank].open_row = op_row;
-            else
-                bank_request[op_channel][op_rank][op_bank].open_row = UINT32_MAX;
-
-            // this bank is ready for another DRAM request
-            bank_request[op_channel][op_rank][op_bank].request_index = -1;
-            bank_request[op_channel][op_rank][op_bank].row_buffer_hit = 0;
-            bank_request[op_channel][op_rank][op_bank].working = 0;
-            bank_request[op_channel][op_rank][op_bank].cycle_available = current_core_cycle[op_cpu];
-            if (bank_request[op_channel][op_rank][op_bank].is_write) {
-                scheduled_writes[channel]--;
-                bank_request[op_channel][op_rank][op_bank].is_write = 0;
-            }
-            else if (bank_request[op_channel][op_rank][op_bank].is_read) {
-                scheduled_reads[channel]--;
-                bank_request[op_channel][op_rank][op_bank].is_read = 0;
-            }
+    hit_index[b] = -1;
+    for (uint32_t i=0; i<pending[b].size(); i++) {
+        if (coord[pending[b][i]].row == open_row) {
+            hit_index[b] = pending[b][i];
+            break;
+        }
+    }
+    hit_row[b] = open_row;
+    hit_valid[b] = 1;
 
-            queue->entry[i].scheduled = 0;
-            queue->entry[i].event_cycle = current_core_cycle[op_cpu];
+    return hit_index[b];
+}
 
-            DP ( if (warmup_complete[op_cpu]) {
-            cout << queue->NAME << " instr_id: " << queue->entry[i].instr_id << " swrites: " << scheduled_writes[channel] << " sreads: " << scheduled_reads[channel] << endl; });
+void DRAM_QUEUE_INDEX::add(uint32_t index, DRAM_COORD v1)
+{
+    coord[index] = v1;
+    if (queue->entry[index].scheduled)
+        scheduled.push_back(index);
+    else if (queue->entry[index].address)
+        add_pending(index);
+}
+
+void DRAM_QUEUE_INDEX::schedule(uint32_t index)
+{
+    remove_pending(index);
+    scheduled.push_back(index);
+}
+
+void DRAM_QUEUE_INDEX::unschedule(uint32_t index)
+{
+    remove(index);
+    add_pending(index);
+}
+
+void DRAM_QUEUE_INDEX::remove(uint32_t index)
+{
+    for (uint32_t i=0; i<scheduled.size(); i++) {
+        if (scheduled[i] == index) {
+            scheduled[i] = scheduled.back();
+            scheduled.pop_back();
+            return;
+        }
+    }
+    assert(0);
+}
 
+void DRAM_QUEUE_INDEX::add_pending(uint32_t index)
+{
+    // requests mostly arrive in age order, so look for the slot from the young end
+    uint32_t b = bank_of(index);
+    vector<uint32_t> &list = pending[b];
+    uint32_t pos = list.size();
+    while (pos && older(index, list[pos-1]))
+        pos--;
+    list.insert(list.begin() + pos, index);
+    hit_valid[b] = 0;
+}
+
+void DRAM_QUEUE_INDEX::remove_pending(uint32_t index)
+{
+    uint32_t b = bank_of(index);
+    vector<uint32_t> &list = pending[b];
+    for (uint32_t i=0; i<list.size(); i++) {
+        if (list[i] == index) {
+            list.erase(list.begin() + i);
+            hit_valid[b] = 0;
+            return;
+        }
+    }
+    assert(0);
+}
+
+void MEMORY_CONTROLLER::reset_remain_requests(PACKET_QUEUE *queue, uint32_t channel)
+{
+    DRAM_QUEUE_INDEX *index = queue_index(queue);
+
+    // in queue order, as the scan over the whole queue did
+    vector<uint32_t> scheduled = index->scheduled;
+    sort(scheduled.begin(), scheduled.end());
+
+    for (uint32_t j=0; j<scheduled.size(); j++) {
+        uint32_t i = scheduled[j];
+
+        uint32_t op_cpu = queue->entry[i].cpu,
+                 op_channel = channel,
+                 op_rank = index->coord[i].rank,
+                 op_bank = index->coord[i].bank,
+                 op_row = index->coord[i].row;
+
+        // update open row
+        if ((bank_request[op_channel][op_rank][op_bank].cycle_available - tCAS) <= current_core_cycle[op_cpu])
+            bank_request[op_channel][op_rank][op_bank].open_row = op_row;
+        else
+            bank_request[op_channel][op_rank][op_bank].open_row = UINT32_MAX;
+
+        // this bank is ready for another DRAM request
+        bank_request[op_channel][op_rank][op_bank].request_index = -1;
+        bank_request[op_channel][op_rank][op_bank].row_buffer_hit = 0;
+        bank_request[op_channel][op_rank][op_bank].working = 0;
+        bank_request[op_channel][op_rank][op_bank].cycle_available = current_core_cycle[op_cpu];
+        if (bank_request[op_channel][op_rank][op_bank].is_write) {
+            scheduled_writes[channel]--;
+            bank_request[op_channel][op_rank][op_bank].is_write = 0;
+        }
+        else if (bank_request[op_channel][op_rank][op_bank].is_read) {
+            scheduled_reads[channel]--;
+            bank_request[op_channel][op_rank][op_bank].is_read = 0;
         }
+
+        queue->entry[i].scheduled = 0;
+        queue->entry[i].event_cycle = current_core_cycle[op_cpu];
+        index->unschedule(i);
+
+        DP ( if (warmup_complete[op_cpu]) {
+        cout << queue->NAME << " instr_id: " << queue->entry[i].instr_id << " swrites: " << scheduled_writes[channel] << " sreads: " << scheduled_reads[channel] << endl; });
     }
     
     update_schedule_cycle(&RQ[channel]);
@@ -85,6 +180,8 @@ void MEMORY_CONTROLLER::reset_remain_requests(PACKET_QUEUE *queue, uint32_t chan
 
 void MEMORY_CONTROLLER::operate()
 {
+    PROFILE_SCOPE(profile_operate);
+
     for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
         //if ((write_mode[i] == 0) && (WQ[i].occupancy >= DRAM_WRITE_HIGH_WM)) {
       if ((write_mode[i] == 0) && ((WQ[i].occupancy >= DRAM_WRITE_HIGH_WM) || ((RQ[i].occupancy == 0) && (WQ[i].occupancy > 0)))) { // use idle cycles to perform writes
@@ -139,95 +236,37 @@ void MEMORY_CONTROLLER::operate()
 
 void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
 {
-    uint64_t read_addr;
-    uint32_t read_channel, read_rank, read_bank, read_row;
+    PROFILE_SCOPE(profile_schedule);
+
+    DRAM_QUEUE_INDEX *index = queue_index(queue);
+    uint32_t channel = queue - (queue->is_WQ ? WQ : RQ);
     uint8_t  row_buffer_hit = 0;
 
     int oldest_index = -1;
-    uint64_t oldest_cycle = UINT64_MAX;
 
     // first, search for the oldest open row hit
-    for (uint32_t i=0; i<queue->SIZE; i++) {
-
-        // already scheduled
-        if (queue->entry[i].scheduled) 
-            continue;
-
-        // empty entry
-        read_addr = queue->entry[i].address;
-        if (read_addr == 0) 
-            continue;
-
-        read_channel = dram_get_channel(read_addr);
-        read_rank = dram_get_rank(read_addr);
-        read_bank = dram_get_bank(read_addr);
-
-        // bank is busy
-        if (bank_request[read_channel][read_rank][read_bank].working) { // should we check this or not? how do we know if bank is busy or not for all requests in the queue?
-
-            //DP ( if (warmup_complete[0]) {
-            //cout << queue->NAME << " " << __func__ << " instr_id: " << queue->entry[i].instr_id << " bank is busy";
-            //cout << " swrites: " << scheduled_writes[channel] << " sreads: " << scheduled_reads[channel];
-            //cout << " write: " << +bank_request[read_channel][read_rank][read_bank].is_write << " read: " << +bank_request[read_channel][read_rank][read_bank].is_read << hex;
-            //cout << " address: " << queue->entry[i].address << dec << " channel: " << read_channel << " rank: " << read_rank << " bank: " << read_bank << endl; });
-
+    // banks that are busy cannot take a request, banks without pending requests have none to offer
+    for (uint32_t b=0; b<DRAM_RANKS*DRAM_BANKS; b++) {
+        BANK_REQUEST *bank = &bank_request[channel][b / DRAM_BANKS][b % DRAM_BANKS];
+        if (bank->working || index->pending[b].empty())
             continue;
-        }
-
-        read_row = dram_get_row(read_addr);
-        //read_column = dram_get_column(read_addr);
-
-        // check open row
-        if (bank_request[read_channel][read_rank][read_bank].open_row != read_row) {
-
-            /*
-            DP ( if (warmup_complete[0]) {
-            cout << queue->NAME << " " << __func__ << " instr_id: " << queue->entry[i].instr_id << " row is inactive";
-            cout << " swrites: " << scheduled_writes[channel] << " sreads: " << scheduled_reads[channel];
-            cout << " write: " << +bank_request[read_channel][read_rank][read_bank].is_write << " read: " << +bank_request[read_channel][read_rank][read_bank].is_read << hex;
-            cout << " address: " << queue->entry[i].address << dec << " channel: " << read_channel << " rank: " << read_rank << " bank: " << read_bank << endl; });
-            */
 
-            continue;
-        }
-
-        // select the oldest entry
-        if (queue->entry[i].event_cycle < oldest_cycle) {
-            oldest_cycle = queue->entry[i].event_cycle;
+        int i = index->oldest_hit(b, bank->open_row);
+        if ((i != -1) && ((oldest_index == -1) || index->older(i, oldest_index))) {
             oldest_index = i;
             row_buffer_hit = 1;
-        }	  
+        }
     }
 
     if (oldest_index == -1) { // no matching open_row (row buffer miss)
 
-        oldest_cycle = UINT64_MAX;
-        for (uint32_t i=0; i<queue->SIZE; i++) {
-
-            // already scheduled
-            if (queue->entry[i].scheduled)
-                continue;
-
-            // empty entry
-            read_addr = queue->entry[i].address;
-            if (read_addr == 0) 
+        for (uint32_t b=0; b<DRAM_RANKS*DRAM_BANKS; b++) {
+            if (bank_request[channel][b / DRAM_BANKS][b % DRAM_BANKS].working)
                 continue;
 
-            // bank is busy
-            read_channel = dram_get_channel(read_addr);
-            read_rank = dram_get_rank(read_addr);
-            read_bank = dram_get_bank(read_addr);
-            if (bank_request[read_channel][read_rank][read_bank].working) 
-                continue;
-
-            //read_row = dram_get_row(read_addr);
-            //read_column = dram_get_column(read_addr);
-
-            // select the oldest entry
-            if (queue->entry[i].event_cycle < oldest_cycle) {
-                oldest_cycle = queue->entry[i].event_cycle;
+            int i = index->oldest(b);
+            if ((i != -1) && ((oldest_index == -1) || index->older(i, oldest_index)))
                 oldest_index = i;
-            }
         }
     }
 
@@ -240,14 +279,13 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
         else 
             LATENCY = tRP + tRCD + tCAS;
 
-        uint64_t op_addr = queue->entry[oldest_index].address;
         uint32_t op_cpu = queue->entry[oldest_index].cpu,
-                 op_channel = dram_get_channel(op_addr), 
-                 op_rank = dram_get_rank(op_addr), 
-                 op_bank = dram_get_bank(op_addr), 
-                 op_row = dram_get_row(op_addr);
+                 op_channel = channel,
+                 op_rank = index->coord[oldest_index].rank,
+                 op_bank = index->coord[oldest_index].bank,
+                 op_row = index->coord[oldest_index].row;
 #ifdef DEBUG_PRINT
-        uint32_t op_column = dram_get_column(op_addr);
+        uint32_t op_column = dram_get_column(queue->entry[oldest_index].address);
 #endif
 
         // this bank is now busy
@@ -271,6 +309,7 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
         // update open row
         bank_request[op_channel][op_rank][op_bank].open_row = op_row;
 
+        index->schedule(oldest_index);
         queue->entry[oldest_index].scheduled = 1;
         queue->entry[oldest_index].event_cycle = current_core_cycle[op_cpu] + LATENCY;
 
@@ -290,21 +329,23 @@ void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
 
 void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
 {
+    PROFILE_SCOPE(profile_process);
+
     uint32_t request_index = queue->next_process_index;
 
     // sanity check
     if (request_index == queue->SIZE)
         assert(0);
 
+    DRAM_QUEUE_INDEX *index = queue_index(queue);
     uint8_t  op_type = queue->entry[request_index].type;
-    uint64_t op_addr = queue->entry[request_index].address;
     uint32_t op_cpu = queue->entry[request_index].cpu,
-             op_channel = dram_get_channel(op_addr), 
-             op_rank = dram_get_rank(op_addr), 
-             op_bank = dram_get_bank(op_addr);
+             op_channel = queue - (queue->is_WQ ? WQ : RQ),
+             op_rank = index->coord[request_index].rank,
+             op_bank = index->coord[request_index].bank;
 #ifdef DEBUG_PRINT
-    uint32_t op_row = dram_get_row(op_addr), 
-             op_column = dram_get_column(op_addr);
+    uint32_t op_row = index->coord[request_index].row,
+             op_column = dram_get_column(queue->entry[request_index].address);
 #endif
 
     // sanity check
@@ -366,6 +407,7 @@ void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
             }
 
             // remove the oldest entry
+            index->remove(request_index);
             queue->remove_queue(&queue->entry[request_index]);
             update_process_cycle(queue);
         }
@@ -430,6 +472,53 @@ void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
     }
 }
 
+// earliest cycle after current at which operate() may change state, see O3_CPU::next_event_cycle()
+uint64_t MEMORY_CONTROLLER::next_event_cycle(uint64_t current)
+{
+    uint64_t now = current + 1, next = UINT64_MAX;
+
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+
+        // read/write mode switch
+        if (write_mode[i] == 0) {
+            if ((WQ[i].occupancy >= DRAM_WRITE_HIGH_WM) || ((RQ[i].occupancy == 0) && (WQ[i].occupancy > 0)))
+                return now;
+        }
+        else if ((WQ[i].occupancy == 0) || (RQ[i].occupancy && (WQ[i].occupancy < DRAM_WRITE_LOW_WM)))
+            return now;
+
+        PACKET_QUEUE *queue = write_mode[i] ? &WQ[i] : &RQ[i];
+        DRAM_QUEUE_INDEX *index = queue_index(queue);
+
+        // schedule() only depends on which banks are working, not on the cycle
+        if (queue->next_schedule_index < queue->SIZE) {
+            if (queue->next_schedule_cycle > now)
+                next = min(next, queue->next_schedule_cycle);
+            else {
+                for (uint32_t b=0; b<DRAM_RANKS*DRAM_BANKS; b++) {
+                    if (index->pending[b].size() && (bank_request[i][b / DRAM_BANKS][b % DRAM_BANKS].working == 0))
+                        return now;
+                }
+            }
+        }
+
+        // process() waits for the bank before it looks at the data bus
+        if (queue->next_process_index < queue->SIZE) {
+            if (queue->next_process_cycle > now)
+                next = min(next, queue->next_process_cycle);
+            else {
+                DRAM_COORD *coord = &index->coord[queue->next_process_index];
+                uint64_t available = bank_request[i][coord->rank][coord->bank].cycle_available;
+                if (available <= now)
+                    return now;
+                next = min(next, available);
+            }
+        }
+    }
+
+    return next;
+}
+
 int MEMORY_CONTROLLER::add_rq(PACKET *packet)
 {
     // simply return read requests with dummy response before the warmup
@@ -477,31 +566,30 @@ int MEMORY_CONTROLLER::add_rq(PACKET *packet)
         return index; // merged index
 
     // search for the empty index
-    for (index=0; index<DRAM_RQ_SIZE; index++) {
-        if (RQ[channel].entry[index].address == 0) {
-            
-            RQ[channel].entry[index] = *packet;
-            RQ[channel].occupancy++;
+    index = RQ[channel].free_index();
+    if (index != -1) {
 
-            /* keep a track of added entries */
-            rq_enqueue_count++;
+        RQ[channel].entry[index] = *packet;
+        RQ[channel].add_index(index);
+        RQ_index[channel].add(index, dram_get_coord(packet->address));
+        RQ[channel].occupancy++;
+
+        /* keep a track of added entries */
+        rq_enqueue_count++;
 
 #ifdef DEBUG_PRINT
-            uint32_t channel = dram_get_channel(packet->address),
-                     rank = dram_get_rank(packet->address),
-                     bank = dram_get_bank(packet->address),
-                     row = dram_get_row(packet->address),
-                     column = dram_get_column(packet->address); 
+        uint32_t channel = dram_get_channel(packet->address),
+                 rank = dram_get_rank(packet->address),
+                 bank = dram_get_bank(packet->address),
+                 row = dram_get_row(packet->address),
+                 column = dram_get_column(packet->address); 
 #endif
 
-            DP ( if(warmup_complete[packet->cpu]) {
-            cout << "[" << NAME << "_RQ] " <<  __func__ << " instr_id: " << packet->instr_id << " address: " << hex << packet->address;
-            cout << " full_addr: " << packet->full_addr << dec << " ch: " << channel;
-            cout << " rank: " << rank << " bank: " << bank << " row: " << row << " col: " << column;
-            cout << " occupancy: " << RQ[channel].occupancy << " current: " << current_core_cycle[packet->cpu] << " event: " << packet->event_cycle << endl; });
-
-            break;
-        }
+        DP ( if(warmup_complete[packet->cpu]) {
+        cout << "[" << NAME << "_RQ] " <<  __func__ << " instr_id: " << packet->instr_id << " address: " << hex << packet->address;
+        cout << " full_addr: " << packet->full_addr << dec << " ch: " << channel;
+        cout << " rank: " << rank << " bank: " << bank << " row: " << row << " col: " << column;
+        cout << " occupancy: " << RQ[channel].occupancy << " current: " << current_core_cycle[packet->cpu] << " event: " << packet->event_cycle << endl; });
     }
 
     update_schedule_cycle(&RQ[channel]);
@@ -522,28 +610,27 @@ int MEMORY_CONTROLLER::add_wq(PACKET *packet)
         return index; // merged index
 
     // search for the empty index
-    for (index=0; index<DRAM_WQ_SIZE; index++) {
-        if (WQ[channel].entry[index].address == 0) {
-            
-            WQ[channel].entry[index] = *packet;
-            WQ[channel].occupancy++;
+    index = WQ[channel].free_index();
+    if (index != -1) {
+
+        WQ[channel].entry[index] = *packet;
+        WQ[channel].add_index(index);
+        WQ_index[channel].add(index, dram_get_coord(packet->address));
+        WQ[channel].occupancy++;
 
 #ifdef DEBUG_PRINT
-            uint32_t channel = dram_get_channel(packet->address),
-                     rank = dram_get_rank(packet->address),
-                     bank = dram_get_bank(packet->address),
-                     row = dram_get_row(packet->address),
-                     column = dram_get_column(packet->address); 
+        uint32_t channel = dram_get_channel(packet->address),
+                 rank = dram_get_rank(packet->address),
+                 bank = dram_get_bank(packet->address),
+                 row = dram_get_row(packet->address),
+                 column = dram_get_column(packet->address); 
 #endif
 
-            DP ( if(warmup_complete[packet->cpu]) {
-            cout << "[" << NAME << "_WQ] " <<  __func__ << " instr_id: " << packet->instr_id << " address: " << hex << packet->address;
-            cout << " full_addr: " << packet->full_addr << dec << " ch: " << channel;
-            cout << " rank: " << rank << " bank: " << bank << " row: " << row << " col: " << column;
-            cout << " occupancy: " << WQ[channel].occupancy << " current: " << current_core_cycle[packet->cpu] << " event: " << packet->event_cycle << endl; });
-
-            break;
-        }
+        DP ( if(warmup_complete[packet->cpu]) {
+        cout << "[" << NAME << "_WQ] " <<  __func__ << " instr_id: " << packet->instr_id << " address: " << hex << packet->address;
+        cout << " full_addr: " << packet->full_addr << dec << " ch: " << channel;
+        cout << " rank: " << rank << " bank: " << bank << " row: " << row << " col: " << column;
+        cout << " occupancy: " << WQ[channel].occupancy << " current: " << current_core_cycle[packet->cpu] << " event: " << packet->event_cycle << endl; });
     }
 
     update_schedule_cycle(&WQ[channel]);
@@ -563,19 +650,13 @@ void MEMORY_CONTROLLER::return_data(PACKET *packet)
 
 void MEMORY_CONTROLLER::update_schedule_cycle(PACKET_QUEUE *queue)
 {
-    // update next_schedule_cycle
+    // update next_schedule_cycle, the oldest pending request is at the head of its bank's list
+    DRAM_QUEUE_INDEX *index = queue_index(queue);
     uint64_t min_cycle = UINT64_MAX;
     uint32_t min_index = queue->SIZE;
-    for (uint32_t i=0; i<queue->SIZE; i++) {
-        /*
-        DP (if (warmup_complete[queue->entry[min_index].cpu]) {
-        cout << "[" << queue->NAME << "] " <<  __func__ << " instr_id: " << queue->entry[i].instr_id;
-        cout << " index: " << i << " address: " << hex << queue->entry[i].address << dec << " scheduled: " << +queue->entry[i].scheduled;
-        cout << " event: " << queue->entry[i].event_cycle << " min_cycle: " << min_cycle << endl;
-        });
-        */
-
-        if (queue->entry[i].address && (queue->entry[i].scheduled == 0) && (queue->entry[i].event_cycle < min_cycle)) {
+    for (uint32_t b=0; b<DRAM_RANKS*DRAM_BANKS; b++) {
+        int i = index->oldest(b);
+        if ((i != -1) && ((min_index == queue->SIZE) || index->older(i, min_index))) {
             min_cycle = queue->entry[i].event_cycle;
             min_index = i;
         }
@@ -596,10 +677,12 @@ void MEMORY_CONTROLLER::update_schedule_cycle(PACKET_QUEUE *queue)
 void MEMORY_CONTROLLER::update_process_cycle(PACKET_QUEUE *queue)
 {
     // update next_process_cycle
+    DRAM_QUEUE_INDEX *index = queue_index(queue);
     uint64_t min_cycle = UINT64_MAX;
     uint32_t min_index = queue->SIZE;
-    for (uint32_t i=0; i<queue->SIZE; i++) {
-        if (queue->entry[i].scheduled && (queue->entry[i].event_cycle < min_cycle)) {
+    for (uint32_t j=0; j<index->scheduled.size(); j++) {
+        uint32_t i = index->scheduled[j];
+        if ((queue->entry[i].event_cycle < min_cycle) || ((queue->entry[i].event_cycle == min_cycle) && (i < min_index))) {
             min_cycle = queue->entry[i].event_cycle;
             min_index = i;
         }
@@ -620,15 +703,14 @@ void MEMORY_CONTROLLER::update_process_cycle(PACKET_QUEUE *queue)
 int MEMORY_CONTROLLER::check_dram_queue(PACKET_QUEUE *queue, PACKET *packet)
 {
     // search write queue
-    for (uint32_t index=0; index<queue->SIZE; index++) {
-        if (queue->entry[index].address == packet->address) {
-            
-            DP ( if (warmup_complete[packet->cpu]) {
-            cout << "[" << queue->NAME << "] " << __func__ << " same entry instr_id: " << packet->instr_id << " prior_id: " << queue->entry[index].instr_id;
-            cout << " address: " << hex << packet->address << " full_addr: " << packet->full_addr << dec << endl; });
-
-            return index;
-        }
+    int index = queue->check_address(packet->address);
+    if (index != -1) {
+
+        DP ( if (warmup_complete[packet->cpu]) {
+        cout << "[" << queue->NAME << "] " << __func__ << " same entry instr_id: " << packet->instr_id << " prior_id: " << queue->entry[index].instr_id;
+        cout << " address: " << hex << packet->address << " full_addr: " << packet->full_addr << dec << endl; });
+
+        return index;
     }
 
     DP ( if (warmup_complete[packet->cpu]) {
@@ -645,6 +727,16 @@ int MEMORY_CONTROLLER::check_dram_queue(PACKET_QUEUE *queue, PACKET *packet)
     return -1;
 }
 
+DRAM_COORD MEMORY_CONTROLLER::dram_get_coord(uint64_t address)
+{
+    DRAM_COORD coord;
+    coord.rank = dram_get_rank(address);
+    coord.bank = dram_get_bank(address);
+    coord.row = dram_get_row(address);
+
+    return coord;
+}
+
 uint32_t MEMORY_CONTROLLER::dram_get_channel(uint64_t address)
 {
     if (LOG2_DRAM_CHANNELS == 0)
@@ -722,3 +814,53 @@ void MEMORY_CONTROLLER::increment_WQ_FULL(uint64_t address)
     uint32_t channel = dram_get_channel(address);
     WQ[channel].FULL++;
 }
+
+void MEMORY_CONTROLLER::rebuild_queue_index(DRAM_QUEUE_INDEX *index)
+{
+    PACKET_QUEUE *queue = index->queue;
+
+    index->clear();
+    for (uint32_t i=queue->next_busy(0); i<queue->SIZE; i=queue->next_busy(i+1))
+        index->add(i, dram_get_coord(queue->entry[i].address));
+}
+
+void MEMORY_CONTROLLER::checkpoint(CHECKPOINT &cp)
+{
+    cp.section(NAME.c_str());
+
+    cp.array(dbus_cycle_available, DRAM_CHANNELS);
+    cp.array(dbus_cycle_congested, DRAM_CHANNELS);
+    cp.array(&dbus_congested[0][0][0], DRAM_CHANNELS*(NUM_TYPES+1)*(NUM_TYPES+1));
+    cp.array(&bank_cycle_available[0][0][0], DRAM_CHANNELS*DRAM_RANKS*DRAM_BANKS);
+    cp.scalar(do_write);
+    cp.array(write_mode, DRAM_CHANNELS);
+    cp.scalar(processed_writes);
+    cp.array(scheduled_reads, DRAM_CHANNELS);
+    cp.array(scheduled_writes, DRAM_CHANNELS);
+    cp.array(&bank_request[0][0][0], DRAM_CHANNELS*DRAM_RANKS*DRAM_BANKS);
+
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        WQ[i].checkpoint(cp);
+        RQ[i].checkpoint(cp);
+
+        // the indexes are derived from the queues, rebuild them rather than store them
+        if (!cp.saving()) {
+            rebuild_queue_index(&WQ_index[i]);
+            rebuild_queue_index(&RQ_index[i]);
+        }
+    }
+
+    cp.array(ACCESS, NUM_TYPES);
+    cp.array(HIT, NUM_TYPES);
+    cp.array(MISS, NUM_TYPES);
+    cp.array(MSHR_MERGED, NUM_TYPES);
+    cp.array(STALL, NUM_TYPES);
+
+    cp.scalar(rq_enqueue_count);
+    cp.scalar(last_enqueue_count);
+    cp.scalar(epoch_enqueue_count);
+    cp.scalar(next_bw_measure_cycle);
+    cp.scalar(bw);
+    cp.scalar(total_bw_epochs);
+    cp.array(bw_level_hist, DRAM_BW_LEVELS);
+}
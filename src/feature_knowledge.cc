@@ -1,5 +1,8 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include "checkpoint.h"
 #include "feature_knowledge.h"
 #include "feature_knowledge_helper.h"
 
@@ -16,6 +19,9 @@
 namespace knob
 {
 	extern bool le_featurewise_enable_action_fallback;
+	extern bool     le_enable_fixed_point;
+	extern uint32_t le_fixed_point_int_bits;
+	extern uint32_t le_fixed_point_frac_bits;
 	extern bool 			le_featurewise_enable_trace;
 	extern uint32_t		le_featurewise_trace_feature_type;
 	extern string 			le_featurewise_trace_feature;
@@ -37,19 +43,30 @@ FeatureKnowledge::FeatureKnowledge(FeatureType feature_type, float alpha, float
 {
 	assert(m_num_tilings <= FK_MAX_TILINGS);
 	assert(m_num_tilings == 1 || m_enable_tiling_offset); /* enforce the use of tiling offsets in case of multiple tilings */
+	m_hash = HashZoo::getHashFunction(m_hash_type);
 
 	/* create Q-table */
-	m_qtable = (float***)calloc(m_num_tilings, sizeof(float**));
-	assert(m_qtable);
-	for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
+	m_fixed_point = knob::le_enable_fixed_point;
+	m_qtable = NULL;
+	m_q_sum = NULL;
+	m_qtable_fx = NULL;
+	m_q_sum_fx = NULL;
+	m_row_size = (m_actions + FK_ROW_ALIGN - 1) / FK_ROW_ALIGN * FK_ROW_ALIGN;
+	uint64_t num_rows = (uint64_t)m_num_tilings * m_num_tiles;
+	int ret = 0;
+	if(m_fixed_point)
 	{
-		m_qtable[tiling] = (float**)calloc(m_num_tiles, sizeof(float*));
-		assert(m_qtable[tiling]);
-		for(uint32_t tile = 0; tile < m_num_tiles; ++tile)
-		{
-			m_qtable[tiling][tile] = (float*)calloc(m_actions, sizeof(float));
-			assert(m_qtable[tiling][tile]);
-		}
+		ret |= posix_memalign((void**)&m_qtable_fx, FK_ROW_ALIGN * sizeof(float), num_rows * m_row_size * sizeof(int16_t));
+		ret |= posix_memalign((void**)&m_q_sum_fx, FK_ROW_ALIGN * sizeof(float), m_row_size * sizeof(int32_t));
+		assert(!ret);
+		memset(m_qtable_fx, 0, num_rows * m_row_size * sizeof(int16_t)); /* padding actions stay zero */
+	}
+	else
+	{
+		ret |= posix_memalign((void**)&m_qtable, FK_ROW_ALIGN * sizeof(float), num_rows * m_row_size * sizeof(float));
+		ret |= posix_memalign((void**)&m_q_sum, FK_ROW_ALIGN * sizeof(float), m_row_size * sizeof(float));
+		assert(!ret);
+		memset(m_qtable, 0, num_rows * m_row_size * sizeof(float)); /* padding actions stay zero */
 	}
 
 	/* init Q-table */
@@ -61,13 +78,34 @@ FeatureKnowledge::FeatureKnowledge(FeatureType feature_type, float alpha, float
 	{
 		m_init_value = (float)1ul/(1-gamma);
 	}
-	for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
+	if(m_fixed_point)
+	{
+		m_fixed.init(knob::le_fixed_point_int_bits, knob::le_fixed_point_frac_bits, alpha, gamma);
+		int16_t init_value_fx = m_fixed.from_float(m_init_value);
+		m_init_value = m_fixed.to_float(init_value_fx);
+		for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
+		{
+			for(uint32_t tile = 0; tile < m_num_tiles; ++tile)
+			{
+				int16_t *row = getRowFx(tiling, tile);
+				for(uint32_t action = 0; action < m_actions; ++action)
+				{
+					row[action] = init_value_fx;
+				}
+			}
+		}
+	}
+	else
 	{
-		for(uint32_t tile = 0; tile < m_num_tiles; ++tile)
+		for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
 		{
-			for(uint32_t action = 0; action < m_actions; ++action)
+			for(uint32_t tile = 0; tile < m_num_tiles; ++tile)
 			{
-				m_qtable[tiling][tile][action] = m_init_value;
+				float *row = getRow(tiling, tile);
+				for(uint32_t action = 0; action < m_actions; ++action)
+				{
+					row[action] = m_init_value;
+				}
 			}
 		}
 	}
@@ -88,7 +126,28 @@ FeatureKnowledge::FeatureKnowledge(FeatureType feature_type, float alpha, float
 
 FeatureKnowledge::~FeatureKnowledge()
 {
+	free(m_qtable);
+	free(m_q_sum);
+	free(m_qtable_fx);
+	free(m_q_sum_fx);
+}
 
+void FeatureKnowledge::checkpoint(CHECKPOINT &cp)
+{
+	uint64_t num_entries = (uint64_t)m_num_tilings * m_num_tiles * m_row_size;
+	cp.check(num_entries, "feature Q-table size");
+	cp.check(m_fixed_point, "feature fixed point");
+	if(m_fixed_point)
+	{
+		cp.array(m_qtable_fx, num_entries);
+	}
+	else
+	{
+		cp.array(m_qtable, num_entries);
+	}
+	cp.scalar(m_weight);
+	cp.scalar(min_weight);
+	cp.scalar(max_weight);
 }
 
 float FeatureKnowledge::getQ(uint32_t tiling, uint32_t tile_index, uint32_t action)
@@ -96,7 +155,7 @@ float FeatureKnowledge::getQ(uint32_t tiling, uint32_t tile_index, uint32_t acti
 	assert(tiling < m_num_tilings);
 	assert(tile_index < m_num_tiles);
 	assert(action < m_actions);
-	return m_qtable[tiling][tile_index][action];
+	return getRow(tiling, tile_index)[action];
 }
 
 void FeatureKnowledge::setQ(uint32_t tiling, uint32_t tile_index, uint32_t action, float value)
@@ -104,7 +163,7 @@ void FeatureKnowledge::setQ(uint32_t tiling, uint32_t tile_index, uint32_t actio
 	assert(tiling < m_num_tilings);
 	assert(tile_index < m_num_tiles);
 	assert(action < m_actions);
-	m_qtable[tiling][tile_index][action] = value;
+	getRow(tiling, tile_index)[action] = value;
 }
 
 float FeatureKnowledge::retrieveQ(State *state, uint32_t action)
@@ -112,6 +171,18 @@ float FeatureKnowledge::retrieveQ(State *state, uint32_t action)
 	uint32_t tile_index = 0;
 	float q_value = 0.0;
 
+	if(m_fixed_point)
+	{
+		int32_t q_value_fx = 0;
+		for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
+		{
+			tile_index = get_tile_index(tiling, state);
+			assert(tile_index < m_num_tiles && action < m_actions);
+			q_value_fx += getRowFx(tiling, tile_index)[action];
+		}
+		return m_weight * m_fixed.to_float(q_value_fx);
+	}
+
 	for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
 	{
 		tile_index = get_tile_index(tiling, state);
@@ -121,6 +192,65 @@ float FeatureKnowledge::retrieveQ(State *state, uint32_t action)
 	return m_weight * q_value;
 }
 
+/* adds a padded action row into the running sum; both rows are line-aligned and a multiple of
+ * FK_ROW_ALIGN long, so the loop compiles to packed adds without a remainder */
+static inline void add_row(float *__restrict sum, const float *__restrict row, uint32_t row_size)
+{
+	sum = (float*)__builtin_assume_aligned(sum, FK_ROW_ALIGN * sizeof(float));
+	row = (const float*)__builtin_assume_aligned(row, FK_ROW_ALIGN * sizeof(float));
+	for(uint32_t action = 0; action < row_size; ++action)
+	{
+		sum[action] += row[action];
+	}
+}
+
+/* same for a fixed-point row, widened so the sum over the tilings cannot overflow;
+ * fixed-point rows are m_row_size int16s, so they are only FK_ROW_ALIGN * sizeof(int16_t) aligned */
+static inline void add_row(int32_t *__restrict sum, const int16_t *__restrict row, uint32_t row_size)
+{
+	sum = (int32_t*)__builtin_assume_aligned(sum, FK_ROW_ALIGN * sizeof(int32_t));
+	row = (const int16_t*)__builtin_assume_aligned(row, FK_ROW_ALIGN * sizeof(int16_t));
+	for(uint32_t action = 0; action < row_size; ++action)
+	{
+		sum[action] += row[action];
+	}
+}
+
+/* Q-values of every action, summed over the tilings in the same order as retrieveQ(state, action),
+ * so each action sees the exact same floating point result */
+void FeatureKnowledge::retrieveQ(State *state, float *q_values)
+{
+	uint32_t tile_index[FK_MAX_TILINGS];
+	get_tile_indices(state, tile_index);
+
+	if(m_fixed_point)
+	{
+		memset(m_q_sum_fx, 0, m_row_size * sizeof(int32_t));
+		for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
+		{
+			assert(tile_index[tiling] < m_num_tiles);
+			add_row(m_q_sum_fx, getRowFx(tiling, tile_index[tiling]), m_row_size);
+		}
+		for(uint32_t action = 0; action < m_actions; ++action)
+		{
+			q_values[action] = m_weight * m_fixed.to_float(m_q_sum_fx[action]);
+		}
+		return;
+	}
+
+	memset(m_q_sum, 0, m_row_size * sizeof(float));
+	for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
+	{
+		assert(tile_index[tiling] < m_num_tiles);
+		add_row(m_q_sum, getRow(tiling, tile_index[tiling]), m_row_size);
+	}
+
+	for(uint32_t action = 0; action < m_actions; ++action)
+	{
+		q_values[action] = m_weight * m_q_sum[action];
+	}
+}
+
 void FeatureKnowledge::updateQ(State *state1, uint32_t action1, int32_t reward, State *state2, uint32_t action2)
 {
 	uint32_t tile_index1 = 0, tile_index2 = 0;
@@ -133,6 +263,13 @@ void FeatureKnowledge::updateQ(State *state1, uint32_t action1, int32_t reward,
 	{
 		tile_index1 = get_tile_index(tiling, state1);
 		tile_index2 = get_tile_index(tiling, state2);
+		if(m_fixed_point)
+		{
+			assert(tile_index1 < m_num_tiles && tile_index2 < m_num_tiles && action1 < m_actions && action2 < m_actions);
+			int16_t *Qsa1_fx = &getRowFx(tiling, tile_index1)[action1];
+			*Qsa1_fx = m_fixed.sarsa(*Qsa1_fx, reward, getRowFx(tiling, tile_index2)[action2]);
+			continue;
+		}
 		Qsa1 = getQ(tiling, tile_index1, action1);
 		Qsa2 = getQ(tiling, tile_index2, action2);
 		Qsa1_old = Qsa1;
@@ -195,20 +332,29 @@ uint32_t FeatureKnowledge::get_tile_index(uint32_t tiling, State *state)
 	}
 }
 
-uint32_t FeatureKnowledge::getMaxAction(State *state)
+void FeatureKnowledge::get_tile_indices(State *state, uint32_t *tile_index)
+{
+	for(uint32_t tiling = 0; tiling < m_num_tilings; ++tiling)
+	{
+		tile_index[tiling] = get_tile_index(tiling, state);
+	}
+}
+
+/* q_values as filled by retrieveQ(state, q_values) */
+uint32_t FeatureKnowledge::getMaxAction(const float *q_values)
 {
 	float max_q_value = 0.0, q_value = 0.0;
 	uint32_t selected_action = 0, init_index = 0;
 
 	if(!knob::le_featurewise_enable_action_fallback)
 	{
-		max_q_value = retrieveQ(state, 0);
+		max_q_value = q_values[0];
 		init_index = 1;
 	}
 
 	for(uint32_t action = init_index; action < m_actions; ++action)
 	{
-		q_value = retrieveQ(state, action);
+		q_value = q_values[action];
 		if(q_value > max_q_value)
 		{
 			max_q_value = q_value;
@@ -247,11 +393,14 @@ string FeatureKnowledge::get_feature_string(State *state)
 
 void FeatureKnowledge::dump_feature_trace(State *state)
 {
+	vector<float> q_values(m_actions);
+	retrieveQ(state, &q_values[0]);
+
 	trace_timestamp++;
 	fprintf(trace, "%lu,", trace_timestamp);
 	for(uint32_t action = 0; action < m_actions; ++action)
 	{
-		fprintf(trace, "%.2f,", retrieveQ(state, action));
+		fprintf(trace, "%.2f,", q_values[action]);
 	}
 	fprintf(trace, "\n");
 	fflush(trace);
@@ -0,0 +1,152 @@
+#include <iostream>
+#include <assert.h>
+#include <string.h>
+#include "interval_stats.h"
+#include "stats.h"
+
+using namespace std;
+
+INTERVAL_STATS interval_stats;
+
+INTERVAL_STATS::INTERVAL_STATS()
+{
+    file = NULL;
+    epoch = next_sample_cycle = 0;
+    width = half = fill = 0;
+    writer = NULL;
+    pending[0] = pending[1] = false;
+    pending_records[0] = pending_records[1] = 0;
+    writer_exit = false;
+}
+
+INTERVAL_STATS::~INTERVAL_STATS() { close(); }
+
+void INTERVAL_STATS::open(const char *v1, vector<string> &v2, uint64_t v3, uint32_t v4)
+{
+    assert(file == NULL);
+    if (v3 == 0 || v4 < 2) {
+        cerr << "*** INTERVAL STATS NEED AN EPOCH AND AT LEAST 2 BUFFERED SAMPLES ***" << endl;
+        assert(0);
+    }
+
+    for (uint32_t i = 0; i < v2.size(); i++) {
+        string reason;
+        columns.push_back(stats_registry.reader(v2[i], reason));
+        if (!columns.back()) {
+            cerr << "*** CANNOT SAMPLE " << v2[i] << " FOR INTERVAL STATS: " << reason << " ***" << endl;
+            assert(0);
+        }
+    }
+
+    file = fopen(v1, "wb");
+    if (file == NULL) {
+        cerr << "*** CANNOT OPEN INTERVAL STATS FILE: " << v1 << " ***" << endl;
+        assert(0);
+    }
+
+    char magic[8];
+    memset(magic, 0, sizeof(magic));
+    strcpy(magic, "CSINTVL");
+    uint32_t version = INTERVAL_STATS_VERSION, num_columns = v2.size();
+    fwrite(magic, sizeof(magic), 1, file);
+    fwrite(&version, sizeof(version), 1, file);
+    fwrite(&num_columns, sizeof(num_columns), 1, file);
+    fwrite(&v3, sizeof(v3), 1, file);
+    for (uint32_t i = 0; i < v2.size(); i++) {
+        uint32_t length = v2[i].size();
+        fwrite(&length, sizeof(length), 1, file);
+        fwrite(v2[i].data(), 1, length, file);
+    }
+
+    epoch = v3;
+    next_sample_cycle = v3;
+    width = v2.size() + 1;
+    half = v4 / 2;
+    fill = 0;
+    buffer.assign((uint64_t)2 * half * width, 0);
+
+    writer_exit = false;
+    writer = new thread(&INTERVAL_STATS::write_halves, this);
+}
+
+void INTERVAL_STATS::sample(uint64_t v1)
+{
+    uint64_t *record = &buffer[(uint64_t)fill * width];
+    record[0] = v1;
+    for (uint32_t i = 0; i < columns.size(); i++)
+        record[i + 1] = columns[i]();
+    fill++;
+
+    // a restored or fast-forwarded run can be several epochs past, it samples once and catches up
+    next_sample_cycle += epoch;
+    if (next_sample_cycle <= v1)
+        next_sample_cycle = v1 - (v1 % epoch) + epoch;
+
+    if (fill % half)
+        return;
+
+    uint32_t full = fill / half - 1;
+    hand_off(full, half);
+    if (fill == 2 * half)
+        fill = 0;
+
+    // the half written next must be back from the writer
+    unique_lock<mutex> guard(lock);
+    while (pending[full ^ 1])
+        written.wait(guard);
+}
+
+void INTERVAL_STATS::close()
+{
+    if (file == NULL)
+        return;
+
+    if (fill % half)
+        hand_off(fill / half, fill % half);
+
+    {
+        lock_guard<mutex> guard(lock);
+        writer_exit = true;
+    }
+    handed.notify_one();
+    writer->join();
+    delete writer;
+    writer = NULL;
+
+    fclose(file);
+    file = NULL;
+}
+
+void INTERVAL_STATS::hand_off(uint32_t v1, uint32_t v2)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        pending[v1] = true;
+        pending_records[v1] = v2;
+    }
+    handed.notify_one();
+}
+
+// the halves are handed over alternately, so the writer takes them in that order too
+void INTERVAL_STATS::write_halves()
+{
+    uint32_t next = 0;
+    unique_lock<mutex> guard(lock);
+    while (1) {
+        if (!pending[next]) {
+            if (writer_exit)
+                return;
+            handed.wait(guard);
+            continue;
+        }
+
+        uint32_t records = pending_records[next];
+        guard.unlock();
+        fwrite(&buffer[(uint64_t)next * half * width], sizeof(uint64_t), (uint64_t)records * width, file);
+        guard.lock();
+
+        pending[next] = false;
+        next ^= 1;
+        written.notify_one();
+    }
+}
@@ -30,6 +30,19 @@ namespace knob
 	uint64_t measure_dram_bw_epoch = 256;
 	bool measure_cache_acc = true;
 	uint64_t measure_cache_acc_epoch = 1024;
+	string trace_cache_dir;
+	string checkpoint_save;
+	string checkpoint_load;
+	bool checkpoint_exit = false;
+	bool skip_idle_cycles = false;
+	bool parallel_cores = false;
+	string stats_json_file;
+	string interval_stats_file;
+	uint64_t interval_stats_epoch = 100000;
+	uint32_t interval_stats_buffer = 4096;
+	vector<string> interval_stats_counters;
+	vector<string> fanout_config;
+	string fanout_output_dir = ".";
 
 	/* next-line */
 	vector<int32_t> next_line_deltas;
@@ -215,12 +228,39 @@ namespace knob
 	uint32_t ISB_stream_max_lenth_bits = 8;
 	uint32_t ISB_degree = 8;
 	uint32_t ISB_debug_level = 0;
+	bool ISB_window_stats = false;
+	uint32_t ISB_metadata_cache_size = 0;
+	uint32_t ISB_metadata_cache_ways = 8;
+	uint32_t ISB_metadata_line_entries = 8;
 
 	/* Domino */
 	uint32_t Domino_active_stream_size = 4;
 	uint32_t Domino_degree = 4;
 	uint32_t Domino_super_entry_size = 4;
 	uint32_t Domino_debug_level = 0;
+	bool Domino_bounded = false;
+	uint32_t Domino_history_size = 1048576;
+	uint32_t Domino_index_table_size = 65536;
+	uint32_t Domino_index_table_ways = 16;
+	uint32_t Domino_prefetch_filter_size = 4096;
+	uint32_t Domino_prefetch_filter_ways = 16;
+
+	/* sdomino */
+	uint32_t sdomino_ghb_size = 1048576;
+	uint32_t sdomino_eit_size = 65536;
+	uint32_t sdomino_eit_ways = 16;
+	uint32_t sdomino_eit_slots = 3;
+	uint32_t sdomino_degree = 4;
+
+	/* sisb */
+	uint32_t sisb_degree = 2;
+	bool sisb_bounded = false;
+	uint32_t sisb_tu_size = 256;
+	uint32_t sisb_tu_ways = 8;
+	uint32_t sisb_cache_size = 65536;
+	uint32_t sisb_cache_ways = 16;
+	string sisb_replacement = "lru";
+	uint32_t sisb_pc_stats_sample = 0;
 
 	/* Stride */
 	uint32_t stride_num_trackers = 64;
@@ -320,6 +360,9 @@ namespace knob
 	uint32_t le_action_trace_interval;
 	std::string le_action_trace_name;
 	bool le_enable_action_plot;
+	bool le_enable_fixed_point = false;
+	uint32_t le_fixed_point_int_bits = 6;
+	uint32_t le_fixed_point_frac_bits = 9;
 
 	/* Featurewise Learning Engine */
 	vector<int32_t> le_featurewise_active_features;
@@ -483,6 +526,58 @@ int parse_knobs(void *user, const char *section, const char *name, const char *v
 	{
 		knob::measure_cache_acc_epoch = atoi(value);
 	}
+	else if (MATCH("", "trace_cache_dir"))
+	{
+		knob::trace_cache_dir = string(value);
+	}
+	else if (MATCH("", "checkpoint_save"))
+	{
+		knob::checkpoint_save = string(value);
+	}
+	else if (MATCH("", "checkpoint_load"))
+	{
+		knob::checkpoint_load = string(value);
+	}
+	else if (MATCH("", "checkpoint_exit"))
+	{
+		knob::checkpoint_exit = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "skip_idle_cycles"))
+	{
+		knob::skip_idle_cycles = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "parallel_cores"))
+	{
+		knob::parallel_cores = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "stats_json_file"))
+	{
+		knob::stats_json_file = string(value);
+	}
+	else if (MATCH("", "interval_stats_file"))
+	{
+		knob::interval_stats_file = string(value);
+	}
+	else if (MATCH("", "interval_stats_epoch"))
+	{
+		knob::interval_stats_epoch = atol(value);
+	}
+	else if (MATCH("", "interval_stats_buffer"))
+	{
+		knob::interval_stats_buffer = atoi(value);
+	}
+	else if (MATCH("", "interval_stats_counters"))
+	{
+		knob::interval_stats_counters.push_back(string(value));
+	}
+	else if (MATCH("", "fanout_config"))
+	{
+		knob::fanout_config.push_back(string(value));
+	}
+	else if (MATCH("", "fanout_output_dir"))
+	{
+		knob::fanout_output_dir = string(value);
+	}
 
 /* RB_L1 */
 	else if (MATCH("", "rb_l1_levels"))
@@ -1127,6 +1222,22 @@ int parse_knobs(void *user, const char *section, const char *name, const char *v
 	{
 		knob::ISB_debug_level = atoi(value);
 	}
+	else if (MATCH("", "ISB_window_stats"))
+	{
+		knob::ISB_window_stats = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "ISB_metadata_cache_size"))
+	{
+		knob::ISB_metadata_cache_size = atoi(value);
+	}
+	else if (MATCH("", "ISB_metadata_cache_ways"))
+	{
+		knob::ISB_metadata_cache_ways = atoi(value);
+	}
+	else if (MATCH("", "ISB_metadata_line_entries"))
+	{
+		knob::ISB_metadata_line_entries = atoi(value);
+	}
 
 	/* Domino */
 	else if (MATCH("", "Domino_active_stream_size"))
@@ -1145,6 +1256,86 @@ int parse_knobs(void *user, const char *section, const char *name, const char *v
 	{
 		knob::Domino_debug_level = atoi(value);
 	}
+	else if (MATCH("", "Domino_bounded"))
+	{
+		knob::Domino_bounded = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "Domino_history_size"))
+	{
+		knob::Domino_history_size = atoi(value);
+	}
+	else if (MATCH("", "Domino_index_table_size"))
+	{
+		knob::Domino_index_table_size = atoi(value);
+	}
+	else if (MATCH("", "Domino_index_table_ways"))
+	{
+		knob::Domino_index_table_ways = atoi(value);
+	}
+	else if (MATCH("", "Domino_prefetch_filter_size"))
+	{
+		knob::Domino_prefetch_filter_size = atoi(value);
+	}
+	else if (MATCH("", "Domino_prefetch_filter_ways"))
+	{
+		knob::Domino_prefetch_filter_ways = atoi(value);
+	}
+
+	/* sdomino */
+	else if (MATCH("", "sdomino_ghb_size"))
+	{
+		knob::sdomino_ghb_size = atoi(value);
+	}
+	else if (MATCH("", "sdomino_eit_size"))
+	{
+		knob::sdomino_eit_size = atoi(value);
+	}
+	else if (MATCH("", "sdomino_eit_ways"))
+	{
+		knob::sdomino_eit_ways = atoi(value);
+	}
+	else if (MATCH("", "sdomino_eit_slots"))
+	{
+		knob::sdomino_eit_slots = atoi(value);
+	}
+	else if (MATCH("", "sdomino_degree"))
+	{
+		knob::sdomino_degree = atoi(value);
+	}
+
+	/* sisb */
+	else if (MATCH("", "sisb_degree"))
+	{
+		knob::sisb_degree = atoi(value);
+	}
+	else if (MATCH("", "sisb_bounded"))
+	{
+		knob::sisb_bounded = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "sisb_tu_size"))
+	{
+		knob::sisb_tu_size = atoi(value);
+	}
+	else if (MATCH("", "sisb_tu_ways"))
+	{
+		knob::sisb_tu_ways = atoi(value);
+	}
+	else if (MATCH("", "sisb_cache_size"))
+	{
+		knob::sisb_cache_size = atoi(value);
+	}
+	else if (MATCH("", "sisb_cache_ways"))
+	{
+		knob::sisb_cache_ways = atoi(value);
+	}
+	else if (MATCH("", "sisb_replacement"))
+	{
+		knob::sisb_replacement = string(value);
+	}
+	else if (MATCH("", "sisb_pc_stats_sample"))
+	{
+		knob::sisb_pc_stats_sample = atoi(value);
+	}
 
 	/* Stride Prefetcher */
 	else if (MATCH("", "stride_num_trackers"))
@@ -1492,6 +1683,18 @@ int parse_knobs(void *user, const char *section, const char *name, const char *v
 	{
 		knob::le_enable_action_plot = !strcmp(value, "true") ? true : false;
 	}
+	else if (MATCH("", "le_enable_fixed_point"))
+	{
+		knob::le_enable_fixed_point = !strcmp(value, "true") ? true : false;
+	}
+	else if (MATCH("", "le_fixed_point_int_bits"))
+	{
+		knob::le_fixed_point_int_bits = atoi(value);
+	}
+	else if (MATCH("", "le_fixed_point_frac_bits"))
+	{
+		knob::le_fixed_point_frac_bits = atoi(value);
+	}
 
 	/* Featurewise Learning Engine */
 	else if (MATCH("", "le_featurewise_active_features"))
@@ -3,8 +3,10 @@
 #include <string.h>
 #include <strings.h>
 #include <sstream>
+#include "checkpoint.h"
 #include "learning_engine_basic.h"
 #include "scooby.h"
+#include "stats.h"
 // #include "velma.h"
 #include "util.h"
 
@@ -31,18 +33,17 @@ namespace knob
 	extern uint32_t le_action_trace_interval;
 	extern std::string le_action_trace_name;
 	extern bool     le_enable_action_plot;
+	extern bool     le_enable_fixed_point;
+	extern uint32_t le_fixed_point_int_bits;
+	extern uint32_t le_fixed_point_frac_bits;
 }
 
 LearningEngineBasic::LearningEngineBasic(Prefetcher *parent, float alpha, float gamma, float epsilon, uint32_t actions, uint32_t states, uint64_t seed, std::string policy, std::string type, bool zero_init, uint64_t early_exploration_window)
 	: LearningEngineBase(parent, alpha, gamma, epsilon, actions, states, seed, policy, type)
 {
-	qtable = (float**)calloc(m_states, sizeof(float*));
-	assert(qtable);
-	for(uint32_t index = 0; index < m_states; ++index)
-	{
-		qtable[index] = (float*)calloc(m_actions, sizeof(float));
-		assert(qtable);
-	}
+	fixed_point = knob::le_enable_fixed_point;
+	qtable = NULL;
+	qtable_fx = NULL;
 
 	/* init Q-table */
 	if(zero_init)
@@ -53,11 +54,36 @@ LearningEngineBasic::LearningEngineBasic(Prefetcher *parent, float alpha, float
 	{
 		init_value = (float)1ul/(1-gamma);
 	}
-	for(uint32_t row = 0; row < m_states; ++row)
+
+	if(fixed_point)
+	{
+		fixed.init(knob::le_fixed_point_int_bits, knob::le_fixed_point_frac_bits, alpha, gamma);
+		int16_t init_value_fx = fixed.from_float(init_value);
+		init_value = fixed.to_float(init_value_fx); /* the value the table actually starts at */
+		qtable_fx = (int16_t**)calloc(m_states, sizeof(int16_t*));
+		assert(qtable_fx);
+		for(uint32_t row = 0; row < m_states; ++row)
+		{
+			qtable_fx[row] = (int16_t*)calloc(m_actions, sizeof(int16_t));
+			assert(qtable_fx[row]);
+			for(uint32_t col = 0; col < m_actions; ++col)
+			{
+				qtable_fx[row][col] = init_value_fx;
+			}
+		}
+	}
+	else
 	{
-		for(uint32_t col = 0; col < m_actions; ++col)
+		qtable = (float**)calloc(m_states, sizeof(float*));
+		assert(qtable);
+		for(uint32_t row = 0; row < m_states; ++row)
 		{
-			qtable[row][col] = init_value;
+			qtable[row] = (float*)calloc(m_actions, sizeof(float));
+			assert(qtable[row]);
+			for(uint32_t col = 0; col < m_actions; ++col)
+			{
+				qtable[row][col] = init_value;
+			}
 		}
 	}
 
@@ -91,9 +117,9 @@ LearningEngineBasic::~LearningEngineBasic()
 {
 	for(uint32_t row = 0; row < m_states; ++row)
 	{
-		free(qtable[row]);
+		free(fixed_point ? (void*)qtable_fx[row] : (void*)qtable[row]);
 	}
-	free(qtable);
+	free(fixed_point ? (void*)qtable_fx : (void*)qtable);
 	if(knob::le_enable_trace && trace)
 	{
 		fclose(trace);
@@ -148,8 +174,16 @@ void LearningEngineBasic::learn(uint32_t state1, uint32_t action1, int32_t rewar
 		Qsa2 = consultQ(state2, action2);
 		Qsa1_old = Qsa1;
 		/* SARSA */
-		Qsa1 = Qsa1 + m_alpha * ((float)reward + m_gamma * Qsa2 - Qsa1);
-		updateQ(state1, action1, Qsa1);
+		if(fixed_point)
+		{
+			qtable_fx[state1][action1] = fixed.sarsa(qtable_fx[state1][action1], reward, qtable_fx[state2][action2]);
+			Qsa1 = consultQ(state1, action1);
+		}
+		else
+		{
+			Qsa1 = Qsa1 + m_alpha * ((float)reward + m_gamma * Qsa2 - Qsa1);
+			updateQ(state1, action1, Qsa1);
+		}
 		MYLOG("Q(%x,%u) = %.2f, R = %d, Q(%x,%u) = %.2f, Q(%x,%u) = %.2f", state1, action1, Qsa1_old, reward, state2, action2, Qsa2, state1, action1, Qsa1);
 		MYLOG("state %x, scores %s", state1, getStringQ(state1).c_str());
 
@@ -169,19 +203,38 @@ void LearningEngineBasic::learn(uint32_t state1, uint32_t action1, int32_t rewar
 float LearningEngineBasic::consultQ(uint32_t state, uint32_t action)
 {
 	assert(state < m_states && action < m_actions);
-	float value = qtable[state][action];
+	float value = fixed_point ? fixed.to_float(qtable_fx[state][action]) : qtable[state][action];
 	return value;
 }
 
 void LearningEngineBasic::updateQ(uint32_t state, uint32_t action, float value)
 {
 	assert(state < m_states && action < m_actions);
-	qtable[state][action] = value;	
+	if(fixed_point)
+		qtable_fx[state][action] = fixed.from_float(value);
+	else
+		qtable[state][action] = value;
 }
 
 uint32_t LearningEngineBasic::getMaxAction(uint32_t state)
 {
 	assert(state < m_states);
+	if(fixed_point)
+	{
+		/* the format is monotonic, so the raw integers pick the same action */
+		int16_t max_fx = qtable_fx[state][0];
+		uint32_t action = 0;
+		for(uint32_t index = 1; index < m_actions; ++index)
+		{
+			if(qtable_fx[state][index] > max_fx)
+			{
+				max_fx = qtable_fx[state][index];
+				action = index;
+			}
+		}
+		return action;
+	}
+
 	float max = qtable[state][0];
 	uint32_t action = 0;
 	for(uint32_t index = 1; index < m_actions; ++index)
@@ -201,62 +254,84 @@ std::string LearningEngineBasic::getStringQ(uint32_t state)
 	std::stringstream ss;
 	for(uint32_t index = 0; index < m_actions; ++index)
 	{
-		ss << qtable[state][index] << ",";
+		ss << consultQ(state, index) << ",";
 	}
 	return ss.str();
 }
 
-void LearningEngineBasic::print_aux_stats()
+/* state-action table usage: how many state entries are actually used? */
+uint32_t LearningEngineBasic::count_used_states()
 {
-	/* compute state-action table usage
-	 * how mane state entries are actually used?
-	 * heat-map dump, etc. etc. */
 	uint32_t state_used = 0;
 	for(uint32_t state = 0; state < m_states; ++state)
 	{
 		for(uint32_t action = 0; action < m_actions; ++action)
 		{
-			if(qtable[state][action] != init_value)
+			if(consultQ(state, action) != init_value)
 			{
 				state_used++;
 				break;
 			}
 		}
 	}
-
-	fprintf(stdout, "learning_engine.state_used %u\n", state_used);
-	fprintf(stdout, "\n");
+	return state_used;
 }
 
-void LearningEngineBasic::dump_stats()
+void LearningEngineBasic::register_stats()
 {
 	Scooby *scooby = (Scooby*)m_parent;
-	fprintf(stdout, "learning_engine.action.called %lu\n", stats.action.called);
-	fprintf(stdout, "learning_engine.action.explore %lu\n", stats.action.explore);
-	fprintf(stdout, "learning_engine.action.exploit %lu\n", stats.action.exploit);
+	stats_registry.counter("learning_engine.action.called", &stats.action.called);
+	stats_registry.counter("learning_engine.action.explore", &stats.action.explore);
+	stats_registry.counter("learning_engine.action.exploit", &stats.action.exploit);
 	for(uint32_t action = 0; action < m_actions; ++action)
 	{
-		fprintf(stdout, "learning_engine.action.index_%d_explored %lu\n", scooby->getAction(action), stats.action.dist[action][0]);
-		fprintf(stdout, "learning_engine.action.index_%d_exploited %lu\n", scooby->getAction(action), stats.action.dist[action][1]);
+		string name = "learning_engine.action.index_" + to_string(scooby->getAction(action));
+		stats_registry.counter(name + "_explored", &stats.action.dist[action][0]);
+		stats_registry.counter(name + "_exploited", &stats.action.dist[action][1]);
 	}
-	fprintf(stdout, "learning_engine.learn.called %lu\n", stats.learn.called);
-	fprintf(stdout, "\n");
+	stats_registry.counter("learning_engine.learn.called", &stats.learn.called);
+	stats_registry.blank();
 
-	print_aux_stats();
+	stats_registry.value("learning_engine.state_used", [this]() { return count_used_states(); });
+	stats_registry.blank();
+}
 
+void LearningEngineBasic::dump_stats()
+{
 	if(knob::le_enable_trace && knob::le_enable_score_plot)
 	{
 		plot_scores();
 	}
 }
 
+void LearningEngineBasic::checkpoint(CHECKPOINT &cp)
+{
+	cp.check(m_states, "learning engine states");
+	cp.check(m_actions, "learning engine actions");
+	cp.check(fixed_point, "learning engine fixed point");
+	for(uint32_t row = 0; row < m_states; ++row)
+	{
+		if(fixed_point)
+		{
+			cp.array(qtable_fx[row], m_actions);
+		}
+		else
+		{
+			cp.array(qtable[row], m_actions);
+		}
+	}
+	cp.engine(generator);
+	cp.scalar(m_action_counter);
+	cp.scalar(stats);
+}
+
 void LearningEngineBasic::dump_state_trace(uint32_t state)
 {
 	trace_timestamp++;
 	fprintf(trace, "%lu,", trace_timestamp);
 	for(uint32_t index = 0; index < m_actions; ++index)
 	{
-		fprintf(trace, "%.2f,", qtable[state][index]);
+		fprintf(trace, "%.2f,", consultQ(state, index));
 	}
 	fprintf(trace, "\n");
 	fflush(trace);
@@ -4,8 +4,10 @@
 #include <strings.h>
 #include <numeric>
 #include "util.h"
+#include "checkpoint.h"
 #include "learning_engine_featurewise.h"
 #include "scooby.h"
+#include "stats.h"
 
 #if 0
 #	define LOCKED(...) {fflush(stdout); __VA_ARGS__; fflush(stdout);}
@@ -63,6 +65,8 @@ void LearningEngineFeaturewise::init_stats()
 LearningEngineFeaturewise::LearningEngineFeaturewise(Prefetcher *parent, float alpha, float gamma, float epsilon, uint32_t actions, uint64_t seed, std::string policy, std::string type, bool zero_init)
 	: LearningEngineBase(parent, alpha, gamma, epsilon, actions, 0 /*dummy state value*/, seed, policy, type)
 {
+	assert(m_actions <= MAX_ACTIONS);
+
 	/* init each feature engine */
 	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
 	{
@@ -187,18 +191,20 @@ uint32_t LearningEngineFeaturewise::getMaxAction(State *state, float &max_q, flo
 {
 	float max_q_value = 0.0, q_value = 0.0, total_q_value = 0.0;
 	uint32_t selected_action = 0, init_index = 0;
+	float q_values[MAX_ACTIONS];
 
 	bool fallback = do_fallback(state);
+	consultQ(state, q_values);
 
 	if(!fallback)
 	{
-		max_q_value = consultQ(state, 0);
+		max_q_value = q_values[0];
 		total_q_value += max_q_value;
 		init_index = 1;
 	}
 	for(uint32_t action = init_index; action < m_actions; ++action)
 	{
-		q_value = consultQ(state, action);
+		q_value = q_values[action];
 		total_q_value += q_value;
 		if(q_value > max_q_value)
 		{
@@ -232,28 +238,39 @@ uint32_t LearningEngineFeaturewise::getMaxAction(State *state, float &max_q, flo
 	return selected_action;
 }
 
-float LearningEngineFeaturewise::consultQ(State *state, uint32_t action)
+/* pooled Q-values of all actions; also leaves each feature's own Q-values in m_feature_q_values */
+void LearningEngineFeaturewise::consultQ(State *state, float *q_values)
 {
-	assert(action < m_actions);
-	float q_value = 0.0;
-	float max = -1000000000.0;
+	float max[MAX_ACTIONS];
+	for(uint32_t action = 0; action < m_actions; ++action)
+	{
+		q_values[action] = 0.0;
+		max[action] = -1000000000.0;
+	}
 
 	/* pool Q-value accross all feature tables */
 	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
 	{
 		if(m_feature_knowledges[index])
 		{
+			float *feature_q = m_feature_q_values[index];
+			m_feature_knowledges[index]->retrieveQ(state, feature_q);
 			if(knob::le_featurewise_pooling_type == 1) /* sum pooling */
 			{
-				q_value += m_feature_knowledges[index]->retrieveQ(state, action);
+				for(uint32_t action = 0; action < m_actions; ++action)
+				{
+					q_values[action] += feature_q[action];
+				}
 			}
 			else if(knob::le_featurewise_pooling_type == 2) /* max pooling */
 			{
-				float tmp = m_feature_knowledges[index]->retrieveQ(state, action);
-				if(tmp >= max)
+				for(uint32_t action = 0; action < m_actions; ++action)
 				{
-					max = tmp;
-					q_value = tmp;
+					if(feature_q[action] >= max[action])
+					{
+						max[action] = feature_q[action];
+						q_values[action] = feature_q[action];
+					}
 				}
 			}
 			else
@@ -262,64 +279,67 @@ float LearningEngineFeaturewise::consultQ(State *state, uint32_t action)
 			}
 		}
 	}
-	return q_value;
 }
 
-void LearningEngineFeaturewise::dump_stats()
+void LearningEngineFeaturewise::register_stats()
 {
 	Scooby *scooby = (Scooby*)m_parent;
-	fprintf(stdout, "learning_engine_featurewise.action.called %lu\n", stats.action.called);
-	fprintf(stdout, "learning_engine_featurewise.action.explore %lu\n", stats.action.explore);
-	fprintf(stdout, "learning_engine_featurewise.action.exploit %lu\n", stats.action.exploit);
-	fprintf(stdout, "learning_engine_featurewise.action.fallback %lu\n", stats.action.fallback);
-	fprintf(stdout, "learning_engine_featurewise.action.dyn_fallback_saved_bw %lu\n", stats.action.dyn_fallback_saved_bw);
-	fprintf(stdout, "learning_engine_featurewise.action.dyn_fallback_saved_bw_acc %lu\n", stats.action.dyn_fallback_saved_bw_acc);
+	stats_registry.counter("learning_engine_featurewise.action.called", &stats.action.called);
+	stats_registry.counter("learning_engine_featurewise.action.explore", &stats.action.explore);
+	stats_registry.counter("learning_engine_featurewise.action.exploit", &stats.action.exploit);
+	stats_registry.counter("learning_engine_featurewise.action.fallback", &stats.action.fallback);
+	stats_registry.counter("learning_engine_featurewise.action.dyn_fallback_saved_bw", &stats.action.dyn_fallback_saved_bw);
+	stats_registry.counter("learning_engine_featurewise.action.dyn_fallback_saved_bw_acc", &stats.action.dyn_fallback_saved_bw_acc);
 	for(uint32_t action = 0; action < m_actions; ++action)
 	{
-		fprintf(stdout, "learning_engine_featurewise.action.index_%d_explored %lu\n", scooby->getAction(action), stats.action.dist[action][0]);
-		fprintf(stdout, "learning_engine_featurewise.action.index_%d_exploited %lu\n", scooby->getAction(action), stats.action.dist[action][1]);
+		string name = "learning_engine_featurewise.action.index_" + to_string(scooby->getAction(action));
+		stats_registry.counter(name + "_explored", &stats.action.dist[action][0]);
+		stats_registry.counter(name + "_exploited", &stats.action.dist[action][1]);
 	}
-	fprintf(stdout, "learning_engine_featurewise.learn.called %lu\n", stats.learn.called);
+	stats_registry.counter("learning_engine_featurewise.learn.called", &stats.learn.called);
 	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
 	{
 		if(m_feature_knowledges[index])
 		{
-			fprintf(stdout, "learning_engine_featurewise.learn.su_skip_%s %lu\n", FeatureKnowledge::getFeatureString((FeatureType)index).c_str(), stats.learn.su_skip[index]);
+			stats_registry.counter("learning_engine_featurewise.learn.su_skip_" + FeatureKnowledge::getFeatureString((FeatureType)index), &stats.learn.su_skip[index]);
 		}
 	}
-	fprintf(stdout, "\n");
+	stats_registry.blank();
 
 	/* plot histogram */
-	for(uint32_t index = 0; index < m_q_value_histogram.size(); ++index)
-	{
-		fprintf (stdout, "learning_engine_featurewise.q_value_histogram.bucket_%u %lu\n", index, m_q_value_histogram[index]);
-	}
-	fprintf(stdout, "\n");
+	stats_registry.histogram("learning_engine_featurewise.q_value_histogram.bucket", m_q_value_histogram.data(), m_q_value_histogram.size());
+	stats_registry.blank();
 
 	/* consensus stats */
-	fprintf(stdout, "learning_engine_featurewise.consensus.total %lu\n", stats.consensus.total);
+	stats_registry.counter("learning_engine_featurewise.consensus.total", &stats.consensus.total);
 	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
 	{
 		if(m_feature_knowledges[index])
 		{
-			fprintf(stdout, "learning_engine_featurewise.consensus.feature_align_%s %lu\n", FeatureKnowledge::getFeatureString((FeatureType)index).c_str(), stats.consensus.feature_align_dist[index]);
-			fprintf(stdout, "learning_engine_featurewise.consensus.feature_align_%s_ratio %0.2f\n", FeatureKnowledge::getFeatureString((FeatureType)index).c_str(), (float)stats.consensus.feature_align_dist[index]/stats.consensus.total);
+			string name = "learning_engine_featurewise.consensus.feature_align_" + FeatureKnowledge::getFeatureString((FeatureType)index);
+			stats_registry.counter(name, &stats.consensus.feature_align_dist[index]);
+			stats_registry.ratio(name + "_ratio", [this, index]() { return (float)stats.consensus.feature_align_dist[index] / stats.consensus.total; }, "%0.2f");
 		}
 	}
-	fprintf(stdout, "learning_engine_featurewise.consensus.feature_align_all %lu\n", stats.consensus.feature_align_all);
-	fprintf(stdout, "learning_engine_featurewise.consensus.feature_align_all_ratio %0.2f\n", (float)stats.consensus.feature_align_all/stats.consensus.total);
-	fprintf(stdout, "\n");
+	stats_registry.counter("learning_engine_featurewise.consensus.feature_align_all", &stats.consensus.feature_align_all);
+	stats_registry.ratio("learning_engine_featurewise.consensus.feature_align_all_ratio", [this]() { return (float)stats.consensus.feature_align_all / stats.consensus.total; }, "%0.2f");
+	stats_registry.blank();
 
 	/* weight stats */
 	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
 	{
 		if(m_feature_knowledges[index])
 		{
-			fprintf(stdout, "learning_engine_featurewise.feature_%s_min_weight %0.8f\n", FeatureKnowledge::getFeatureString((FeatureType)index).c_str(), m_feature_knowledges[index]->get_min_weight());
-			fprintf(stdout, "learning_engine_featurewise.feature_%s_max_weight %0.8f\n", FeatureKnowledge::getFeatureString((FeatureType)index).c_str(), m_feature_knowledges[index]->get_max_weight());
+			FeatureKnowledge *feature = m_feature_knowledges[index];
+			string name = "learning_engine_featurewise.feature_" + FeatureKnowledge::getFeatureString((FeatureType)index);
+			stats_registry.ratio(name + "_min_weight", [feature]() { return feature->get_min_weight(); }, "%0.8f");
+			stats_registry.ratio(name + "_max_weight", [feature]() { return feature->get_max_weight(); }, "%0.8f");
 		}
 	}
+}
 
+void LearningEngineFeaturewise::dump_stats()
+{
 	/* score plotting */
 	if(knob::le_featurewise_enable_trace && knob::le_featurewise_enable_score_plot)
 	{
@@ -327,6 +347,21 @@ void LearningEngineFeaturewise::dump_stats()
 	}
 }
 
+void LearningEngineFeaturewise::checkpoint(CHECKPOINT &cp)
+{
+	for(uint32_t index = 0; index < NumFeatureTypes; ++index)
+	{
+		cp.check(m_feature_knowledges[index] != NULL, "featurewise engine active features");
+		if(m_feature_knowledges[index])
+		{
+			m_feature_knowledges[index]->checkpoint(cp);
+		}
+	}
+	cp.engine(m_generator);
+	cp.vector_entries(m_q_value_histogram);
+	cp.scalar(stats);
+}
+
 void LearningEngineFeaturewise::gather_stats(float max_q, float max_to_avg_q_ratio)
 {
 	float high = 0.0, low = 0.0;
@@ -342,7 +377,8 @@ void LearningEngineFeaturewise::gather_stats(float max_q, float max_to_avg_q_rat
 	}
 }
 
-/* consensus stats: whether each feature's maxAction decision aligns with the final selected action */
+/* consensus stats: whether each feature's maxAction decision aligns with the final selected action
+ * each feature decides on the Q-values consultQ just retrieved for this state */
 void LearningEngineFeaturewise::action_selection_consensus(State *state, uint32_t selected_action, vector<bool> &consensus_vec)
 {
 	stats.consensus.total++;
@@ -351,7 +387,7 @@ void LearningEngineFeaturewise::action_selection_consensus(State *state, uint32_
 	{
 		if(m_feature_knowledges[index])
 		{
-			if(m_feature_knowledges[index]->getMaxAction(state) == selected_action)
+			if(m_feature_knowledges[index]->getMaxAction(m_feature_q_values[index]) == selected_action)
 			{
 				stats.consensus.feature_align_dist[index]++;
 				consensus_vec[index] = true;
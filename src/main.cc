@@ -1,10 +1,18 @@
 #define _BSD_SOURCE
 
 #include <getopt.h>
+#include <sys/prctl.h>
 #include "ooo_cpu.h"
 #include "uncore.h"
 #include "knobs.h"
+#include "checkpoint.h"
+#include "stats.h"
+#include "interval_stats.h"
+#include "profile.h"
 #include <fstream>
+#include <algorithm>
+#include <thread>
+#include "cycle_barrier.h"
 
 #define FIXED_FLOAT(x) std::fixed << std::setprecision(5) << (x)
 
@@ -50,16 +58,43 @@ namespace knob
     extern bool l2c_semi_perfect;
     extern bool llc_semi_perfect;
     extern uint32_t semi_perfect_cache_page_buffer_size;
+    extern string   trace_cache_dir;
+    extern string   checkpoint_save;
+    extern string   checkpoint_load;
+    extern bool     checkpoint_exit;
+    extern bool     skip_idle_cycles;
+    extern bool     parallel_cores;
+    extern string   stats_json_file;
+    extern string   interval_stats_file;
+    extern uint64_t interval_stats_epoch;
+    extern uint32_t interval_stats_buffer;
+    extern vector<string> interval_stats_counters;
+    extern vector<string> fanout_config;
+    extern string   fanout_output_dir;
 }
 
 time_t start_time;
+uint8_t show_heartbeat = 1;
 
 // PAGE TABLE
 uint32_t PAGE_TABLE_LATENCY = 0, SWAP_LATENCY = 0;
 queue <uint64_t > page_queue;
-map <uint64_t, uint64_t> page_table, inverse_table, recent_page, unique_cl[NUM_CPUS];
+FLAT_MAP page_table, inverse_table, unique_cl[NUM_CPUS];
+vector <uint64_t> resident_vpages; // min-heap of the vpages in page_table, for victim selection
 uint64_t previous_ppage, num_adjacent_page, num_cl[NUM_CPUS], allocated_pages, num_page[NUM_CPUS], minor_fault[NUM_CPUS], major_fault[NUM_CPUS];
 
+// set by finish_warmup() when the warmed-up state is to be saved at the end of that cycle
+uint8_t checkpoint_pending = 0;
+
+// cycles fast-forwarded by the main loop with skip_idle_cycles
+uint64_t skipped_cycles = 0;
+
+// parallel_cores: threads of cores 1 and up, and the core order drawn for the current cycle
+CYCLE_BARRIER *core_barrier = NULL;
+vector <thread *> core_threads;
+uint8_t core_threads_exit = 0;
+int core_order[NUM_CPUS];
+
 void record_roi_stats(uint32_t cpu, CACHE *cache)
 {
     for (uint32_t i=0; i<NUM_TYPES; i++) {
@@ -69,63 +104,53 @@ void record_roi_stats(uint32_t cpu, CACHE *cache)
     }
 }
 
-void print_roi_stats(uint32_t cpu, CACHE *cache)
+void register_roi_stats(uint32_t cpu, CACHE *cache)
 {
-    uint64_t TOTAL_ACCESS = 0, TOTAL_HIT = 0, TOTAL_MISS = 0;
-
+    string prefix = "Core_" + to_string(cpu) + "_" + cache->NAME;
+    const char *type_name[NUM_TYPES][3] = {{"_loads", "_load_hit", "_load_miss"},
+                                           {"_RFOs", "_RFO_hit", "_RFO_miss"},
+                                           {"_prefetches", "_prefetch_hit", "_prefetch_miss"},
+                                           {"_writebacks", "_writeback_hit", "_writeback_miss"}};
+
+    stats_registry.at_end(true);
+    stats_registry.value(prefix + "_total_access", [=]() { uint64_t total = 0; for (uint32_t i=0; i<NUM_TYPES; i++) total += cache->roi_access[cpu][i]; return total; });
+    stats_registry.value(prefix + "_total_hit", [=]() { uint64_t total = 0; for (uint32_t i=0; i<NUM_TYPES; i++) total += cache->roi_hit[cpu][i]; return total; });
+    stats_registry.value(prefix + "_total_miss", [=]() { uint64_t total = 0; for (uint32_t i=0; i<NUM_TYPES; i++) total += cache->roi_miss[cpu][i]; return total; });
     for (uint32_t i=0; i<NUM_TYPES; i++) {
-        TOTAL_ACCESS += cache->roi_access[cpu][i];
-        TOTAL_HIT += cache->roi_hit[cpu][i];
-        TOTAL_MISS += cache->roi_miss[cpu][i];
+        stats_registry.counter(prefix + type_name[i][0], &cache->roi_access[cpu][i]);
+        stats_registry.counter(prefix + type_name[i][1], &cache->roi_hit[cpu][i]);
+        stats_registry.counter(prefix + type_name[i][2], &cache->roi_miss[cpu][i]);
+    }
+    stats_registry.at_end(false);
+    stats_registry.counter(prefix + "_prefetch_requested", &cache->pf_requested);
+    stats_registry.counter(prefix + "_prefetch_dropped", &cache->pf_dropped);
+    stats_registry.counter(prefix + "_prefetch_issued", &cache->pf_issued);
+    stats_registry.counter(prefix + "_prefetch_filled", &cache->pf_filled);
+    stats_registry.counter(prefix + "_prefetch_useful", &cache->pf_useful);
+    stats_registry.counter(prefix + "_prefetch_useless", &cache->pf_useless);
+    stats_registry.counter(prefix + "_prefetch_late", &cache->pf_late);
+    stats_registry.ratio(prefix + "_average_miss_latency", [=]() {
+        uint64_t total_miss = 0;
+        for (uint32_t i=0; i<NUM_TYPES; i++)
+            total_miss += cache->roi_miss[cpu][i];
+        return (1.0*(cache->total_miss_latency))/total_miss;
+    });
+    stats_registry.blank();
+
+    PACKET_QUEUE *queue[3] = {&cache->RQ, &cache->WQ, &cache->PQ};
+    const char *queue_name[3] = {"_rq", "_wq", "_pq"};
+    for (uint32_t i=0; i<3; i++) {
+        stats_registry.counter(prefix + queue_name[i] + "_access", &queue[i]->ACCESS);
+        stats_registry.counter(prefix + queue_name[i] + "_forward", &queue[i]->FORWARD);
+        stats_registry.counter(prefix + queue_name[i] + "_merged", &queue[i]->MERGED);
+        stats_registry.counter(prefix + queue_name[i] + "_to_cache", &queue[i]->TO_CACHE);
+        stats_registry.counter(prefix + queue_name[i] + "_full", &queue[i]->FULL);
+        stats_registry.blank();
     }
 
-    cout<< "Core_" << cpu << "_" << cache->NAME << "_total_access " << TOTAL_ACCESS << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_total_hit " << TOTAL_HIT << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_total_miss " << TOTAL_MISS << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_loads " << cache->roi_access[cpu][0] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_load_hit " << cache->roi_hit[cpu][0] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_load_miss " << cache->roi_miss[cpu][0] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_RFOs " << cache->roi_access[cpu][1] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_RFO_hit " << cache->roi_hit[cpu][1] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_RFO_miss " << cache->roi_miss[cpu][1] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetches " << cache->roi_access[cpu][2] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_hit " << cache->roi_hit[cpu][2] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_miss " << cache->roi_miss[cpu][2] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_writebacks " << cache->roi_access[cpu][3] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_writeback_hit " << cache->roi_hit[cpu][3] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_writeback_miss " << cache->roi_miss[cpu][3] << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_requested " << cache->pf_requested << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_dropped " << cache->pf_dropped << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_issued " << cache->pf_issued << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_filled " << cache->pf_filled << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_useful " << cache->pf_useful << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_useless " << cache->pf_useless << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_prefetch_late " << cache->pf_late << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_average_miss_latency " << (1.0*(cache->total_miss_latency))/TOTAL_MISS << endl
-        << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_rq_access " << cache->RQ.ACCESS << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_rq_forward " << cache->RQ.FORWARD << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_rq_merged " << cache->RQ.MERGED << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_rq_to_cache " << cache->RQ.TO_CACHE << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_rq_full " << cache->RQ.FULL << endl
-        << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_wq_access " << cache->WQ.ACCESS << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_wq_forward " << cache->WQ.FORWARD << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_wq_merged " << cache->WQ.MERGED << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_wq_to_cache " << cache->WQ.TO_CACHE << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_wq_full " << cache->WQ.FULL << endl
-        << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_pq_access " << cache->PQ.ACCESS << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_pq_forward " << cache->PQ.FORWARD << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_pq_merged " << cache->PQ.MERGED << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_pq_to_cache " << cache->PQ.TO_CACHE << endl
-        << "Core_" << cpu << "_" << cache->NAME << "_pq_full " << cache->PQ.FULL << endl
-        << endl;
-
-    cout<< "Core_" << cpu << "_" << cache->NAME << "_acc_epochs " << cache->total_acc_epochs << endl;
-    for(uint32_t i = 0; i < CACHE_ACC_LEVELS; ++i)
-        cout<< "Core_" << cpu << "_" << cache->NAME << "_acc_level_" << i << " " << cache->acc_epoch_hist[i] << endl;
-    cout << endl;
+    stats_registry.counter(prefix + "_acc_epochs", &cache->total_acc_epochs);
+    stats_registry.histogram(prefix + "_acc_level", cache->acc_epoch_hist, CACHE_ACC_LEVELS);
+    stats_registry.blank();
 }
 
 void print_sim_stats(uint32_t cpu, CACHE *cache)
@@ -156,48 +181,162 @@ void print_sim_stats(uint32_t cpu, CACHE *cache)
         << endl;
 }
 
-void print_branch_stats(uint32_t cpu)
+void register_branch_stats(uint32_t cpu)
 {
-    // for (uint32_t i=0; i<NUM_CPUS; i++) {
-        cout << "Core_" << cpu << "_branch_prediction_accuracy " << (100.0*(ooo_cpu[cpu].num_branch - ooo_cpu[cpu].branch_mispredictions)) / ooo_cpu[cpu].num_branch << endl
-            << "Core_" << cpu << "_branch_MPKI " << (1000.0*ooo_cpu[cpu].branch_mispredictions)/(ooo_cpu[cpu].num_retired - ooo_cpu[cpu].warmup_instructions) << endl
-            << "Core_" << cpu << "_average_ROB_occupancy_at_mispredict " << (1.0*ooo_cpu[cpu].total_rob_occupancy_at_branch_mispredict)/ooo_cpu[cpu].branch_mispredictions << endl
-            << endl;
-    // }
+    O3_CPU *core = &ooo_cpu[cpu];
+    string prefix = "Core_" + to_string(cpu);
+    stats_registry.ratio(prefix + "_branch_prediction_accuracy", [=]() { return (100.0*(core->num_branch - core->branch_mispredictions)) / core->num_branch; });
+    stats_registry.ratio(prefix + "_branch_MPKI", [=]() { return (1000.0*core->branch_mispredictions)/(core->num_retired - core->warmup_instructions); });
+    stats_registry.ratio(prefix + "_average_ROB_occupancy_at_mispredict", [=]() { return (1.0*core->total_rob_occupancy_at_branch_mispredict)/core->branch_mispredictions; });
+    stats_registry.blank();
 }
 
-void print_dram_stats()
+void register_dram_stats()
 {
-    // cout << endl;
-    // cout << "DRAM Statistics" << endl;
+    stats_registry.section("DRAM");
     for (uint32_t i=0; i<DRAM_CHANNELS; i++)
     {
-        cout << "Channel_" << i << "_RQ_row_buffer_hit " << uncore.DRAM.RQ[i].ROW_BUFFER_HIT << endl
-            << "Channel_" << i << "_RQ_row_buffer_miss " << uncore.DRAM.RQ[i].ROW_BUFFER_MISS << endl
-            << "Channel_" << i << "_WQ_row_buffer_hit " << uncore.DRAM.WQ[i].ROW_BUFFER_HIT << endl
-            << "Channel_" << i << "_WQ_row_buffer_miss " << uncore.DRAM.WQ[i].ROW_BUFFER_MISS << endl
-            << "Channel_" << i << "_WQ_full " << uncore.DRAM.WQ[i].FULL << endl
-            << "Channel_" << i << "_dbus_congested " << uncore.DRAM.dbus_congested[i][NUM_TYPES][NUM_TYPES] << endl
-            << endl;
+        string prefix = "Channel_" + to_string(i);
+        stats_registry.counter(prefix + "_RQ_row_buffer_hit", &uncore.DRAM.RQ[i].ROW_BUFFER_HIT);
+        stats_registry.counter(prefix + "_RQ_row_buffer_miss", &uncore.DRAM.RQ[i].ROW_BUFFER_MISS);
+        stats_registry.counter(prefix + "_WQ_row_buffer_hit", &uncore.DRAM.WQ[i].ROW_BUFFER_HIT);
+        stats_registry.counter(prefix + "_WQ_row_buffer_miss", &uncore.DRAM.WQ[i].ROW_BUFFER_MISS);
+        stats_registry.counter(prefix + "_WQ_full", &uncore.DRAM.WQ[i].FULL);
+        stats_registry.counter(prefix + "_dbus_congested", &uncore.DRAM.dbus_congested[i][NUM_TYPES][NUM_TYPES]);
+        stats_registry.blank();
     }
 
-    uint64_t total_congested_cycle = 0, total_congested = 0;
-    for (uint32_t i=0; i<DRAM_CHANNELS; i++){
-        total_congested_cycle += uncore.DRAM.dbus_cycle_congested[i];
-	total_congested += uncore.DRAM.dbus_congested[i][NUM_TYPES][NUM_TYPES];
+    stats_registry.value("avg_congested_cycle", []() {
+        uint64_t total_congested_cycle = 0, total_congested = 0;
+        for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+            total_congested_cycle += uncore.DRAM.dbus_cycle_congested[i];
+            total_congested += uncore.DRAM.dbus_congested[i][NUM_TYPES][NUM_TYPES];
+        }
+        return total_congested ? (total_congested_cycle / total_congested) : 0;
+    });
+    stats_registry.blank();
+
+    stats_registry.counter("DRAM_bw_pochs", &uncore.DRAM.total_bw_epochs);
+    stats_registry.histogram("DRAM_bw_level", uncore.DRAM.bw_level_hist, DRAM_BW_LEVELS);
+}
+
+// everything main() prints at the end of the run, in the order it is printed
+void register_stats()
+{
+    stats_registry.section("ROI");
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+    {
+        O3_CPU *core = &ooo_cpu[i];
+        string prefix = "Core_" + to_string(i);
+        stats_registry.at_end(true);
+        stats_registry.counter(prefix + "_instructions", &core->finish_sim_instr);
+        stats_registry.counter(prefix + "_cycles", &core->finish_sim_cycle);
+        stats_registry.at_end(false);
+        stats_registry.ratio(prefix + "_IPC", [=]() { return (float) core->finish_sim_instr / core->finish_sim_cycle; });
+        stats_registry.blank();
+#ifndef CRC2_COMPILE
+        register_branch_stats(i);
+        register_roi_stats(i, &ooo_cpu[i].L1D);
+        register_roi_stats(i, &ooo_cpu[i].L1I);
+        register_roi_stats(i, &ooo_cpu[i].L2C);
+#endif
+        register_roi_stats(i, &uncore.LLC);
+        stats_registry.counter(prefix + "_major_page_fault", &major_fault[i]);
+        stats_registry.counter(prefix + "_minor_page_fault", &minor_fault[i]);
+        stats_registry.blank();
     }
-    if (total_congested)
-        cout << "avg_congested_cycle " << (total_congested_cycle / total_congested) << endl;
-    else
-        cout << "avg_congested_cycle 0" << endl;
-    cout << endl;
 
-    cout << "DRAM_bw_pochs " << uncore.DRAM.total_bw_epochs << endl;
-    for(uint32_t index = 0; index < DRAM_BW_LEVELS; ++index)
+#ifndef CRC2_COMPILE
+    register_dram_stats();
+#endif
+}
+
+// live counters for --interval_stats_file, sampled when no interval_stats_counters are given
+// never printed: the end-of-run dump has the ROI versions of these
+// the per-type cache counters are sampleable by name (Core_0_L2C_sim_load_miss) but not sampled by default
+void register_interval_stats()
+{
+    const char *type_name[NUM_TYPES] = {"load", "RFO", "prefetch", "writeback"};
+    stats_registry.section("INTERVAL");
+    for (uint32_t i=0; i<NUM_CPUS; i++)
     {
-        cout << "DRAM_bw_level_" << index << " " << uncore.DRAM.bw_level_hist[index] << endl;
+        O3_CPU *core = &ooo_cpu[i];
+        string prefix = "Core_" + to_string(i);
+        stats_registry.counter(prefix + "_retired", &core->num_retired);
+        stats_registry.counter(prefix + "_cycle", &current_core_cycle[i]);
+        CACHE *caches[3] = {&core->L1D, &core->L2C, &uncore.LLC};
+        for (uint32_t j=0; j<3; j++) {
+            CACHE *cache = caches[j];
+            stats_registry.value(prefix + "_" + cache->NAME + "_demand_access", [=]() { return cache->sim_access[i][LOAD] + cache->sim_access[i][RFO]; });
+            stats_registry.value(prefix + "_" + cache->NAME + "_demand_miss", [=]() { return cache->sim_miss[i][LOAD] + cache->sim_miss[i][RFO]; });
+        }
     }
+    stats_registry.section("INTERVAL_TYPES");
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+    {
+        CACHE *caches[3] = {&ooo_cpu[i].L1D, &ooo_cpu[i].L2C, &uncore.LLC};
+        for (uint32_t j=0; j<3; j++) {
+            string prefix = "Core_" + to_string(i) + "_" + caches[j]->NAME + "_sim_";
+            for (uint32_t k=0; k<NUM_TYPES; k++) {
+                stats_registry.counter(prefix + type_name[k] + "_access", &caches[j]->sim_access[i][k]);
+                stats_registry.counter(prefix + type_name[k] + "_miss", &caches[j]->sim_miss[i][k]);
+            }
+        }
+    }
+
+#ifndef CRC2_COMPILE
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        string prefix = "Channel_" + to_string(i);
+        stats_registry.value(prefix + "_RQ_occupancy", [=]() { return (uint64_t)uncore.DRAM.RQ[i].occupancy; });
+        stats_registry.value(prefix + "_WQ_occupancy", [=]() { return (uint64_t)uncore.DRAM.WQ[i].occupancy; });
+    }
+    stats_registry.value("DRAM_bw_level", []() { return (uint64_t)uncore.DRAM.bw; });
+#endif
+}
+
+#ifdef ENABLE_PROFILE
+void register_cache_profile(string prefix, CACHE *cache)
+{
+    profile_register(prefix + "_operate", &cache->profile_operate);
+    profile_register(prefix + "_handle_fill", &cache->profile_handle_fill);
+    profile_register(prefix + "_handle_writeback", &cache->profile_handle_writeback);
+    profile_register(prefix + "_handle_read", &cache->profile_handle_read);
+    profile_register(prefix + "_handle_prefetch", &cache->profile_handle_prefetch);
+    for (uint32_t i=0; i<cache->prefetchers.size(); i++)
+        profile_register(prefix + "_" + cache->prefetchers[i]->get_type(), &cache->prefetchers[i]->profile);
+    for (uint32_t i=0; i<cache->l1d_prefetchers.size(); i++)
+        profile_register(prefix + "_" + cache->l1d_prefetchers[i]->get_type(), &cache->l1d_prefetchers[i]->profile);
+}
+
+// host time per component, printed as [Profile] at the end; main_loop keeps what no component took
+void register_profile()
+{
+    profile_register("main_loop", &profile_main_loop);
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+    {
+        O3_CPU *core = &ooo_cpu[i];
+        string prefix = "Core_" + to_string(i);
+        profile_register(prefix + "_handle_branch", &core->profile_handle_branch);
+        profile_register(prefix + "_fetch_instruction", &core->profile_fetch_instruction);
+        profile_register(prefix + "_schedule_instruction", &core->profile_schedule_instruction);
+        profile_register(prefix + "_execute_instruction", &core->profile_execute_instruction);
+        profile_register(prefix + "_schedule_memory_instruction", &core->profile_schedule_memory_instruction);
+        profile_register(prefix + "_execute_memory_instruction", &core->profile_execute_memory_instruction);
+        profile_register(prefix + "_update_rob", &core->profile_update_rob);
+        profile_register(prefix + "_retire_rob", &core->profile_retire_rob);
+        register_cache_profile(prefix + "_ITLB", &core->ITLB);
+        register_cache_profile(prefix + "_DTLB", &core->DTLB);
+        register_cache_profile(prefix + "_STLB", &core->STLB);
+        register_cache_profile(prefix + "_L1I", &core->L1I);
+        register_cache_profile(prefix + "_L1D", &core->L1D);
+        register_cache_profile(prefix + "_L2C", &core->L2C);
+    }
+    register_cache_profile("LLC", &uncore.LLC);
+    profile_register("DRAM_operate", &uncore.DRAM.profile_operate);
+    profile_register("DRAM_schedule", &uncore.DRAM.profile_schedule);
+    profile_register("DRAM_process", &uncore.DRAM.profile_process);
 }
+#endif
 
 void reset_cache_stats(uint32_t cpu, CACHE *cache)
 {
@@ -278,6 +417,9 @@ void finish_warmup()
         ooo_cpu[i].L2C.LATENCY  = L2C_LATENCY;
     }
     uncore.LLC.LATENCY = LLC_LATENCY;
+
+    if (knob::checkpoint_save.size())
+        checkpoint_pending = 1;
 }
 
 void print_deadlock(uint32_t i)
@@ -369,63 +511,54 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
     // smart random number generator
     uint64_t random_ppage;
 
-    map <uint64_t, uint64_t>::iterator pr = page_table.begin();
-    map <uint64_t, uint64_t>::iterator ppage_check = inverse_table.begin();
-
     // check unique cache line footprint
-    map <uint64_t, uint64_t>::iterator cl_check = unique_cl[cpu].find(unique_va >> LOG2_BLOCK_SIZE);
-    if (cl_check == unique_cl[cpu].end()) { // we've never seen this cache line before
-        unique_cl[cpu].insert(make_pair(unique_va >> LOG2_BLOCK_SIZE, 0));
+    uint64_t *cl_check = unique_cl[cpu].find(unique_va >> LOG2_BLOCK_SIZE);
+    if (cl_check == NULL) { // we've never seen this cache line before
+        unique_cl[cpu].insert(unique_va >> LOG2_BLOCK_SIZE, 0);
         num_cl[cpu]++;
     }
     else
-        cl_check->second++;
+        (*cl_check)++;
 
-    pr = page_table.find(vpage);
-    if (pr == page_table.end()) { // no VA => PA translation found
+    uint64_t *pr = page_table.find(vpage);
+    uint64_t ppage;
+    if (pr == NULL) { // no VA => PA translation found
 
         if (allocated_pages >= DRAM_PAGES) { // not enough memory
 
             // TODO: elaborate page replacement algorithm
-            // here, ChampSim randomly selects a page that is not recently used and we only track 32K recently accessed pages
-            uint8_t  found_NRU = 0;
-            uint64_t NRU_vpage = 0; // implement it
-            // map <uint64_t, uint64_t>::iterator pr2 = recent_page.begin();
-            for (pr = page_table.begin(); pr != page_table.end(); pr++) {
-
-                NRU_vpage = pr->first;
-                if (recent_page.find(NRU_vpage) == recent_page.end()) {
-                    found_NRU = 1;
-                    break;
-                }
-            }
+            // here, ChampSim swaps out the resident page with the lowest vpage (the first one an ordered page table visits)
+            // resident_vpages keeps them in a min-heap, so the victim is found without walking the page table
+            pop_heap(resident_vpages.begin(), resident_vpages.end(), greater<uint64_t>());
+            uint64_t NRU_vpage = resident_vpages.back();
+            resident_vpages.back() = vpage;
+            push_heap(resident_vpages.begin(), resident_vpages.end(), greater<uint64_t>());
+
+            pr = page_table.find(NRU_vpage);
 #ifdef SANITY_CHECK
-            if (found_NRU == 0)
-                assert(0);
-
-            if (pr == page_table.end())
+            if (pr == NULL)
                 assert(0);
 #endif
+            uint64_t mapped_ppage = *pr;
+
             DP ( if (warmup_complete[cpu]) {
-            cout << "[SWAP] update page table NRU_vpage: " << hex << pr->first << " new_vpage: " << vpage << " ppage: " << pr->second << dec << endl; });
+            cout << "[SWAP] update page table NRU_vpage: " << hex << NRU_vpage << " new_vpage: " << vpage << " ppage: " << mapped_ppage << dec << endl; });
 
             // update page table with new VA => PA mapping
-            // since we cannot change the key value already inserted in a map structure, we need to erase the old node and add a new node
-            uint64_t mapped_ppage = pr->second;
-            page_table.erase(pr);
-            page_table.insert(make_pair(vpage, mapped_ppage));
+            page_table.erase(NRU_vpage);
+            page_table.insert(vpage, mapped_ppage);
 
             // update inverse table with new PA => VA mapping
-            ppage_check = inverse_table.find(mapped_ppage);
+            uint64_t *ppage_check = inverse_table.find(mapped_ppage);
 #ifdef SANITY_CHECK
-            if (ppage_check == inverse_table.end())
+            if (ppage_check == NULL)
                 assert(0);
 #endif
-            ppage_check->second = vpage;
+            *ppage_check = vpage;
 
             DP ( if (warmup_complete[cpu]) {
             cout << "[SWAP] update inverse table NRU_vpage: " << hex << NRU_vpage << " new_vpage: ";
-            cout << ppage_check->second << " ppage: " << ppage_check->first << dec << endl; });
+            cout << *ppage_check << " ppage: " << mapped_ppage << dec << endl; });
 
             // update page_queue
             page_queue.pop();
@@ -445,6 +578,7 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 
             // swap complete
             swap = 1;
+            ppage = mapped_ppage;
         } else {
             uint8_t fragmented = 0;
             if (num_adjacent_page > 0)
@@ -461,10 +595,10 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
             //random_ppage |= (cpu<<(32-LOG2_PAGE_SIZE));
 
             while (1) { // try to find an empty physical page number
-                ppage_check = inverse_table.find(random_ppage); // check if this page can be allocated
-                if (ppage_check != inverse_table.end()) { // random_ppage is not available
+                uint64_t *ppage_check = inverse_table.find(random_ppage); // check if this page can be allocated
+                if (ppage_check != NULL) { // random_ppage is not available
                     DP ( if (warmup_complete[cpu]) {
-                    cout << "vpage: " << hex << ppage_check->first << " is already mapped to ppage: " << random_ppage << dec << endl; });
+                    cout << "vpage: " << hex << *ppage_check << " is already mapped to ppage: " << random_ppage << dec << endl; });
 
                     if (num_adjacent_page > 0)
                         fragmented = 1;
@@ -482,8 +616,10 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 
             // insert translation to page tables
             //printf("Insert  num_adjacent_page: %u  vpage: %lx  ppage: %lx\n", num_adjacent_page, vpage, random_ppage);
-            page_table.insert(make_pair(vpage, random_ppage));
-            inverse_table.insert(make_pair(random_ppage, vpage));
+            page_table.insert(vpage, random_ppage);
+            inverse_table.insert(random_ppage, vpage);
+            resident_vpages.push_back(vpage);
+            push_heap(resident_vpages.begin(), resident_vpages.end(), greater<uint64_t>());
             page_queue.push(vpage);
             previous_ppage = random_ppage;
             num_adjacent_page--;
@@ -496,6 +632,7 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
                 DP ( if (warmup_complete[cpu]) {
                 cout << "Recalculate num_adjacent_page: " << num_adjacent_page << endl; });
             }
+            ppage = random_ppage;
         }
 
         if (swap)
@@ -504,16 +641,10 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
             minor_fault[cpu]++;
     }
     else {
-        //printf("Found  vpage: %lx  random_ppage: %lx\n", vpage, pr->second);
+        //printf("Found  vpage: %lx  random_ppage: %lx\n", vpage, *pr);
+        ppage = *pr;
     }
 
-    pr = page_table.find(vpage);
-#ifdef SANITY_CHECK
-    if (pr == page_table.end())
-        assert(0);
-#endif
-    uint64_t ppage = pr->second;
-
     uint64_t pa = ppage << LOG2_PAGE_SIZE;
     pa |= voffset;
 
@@ -531,6 +662,91 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
     return pa;
 }
 
+// everything the simulation loop carries from one cycle to the next,
+// walked in the same order by save_checkpoint() and load_checkpoint()
+void checkpoint_state(CHECKPOINT &cp)
+{
+    cp.check(NUM_CPUS, "num_cpus");
+    cp.check(knob::knob_cloudsuite, "knob_cloudsuite");
+    cp.check(sizeof(BLOCK), "BLOCK size");
+    cp.check(sizeof(PACKET), "PACKET size");
+    cp.check(sizeof(ooo_model_instr), "ooo_model_instr size");
+    cp.check(sizeof(LSQ_ENTRY), "LSQ_ENTRY size");
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        const char *trace_name = strrchr(ooo_cpu[i].trace_string, '/');
+        trace_name = trace_name ? trace_name+1 : ooo_cpu[i].trace_string;
+
+        string saved_name = trace_name;
+        cp.str(saved_name);
+        if (saved_name != trace_name) {
+            cerr << "*** CHECKPOINT OF CPU " << i << " WAS TAKEN ON TRACE " << saved_name << " NOT " << trace_name << " ***" << endl;
+            assert(0);
+        }
+    }
+
+    cp.section("SIMULATION");
+    cp.array(warmup_complete, NUM_CPUS);
+    cp.array(simulation_complete, NUM_CPUS);
+    cp.scalar(all_warmup_complete);
+    cp.scalar(all_simulation_complete);
+    cp.array(current_core_cycle, NUM_CPUS);
+    cp.array(stall_cycle, NUM_CPUS);
+    cp.scalar(SCHEDULING_LATENCY);
+    cp.scalar(EXEC_LATENCY);
+    cp.scalar(PAGE_TABLE_LATENCY);
+    cp.scalar(SWAP_LATENCY);
+    cp.scalar(l2pf_access);
+
+    cp.engine(generator);
+    cp.array(generated, NUM_CPUS);
+    cp.scalar(num_generated);
+    cp.engine(champsim_rand.engine);
+    cp.libc_rand();
+
+    cp.section("PAGE_TABLE");
+    cp.queue_entries(page_queue);
+    page_table.checkpoint(cp);
+    inverse_table.checkpoint(cp);
+    cp.vector_entries(resident_vpages);
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        unique_cl[i].checkpoint(cp);
+    cp.scalar(previous_ppage);
+    cp.scalar(num_adjacent_page);
+    cp.array(num_cl, NUM_CPUS);
+    cp.scalar(allocated_pages);
+    cp.array(num_page, NUM_CPUS);
+    cp.array(minor_fault, NUM_CPUS);
+    cp.array(major_fault, NUM_CPUS);
+
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        ooo_cpu[i].checkpoint(cp);
+    uncore.checkpoint(cp);
+
+    cp.section("END");
+}
+
+void save_checkpoint(const char *file_name)
+{
+    CHECKPOINT cp;
+    checkpoint_state(cp);
+    cp.write_file(file_name);
+
+    cout << "Saved checkpoint " << file_name << " (" << cp.position() << " bytes)" << endl;
+}
+
+void load_checkpoint(const char *file_name)
+{
+    CHECKPOINT cp(file_name);
+    checkpoint_state(cp);
+
+    cout << endl;
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        cout << "Restored checkpoint " << file_name << " CPU " << setw(2) << i << " instructions: " << setw(10) << ooo_cpu[i].num_retired;
+        cout << " cycles: " << setw(10) << current_core_cycle[i] << endl;
+    }
+    cout << endl;
+}
+
 void print_knobs()
 {
     cout << "warmup_instructions " << knob::warmup_instructions << endl
@@ -552,6 +768,25 @@ void print_knobs()
         << "l2c_semi_perfect " << knob::l2c_semi_perfect << endl
         << "llc_semi_perfect " << knob::llc_semi_perfect << endl
         << "semi_perfect_cache_page_buffer_size " << knob::semi_perfect_cache_page_buffer_size << endl
+        << "trace_cache_dir " << knob::trace_cache_dir << endl
+        << "checkpoint_save " << knob::checkpoint_save << endl
+        << "checkpoint_load " << knob::checkpoint_load << endl
+        << "checkpoint_exit " << knob::checkpoint_exit << endl
+        << "skip_idle_cycles " << knob::skip_idle_cycles << endl
+        << "parallel_cores " << knob::parallel_cores << endl
+        << "stats_json_file " << knob::stats_json_file << endl
+        << "interval_stats_file " << knob::interval_stats_file << endl
+        << "interval_stats_epoch " << knob::interval_stats_epoch << endl
+        << "interval_stats_buffer " << knob::interval_stats_buffer << endl
+        << "interval_stats_counters";
+    for (uint32_t i=0; i<knob::interval_stats_counters.size(); i++)
+        cout << (i ? "," : " ") << knob::interval_stats_counters[i];
+    cout << endl
+        << "fanout_config";
+    for (uint32_t i=0; i<knob::fanout_config.size(); i++)
+        cout << (i ? "," : " ") << knob::fanout_config[i];
+    cout << endl
+        << "fanout_output_dir " << knob::fanout_output_dir << endl
         << endl;
     cout << "num_cpus " << NUM_CPUS << endl
         << "cpu_freq " << CPU_FREQ << endl
@@ -604,6 +839,330 @@ int get_next_cpu()
    return index;
 }
 
+// earliest cycle after current at which any core, the LLC, or DRAM may change state
+// the per-core bookkeeping of the main loop (warmup, heartbeat, deadlock, IPC epochs) counts as well
+uint64_t next_event_cycle(uint64_t current)
+{
+    uint64_t now = current + 1, next = UINT64_MAX;
+
+    if (all_warmup_complete == NUM_CPUS)
+        return now;
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        // cores only run in lockstep between iterations of the main loop
+        if (current_core_cycle[i] != current)
+            return now;
+
+        if ((warmup_complete[i] == 0) && (ooo_cpu[i].num_retired > knob::warmup_instructions))
+            return now;
+        if ((all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions)))
+            return now;
+        if (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction)
+            return now;
+        if (uncore.port[i].pending.size())
+            return now;
+
+        if (knob::measure_ipc)
+            next = min(next, ooo_cpu[i].next_measure_ipc_cycle);
+        if (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].ip)
+            next = min(next, ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle + DEADLOCK_CYCLE);
+
+        // a stalled core does not run its pipeline or its private caches
+        if (stall_cycle[i] > now)
+            next = min(next, stall_cycle[i]);
+        else
+            next = min(next, ooo_cpu[i].next_event_cycle(current));
+
+        if (next <= now)
+            return now;
+    }
+
+    // the DRAM bandwidth and interval stats epochs count uncore cycles
+    if (knob::measure_dram_bw)
+        next = min(next, (uncore.DRAM.next_bw_measure_cycle > uncore.cycle) ? (current + uncore.DRAM.next_bw_measure_cycle - uncore.cycle) : now);
+    if (interval_stats.enabled())
+        next = min(next, (interval_stats.next_cycle() > uncore.cycle) ? (current + interval_stats.next_cycle() - uncore.cycle) : now);
+
+    next = min(next, uncore.LLC.next_event_cycle(current));
+    next = min(next, uncore.DRAM.next_event_cycle(current));
+
+    return max(next, now);
+}
+
+// fast-forward all clocks by cycles in which nothing changes state
+// the random core order is drawn as usual, so later cycles see the same order as without skipping
+void skip_cycles(uint64_t cycles)
+{
+    for (uint64_t c=0; c<cycles; c++) {
+        for (uint32_t i=0; i<NUM_CPUS; i++)
+            get_next_cpu();
+    }
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        if (stall_cycle[i] <= current_core_cycle[i] + 1)
+            ooo_cpu[i].fast_forward(cycles);
+        current_core_cycle[i] += cycles;
+    }
+
+    uncore.LLC.fast_forward(cycles);
+    uncore.cycle += cycles;
+
+    skipped_cycles += cycles;
+}
+
+// one cycle of core i: its pipeline and private caches
+// under parallel_cores this runs on the thread of core i, so it may only touch state private to the core
+// the shared page table and the LLC are reached through STLB.page_walks and uncore.port[i]
+void operate_core(uint32_t i)
+{
+    // proceed one cycle
+    current_core_cycle[i]++;
+
+    /* monitor IPC */
+    if(knob::measure_ipc && current_core_cycle[i] >= ooo_cpu[i].next_measure_ipc_cycle)
+    {
+        uint64_t ins_in_epoch = ooo_cpu[i].num_retired - ooo_cpu[i].last_num_ins;
+        if(ins_in_epoch >= ooo_cpu[i].last_ins_in_epoch)
+        {
+            /* IPC increased */
+            // MYLOG("Core-%u cycle %lu last_num_ins %lu last_ins_in_epoch %lu ins_in_epoch %lu UP", i, current_core_cycle[i], ooo_cpu[i].last_num_ins, ooo_cpu[i].last_ins_in_epoch, ins_in_epoch);
+            ooo_cpu[i].broadcast_ipc(1);
+        }
+        else
+        {
+            /* IPC decreased */
+            // MYLOG("Core-%u cycle %lu last_num_ins %lu last_ins_in_epoch %lu ins_in_epoch %lu DOWN", i, current_core_cycle[i], ooo_cpu[i].last_num_ins, ooo_cpu[i].last_ins_in_epoch, ins_in_epoch);
+            ooo_cpu[i].broadcast_ipc(0);
+        }
+        ooo_cpu[i].last_num_ins = ooo_cpu[i].num_retired;
+        ooo_cpu[i].last_ins_in_epoch = ins_in_epoch;
+        ooo_cpu[i].next_measure_ipc_cycle = current_core_cycle[i] + knob::measure_ipc_epoch;
+    }
+
+    //cout << "Trying to process instr_id: " << ooo_cpu[i].instr_unique_id << " fetch_stall: " << +ooo_cpu[i].fetch_stall;
+    //cout << " stall_cycle: " << stall_cycle[i] << " current: " << current_core_cycle[i] << endl;
+
+    // core might be stalled due to page fault or branch misprediction
+    if (stall_cycle[i] <= current_core_cycle[i]) {
+
+        // fetch unit
+        if (ooo_cpu[i].ROB.occupancy < ooo_cpu[i].ROB.SIZE) {
+            // handle branch
+            if (ooo_cpu[i].fetch_stall == 0)
+                ooo_cpu[i].handle_branch();
+        }
+
+        // fetch
+        ooo_cpu[i].fetch_instruction();
+
+
+        // schedule (including decode latency)
+        uint32_t schedule_index = ooo_cpu[i].ROB.next_schedule;
+        if ((ooo_cpu[i].ROB.entry[schedule_index].scheduled == 0) && (ooo_cpu[i].ROB.entry[schedule_index].event_cycle <= current_core_cycle[i]))
+            ooo_cpu[i].schedule_instruction();
+
+        // execute
+        ooo_cpu[i].execute_instruction();
+
+        // memory operation
+        ooo_cpu[i].schedule_memory_instruction();
+        ooo_cpu[i].execute_memory_instruction();
+
+        // complete
+        ooo_cpu[i].update_rob();
+
+        // retire
+        if ((ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].executed == COMPLETED) && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle <= current_core_cycle[i]))
+            ooo_cpu[i].retire_rob();
+    }
+}
+
+// main-loop bookkeeping of core i after its cycle: heartbeat, deadlock, warmup, and end of simulation
+void check_core(uint32_t i, uint64_t elapsed_hour, uint64_t elapsed_minute, uint64_t elapsed_second)
+{
+    // heartbeat information
+    if (show_heartbeat && (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction)) {
+        float cumulative_ipc;
+        if (warmup_complete[i])
+            cumulative_ipc = (1.0*(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr)) / (current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle);
+        else
+            cumulative_ipc = (1.0*ooo_cpu[i].num_retired) / current_core_cycle[i];
+        float heartbeat_ipc = (1.0*ooo_cpu[i].num_retired - ooo_cpu[i].last_sim_instr) / (current_core_cycle[i] - ooo_cpu[i].last_sim_cycle);
+
+        cout << "Heartbeat CPU " << setw(2) << i << " instructions: " << setw(10) << ooo_cpu[i].num_retired << " cycles: " << setw(10) << current_core_cycle[i];
+        cout << " heartbeat IPC: " << FIXED_FLOAT(heartbeat_ipc) << " cumulative IPC: " << FIXED_FLOAT(cumulative_ipc);
+        cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
+        ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
+
+        ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
+        ooo_cpu[i].last_sim_cycle = current_core_cycle[i];
+    }
+
+    // check for deadlock
+    if (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].ip && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle + DEADLOCK_CYCLE) <= current_core_cycle[i])
+        print_deadlock(i);
+
+    // check for warmup
+    // warmup complete
+    if ((warmup_complete[i] == 0) && (ooo_cpu[i].num_retired > knob::warmup_instructions)) {
+        warmup_complete[i] = 1;
+        all_warmup_complete++;
+    }
+    if (all_warmup_complete == NUM_CPUS) { // this part is called only once when all cores are warmed up
+        all_warmup_complete++;
+        finish_warmup();
+    }
+
+    /*
+    if (all_warmup_complete == 0) {
+        all_warmup_complete = 1;
+        finish_warmup();
+    }
+    if (ooo_cpu[1].num_retired > 0)
+        warmup_complete[1] = 1;
+    */
+
+    // simulation complete
+    if ((all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions))) {
+        simulation_complete[i] = 1;
+        ooo_cpu[i].finish_sim_instr = ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr;
+        ooo_cpu[i].finish_sim_cycle = current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle;
+
+        cout << "Finished CPU " << i << " instructions: " << ooo_cpu[i].finish_sim_instr << " cycles: " << ooo_cpu[i].finish_sim_cycle;
+        cout << " cumulative IPC: " << ((float) ooo_cpu[i].finish_sim_instr / ooo_cpu[i].finish_sim_cycle);
+        cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
+
+        record_roi_stats(i, &ooo_cpu[i].L1D);
+        record_roi_stats(i, &ooo_cpu[i].L1I);
+        record_roi_stats(i, &ooo_cpu[i].L2C);
+        record_roi_stats(i, &uncore.LLC);
+
+        all_simulation_complete++;
+    }
+}
+
+// finish_warmup() switches all latencies to their ROI values and resets the stats in the middle of a serial cycle,
+// before the cores later in the order of that cycle run it, so parallel_cores runs such a cycle serially.
+// A core retires at most RETIRE_WIDTH instructions a cycle, so it is known before the cycle whether it can fire
+bool warmup_may_finish()
+{
+    if (all_warmup_complete > NUM_CPUS)
+        return false;
+
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        if ((warmup_complete[i] == 0) && (ooo_cpu[i].num_retired + RETIRE_WIDTH <= knob::warmup_instructions))
+            return false;
+
+    return true;
+}
+
+// core 0 runs on the main thread, every other core waits here for the start of each cycle
+void core_thread(uint32_t cpu)
+{
+    while (1) {
+        core_barrier->wait();
+        if (core_threads_exit)
+            return;
+
+        operate_core(cpu);
+        core_barrier->wait();
+    }
+}
+
+void start_core_threads()
+{
+    core_barrier = new CYCLE_BARRIER(NUM_CPUS);
+    for (uint32_t i=1; i<NUM_CPUS; i++)
+        core_threads.push_back(new thread(core_thread, i));
+}
+
+void join_core_threads()
+{
+    if (core_barrier == NULL)
+        return;
+
+    core_threads_exit = 1;
+    core_barrier->wait();
+    for (uint32_t i=0; i<core_threads.size(); i++) {
+        core_threads[i]->join();
+        delete core_threads[i];
+    }
+    core_threads.clear();
+
+    delete core_barrier;
+    core_barrier = NULL;
+}
+
+// --fanout_config: one child per config file, all fed by this process decoding the traces once
+// each child layers its config file over the command line knobs and writes what would have been
+// its stdout to <fanout_output_dir>/<config name>.out; this returns in the children only
+void fanout(int argc, char** argv)
+{
+    if (!knob::trace_cache_dir.empty() || !knob::checkpoint_load.empty()) {
+        cerr << "*** --fanout_config CANNOT BE COMBINED WITH --trace_cache_dir OR --checkpoint_load ***" << endl;
+        assert(0);
+    }
+
+    vector<string> traces, out_names;
+    for (int i=0; i<argc; i++) {
+        if (strcmp(argv[i], "-traces") == 0) {
+            for (i++; i<argc; i++)
+                traces.push_back(argv[i]);
+        }
+    }
+
+    for (uint32_t i=0; i<knob::fanout_config.size(); i++) {
+        string config = knob::fanout_config[i];
+        size_t slash = config.find_last_of('/'), dot = config.find_last_of('.');
+        string base = config.substr(slash == string::npos ? 0 : slash + 1);
+        if (dot != string::npos && (slash == string::npos || dot > slash))
+            base = base.substr(0, base.size() - (config.size() - dot));
+        string out_name = knob::fanout_output_dir + "/" + base + ".out";
+        if (find(out_names.begin(), out_names.end(), out_name) != out_names.end()) {
+            cerr << "*** FANOUT CONFIGS MUST HAVE DISTINCT NAMES: " << config << " ***" << endl;
+            assert(0);
+        }
+        out_names.push_back(out_name);
+    }
+
+    trace_fanout = new TRACE_FANOUT(traces, knob::knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr), knob::fanout_config.size());
+
+    vector<pid_t> children;
+    for (uint32_t i=0; i<knob::fanout_config.size(); i++) {
+        cout << "fanout " << i << " " << knob::fanout_config[i] << " > " << out_names[i] << endl;
+        // nothing buffered may be inherited, or every child would print it again
+        cout.flush();
+        fflush(stdout);
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "*** CANNOT FORK FANOUT CHILD " << i << " ***" << endl;
+            assert(0);
+        }
+        if (pid == 0) {
+            // a child has nothing to read once the parent is gone
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (freopen(out_names[i].c_str(), "w", stdout) == NULL) {
+                cerr << "*** CANNOT OPEN FANOUT OUTPUT: " << out_names[i] << " ***" << endl;
+                exit(1);
+            }
+            dup2(fileno(stdout), fileno(stderr));
+
+            trace_fanout->attach(i);
+            char config_file_name[MAX_LEN];
+            strncpy(config_file_name, knob::fanout_config[i].c_str(), MAX_LEN - 1);
+            config_file_name[MAX_LEN - 1] = '\0';
+            parse_config(config_file_name);
+            return;
+        }
+        children.push_back(pid);
+    }
+
+    uint32_t failed = trace_fanout->produce(children);
+    cout << "fanout " << children.size() - failed << " of " << children.size() << " configs finished" << endl;
+    exit(failed ? 1 : 0);
+}
+
 int main(int argc, char** argv)
 {
    for(uint32_t index = 0; index < NUM_CPUS; ++index) generated[index] = false;
@@ -621,10 +1180,11 @@ int main(int argc, char** argv)
          << "*************************************************" << endl;
 
     // initialize knobs
-    uint8_t show_heartbeat = 1;
-
     parse_args(argc, argv);
 
+    if (knob::fanout_config.size())
+        fanout(argc, argv);
+
     uint32_t seed_number = 0;
 
     if(knob::knob_cloudsuite)
@@ -659,8 +1219,7 @@ int main(int argc, char** argv)
 
             sprintf(ooo_cpu[count_traces].trace_string, "%s", argv[i]);
 
-            char *full_name = ooo_cpu[count_traces].trace_string,
-                 *last_dot = strrchr(ooo_cpu[count_traces].trace_string, '.');
+            char *full_name = ooo_cpu[count_traces].trace_string;
 
 			ifstream test_file(full_name);
 			if(!test_file.good()){
@@ -668,15 +1227,9 @@ int main(int argc, char** argv)
 				assert(false);
 			}
 
-
-            if (full_name[last_dot - full_name + 1] == 'g') // gzip format
-                sprintf(ooo_cpu[count_traces].gunzip_command, "gunzip -c %s", argv[i]);
-            else if (full_name[last_dot - full_name + 1] == 'x') // xz
-                sprintf(ooo_cpu[count_traces].gunzip_command, "xz -dc %s", argv[i]);
-            else {
-                cout << "ChampSim does not support traces other than gz or xz compression!" << endl;
-                assert(0);
-            }
+            // gz, xz (and zst) traces are decompressed in-process by a read-ahead thread,
+            // or mapped from a pre-decoded image under --trace_cache_dir
+            ooo_cpu[count_traces].trace_reader = new TRACE_READER(full_name, knob::knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr));
 
             char *pch[100];
             int count_str = 0;
@@ -697,12 +1250,6 @@ int main(int argc, char** argv)
                 j++;
             }
 
-            ooo_cpu[count_traces].trace_file = popen(ooo_cpu[count_traces].gunzip_command, "r");
-            if (ooo_cpu[count_traces].trace_file == NULL) {
-                printf("\n*** Trace file not found: %s ***\n\n", argv[i]);
-                assert(0);
-            }
-
             count_traces++;
             if (count_traces > NUM_CPUS) {
                 printf("\n*** Too many traces for the configured number of cores ***\n\n");
@@ -777,7 +1324,10 @@ int main(int argc, char** argv)
         ooo_cpu[i].L2C.fill_level = FILL_L2;
         ooo_cpu[i].L2C.upper_level_icache[i] = &ooo_cpu[i].L1I;
         ooo_cpu[i].L2C.upper_level_dcache[i] = &ooo_cpu[i].L1D;
-        ooo_cpu[i].L2C.lower_level = &uncore.LLC;
+        if (knob::parallel_cores)
+            ooo_cpu[i].L2C.lower_level = &uncore.port[i];
+        else
+            ooo_cpu[i].L2C.lower_level = &uncore.LLC;
         ooo_cpu[i].L2C.l2c_prefetcher_initialize();
 
         // SHARED CACHE
@@ -816,12 +1366,38 @@ int main(int argc, char** argv)
     uncore.LLC.llc_prefetcher_initialize();
 
     print_knobs();
+    register_stats();
+#ifdef ENABLE_PROFILE
+    register_profile();
+#endif
+
+    if (knob::interval_stats_file.size()) {
+        register_interval_stats();
+        if (knob::interval_stats_counters.empty())
+            knob::interval_stats_counters = stats_registry.names("INTERVAL");
+        interval_stats.open(knob::interval_stats_file.c_str(), knob::interval_stats_counters, knob::interval_stats_epoch, knob::interval_stats_buffer);
+    }
 
     // simulation entry point
     generator.seed(champsim_seed);
+
+    // a restored run picks up right after finish_warmup() of the run that saved the checkpoint
+    if (knob::checkpoint_load.size())
+        load_checkpoint(knob::checkpoint_load.c_str());
+
+    if (knob::parallel_cores)
+        start_core_threads();
+
     start_time = time(NULL);
     uint8_t run_simulation = 1;
     while (run_simulation) {
+        PROFILE_SCOPE(profile_main_loop);
+
+        if (knob::skip_idle_cycles) {
+            uint64_t next = next_event_cycle(current_core_cycle[0]);
+            if ((next != UINT64_MAX) && (next > current_core_cycle[0] + 1))
+                skip_cycles(next - current_core_cycle[0] - 1);
+        }
 
         uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
                  elapsed_minute = elapsed_second / 60,
@@ -829,135 +1405,45 @@ int main(int argc, char** argv)
         elapsed_minute -= elapsed_hour*60;
         elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
 
-        for (int index = 0; index < NUM_CPUS; ++index) {
-	    /* randomizes CPU traversal to improve QoS for high-core simulations */
-	    int i = get_next_cpu();
-	    // cout << "Next cpu: " << i << endl;
-
-            // proceed one cycle
-            current_core_cycle[i]++;
-
-            /* monitor IPC */
-            if(knob::measure_ipc && current_core_cycle[i] >= ooo_cpu[i].next_measure_ipc_cycle)
-            {
-                uint64_t ins_in_epoch = ooo_cpu[i].num_retired - ooo_cpu[i].last_num_ins;
-                if(ins_in_epoch >= ooo_cpu[i].last_ins_in_epoch)
-                {
-                    /* IPC increased */
-                    // MYLOG("Core-%u cycle %lu last_num_ins %lu last_ins_in_epoch %lu ins_in_epoch %lu UP", i, current_core_cycle[i], ooo_cpu[i].last_num_ins, ooo_cpu[i].last_ins_in_epoch, ins_in_epoch);
-                    ooo_cpu[i].broadcast_ipc(1);
-                }
-                else
-                {
-                    /* IPC decreased */
-                    // MYLOG("Core-%u cycle %lu last_num_ins %lu last_ins_in_epoch %lu ins_in_epoch %lu DOWN", i, current_core_cycle[i], ooo_cpu[i].last_num_ins, ooo_cpu[i].last_ins_in_epoch, ins_in_epoch);
-                    ooo_cpu[i].broadcast_ipc(0);
-                }
-                ooo_cpu[i].last_num_ins = ooo_cpu[i].num_retired;
-                ooo_cpu[i].last_ins_in_epoch = ins_in_epoch;
-                ooo_cpu[i].next_measure_ipc_cycle = current_core_cycle[i] + knob::measure_ipc_epoch;
+        if (core_barrier && !warmup_may_finish()) {
+            // the core order of the cycle is drawn up front, and every core runs the cycle on its own thread
+            // the main thread then hands their page walks and LLC requests over in that order
+            for (int index = 0; index < NUM_CPUS; ++index)
+                core_order[index] = get_next_cpu();
+
+            core_barrier->wait();
+            operate_core(0);
+            core_barrier->wait();
+
+            for (int index = 0; index < NUM_CPUS; ++index) {
+                int i = core_order[index];
+                ooo_cpu[i].STLB.finish_page_walks();
+                uncore.port[i].drain();
+                check_core(i, elapsed_hour, elapsed_minute, elapsed_second);
             }
-
-            //cout << "Trying to process instr_id: " << ooo_cpu[i].instr_unique_id << " fetch_stall: " << +ooo_cpu[i].fetch_stall;
-            //cout << " stall_cycle: " << stall_cycle[i] << " current: " << current_core_cycle[i] << endl;
-
-            // core might be stalled due to page fault or branch misprediction
-            if (stall_cycle[i] <= current_core_cycle[i]) {
-
-                // fetch unit
-                if (ooo_cpu[i].ROB.occupancy < ooo_cpu[i].ROB.SIZE) {
-                    // handle branch
-                    if (ooo_cpu[i].fetch_stall == 0)
-                        ooo_cpu[i].handle_branch();
+        }
+        else {
+            for (int index = 0; index < NUM_CPUS; ++index) {
+                /* randomizes CPU traversal to improve QoS for high-core simulations */
+                int i = get_next_cpu();
+                // cout << "Next cpu: " << i << endl;
+
+                operate_core(i);
+                if (core_barrier) {
+                    // the threads of the other cores wait at the barrier meanwhile
+                    ooo_cpu[i].STLB.finish_page_walks();
+                    uncore.port[i].drain();
                 }
-
-                // fetch
-                ooo_cpu[i].fetch_instruction();
-
-
-                // schedule (including decode latency)
-                uint32_t schedule_index = ooo_cpu[i].ROB.next_schedule;
-                if ((ooo_cpu[i].ROB.entry[schedule_index].scheduled == 0) && (ooo_cpu[i].ROB.entry[schedule_index].event_cycle <= current_core_cycle[i]))
-                    ooo_cpu[i].schedule_instruction();
-
-                // execute
-                ooo_cpu[i].execute_instruction();
-
-                // memory operation
-                ooo_cpu[i].schedule_memory_instruction();
-                ooo_cpu[i].execute_memory_instruction();
-
-                // complete
-                ooo_cpu[i].update_rob();
-
-                // retire
-                if ((ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].executed == COMPLETED) && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle <= current_core_cycle[i]))
-                    ooo_cpu[i].retire_rob();
-            }
-
-            // heartbeat information
-            if (show_heartbeat && (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction)) {
-                float cumulative_ipc;
-                if (warmup_complete[i])
-                    cumulative_ipc = (1.0*(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr)) / (current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle);
-                else
-                    cumulative_ipc = (1.0*ooo_cpu[i].num_retired) / current_core_cycle[i];
-                float heartbeat_ipc = (1.0*ooo_cpu[i].num_retired - ooo_cpu[i].last_sim_instr) / (current_core_cycle[i] - ooo_cpu[i].last_sim_cycle);
-
-                cout << "Heartbeat CPU " << setw(2) << i << " instructions: " << setw(10) << ooo_cpu[i].num_retired << " cycles: " << setw(10) << current_core_cycle[i];
-                cout << " heartbeat IPC: " << FIXED_FLOAT(heartbeat_ipc) << " cumulative IPC: " << FIXED_FLOAT(cumulative_ipc);
-                cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
-                ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
-
-                ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
-                ooo_cpu[i].last_sim_cycle = current_core_cycle[i];
-            }
-
-            // check for deadlock
-            if (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].ip && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle + DEADLOCK_CYCLE) <= current_core_cycle[i])
-                print_deadlock(i);
-
-            // check for warmup
-            // warmup complete
-            if ((warmup_complete[i] == 0) && (ooo_cpu[i].num_retired > knob::warmup_instructions)) {
-                warmup_complete[i] = 1;
-                all_warmup_complete++;
-            }
-            if (all_warmup_complete == NUM_CPUS) { // this part is called only once when all cores are warmed up
-                all_warmup_complete++;
-                finish_warmup();
-            }
-
-            /*
-            if (all_warmup_complete == 0) {
-                all_warmup_complete = 1;
-                finish_warmup();
-            }
-            if (ooo_cpu[1].num_retired > 0)
-                warmup_complete[1] = 1;
-            */
-
-            // simulation complete
-            if ((all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions))) {
-                simulation_complete[i] = 1;
-                ooo_cpu[i].finish_sim_instr = ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr;
-                ooo_cpu[i].finish_sim_cycle = current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle;
-
-                cout << "Finished CPU " << i << " instructions: " << ooo_cpu[i].finish_sim_instr << " cycles: " << ooo_cpu[i].finish_sim_cycle;
-                cout << " cumulative IPC: " << ((float) ooo_cpu[i].finish_sim_instr / ooo_cpu[i].finish_sim_cycle);
-                cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
-
-                record_roi_stats(i, &ooo_cpu[i].L1D);
-                record_roi_stats(i, &ooo_cpu[i].L1I);
-                record_roi_stats(i, &ooo_cpu[i].L2C);
-                record_roi_stats(i, &uncore.LLC);
-
-                all_simulation_complete++;
+                check_core(i, elapsed_hour, elapsed_minute, elapsed_second);
             }
 
-            if (all_simulation_complete == NUM_CPUS)
-                run_simulation = 0;
+            // only a checkpoint saved with parallel_cores can leave requests in the ports
+            for (uint32_t i=0; i<NUM_CPUS; i++)
+                uncore.port[i].drain();
         }
+
+        if (all_simulation_complete == NUM_CPUS)
+            run_simulation = 0;
 	// cout << "-----------------" << endl;
 
         // TODO: should it be backward?
@@ -978,9 +1464,21 @@ int main(int argc, char** argv)
             uncore.DRAM.bw_level_hist[uncore.DRAM.bw]++;
             uncore.LLC.broadcast_bw(uncore.DRAM.bw);
         }
+        if (interval_stats.enabled() && uncore.cycle >= interval_stats.next_cycle())
+            interval_stats.sample(uncore.cycle);
 
         uncore.LLC.operate();
         uncore.DRAM.operate();
+
+        if (checkpoint_pending) {
+            checkpoint_pending = 0;
+            save_checkpoint(knob::checkpoint_save.c_str());
+            if (knob::checkpoint_exit) {
+                join_core_threads();
+                cout << "ChampSim stopped after saving the warmup checkpoint" << endl;
+                return 0;
+            }
+        }
     }
 
     uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
@@ -989,7 +1487,12 @@ int main(int argc, char** argv)
     elapsed_minute -= elapsed_hour*60;
     elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
 
+    join_core_threads();
+    interval_stats.close();
+
     cout << endl << "ChampSim completed all CPUs" << endl;
+    if (knob::skip_idle_cycles)
+        cout << "Skipped idle cycles: " << skipped_cycles << endl;
     if (NUM_CPUS > 1) {
 //         cout << endl << "Total Simulation Statistics (not including warmup)" << endl;
 //         for (uint32_t i=0; i<NUM_CPUS; i++) {
@@ -1008,23 +1511,7 @@ int main(int argc, char** argv)
     }
 
     cout << endl << "[ROI Statistics]" << endl;
-    for (uint32_t i=0; i<NUM_CPUS; i++)
-    {
-        cout << "Core_" << i << "_instructions " << ooo_cpu[i].finish_sim_instr << endl
-            << "Core_" << i << "_cycles " << ooo_cpu[i].finish_sim_cycle << endl
-            << "Core_" << i << "_IPC " << ((float) ooo_cpu[i].finish_sim_instr / ooo_cpu[i].finish_sim_cycle) << endl
-            << endl;
-#ifndef CRC2_COMPILE
-        print_branch_stats(i);
-        print_roi_stats(i, &ooo_cpu[i].L1D);
-        print_roi_stats(i, &ooo_cpu[i].L1I);
-        print_roi_stats(i, &ooo_cpu[i].L2C);
-#endif
-        print_roi_stats(i, &uncore.LLC);
-        cout << "Core_" << i << "_major_page_fault " << major_fault[i] << endl
-            << "Core_" << i << "_minor_page_fault " << minor_fault[i] << endl
-            << endl;
-    }
+    stats_registry.print("ROI", cout);
 
     for (uint32_t i=0; i<NUM_CPUS; i++) {
         ooo_cpu[i].L1D.l1d_prefetcher_final_stats();
@@ -1035,8 +1522,16 @@ int main(int argc, char** argv)
 
 #ifndef CRC2_COMPILE
     uncore.LLC.llc_replacement_final_stats();
-    print_dram_stats();
+    stats_registry.print("DRAM", cout);
 #endif
 
+#ifdef ENABLE_PROFILE
+    cout << endl << "[Profile]" << endl;
+    stats_registry.print("PROFILE", cout);
+#endif
+
+    if (knob::stats_json_file.size())
+        stats_registry.write_json(knob::stats_json_file.c_str());
+
     return 0;
 }
@@ -1,5 +1,6 @@
 #include "ooo_cpu.h"
 #include "set.h"
+#include "checkpoint.h"
 namespace knob
 {
 	extern bool knob_cloudsuite;
@@ -45,6 +46,8 @@ void O3_CPU::initialize_core()
 
 void O3_CPU::handle_branch()
 {
+    PROFILE_SCOPE(profile_handle_branch);
+
     // actual processors do not work like this but for easier implementation,
     // we read instruction traces and virtually add them in the ROB
     // note that these traces are not yet translated and fetched 
@@ -59,18 +62,13 @@ void O3_CPU::handle_branch()
         size_t instr_size = knob::knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
 
         if (knob::knob_cloudsuite) {
-            if (!fread(&current_cloudsuite_instr, instr_size, 1, trace_file)) {
+            const uint8_t *record = trace_reader->next_record();
+            if (record == NULL) {
                 // reached end of file for this trace
+                // the trace reader has already started over from the beginning of the trace
                 cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
-
-                // close the trace file and re-open it
-                pclose(trace_file);
-                trace_file = popen(gunzip_command, "r");
-                if (trace_file == NULL) {
-                    cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << trace_string << " ***" << endl;
-                    assert(0);
-                }
             } else { // successfully read the trace
+                memcpy(&current_cloudsuite_instr, record, instr_size);
 
                 // copy the instruction into the performance model's instruction format
                 ooo_model_instr arch_instr;
@@ -193,18 +191,13 @@ void O3_CPU::handle_branch()
         }
 	else
 	  {
-            if (!fread(&current_instr, instr_size, 1, trace_file)) {
+            const uint8_t *record = trace_reader->next_record();
+            if (record == NULL) {
                 // reached end of file for this trace
+                // the trace reader has already started over from the beginning of the trace
                 cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
-
-                // close the trace file and re-open it
-                pclose(trace_file);
-                trace_file = popen(gunzip_command, "r");
-                if (trace_file == NULL) {
-                    cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << trace_string << " ***" << endl;
-                    assert(0);
-                }
             } else { // successfully read the trace
+                memcpy(&current_instr, record, instr_size);
 
                 // copy the instruction into the performance model's instruction format
                 ooo_model_instr arch_instr;
@@ -409,6 +402,8 @@ uint32_t O3_CPU::check_rob(uint64_t instr_id)
 
 void O3_CPU::fetch_instruction()
 {
+    PROFILE_SCOPE(profile_fetch_instruction);
+
     // TODO: can we model wrong path execusion?
 
   // if we had a branch mispredict, turn fetching back on after the branch mispredict penalty
@@ -546,6 +541,8 @@ void O3_CPU::fetch_instruction()
 // III. Instruction is retired
 void O3_CPU::schedule_instruction()
 {
+    PROFILE_SCOPE(profile_schedule_instruction);
+
     if ((ROB.head == ROB.tail) && ROB.occupancy == 0)
         return;
 
@@ -700,6 +697,8 @@ void O3_CPU::reg_RAW_dependency(uint32_t prior, uint32_t current, uint32_t sourc
 
 void O3_CPU::execute_instruction()
 {
+    PROFILE_SCOPE(profile_execute_instruction);
+
     if ((ROB.head == ROB.tail) && ROB.occupancy == 0)
         return;
 
@@ -779,6 +778,8 @@ void O3_CPU::do_execution(uint32_t rob_index)
 
 void O3_CPU::schedule_memory_instruction()
 {
+    PROFILE_SCOPE(profile_schedule_memory_instruction);
+
     if ((ROB.head == ROB.tail) && ROB.occupancy == 0)
         return;
 
@@ -826,6 +827,8 @@ void O3_CPU::schedule_memory_instruction()
 
 void O3_CPU::execute_memory_instruction()
 {
+    PROFILE_SCOPE(profile_execute_memory_instruction);
+
     operate_lsq();
     operate_cache();
 }
@@ -1528,6 +1531,8 @@ void O3_CPU::broadcast_ipc(uint8_t ipc)
 
 void O3_CPU::update_rob()
 {
+    PROFILE_SCOPE(profile_update_rob);
+
     if (ITLB.PROCESSED.occupancy && (ITLB.PROCESSED.entry[ITLB.PROCESSED.head].event_cycle <= current_core_cycle[cpu]))
         complete_instr_fetch(&ITLB.PROCESSED, 1);
 
@@ -1884,6 +1889,8 @@ void O3_CPU::release_load_queue(uint32_t lq_index)
 
 void O3_CPU::retire_rob()
 {
+    PROFILE_SCOPE(profile_retire_rob);
+
     for (uint32_t n=0; n<RETIRE_WIDTH; n++) {
         if (ROB.entry[ROB.head].ip == 0)
             return;
@@ -1976,3 +1983,286 @@ void O3_CPU::retire_rob()
         num_retired++;
     }
 }
+
+// earliest cycle after current at which this core's pipeline or one of its caches may change state,
+// provided nothing else changes in between, and current+1 whenever it may act right away
+// every check below mirrors the condition the corresponding stage tests before doing any work
+uint64_t O3_CPU::next_event_cycle(uint64_t current)
+{
+    uint64_t now = current + 1, next = UINT64_MAX;
+
+    // handle_branch() reads the trace whenever the ROB has room
+    if ((ROB.occupancy < ROB.SIZE) && (fetch_stall == 0))
+        return now;
+
+    // fetch_instruction()
+    if ((fetch_stall == 1) && (fetch_resume_cycle != 0)) {
+        if (fetch_resume_cycle <= now)
+            return now;
+        next = min(next, fetch_resume_cycle);
+    }
+
+    uint32_t read_index = (ROB.last_read == (ROB.SIZE-1)) ? 0 : (ROB.last_read + 1);
+    if (ROB.entry[read_index].ip) {
+#ifdef SANITY_CHECK
+        if ((ROB.entry[read_index].translated == 0) || (read_index != ROB.head))
+            return now;
+#else
+        return now;
+#endif
+    }
+
+    uint32_t fetch_index = (ROB.last_fetch == (ROB.SIZE-1)) ? 0 : (ROB.last_fetch + 1);
+    if (ROB.entry[fetch_index].translated == COMPLETED) {
+        if (ROB.entry[fetch_index].event_cycle > now)
+            next = min(next, ROB.entry[fetch_index].event_cycle);
+        else if ((ROB.entry[fetch_index].fetched == 0) || (fetch_index != ROB.head))
+            return now;
+    }
+
+    // schedule_instruction(), only called when the next entry to schedule is ready
+    uint32_t schedule_index = ROB.next_schedule;
+    if (ROB.entry[schedule_index].scheduled == 0) {
+        if (ROB.entry[schedule_index].event_cycle > now)
+            next = min(next, ROB.entry[schedule_index].event_cycle);
+        else if (ROB.occupancy) {
+            uint32_t limit = ROB.next_fetch[1],
+                     count = (ROB.head < limit) ? (limit - ROB.head) : (ROB.SIZE - ROB.head + limit);
+            for (uint32_t n=0; n<count; n++) {
+                uint32_t i = (ROB.head + n) % ROB.SIZE;
+                if ((ROB.entry[i].fetched != COMPLETED) || (n >= SCHEDULER_SIZE))
+                    break;
+                if (ROB.entry[i].event_cycle > now) {
+                    next = min(next, ROB.entry[i].event_cycle);
+                    break;
+                }
+                if (ROB.entry[i].scheduled == 0)
+                    return now;
+            }
+        }
+    }
+
+    if (ROB.occupancy) {
+        // execute_instruction()
+        if (RTE0[RTE0_head] < ROB_SIZE) {
+            if (ROB.entry[RTE0[RTE0_head]].event_cycle <= now)
+                return now;
+            next = min(next, ROB.entry[RTE0[RTE0_head]].event_cycle);
+        }
+        if (RTE1[RTE1_head] < ROB_SIZE) {
+            if (ROB.entry[RTE1[RTE1_head]].event_cycle <= now)
+                return now;
+            next = min(next, ROB.entry[RTE1[RTE1_head]].event_cycle);
+        }
+
+        // schedule_memory_instruction(), which scans a wrapped ROB in two separate loops
+        uint32_t limit = ROB.next_schedule, searched = 0;
+        if (ROB.head < limit) {
+            if (memory_scheduling_pending(ROB.head, limit, now, searched, next))
+                return now;
+        }
+        else {
+            if (memory_scheduling_pending(ROB.head, ROB.SIZE, now, searched, next))
+                return now;
+            if (memory_scheduling_pending(0, limit, now, searched, next))
+                return now;
+        }
+    }
+
+    // operate_lsq()
+    if (RTS0[RTS0_head] < SQ_SIZE) {
+        if (SQ.entry[RTS0[RTS0_head]].event_cycle <= now)
+            return now;
+        next = min(next, SQ.entry[RTS0[RTS0_head]].event_cycle);
+    }
+    if (RTS1[RTS1_head] < SQ_SIZE) {
+        if (SQ.entry[RTS1[RTS1_head]].event_cycle <= now)
+            return now;
+        next = min(next, SQ.entry[RTS1[RTS1_head]].event_cycle);
+    }
+    if (RTL0[RTL0_head] < LQ_SIZE) {
+        if (LQ.entry[RTL0[RTL0_head]].event_cycle <= now)
+            return now;
+        next = min(next, LQ.entry[RTL0[RTL0_head]].event_cycle);
+    }
+    if (RTL1[RTL1_head] < LQ_SIZE) {
+        if (LQ.entry[RTL1[RTL1_head]].event_cycle <= now)
+            return now;
+        next = min(next, LQ.entry[RTL1[RTL1_head]].event_cycle);
+    }
+
+    // operate_cache()
+    CACHE *cache[6] = {&ITLB, &DTLB, &STLB, &L1I, &L1D, &L2C};
+    for (uint32_t i=0; i<6; i++) {
+        next = min(next, cache[i]->next_event_cycle(current));
+        if (next <= now)
+            return now;
+    }
+
+    // update_rob()
+    PACKET_QUEUE *processed[4] = {&ITLB.PROCESSED, &L1I.PROCESSED, &DTLB.PROCESSED, &L1D.PROCESSED};
+    for (uint32_t i=0; i<4; i++) {
+        if (processed[i]->occupancy) {
+            if (processed[i]->entry[processed[i]->head].event_cycle <= now)
+                return now;
+            next = min(next, processed[i]->entry[processed[i]->head].event_cycle);
+        }
+    }
+
+    if ((inflight_reg_executions > 0) || (inflight_mem_executions > 0)) {
+        for (uint32_t i=0; i<ROB.SIZE; i++) {
+            if ((ROB.entry[i].executed == INFLIGHT) && ((ROB.entry[i].is_memory == 0) || (ROB.entry[i].num_mem_ops == 0))) {
+                if (ROB.entry[i].event_cycle <= now)
+                    return now;
+                next = min(next, ROB.entry[i].event_cycle);
+            }
+        }
+    }
+
+    // retire_rob()
+    if (ROB.entry[ROB.head].executed == COMPLETED) {
+        if (ROB.entry[ROB.head].event_cycle <= now)
+            return now;
+        next = min(next, ROB.entry[ROB.head].event_cycle);
+    }
+
+    return next;
+}
+
+// dry run of one scan loop of schedule_memory_instruction(), 1 if it would schedule an entry
+uint8_t O3_CPU::memory_scheduling_pending(uint32_t begin, uint32_t end, uint64_t now, uint32_t &searched, uint64_t &next)
+{
+    for (uint32_t i=begin; i<end; i++) {
+
+        if (ROB.entry[i].is_memory == 0)
+            continue;
+
+        if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > now) || (searched >= SCHEDULER_SIZE)) {
+            if ((ROB.entry[i].fetched == COMPLETED) && (ROB.entry[i].event_cycle > now))
+                next = min(next, ROB.entry[i].event_cycle);
+            break;
+        }
+
+        if (ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT)) {
+            if (lsq_pending(i))
+                return 1;
+            searched++;
+        }
+    }
+
+    return 0;
+}
+
+// 1 if check_and_add_lsq() would add an operand to the LSQ or find all of them added
+uint8_t O3_CPU::lsq_pending(uint32_t rob_index)
+{
+    uint32_t num_mem_ops = 0, num_added = 0;
+
+    for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+        if (ROB.entry[rob_index].source_memory[i]) {
+            num_mem_ops++;
+            if (ROB.entry[rob_index].source_added[i])
+                num_added++;
+            else if (LQ.occupancy < LQ.SIZE)
+                return 1;
+        }
+    }
+
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[rob_index].destination_memory[i]) {
+            num_mem_ops++;
+            if (ROB.entry[rob_index].destination_added[i])
+                num_added++;
+            else if ((SQ.occupancy < SQ.SIZE) && (STA[STA_head] == ROB.entry[rob_index].instr_id))
+                return 1;
+        }
+    }
+
+    return num_added == num_mem_ops;
+}
+
+// account for idle cycles skipped by the main loop while this core was not stalled
+void O3_CPU::fast_forward(uint64_t cycles)
+{
+    ITLB.fast_forward(cycles);
+    DTLB.fast_forward(cycles);
+    STLB.fast_forward(cycles);
+    L1I.fast_forward(cycles);
+    L1D.fast_forward(cycles);
+    L2C.fast_forward(cycles);
+}
+
+void O3_CPU::checkpoint(CHECKPOINT &cp)
+{
+    cp.section(("CPU" + to_string(cpu)).c_str());
+
+    // the trace is fast-forwarded to the record the saved core would have read next
+    uint64_t trace_position = cp.saving() ? trace_reader->position() : 0;
+    cp.scalar(trace_position);
+    if (!cp.saving())
+        trace_reader->skip(trace_position);
+
+    cp.scalar(current_instr);
+    cp.scalar(current_cloudsuite_instr);
+    cp.scalar(instr_unique_id);
+    cp.scalar(completed_executions);
+    cp.scalar(begin_sim_cycle);
+    cp.scalar(begin_sim_instr);
+    cp.scalar(last_sim_cycle);
+    cp.scalar(last_sim_instr);
+    cp.scalar(finish_sim_cycle);
+    cp.scalar(finish_sim_instr);
+    cp.scalar(instrs_to_read_this_cycle);
+    cp.scalar(instrs_to_fetch_this_cycle);
+    cp.scalar(next_print_instruction);
+    cp.scalar(num_retired);
+    cp.scalar(inflight_reg_executions);
+    cp.scalar(inflight_mem_executions);
+    cp.scalar(num_searched);
+    cp.scalar(next_ITLB_fetch);
+    cp.scalar(last_num_ins);
+    cp.scalar(last_ins_in_epoch);
+    cp.scalar(next_measure_ipc_cycle);
+
+    ROB.checkpoint(cp);
+    LQ.checkpoint(cp);
+    SQ.checkpoint(cp);
+
+    cp.array(STA, STA_SIZE);
+    cp.scalar(STA_head);
+    cp.scalar(STA_tail);
+    cp.array(RTE0, ROB_SIZE);
+    cp.scalar(RTE0_head);
+    cp.scalar(RTE0_tail);
+    cp.array(RTE1, ROB_SIZE);
+    cp.scalar(RTE1_head);
+    cp.scalar(RTE1_tail);
+    cp.array(RTL0, LQ_SIZE);
+    cp.scalar(RTL0_head);
+    cp.scalar(RTL0_tail);
+    cp.array(RTL1, LQ_SIZE);
+    cp.scalar(RTL1_head);
+    cp.scalar(RTL1_tail);
+    cp.array(RTS0, SQ_SIZE);
+    cp.scalar(RTS0_head);
+    cp.scalar(RTS0_tail);
+    cp.array(RTS1, SQ_SIZE);
+    cp.scalar(RTS1_head);
+    cp.scalar(RTS1_tail);
+
+    cp.scalar(branch_mispredict_stall_fetch);
+    cp.scalar(mispredicted_branch_iw_index);
+    cp.scalar(fetch_stall);
+    cp.scalar(fetch_resume_cycle);
+    cp.scalar(num_branch);
+    cp.scalar(branch_mispredictions);
+    cp.scalar(total_rob_occupancy_at_branch_mispredict);
+    checkpoint_branch_predictor(cp);
+
+    ITLB.checkpoint(cp);
+    DTLB.checkpoint(cp);
+    STLB.checkpoint(cp);
+    L1I.checkpoint(cp);
+    L1D.checkpoint(cp);
+    L2C.checkpoint(cp);
+}
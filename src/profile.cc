@@ -0,0 +1,21 @@
+#include "profile.h"
+
+#ifdef ENABLE_PROFILE
+
+#include "stats.h"
+
+using namespace std;
+
+thread_local PROFILE_TIMER *PROFILE_TIMER::current = NULL;
+
+PROFILE_SITE profile_main_loop;
+
+void profile_register(const string &v1, PROFILE_SITE *v2)
+{
+    stats_registry.section("PROFILE");
+    stats_registry.counter(v1 + "_calls", &v2->calls);
+    stats_registry.counter(v1 + "_self_ticks", &v2->self_ticks);
+    stats_registry.ratio(v1 + "_self_share", [=]() { return (100.0 * v2->self_ticks) / profile_main_loop.ticks; });
+}
+
+#endif
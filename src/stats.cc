@@ -0,0 +1,312 @@
+#include <iostream>
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include "stats.h"
+
+using namespace std;
+
+STATS stats_registry;
+
+void STATS::section(const string &v1)
+{
+    for (uint32_t i = 0; i < sections.size(); i++) {
+        if (sections[i].name == v1) {
+            current = i;
+            return;
+        }
+    }
+    sections.push_back(SECTION());
+    sections.back().name = v1;
+    current = sections.size() - 1;
+}
+
+void STATS::counter(const string &v1, uint64_t *v2)
+{
+    ENTRY e;
+    e.kind = COUNTER;
+    e.name = v1;
+    e.counter = v2;
+    add(e);
+}
+
+void STATS::value(const string &v1, function<uint64_t()> v2)
+{
+    ENTRY e;
+    e.kind = VALUE;
+    e.name = v1;
+    e.value = v2;
+    add(e);
+}
+
+void STATS::ratio(const string &v1, function<double()> v2, const char *v3)
+{
+    ENTRY e;
+    e.kind = RATIO;
+    e.name = v1;
+    e.ratio = v2;
+    e.format = v3;
+    add(e);
+}
+
+void STATS::histogram(const string &v1, uint64_t *v2, uint32_t v3)
+{
+    ENTRY e;
+    e.kind = HISTOGRAM;
+    e.name = v1;
+    e.counter = v2;
+    e.size = v3;
+    add(e);
+}
+
+void STATS::row(const string &v1, uint64_t *v2, uint32_t v3)
+{
+    ENTRY e;
+    e.kind = ROW;
+    e.name = v1;
+    e.counter = v2;
+    e.size = v3;
+    add(e);
+}
+
+void STATS::values(const string &v1, function<VALUES()> v2, const char *v3)
+{
+    ENTRY e;
+    e.kind = VALUES_AT_END;
+    e.name = v1;
+    e.values = v2;
+    e.format = v3;
+    add(e);
+}
+
+void STATS::rows(const string &v1, function<ROWS()> v2)
+{
+    ENTRY e;
+    e.kind = ROWS_AT_END;
+    e.name = v1;
+    e.rows = v2;
+    add(e);
+}
+
+void STATS::at_end(bool v1) { live = !v1; }
+
+void STATS::blank()
+{
+    ENTRY e;
+    e.kind = BLANK;
+    add(e);
+}
+
+void STATS::line(const string &v1)
+{
+    ENTRY e;
+    e.kind = LINE;
+    e.text = v1;
+    add(e);
+}
+
+void STATS::label(const string &v1)
+{
+    assert(!sections.empty() && !sections[current].entries.empty());
+    ENTRY &e = sections[current].entries.back();
+    e.labeled = true;
+    e.text = v1;
+}
+
+bool STATS::has_section(const string &v1) { return find(v1) != NULL; }
+
+void STATS::print(const string &v1, ostream &out)
+{
+    SECTION *s = find(v1);
+    assert(s);
+    char buffer[256];
+    for (uint32_t i = 0; i < s->entries.size(); i++) {
+        ENTRY &e = s->entries[i];
+        if (e.labeled && e.text.empty())
+            continue;
+        const string &name = e.labeled ? e.text : e.name;
+        switch (e.kind) {
+        case COUNTER:
+            out << name << " " << *e.counter << endl;
+            break;
+        case VALUE:
+            out << name << " " << e.value() << endl;
+            break;
+        case RATIO:
+            if (e.format) {
+                snprintf(buffer, sizeof(buffer), e.format, e.ratio());
+                out << name << " " << buffer << endl;
+            } else
+                out << name << " " << e.ratio() << endl;
+            break;
+        case HISTOGRAM:
+            for (uint32_t j = 0; j < e.size; j++)
+                out << name << "_" << j << " " << e.counter[j] << endl;
+            break;
+        case ROW:
+            out << name << " ";
+            for (uint32_t j = 0; j < e.size; j++)
+                out << e.counter[j] << ",";
+            out << endl;
+            break;
+        case VALUES_AT_END: {
+            VALUES values = e.values();
+            for (uint32_t j = 0; j < values.size(); j++) {
+                if (e.format) {
+                    snprintf(buffer, sizeof(buffer), e.format, values[j].first.c_str(), values[j].second);
+                    out << buffer << endl;
+                } else
+                    out << values[j].first << " " << values[j].second << endl;
+            }
+            break;
+        }
+        case ROWS_AT_END: {
+            ROWS rows = e.rows();
+            for (uint32_t j = 0; j < rows.size(); j++) {
+                out << rows[j].first << " ";
+                for (uint32_t k = 0; k < rows[j].second.size(); k++)
+                    out << rows[j].second[k] << ",";
+                out << endl;
+            }
+            break;
+        }
+        case BLANK:
+            out << endl;
+            break;
+        case LINE:
+            out << e.text << endl;
+            break;
+        }
+    }
+}
+
+// one object per section, counters as integers, histograms and rows as arrays,
+// end-of-run values and rows as one nested object each, all under their names, not their text labels
+// ratios keep full precision whatever their text format; a 0/0 ratio has no JSON number and is written as null
+void STATS::write_json(const char *file_name)
+{
+    FILE *file = fopen(file_name, "w");
+    if (file == NULL) {
+        cerr << "*** CANNOT OPEN STATS FILE: " << file_name << " ***" << endl;
+        assert(0);
+    }
+
+    fprintf(file, "{");
+    for (uint32_t i = 0; i < sections.size(); i++) {
+        fprintf(file, "%s\n  \"%s\": {", i ? "," : "", sections[i].name.c_str());
+        bool first = true;
+        for (uint32_t j = 0; j < sections[i].entries.size(); j++) {
+            ENTRY &e = sections[i].entries[j];
+            if (e.kind == BLANK || e.kind == LINE)
+                continue;
+            fprintf(file, "%s\n    \"%s\": ", first ? "" : ",", e.name.c_str());
+            first = false;
+            if (e.kind == COUNTER)
+                fprintf(file, "%lu", *e.counter);
+            else if (e.kind == VALUE)
+                fprintf(file, "%lu", e.value());
+            else if (e.kind == RATIO) {
+                double r = e.ratio();
+                if (isfinite(r))
+                    fprintf(file, "%.17g", r);
+                else
+                    fprintf(file, "null");
+            } else if (e.kind == VALUES_AT_END) {
+                VALUES values = e.values();
+                fprintf(file, "{");
+                for (uint32_t k = 0; k < values.size(); k++)
+                    fprintf(file, "%s\"%s\": %lu", k ? ", " : "", values[k].first.c_str(), values[k].second);
+                fprintf(file, "}");
+            } else if (e.kind == ROWS_AT_END) {
+                ROWS rows = e.rows();
+                fprintf(file, "{");
+                for (uint32_t k = 0; k < rows.size(); k++) {
+                    fprintf(file, "%s\n      \"%s\": [", k ? "," : "", rows[k].first.c_str());
+                    for (uint32_t l = 0; l < rows[k].second.size(); l++)
+                        fprintf(file, "%s%lu", l ? ", " : "", rows[k].second[l]);
+                    fprintf(file, "]");
+                }
+                fprintf(file, "%s}", rows.empty() ? "" : "\n    ");
+            } else {
+                fprintf(file, "[");
+                for (uint32_t k = 0; k < e.size; k++)
+                    fprintf(file, "%s%lu", k ? ", " : "", e.counter[k]);
+                fprintf(file, "]");
+            }
+        }
+        fprintf(file, "\n  }");
+    }
+    fprintf(file, "\n}\n");
+    fclose(file);
+}
+
+function<uint64_t()> STATS::reader(const string &v1, string &v2)
+{
+    // section:name picks one of several prefetcher instances that use the same names
+    size_t colon = v1.find(':');
+    string name = (colon == string::npos) ? v1 : v1.substr(colon + 1);
+    v2 = "not registered";
+    for (uint32_t i = 0; i < sections.size(); i++) {
+        if (colon != string::npos && sections[i].name != v1.substr(0, colon))
+            continue;
+        for (uint32_t j = 0; j < sections[i].entries.size(); j++) {
+            ENTRY &e = sections[i].entries[j];
+            if (e.kind == HISTOGRAM && name.compare(0, e.name.size() + 1, e.name + "_") == 0) {
+                string bucket = name.substr(e.name.size() + 1);
+                for (uint32_t k = 0; k < e.size; k++) {
+                    if (bucket == to_string(k) && e.live) {
+                        uint64_t *counter = &e.counter[k];
+                        return [=]() { return *counter; };
+                    }
+                }
+            }
+            if (e.name != name || e.kind == BLANK || e.kind == LINE)
+                continue;
+            if (!e.live) {
+                v2 = "only filled at the end of the run, sample the live INTERVAL counters instead";
+                return function<uint64_t()>();
+            }
+            if (e.kind == COUNTER) {
+                uint64_t *counter = e.counter;
+                return [=]() { return *counter; };
+            }
+            if (e.kind == VALUE)
+                return e.value;
+            if (e.kind == RATIO)
+                v2 = "a ratio computed at the end of the run, sample its inputs instead";
+            else
+                v2 = "a row or end-of-run distribution, not a single counter";
+            return function<uint64_t()>();
+        }
+    }
+    return function<uint64_t()>();
+}
+
+vector<string> STATS::names(const string &v1)
+{
+    vector<string> result;
+    SECTION *s = find(v1);
+    if (s == NULL)
+        return result;
+    for (uint32_t i = 0; i < s->entries.size(); i++) {
+        if (s->entries[i].kind == COUNTER || s->entries[i].kind == VALUE)
+            result.push_back(s->entries[i].name);
+    }
+    return result;
+}
+
+STATS::SECTION *STATS::find(const string &v1)
+{
+    for (uint32_t i = 0; i < sections.size(); i++) {
+        if (sections[i].name == v1)
+            return &sections[i];
+    }
+    return NULL;
+}
+
+void STATS::add(ENTRY &v1)
+{
+    assert(!sections.empty());
+    v1.live = live;
+    sections[current].entries.push_back(v1);
+}
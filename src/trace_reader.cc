@@ -0,0 +1,704 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <new>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <zlib.h>
+#include <lzma.h>
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
+#include "trace_reader.h"
+
+using namespace std;
+
+namespace knob
+{
+	extern string trace_cache_dir;
+}
+
+#define TRACE_INPUT_BUFFER_SIZE (1 << 20)
+
+// streaming decoder of one compressed trace file
+class TRACE_DECODER {
+  public:
+    const string NAME;
+
+    TRACE_DECODER(string v1) : NAME(v1) {};
+    virtual ~TRACE_DECODER() {};
+
+    // decode up to len bytes, returns 0 at the end of the trace
+    virtual size_t read(uint8_t *buf, size_t len) = 0;
+    // start over from the beginning of the trace
+    virtual void rewind() = 0;
+};
+
+class GZ_DECODER : public TRACE_DECODER {
+  public:
+    gzFile file;
+
+    GZ_DECODER(string v1) : TRACE_DECODER(v1) {
+        file = gzopen(NAME.c_str(), "rb");
+        if (file == NULL) {
+            cerr << "*** CANNOT OPEN TRACE FILE: " << NAME << " ***" << endl;
+            assert(0);
+        }
+        gzbuffer(file, TRACE_INPUT_BUFFER_SIZE);
+    };
+
+    ~GZ_DECODER() {
+        gzclose(file);
+    };
+
+    size_t read(uint8_t *buf, size_t len) {
+        int bytes = gzread(file, buf, len);
+        if (bytes < 0) {
+            int err;
+            cerr << "*** CANNOT DECOMPRESS TRACE FILE: " << NAME << " " << gzerror(file, &err) << " ***" << endl;
+            assert(0);
+        }
+        return bytes;
+    };
+
+    void rewind() {
+        gzrewind(file);
+    };
+};
+
+class XZ_DECODER : public TRACE_DECODER {
+  public:
+    FILE *file;
+    lzma_stream strm;
+    uint8_t *in_buf;
+    lzma_action action;
+    bool stream_end;
+
+    XZ_DECODER(string v1) : TRACE_DECODER(v1) {
+        file = fopen(NAME.c_str(), "rb");
+        if (file == NULL) {
+            cerr << "*** CANNOT OPEN TRACE FILE: " << NAME << " ***" << endl;
+            assert(0);
+        }
+        in_buf = new uint8_t[TRACE_INPUT_BUFFER_SIZE];
+        memset(&strm, 0, sizeof(strm));
+        init();
+    };
+
+    ~XZ_DECODER() {
+        lzma_end(&strm);
+        fclose(file);
+        delete[] in_buf;
+    };
+
+    void init() {
+        lzma_stream empty = LZMA_STREAM_INIT;
+        strm = empty;
+        if (lzma_stream_decoder(&strm, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+            cerr << "*** CANNOT INITIALIZE XZ DECODER: " << NAME << " ***" << endl;
+            assert(0);
+        }
+        action = LZMA_RUN;
+        stream_end = false;
+    };
+
+    size_t read(uint8_t *buf, size_t len) {
+        if (stream_end)
+            return 0;
+
+        strm.next_out = buf;
+        strm.avail_out = len;
+        while (strm.avail_out) {
+            // once the whole file has been fed in, liblzma has to be told to finish
+            if (strm.avail_in == 0 && action == LZMA_RUN) {
+                strm.next_in = in_buf;
+                strm.avail_in = fread(in_buf, 1, TRACE_INPUT_BUFFER_SIZE, file);
+                if (feof(file))
+                    action = LZMA_FINISH;
+            }
+
+            lzma_ret ret = lzma_code(&strm, action);
+            if (ret == LZMA_STREAM_END) {
+                stream_end = true;
+                break;
+            }
+            if (ret != LZMA_OK) {
+                cerr << "*** CANNOT DECOMPRESS TRACE FILE: " << NAME << " lzma error " << ret << " ***" << endl;
+                assert(0);
+            }
+        }
+        return len - strm.avail_out;
+    };
+
+    void rewind() {
+        lzma_end(&strm);
+        ::rewind(file);
+        init();
+    };
+};
+
+#ifdef ENABLE_ZSTD
+class ZSTD_DECODER : public TRACE_DECODER {
+  public:
+    FILE *file;
+    ZSTD_DCtx *ctx;
+    uint8_t *in_buf;
+    ZSTD_inBuffer input;
+
+    ZSTD_DECODER(string v1) : TRACE_DECODER(v1) {
+        file = fopen(NAME.c_str(), "rb");
+        if (file == NULL) {
+            cerr << "*** CANNOT OPEN TRACE FILE: " << NAME << " ***" << endl;
+            assert(0);
+        }
+        in_buf = new uint8_t[TRACE_INPUT_BUFFER_SIZE];
+        ctx = ZSTD_createDCtx();
+        input.src = in_buf;
+        input.size = 0;
+        input.pos = 0;
+    };
+
+    ~ZSTD_DECODER() {
+        ZSTD_freeDCtx(ctx);
+        fclose(file);
+        delete[] in_buf;
+    };
+
+    size_t read(uint8_t *buf, size_t len) {
+        ZSTD_outBuffer output = {buf, len, 0};
+        while (output.pos < output.size) {
+            if (input.pos == input.size) {
+                input.size = fread(in_buf, 1, TRACE_INPUT_BUFFER_SIZE, file);
+                input.pos = 0;
+                if (input.size == 0)
+                    break;
+            }
+
+            size_t ret = ZSTD_decompressStream(ctx, &output, &input);
+            if (ZSTD_isError(ret)) {
+                cerr << "*** CANNOT DECOMPRESS TRACE FILE: " << NAME << " " << ZSTD_getErrorName(ret) << " ***" << endl;
+                assert(0);
+            }
+        }
+        return output.pos;
+    };
+
+    void rewind() {
+        ZSTD_DCtx_reset(ctx, ZSTD_reset_session_only);
+        ::rewind(file);
+        input.size = 0;
+        input.pos = 0;
+    };
+};
+#endif
+
+TRACE_DECODER *open_decoder(const char *trace_name)
+{
+    const char *last_dot = strrchr(trace_name, '.');
+    string extension = last_dot ? string(last_dot + 1) : string();
+
+    if (extension == "gz")
+        return new GZ_DECODER(trace_name);
+    if (extension == "xz")
+        return new XZ_DECODER(trace_name);
+#ifdef ENABLE_ZSTD
+    if (extension == "zst")
+        return new ZSTD_DECODER(trace_name);
+#endif
+
+#ifdef ENABLE_ZSTD
+    cerr << "ChampSim does not support traces other than gz, xz, or zst compression!" << endl;
+#else
+    cerr << "ChampSim does not support traces other than gz or xz compression! (build with zstd=1 for zst)" << endl;
+#endif
+    assert(0);
+    return NULL;
+}
+
+TRACE_FANOUT *trace_fanout = NULL;
+
+// waiting on the other side of a fanout ring, which lives in another process
+static void fanout_backoff(uint32_t &spins)
+{
+    if (++spins < 64)
+        sched_yield();
+    else
+        usleep(20);
+}
+
+TRACE_FANOUT::TRACE_FANOUT(vector<string> &v1, uint32_t v2, uint32_t v3) : traces(v1), record_size(v2), num_consumers(v3)
+{
+    consumer = 0;
+    attached = 0;
+
+    if (num_consumers == 0 || num_consumers > TRACE_FANOUT_MAX_CONSUMERS) {
+        cerr << "*** FANOUT SUPPORTS 1 TO " << TRACE_FANOUT_MAX_CONSUMERS << " CONFIGS ***" << endl;
+        assert(0);
+    }
+
+    // mapped before the children are forked, so every one of them sees the same pages
+    size_t bytes = TRACE_FANOUT_RING::HEADER_SIZE + (size_t)TRACE_FANOUT_CHUNKS * TRACE_CHUNK_RECORDS * record_size;
+    for (uint32_t i=0; i<traces.size(); i++) {
+        void *base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            cerr << "*** CANNOT MAP FANOUT RING FOR TRACE: " << traces[i] << " ***" << endl;
+            assert(0);
+        }
+
+        TRACE_FANOUT_RING *r = (TRACE_FANOUT_RING *)base;
+        r->record_size = record_size;
+        new (&r->produced) atomic<uint64_t>(0);
+        // slots of absent children never hold the parent back
+        for (uint32_t c=0; c<TRACE_FANOUT_MAX_CONSUMERS; c++)
+            new (&r->consumed[c]) atomic<uint64_t>(c < num_consumers ? 0 : UINT64_MAX);
+        rings.push_back(r);
+    }
+}
+
+void TRACE_FANOUT::attach(uint32_t v1)
+{
+    assert(v1 < num_consumers);
+    consumer = v1;
+    attached = 0;
+}
+
+TRACE_FANOUT_RING *TRACE_FANOUT::next_ring()
+{
+    if (attached == rings.size()) {
+        cerr << "*** FANOUT CHILD OPENS MORE TRACES THAN THE PARENT DECODES ***" << endl;
+        assert(0);
+    }
+    return rings[attached++];
+}
+
+uint32_t TRACE_FANOUT::produce(vector<pid_t> &v1)
+{
+    vector<TRACE_DECODER *> decoders;
+    vector<uint64_t> records_since_rewind(traces.size(), 0);
+    for (uint32_t i=0; i<traces.size(); i++)
+        decoders.push_back(open_decoder(traces[i].c_str()));
+
+    const size_t chunk_bytes = (size_t)TRACE_CHUNK_RECORDS * record_size;
+    uint32_t running = v1.size(), failed = 0;
+    while (running) {
+        bool progress = false;
+
+        for (uint32_t t=0; t<rings.size(); t++) {
+            TRACE_FANOUT_RING *r = rings[t];
+            uint64_t seq = r->produced.load(memory_order_relaxed);
+            uint64_t slowest = UINT64_MAX;
+            for (uint32_t c=0; c<num_consumers; c++)
+                slowest = min(slowest, r->consumed[c].load(memory_order_acquire));
+            if (slowest == UINT64_MAX || seq >= slowest + TRACE_FANOUT_CHUNKS)
+                continue;
+
+            // same chunking and end of trace handling as decode_loop()
+            uint32_t slot = seq % TRACE_FANOUT_CHUNKS;
+            uint8_t *data = r->chunk_data(seq);
+            size_t bytes = 0;
+            r->end_of_trace[slot] = false;
+            while (bytes < chunk_bytes) {
+                size_t n = decoders[t]->read(data + bytes, chunk_bytes - bytes);
+                if (n == 0) {
+                    r->end_of_trace[slot] = true;
+                    break;
+                }
+                bytes += n;
+            }
+            r->num_records[slot] = bytes / record_size;
+            records_since_rewind[t] += r->num_records[slot];
+
+            if (r->end_of_trace[slot]) {
+                if (records_since_rewind[t] == 0) {
+                    cerr << endl << "*** TRACE FILE CONTAINS NO INSTRUCTIONS: " << decoders[t]->NAME << " ***" << endl;
+                    assert(0);
+                }
+                decoders[t]->rewind();
+                records_since_rewind[t] = 0;
+            }
+
+            r->produced.store(seq + 1, memory_order_release);
+            progress = true;
+        }
+
+        // a child that is done, whichever way, stops holding the rings back
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            for (uint32_t c=0; c<v1.size(); c++) {
+                if (v1[c] != pid)
+                    continue;
+                for (uint32_t t=0; t<rings.size(); t++)
+                    rings[t]->consumed[c].store(UINT64_MAX, memory_order_release);
+                running--;
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    cerr << "*** FANOUT CHILD " << c << " FAILED ***" << endl;
+                    failed++;
+                }
+            }
+        }
+
+        if (!progress)
+            usleep(50);
+    }
+
+    for (uint32_t i=0; i<decoders.size(); i++)
+        delete decoders[i];
+    return failed;
+}
+
+TRACE_READER::TRACE_READER(const char *v1, uint32_t v2) : RECORD_SIZE(v2)
+{
+    decoder = NULL;
+
+    image = NULL;
+    image_records = 0;
+    image_pos = 0;
+    image_bytes = 0;
+
+    ring = NULL;
+    ring_data = NULL;
+    ring_seq = 0;
+
+    current = NULL;
+    read_index = 0;
+    read_pos = 0;
+    records_read = 0;
+    end_reported = false;
+
+    write_index = 0;
+    stop = false;
+
+    if (trace_fanout) {
+        ring = trace_fanout->next_ring();
+        if (ring->record_size != RECORD_SIZE) {
+            cerr << "*** FANOUT CONFIGS MUST AGREE ON knob_cloudsuite ***" << endl;
+            assert(0);
+        }
+        return;
+    }
+
+    if (!knob::trace_cache_dir.empty()) {
+        open_trace_cache(v1, knob::trace_cache_dir.c_str());
+        return;
+    }
+
+    decoder = open_decoder(v1);
+    for (uint32_t i=0; i<TRACE_READ_AHEAD_CHUNKS; i++)
+        chunk[i].data = new uint8_t[(size_t)TRACE_CHUNK_RECORDS * RECORD_SIZE];
+
+    worker = std::thread(&TRACE_READER::decode_loop, this);
+}
+
+TRACE_READER::~TRACE_READER()
+{
+    if (image) {
+        munmap(image - TRACE_CACHE_HEADER_SIZE, image_bytes);
+        return;
+    }
+    // the ring belongs to the parent
+    if (ring)
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+    }
+    chunk_empty.notify_all();
+    worker.join();
+
+    for (uint32_t i=0; i<TRACE_READ_AHEAD_CHUNKS; i++)
+        delete[] chunk[i].data;
+    delete decoder;
+}
+
+void TRACE_READER::open_trace_cache(const char *trace_name, const char *cache_dir)
+{
+    TRACE_CACHE_HEADER expected;
+    memset(&expected, 0, sizeof(expected));
+    strncpy(expected.magic, TRACE_CACHE_MAGIC, sizeof(expected.magic));
+    expected.version = TRACE_CACHE_VERSION;
+    expected.record_size = RECORD_SIZE;
+
+    // checksum of the compressed source, so a changed or different trace is never replayed from a stale image
+    FILE *source = fopen(trace_name, "rb");
+    if (source == NULL) {
+        cerr << "*** CANNOT OPEN TRACE FILE: " << trace_name << " ***" << endl;
+        assert(0);
+    }
+    uint8_t *buf = new uint8_t[TRACE_INPUT_BUFFER_SIZE];
+    uLong crc = crc32(0L, Z_NULL, 0);
+    size_t bytes;
+    while ((bytes = fread(buf, 1, TRACE_INPUT_BUFFER_SIZE, source)) > 0) {
+        crc = crc32(crc, buf, bytes);
+        expected.source_size += bytes;
+    }
+    expected.source_crc = crc;
+    fclose(source);
+    delete[] buf;
+
+    // the record size is part of the name, so the cloudsuite and standard images of a trace can coexist
+    const char *base_name = strrchr(trace_name, '/');
+    base_name = base_name ? base_name + 1 : trace_name;
+    string image_name = string(cache_dir) + "/" + base_name + ".r" + to_string(RECORD_SIZE) + ".champsimcache";
+
+    // only one of the jobs sharing a cache directory builds a given image, the others wait for it
+    string lock_name = image_name + ".lock";
+    int lock_fd = open(lock_name.c_str(), O_RDWR | O_CREAT, 0666);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX) < 0) {
+        cerr << "*** CANNOT LOCK TRACE CACHE: " << lock_name << " ***" << endl;
+        assert(0);
+    }
+
+    if (!map_trace_cache(image_name.c_str(), expected)) {
+        build_trace_cache(trace_name, image_name.c_str(), expected);
+        if (!map_trace_cache(image_name.c_str(), expected)) {
+            cerr << "*** CANNOT MAP TRACE CACHE: " << image_name << " ***" << endl;
+            assert(0);
+        }
+    }
+
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
+
+    cout << "trace cache " << image_name << " records " << image_records << endl;
+}
+
+bool TRACE_READER::map_trace_cache(const char *image_name, const TRACE_CACHE_HEADER &expected)
+{
+    int fd = open(image_name, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    TRACE_CACHE_HEADER header;
+    if (fstat(fd, &st) < 0
+        || (size_t)st.st_size < TRACE_CACHE_HEADER_SIZE
+        || pread(fd, &header, sizeof(header), 0) != sizeof(header)
+        || memcmp(header.magic, expected.magic, sizeof(header.magic))
+        || header.version != expected.version
+        || header.record_size != expected.record_size
+        || header.source_crc != expected.source_crc
+        || header.source_size != expected.source_size
+        || header.num_records == 0
+        || (uint64_t)st.st_size != TRACE_CACHE_HEADER_SIZE + header.num_records * header.record_size) {
+        cout << "trace cache " << image_name << " is missing or stale" << endl;
+        close(fd);
+        return false;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return false;
+
+    image = (uint8_t *)base + TRACE_CACHE_HEADER_SIZE;
+    image_records = header.num_records;
+    image_bytes = st.st_size;
+    return true;
+}
+
+void TRACE_READER::build_trace_cache(const char *trace_name, const char *image_name, const TRACE_CACHE_HEADER &expected)
+{
+    cout << "building trace cache " << image_name << endl;
+
+    // written under a private name and renamed into place once complete
+    string tmp_name = string(image_name) + ".tmp." + to_string(getpid());
+    FILE *out = fopen(tmp_name.c_str(), "wb");
+    if (out == NULL) {
+        cerr << "*** CANNOT CREATE TRACE CACHE: " << tmp_name << " ***" << endl;
+        assert(0);
+    }
+
+    TRACE_CACHE_HEADER header = expected;
+    uint8_t *page = new uint8_t[TRACE_CACHE_HEADER_SIZE]();
+    fwrite(page, 1, TRACE_CACHE_HEADER_SIZE, out);
+
+    TRACE_DECODER *source = open_decoder(trace_name);
+    const size_t chunk_bytes = (size_t)TRACE_CHUNK_RECORDS * RECORD_SIZE;
+    uint8_t *buf = new uint8_t[chunk_bytes];
+    bool end_of_trace = false;
+    while (!end_of_trace) {
+        size_t bytes = 0;
+        while (bytes < chunk_bytes) {
+            size_t n = source->read(buf + bytes, chunk_bytes - bytes);
+            if (n == 0) {
+                // a partial record at the end of the trace is dropped
+                end_of_trace = true;
+                break;
+            }
+            bytes += n;
+        }
+
+        uint64_t num_records = bytes / RECORD_SIZE;
+        if (fwrite(buf, RECORD_SIZE, num_records, out) != num_records) {
+            cerr << "*** CANNOT WRITE TRACE CACHE: " << tmp_name << " ***" << endl;
+            assert(0);
+        }
+        header.num_records += num_records;
+    }
+    delete source;
+    delete[] buf;
+
+    memcpy(page, &header, sizeof(header));
+    fseek(out, 0, SEEK_SET);
+    fwrite(page, 1, TRACE_CACHE_HEADER_SIZE, out);
+    delete[] page;
+
+    if (fclose(out) != 0 || rename(tmp_name.c_str(), image_name) != 0) {
+        cerr << "*** CANNOT WRITE TRACE CACHE: " << image_name << " ***" << endl;
+        assert(0);
+    }
+}
+
+void TRACE_READER::decode_loop()
+{
+    const size_t chunk_bytes = (size_t)TRACE_CHUNK_RECORDS * RECORD_SIZE;
+    uint64_t records_since_rewind = 0;
+
+    while (1) {
+        CHUNK *c = &chunk[write_index];
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            chunk_empty.wait(guard, [this, c] { return stop || !c->full; });
+            if (stop)
+                return;
+        }
+
+        // the chunk is owned by this thread until it is marked full
+        size_t bytes = 0;
+        c->end_of_trace = false;
+        while (bytes < chunk_bytes) {
+            size_t n = decoder->read(c->data + bytes, chunk_bytes - bytes);
+            if (n == 0) {
+                // a partial record at the end of the trace is dropped, as fread() did
+                c->end_of_trace = true;
+                break;
+            }
+            bytes += n;
+        }
+        c->num_records = bytes / RECORD_SIZE;
+        records_since_rewind += c->num_records;
+
+        if (c->end_of_trace) {
+            if (records_since_rewind == 0) {
+                cerr << endl << "*** TRACE FILE CONTAINS NO INSTRUCTIONS: " << decoder->NAME << " ***" << endl;
+                assert(0);
+            }
+            decoder->rewind();
+            records_since_rewind = 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            c->full = true;
+        }
+        chunk_full.notify_one();
+
+        write_index++;
+        if (write_index == TRACE_READ_AHEAD_CHUNKS)
+            write_index = 0;
+    }
+}
+
+const uint8_t *TRACE_READER::next_record()
+{
+    if (image) {
+        if (image_pos == image_records) {
+            image_pos = 0;
+            return NULL;
+        }
+        return image + (image_pos++) * RECORD_SIZE;
+    }
+    if (ring)
+        return next_ring_record();
+
+    while (current == NULL || read_pos == current->num_records) {
+        if (current) {
+            if (current->end_of_trace && !end_reported) {
+                end_reported = true;
+                records_read = 0;
+                return NULL;
+            }
+
+            // hand the drained chunk back to the decoder
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                current->full = false;
+            }
+            chunk_empty.notify_one();
+
+            read_index++;
+            if (read_index == TRACE_READ_AHEAD_CHUNKS)
+                read_index = 0;
+        }
+
+        CHUNK *c = &chunk[read_index];
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            chunk_full.wait(guard, [c] { return c->full; });
+        }
+        current = c;
+        read_pos = 0;
+        end_reported = false;
+    }
+
+    records_read++;
+    return current->data + (size_t)(read_pos++) * RECORD_SIZE;
+}
+
+// mirrors the chunk ring walk above, with the chunks released to the parent process
+const uint8_t *TRACE_READER::next_ring_record()
+{
+    while (ring_data == NULL || read_pos == ring->num_records[ring_seq % TRACE_FANOUT_CHUNKS]) {
+        if (ring_data) {
+            if (ring->end_of_trace[ring_seq % TRACE_FANOUT_CHUNKS] && !end_reported) {
+                end_reported = true;
+                records_read = 0;
+                return NULL;
+            }
+
+            ring_seq++;
+            ring->consumed[trace_fanout->consumer].store(ring_seq, memory_order_release);
+        }
+
+        uint32_t spins = 0;
+        while (ring->produced.load(memory_order_acquire) <= ring_seq)
+            fanout_backoff(spins);
+        ring_data = ring->chunk_data(ring_seq);
+        read_pos = 0;
+        end_reported = false;
+    }
+
+    records_read++;
+    return ring_data + (size_t)(read_pos++) * RECORD_SIZE;
+}
+
+uint64_t TRACE_READER::position()
+{
+    return image ? image_pos : records_read;
+}
+
+void TRACE_READER::skip(uint64_t num_records)
+{
+    if (image) {
+        assert(num_records <= image_records);
+        image_pos = num_records;
+        return;
+    }
+
+    for (uint64_t i=0; i<num_records; i++) {
+        if (next_record() == NULL) {
+            cerr << "*** TRACE IS SHORTER THAN THE CHECKPOINTED POSITION ***" << endl;
+            assert(0);
+        }
+    }
+}
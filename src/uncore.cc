@@ -1,4 +1,5 @@
 #include "uncore.h"
+#include "checkpoint.h"
 
 // uncore
 UNCORE uncore;
@@ -6,4 +7,117 @@ UNCORE uncore;
 // constructor
 UNCORE::UNCORE() {
 	cycle = 0;
+
+	for (uint32_t i=0; i<NUM_CPUS; i++)
+		port[i].llc = &LLC;
+}
+
+void UNCORE::checkpoint(CHECKPOINT &cp)
+{
+    LLC.checkpoint(cp);
+    LLC.llc_checkpoint_replacement(cp);
+    DRAM.checkpoint(cp);
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        port[i].checkpoint(cp);
+
+    cp.scalar(cycle);
+}
+
+int LLC_PORT::add_rq(PACKET *packet)
+{
+    return enqueue(1, packet);
+}
+
+int LLC_PORT::add_wq(PACKET *packet)
+{
+    return enqueue(2, packet);
+}
+
+int LLC_PORT::add_pq(PACKET *packet)
+{
+    return enqueue(3, packet);
+}
+
+int LLC_PORT::enqueue(uint8_t queue_type, PACKET *packet)
+{
+    pending.push_back(*packet);
+    pending_queue.push_back(queue_type);
+    num_pending[queue_type]++;
+
+    return -1;
+}
+
+void LLC_PORT::return_data(PACKET *packet)
+{
+    // the LLC returns data straight to the L2C of the requesting core
+    cerr << "*** LLC_PORT CANNOT RETURN DATA instr_id: " << packet->instr_id << " ***" << endl;
+    assert(0);
+}
+
+void LLC_PORT::operate()
+{
+}
+
+void LLC_PORT::increment_WQ_FULL(uint64_t address)
+{
+    wq_full++;
+}
+
+uint32_t LLC_PORT::get_occupancy(uint8_t queue_type, uint64_t address)
+{
+    // the LLC itself does not change while the cores run, so this core sees it as of the end of the last cycle
+    // plus whatever it has issued since, and the L2C compares the result against get_size() for equality
+    uint32_t occupancy = llc->get_occupancy(queue_type, address) + num_pending[queue_type],
+             size = llc->get_size(queue_type, address);
+
+    return (occupancy > size) ? size : occupancy;
+}
+
+uint32_t LLC_PORT::get_size(uint8_t queue_type, uint64_t address)
+{
+    return llc->get_size(queue_type, address);
+}
+
+void LLC_PORT::drain()
+{
+    llc->WQ.FULL += wq_full;
+    wq_full = 0;
+
+    // a request that finds its LLC queue full holds back all later ones headed for the same queue,
+    // as the L2C would have done had it seen the queue full
+    uint8_t blocked[4] = {0, 0, 0, 0};
+    uint32_t kept = 0;
+    for (uint32_t i=0; i<pending.size(); i++) {
+        uint8_t queue_type = pending_queue[i];
+        if ((blocked[queue_type] == 0) && (llc->get_occupancy(queue_type, pending[i].address) == llc->get_size(queue_type, pending[i].address)))
+            blocked[queue_type] = 1;
+
+        if (blocked[queue_type]) {
+            if (kept != i) {
+                pending[kept] = pending[i];
+                pending_queue[kept] = queue_type;
+            }
+            kept++;
+            continue;
+        }
+
+        if (queue_type == 1)
+            llc->add_rq(&pending[i]);
+        else if (queue_type == 2)
+            llc->add_wq(&pending[i]);
+        else
+            llc->add_pq(&pending[i]);
+        num_pending[queue_type]--;
+    }
+
+    pending.resize(kept);
+    pending_queue.resize(kept);
+}
+
+void LLC_PORT::checkpoint(CHECKPOINT &cp)
+{
+    cp.vector_entries(pending);
+    cp.vector_entries(pending_queue);
+    cp.array(num_pending, 4);
+    cp.scalar(wq_full);
 }
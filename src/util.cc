@@ -19,28 +19,6 @@ void gen_random(char *s, const int len)
     s[len] = 0;
 }
 
-uint32_t folded_xor(uint64_t value, uint32_t num_folds)
-{
-	assert(num_folds > 1);
-	assert((num_folds & (num_folds-1)) == 0); /* has to be power of 2 */
-	uint32_t mask = 0;
-	uint32_t bits_in_fold = 64/num_folds;
-	if(num_folds == 2)
-	{
-		mask = 0xffffffff;
-	}
-	else
-	{
-		mask = (1ul << bits_in_fold) - 1;
-	}
-	uint32_t folded_value = 0;
-	for(uint32_t fold = 0; fold < num_folds; ++fold)
-	{
-		folded_value = folded_value ^ ((value >> (fold * bits_in_fold)) & mask);
-	}
-	return folded_value;
-}
-
 uint32_t HashZoo::jenkins(uint32_t key)
 {
     // Robert Jenkins' 32 bit mix function
@@ -205,53 +183,60 @@ uint32_t HashZoo::four_hybrid10(uint32_t key) { return Wang3shift(jenkins32(knut
 uint32_t HashZoo::four_hybrid11(uint32_t key) { return hash5shift(hash32shiftmult(hash32shift(jenkins32(key)))); }
 uint32_t HashZoo::four_hybrid12(uint32_t key) { return Wang4shift(Wang3shift(jenkins(hash7shift(key)))); }
 
-uint32_t HashZoo::getHash(uint32_t selector, uint32_t key)
+uint32_t HashZoo::identity(uint32_t key) { return key; }
+
+HashZoo::hash_fn HashZoo::getHashFunction(uint32_t selector)
 {
     switch(selector)
     {
-        case 1:     return key;
-        case 2:     return jenkins(key);
-        case 3:     return knuth(key);
-        case 4:     return murmur3(key);
-        case 5:     return jenkins32(key);
-        case 6:     return hash32shift(key);
-        case 7:     return hash32shiftmult(key);
-        case 8:     return hash64shift(key);
-        case 9:     return hash5shift(key);
-        case 10:    return hash7shift(key);
-        case 11:    return Wang6shift(key);
-        case 12:    return Wang5shift(key);
-        case 13:    return Wang4shift(key);
-        case 14:    return Wang3shift(key);
+        case 1:     return identity;
+        case 2:     return jenkins;
+        case 3:     return knuth;
+        case 4:     return murmur3;
+        case 5:     return jenkins32;
+        case 6:     return hash32shift;
+        case 7:     return hash32shiftmult;
+        case 8:     return hash64shift;
+        case 9:     return hash5shift;
+        case 10:    return hash7shift;
+        case 11:    return Wang6shift;
+        case 12:    return Wang5shift;
+        case 13:    return Wang4shift;
+        case 14:    return Wang3shift;
         
         /* three hybrid */
-        case 101:  return three_hybrid1(key);
-        case 102:  return three_hybrid2(key);
-        case 103:  return three_hybrid3(key);
-        case 104:  return three_hybrid4(key);
-        case 105:  return three_hybrid5(key);
-        case 106:  return three_hybrid6(key);
-        case 107:  return three_hybrid7(key);
-        case 108:  return three_hybrid8(key);
-        case 109:  return three_hybrid9(key);
-        case 110:  return three_hybrid10(key);
-        case 111:  return three_hybrid11(key);
-        case 112:  return three_hybrid12(key);
+        case 101:  return three_hybrid1;
+        case 102:  return three_hybrid2;
+        case 103:  return three_hybrid3;
+        case 104:  return three_hybrid4;
+        case 105:  return three_hybrid5;
+        case 106:  return three_hybrid6;
+        case 107:  return three_hybrid7;
+        case 108:  return three_hybrid8;
+        case 109:  return three_hybrid9;
+        case 110:  return three_hybrid10;
+        case 111:  return three_hybrid11;
+        case 112:  return three_hybrid12;
 
         /* four hybrid */
-        case 1001:  return four_hybrid1(key);
-        case 1002:  return four_hybrid2(key);
-        case 1003:  return four_hybrid3(key);
-        case 1004:  return four_hybrid4(key);
-        case 1005:  return four_hybrid5(key);
-        case 1006:  return four_hybrid6(key);
-        case 1007:  return four_hybrid7(key);
-        case 1008:  return four_hybrid8(key);
-        case 1009:  return four_hybrid9(key);
-        case 1010:  return four_hybrid10(key);
-        case 1011:  return four_hybrid11(key);
-        case 1012:  return four_hybrid12(key);
-
-        default:    assert(false);
+        case 1001:  return four_hybrid1;
+        case 1002:  return four_hybrid2;
+        case 1003:  return four_hybrid3;
+        case 1004:  return four_hybrid4;
+        case 1005:  return four_hybrid5;
+        case 1006:  return four_hybrid6;
+        case 1007:  return four_hybrid7;
+        case 1008:  return four_hybrid8;
+        case 1009:  return four_hybrid9;
+        case 1010:  return four_hybrid10;
+        case 1011:  return four_hybrid11;
+        case 1012:  return four_hybrid12;
+
+        default:    assert(false); return NULL;
     }
+}
+
+uint32_t HashZoo::getHash(uint32_t selector, uint32_t key)
+{
+    return getHashFunction(selector)(key);
 }
\ No newline at end of file